@@ -28,6 +28,8 @@ VKD3D_DECL_CONFIG("pipeline_library_ignore_mismatch_driver", PIPELINE_LIBRARY_IG
 VKD3D_DECL_CONFIG("breadcrumbs", BREADCRUMBS)
 VKD3D_DECL_CONFIG("pipeline_library_app_cache", PIPELINE_LIBRARY_APP_CACHE_ONLY)
 VKD3D_DECL_CONFIG("shader_cache_sync", SHADER_CACHE_SYNC)
+VKD3D_DECL_CONFIG("shader_cache_indexed", SHADER_CACHE_INDEXED)
+VKD3D_DECL_CONFIG("pipeline_async_fallback", PIPELINE_ASYNC_FALLBACK)
 VKD3D_DECL_CONFIG("force_raw_va_cbv", FORCE_RAW_VA_CBV)
 VKD3D_DECL_CONFIG("dxr12", DXR_1_2)
 VKD3D_DECL_CONFIG("allow_sbt_collection", ALLOW_SBT_COLLECTION)
@@ -70,3 +72,5 @@ VKD3D_DECL_CONFIG("rtas_allow_blas_rebuild_sizes", RTAS_ALLOW_BLAS_REBUILD_SIZES
 VKD3D_DECL_CONFIG_PLAIN(REQUIRE_INPUT_ATTACHMENTS)
 VKD3D_DECL_CONFIG("disallow_committed_texture_suballocation", DISALLOW_COMMITTED_TEXTURE_SUBALLOCATION)
 VKD3D_DECL_CONFIG("allow_image_heap_suballocation", ALLOW_IMAGE_HEAP_SUBALLOCATION)
+VKD3D_DECL_CONFIG("no_bundle_optimize", NO_BUNDLE_OPTIMIZE)
+VKD3D_DECL_CONFIG("shader_cache_shared", SHADER_CACHE_SHARED)
@@ -21,10 +21,27 @@
 
 #ifdef __SSE2__
 #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
 #endif
+#include <stddef.h>
 #include <stdint.h>
 #include <memory.h>
 
+/* Descriptor copies are always a multiple of 16 bytes and 16 byte aligned.
+ * Strides are 16, 32 or 64 bytes in practice, so the fixed size variants are the hot ones.
+ * Vector width is a compile-time decision. SSE2 and NEON are baseline on the targets we care about,
+ * and wider vectors do not help since these copies are bound by store bandwidth into
+ * write-combined memory (or by cache misses on the source for scattered copies). */
+
+#if defined(__SSE2__)
+#define vkd3d_prefetch(ptr) _mm_prefetch((const char *)(ptr), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define vkd3d_prefetch(ptr) __builtin_prefetch(ptr)
+#else
+#define vkd3d_prefetch(ptr) ((void)(ptr))
+#endif
+
 #ifdef __SSE2__
 
 #define vkd3d_memcpy_aligned_64_non_temporal(dst, src) do { \
@@ -79,13 +96,52 @@
     _mm_store_si128((__m128i *)(dst), a); \
 } while(0)
 
+#define vkd3d_memcpy_non_temporal_barrier() _mm_sfence()
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+
+/* There is no non-temporal store intrinsic, so these are plain stores.
+ * Write-combined memory is still written in full lines since the stores are back to back. */
+#define vkd3d_memcpy_aligned_64_cached(dst, src) do { \
+    uint8x16_t a, b, c, d; \
+    a = vld1q_u8((const uint8_t *)(src) + 0); \
+    b = vld1q_u8((const uint8_t *)(src) + 16); \
+    c = vld1q_u8((const uint8_t *)(src) + 32); \
+    d = vld1q_u8((const uint8_t *)(src) + 48); \
+    vst1q_u8((uint8_t *)(dst) + 0, a); \
+    vst1q_u8((uint8_t *)(dst) + 16, b); \
+    vst1q_u8((uint8_t *)(dst) + 32, c); \
+    vst1q_u8((uint8_t *)(dst) + 48, d); \
+} while(0)
+
+#define vkd3d_memcpy_aligned_32_cached(dst, src) do { \
+    uint8x16_t a, b; \
+    a = vld1q_u8((const uint8_t *)(src) + 0); \
+    b = vld1q_u8((const uint8_t *)(src) + 16); \
+    vst1q_u8((uint8_t *)(dst) + 0, a); \
+    vst1q_u8((uint8_t *)(dst) + 16, b); \
+} while(0)
+
+#define vkd3d_memcpy_aligned_16_cached(dst, src) \
+    vst1q_u8((uint8_t *)(dst), vld1q_u8((const uint8_t *)(src)))
+
+#define vkd3d_memcpy_aligned_64_non_temporal(dst, src) vkd3d_memcpy_aligned_64_cached(dst, src)
+#define vkd3d_memcpy_aligned_32_non_temporal(dst, src) vkd3d_memcpy_aligned_32_cached(dst, src)
+#define vkd3d_memcpy_aligned_16_non_temporal(dst, src) vkd3d_memcpy_aligned_16_cached(dst, src)
+#define vkd3d_memcpy_non_temporal_barrier() ((void)0)
+#endif
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(_M_ARM64)
+/* Copy full 64 byte lines where possible so loads can be issued ahead of the stores,
+ * and each write-combining buffer is filled in one go. */
 static inline void vkd3d_memcpy_aligned_non_temporal(void *dst_, const void *src_, size_t size)
 {
     const uint8_t *src = src_;
     uint8_t *dst = dst_;
-    size_t i;
+    size_t i = 0;
 
-    for (i = 0; i < size; i += 16)
+    for (; i + 64 <= size; i += 64)
+        vkd3d_memcpy_aligned_64_non_temporal(dst + i, src + i);
+    for (; i < size; i += 16)
         vkd3d_memcpy_aligned_16_non_temporal(dst + i, src + i);
 }
 
@@ -93,13 +149,13 @@ static inline void vkd3d_memcpy_aligned_cached(void *dst_, const void *src_, siz
 {
     const uint8_t *src = src_;
     uint8_t *dst = dst_;
-    size_t i;
+    size_t i = 0;
 
-    for (i = 0; i < size; i += 16)
+    for (; i + 64 <= size; i += 64)
+        vkd3d_memcpy_aligned_64_cached(dst + i, src + i);
+    for (; i < size; i += 16)
         vkd3d_memcpy_aligned_16_cached(dst + i, src + i);
 }
-
-#define vkd3d_memcpy_non_temporal_barrier() _mm_sfence()
 #else
 #define vkd3d_memcpy_aligned_64_non_temporal(dst, src) memcpy((uint8_t *)(dst), (const uint8_t *)(src), 64)
 #define vkd3d_memcpy_aligned_32_non_temporal(dst, src) memcpy((uint8_t *)(dst), (const uint8_t *)(src), 32)
@@ -112,4 +168,14 @@ static inline void vkd3d_memcpy_aligned_cached(void *dst_, const void *src_, siz
 #define vkd3d_memcpy_non_temporal_barrier() ((void)0)
 #endif
 
+/* Stores bypass the cache. Use this when the destination is write-combined or uncached. */
+#define VKD3D_COPY_ROWS_NON_TEMPORAL (1u << 0)
+
+/* Copies row_count rows of row_size bytes in each of slice_count slices. Unlike the helpers above,
+ * there are no alignment requirements. Rows are merged into larger copies where the pitches allow it,
+ * and large copies are split across a few threads. Source and destination must not overlap. */
+void vkd3d_copy_rows(uint8_t *dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+        const uint8_t *src, size_t src_row_pitch, size_t src_slice_pitch,
+        size_t row_size, unsigned int row_count, unsigned int slice_count, uint32_t flags);
+
 #endif
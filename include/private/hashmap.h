@@ -22,7 +22,13 @@
 #define __VKD3D_HASHMAP_H
 
 #include <stddef.h>
+#include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "vkd3d_common.h"
 #include "vkd3d_memory.h"
 
 enum hash_map_entry_flag
@@ -40,17 +46,39 @@ typedef uint32_t (*pfn_hash_func)(const void* key);
 typedef bool (*pfn_hash_compare_func)(const void *key, const struct hash_map_entry *entry);
 typedef void (*pfn_hash_map_iterator)(struct hash_map_entry *entry, void *userdata);
 
-/* Open-addressing hash table */
+/* Open-addressing hash table with linear probing and power-of-two capacity.
+ * Next to the entries, there is one control byte per slot holding 7 bits of the hash,
+ * so probing can test a whole group of slots against the key at once,
+ * and the comparison callback is only invoked for likely matches.
+ * Entries are only moved when the table grows or when an entry is removed. */
 struct hash_map
 {
     pfn_hash_func hash_func;
     pfn_hash_compare_func compare_func;
     void *entries;
+    uint8_t *control;
     size_t entry_size;
     uint32_t entry_count;
     uint32_t used_count;
 };
 
+#define HASH_MAP_GROUP_SIZE 16u
+#define HASH_MAP_MIN_SIZE 16u
+#define HASH_MAP_CONTROL_EMPTY 0x80u
+
+/* Many of our hashes are fairly weak in the low bits, so spread them out (Fibonacci hashing)
+ * and take the slot index from the upper bits. The control tag is taken from the low bits,
+ * which keeps it mostly independent of the slot index. */
+static inline uint32_t hash_map_mix(uint32_t hash_value)
+{
+    return hash_value * 0x9e3779b1u;
+}
+
+static inline uint8_t hash_map_control_tag(uint32_t hash_value)
+{
+    return hash_map_mix(hash_value) & 0x7f;
+}
+
 static inline struct hash_map_entry *hash_map_get_entry(const struct hash_map *hash_map, uint32_t entry_idx)
 {
     return void_ptr_offset(hash_map->entries, hash_map->entry_size * entry_idx);
@@ -58,56 +86,97 @@ static inline struct hash_map_entry *hash_map_get_entry(const struct hash_map *h
 
 static inline uint32_t hash_map_get_entry_idx(const struct hash_map *hash_map, uint32_t hash_value)
 {
-    return hash_value % hash_map->entry_count;
+    return hash_map_mix(hash_value) >> (32 - vkd3d_log2i(hash_map->entry_count));
 }
 
 static inline uint32_t hash_map_next_entry_idx(const struct hash_map *hash_map, uint32_t entry_idx)
 {
-    uint32_t next_idx = entry_idx + 1;
-    return next_idx < hash_map->entry_count ? next_idx : 0;
+    return (entry_idx + 1) & (hash_map->entry_count - 1);
+}
+
+static inline void hash_map_set_control(struct hash_map *hash_map, uint32_t entry_idx, uint8_t value)
+{
+    hash_map->control[entry_idx] = value;
+
+    /* The first group is mirrored past the end so that groups can be loaded
+     * without caring about wrap-around. */
+    if (entry_idx < HASH_MAP_GROUP_SIZE - 1)
+        hash_map->control[hash_map->entry_count + entry_idx] = value;
+}
+
+/* Returns a bitmask of the slots in the group starting at entry_idx with the given control byte. */
+static inline uint32_t hash_map_match_group(const struct hash_map *hash_map, uint32_t entry_idx, uint8_t value)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)(hash_map->control + entry_idx));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#else
+    const uint8_t *group = hash_map->control + entry_idx;
+    uint32_t i, mask = 0;
+
+    for (i = 0; i < HASH_MAP_GROUP_SIZE; i++)
+        if (group[i] == value)
+            mask |= 1u << i;
+
+    return mask;
+#endif
 }
 
 static inline uint32_t hash_map_next_size(uint32_t old_size)
 {
-    /* This yields a sequence of primes and numbers with two
-     * relatively large prime factors for any reasonable hash
-     * table size */
-    return old_size ? (old_size * 2 + 5) : 37;
+    return old_size ? old_size * 2 : HASH_MAP_MIN_SIZE;
+}
+
+static inline bool hash_map_allocate(struct hash_map *hash_map, uint32_t entry_count)
+{
+    size_t entries_size = entry_count * hash_map->entry_size;
+    void *entries;
+
+    if (!(entries = vkd3d_calloc(1, entries_size + entry_count + HASH_MAP_GROUP_SIZE)))
+        return false;
+
+    hash_map->entries = entries;
+    hash_map->control = void_ptr_offset(entries, entries_size);
+    hash_map->entry_count = entry_count;
+    memset(hash_map->control, HASH_MAP_CONTROL_EMPTY, entry_count + HASH_MAP_GROUP_SIZE);
+    return true;
+}
+
+/* Finds the first empty slot in probe order, starting at the home slot of hash_value. */
+static inline uint32_t hash_map_find_empty_idx(const struct hash_map *hash_map, uint32_t hash_value)
+{
+    uint32_t entry_idx = hash_map_get_entry_idx(hash_map, hash_value);
+    uint32_t empty_mask;
+
+    /* We never allow the hash table to be completely populated, so this is guaranteed to terminate */
+    while (!(empty_mask = hash_map_match_group(hash_map, entry_idx, HASH_MAP_CONTROL_EMPTY)))
+        entry_idx = (entry_idx + HASH_MAP_GROUP_SIZE) & (hash_map->entry_count - 1);
+
+    return (entry_idx + vkd3d_bitmask_tzcnt32(empty_mask)) & (hash_map->entry_count - 1);
 }
 
 static inline bool hash_map_grow(struct hash_map *hash_map)
 {
-    uint32_t i, old_count, new_count;
-    void *new_entries, *old_entries;
+    uint32_t i, old_count, entry_idx;
+    struct hash_map_entry *old_entry;
+    void *old_entries;
 
     old_count = hash_map->entry_count;
     old_entries = hash_map->entries;
 
-    new_count = hash_map_next_size(hash_map->entry_count);
-
-    if (!(new_entries = vkd3d_calloc(new_count, hash_map->entry_size)))
+    if (!hash_map_allocate(hash_map, hash_map_next_size(old_count)))
         return false;
 
-    hash_map->entry_count = new_count;
-    hash_map->entries = new_entries;
-
     for (i = 0; i < old_count; i++)
     {
         /* Relocate existing entries one by one */
-        struct hash_map_entry *old_entry = void_ptr_offset(old_entries, i * hash_map->entry_size);
+        old_entry = void_ptr_offset(old_entries, i * hash_map->entry_size);
 
         if (old_entry->flags & HASH_MAP_ENTRY_OCCUPIED)
         {
-            uint32_t entry_idx = hash_map_get_entry_idx(hash_map, old_entry->hash_value);
-            struct hash_map_entry *new_entry = hash_map_get_entry(hash_map, entry_idx);
-
-            while (new_entry->flags & HASH_MAP_ENTRY_OCCUPIED)
-            {
-                entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
-                new_entry = hash_map_get_entry(hash_map, entry_idx);
-            }
-
-            memcpy(new_entry, old_entry, hash_map->entry_size);
+            entry_idx = hash_map_find_empty_idx(hash_map, old_entry->hash_value);
+            hash_map_set_control(hash_map, entry_idx, hash_map_control_tag(old_entry->hash_value));
+            memcpy(hash_map_get_entry(hash_map, entry_idx), old_entry, hash_map->entry_size);
         }
     }
 
@@ -121,69 +190,114 @@ static inline bool hash_map_should_grow_before_insert(struct hash_map *hash_map)
     return 10 * hash_map->used_count >= 7 * hash_map->entry_count;
 }
 
-static inline struct hash_map_entry *hash_map_find(const struct hash_map *hash_map, const void *key)
+static inline struct hash_map_entry *hash_map_find_with_hash(const struct hash_map *hash_map,
+        const void *key, uint32_t hash_value)
 {
-    uint32_t hash_value, entry_idx;
+    uint32_t entry_idx, match_mask, empty_mask;
+    struct hash_map_entry *entry;
+    uint8_t tag;
 
     if (!hash_map->entries)
         return NULL;
 
-    hash_value = hash_map->hash_func(key);
+    tag = hash_map_control_tag(hash_value);
     entry_idx = hash_map_get_entry_idx(hash_map, hash_value);
 
-    /* We never allow the hash table to be completely
-     * populated, so this is guaranteed to return */
     while (true)
     {
-        struct hash_map_entry *entry = hash_map_get_entry(hash_map, entry_idx);
+        match_mask = hash_map_match_group(hash_map, entry_idx, tag);
+        empty_mask = hash_map_match_group(hash_map, entry_idx, HASH_MAP_CONTROL_EMPTY);
 
-        if (!(entry->flags & HASH_MAP_ENTRY_OCCUPIED))
-            return NULL;
+        /* With linear probing, the key cannot live past the first empty slot. */
+        if (empty_mask)
+            match_mask &= (1u << vkd3d_bitmask_tzcnt32(empty_mask)) - 1;
 
-        if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
-            return entry;
+        while (match_mask)
+        {
+            entry = hash_map_get_entry(hash_map,
+                    (entry_idx + vkd3d_bitmask_iter32(&match_mask)) & (hash_map->entry_count - 1));
 
-        entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
+            if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
+                return entry;
+        }
+
+        if (empty_mask)
+            return NULL;
+
+        entry_idx = (entry_idx + HASH_MAP_GROUP_SIZE) & (hash_map->entry_count - 1);
     }
 }
 
+static inline struct hash_map_entry *hash_map_find(const struct hash_map *hash_map, const void *key)
+{
+    if (!hash_map->entries)
+        return NULL;
+
+    return hash_map_find_with_hash(hash_map, key, hash_map->hash_func(key));
+}
+
 static inline struct hash_map_entry *hash_map_insert(struct hash_map *hash_map, const void *key, const struct hash_map_entry *entry)
 {
-    struct hash_map_entry *target = NULL;
+    struct hash_map_entry *target;
     uint32_t hash_value, entry_idx;
 
+    hash_value = hash_map->hash_func(key);
+
+    /* If there is a match, we already have an entry in the hashmap.
+     * Return old one, caller is responsible for cleaning up the node we attempted to add. */
+    if ((target = hash_map_find_with_hash(hash_map, key, hash_value)))
+        return target;
+
     if (hash_map_should_grow_before_insert(hash_map))
     {
         if (!hash_map_grow(hash_map))
             return NULL;
     }
 
-    hash_value = hash_map->hash_func(key);
-    entry_idx = hash_map_get_entry_idx(hash_map, hash_value);
+    entry_idx = hash_map_find_empty_idx(hash_map, hash_value);
+    target = hash_map_get_entry(hash_map, entry_idx);
 
-    while (!target)
-    {
-        struct hash_map_entry *current = hash_map_get_entry(hash_map, entry_idx);
+    hash_map->used_count += 1;
+    hash_map_set_control(hash_map, entry_idx, hash_map_control_tag(hash_value));
+    target->flags = HASH_MAP_ENTRY_OCCUPIED;
+    target->hash_value = hash_value;
+    memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
+    return target;
+}
 
-        if (!(current->flags & HASH_MAP_ENTRY_OCCUPIED) ||
-                (current->hash_value == hash_value && hash_map->compare_func(key, current)))
-            target = current;
-        else
-            entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
-    }
+/* Removes an entry previously returned by hash_map_find() or hash_map_insert().
+ * Later entries in the probe sequence are shifted back rather than leaving a tombstone,
+ * so pointers to other entries may be invalidated. */
+static inline void hash_map_remove(struct hash_map *hash_map, struct hash_map_entry *entry)
+{
+    uint32_t hole_idx, entry_idx, home_idx;
+    struct hash_map_entry *current;
+
+    hole_idx = ((uintptr_t)entry - (uintptr_t)hash_map->entries) / hash_map->entry_size;
+    entry_idx = hole_idx;
 
-    if (!(target->flags & HASH_MAP_ENTRY_OCCUPIED))
+    while (true)
     {
-        hash_map->used_count += 1;
-        target->flags = HASH_MAP_ENTRY_OCCUPIED;
-        target->hash_value = hash_value;
-        memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
-    }
+        entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
+        if (hash_map->control[entry_idx] == HASH_MAP_CONTROL_EMPTY)
+            break;
 
-    /* If target is occupied, we already have an entry in the hashmap.
-     * Return old one, caller is responsible for cleaning up the node we attempted to add. */
+        current = hash_map_get_entry(hash_map, entry_idx);
+        home_idx = hash_map_get_entry_idx(hash_map, current->hash_value);
 
-    return target;
+        /* The entry can fill the hole if its home slot is not cyclically within (hole_idx, entry_idx]. */
+        if (((entry_idx - home_idx) & (hash_map->entry_count - 1)) >=
+                ((entry_idx - hole_idx) & (hash_map->entry_count - 1)))
+        {
+            memcpy(hash_map_get_entry(hash_map, hole_idx), current, hash_map->entry_size);
+            hash_map_set_control(hash_map, hole_idx, hash_map->control[entry_idx]);
+            hole_idx = entry_idx;
+        }
+    }
+
+    hash_map_get_entry(hash_map, hole_idx)->flags = 0;
+    hash_map_set_control(hash_map, hole_idx, HASH_MAP_CONTROL_EMPTY);
+    hash_map->used_count -= 1;
 }
 
 static inline void hash_map_iter(struct hash_map *hash_map, pfn_hash_map_iterator iterator, void *userdata)
@@ -204,6 +318,7 @@ static inline void hash_map_init(struct hash_map *hash_map, pfn_hash_func hash_f
     hash_map->hash_func = hash_func;
     hash_map->compare_func = compare_func;
     hash_map->entries = NULL;
+    hash_map->control = NULL;
     hash_map->entry_size = entry_size;
     hash_map->entry_count = 0;
     hash_map->used_count = 0;
@@ -221,6 +336,9 @@ static inline void hash_map_clear(struct hash_map *hash_map)
         memset(entry, 0, sizeof(*entry));
     }
 
+    if (hash_map->control)
+        memset(hash_map->control, HASH_MAP_CONTROL_EMPTY, hash_map->entry_count + HASH_MAP_GROUP_SIZE);
+
     hash_map->used_count = 0;
 }
 
@@ -228,6 +346,7 @@ static inline void hash_map_free(struct hash_map *hash_map)
 {
     vkd3d_free(hash_map->entries);
     hash_map->entries = NULL;
+    hash_map->control = NULL;
     hash_map->entry_count = 0;
     hash_map->used_count = 0;
 }
@@ -292,4 +411,112 @@ static inline uint64_t hash_fnv1_iterate_string(uint64_t h, const char *str)
     return h;
 }
 
+/* XXH64. Consumes 32 bytes per iteration over four independent 64-bit lanes, so unlike FNV-1
+ * it is not bound by the latency of a multiply per input byte. Used for bulk content hashing
+ * where the value is not user-visible. Input is read with memcpy, so it may be unaligned. */
+#define HASH_XXH64_PRIME1 0x9e3779b185ebca87ull
+#define HASH_XXH64_PRIME2 0xc2b2ae3d27d4eb4full
+#define HASH_XXH64_PRIME3 0x165667b19e3779f9ull
+#define HASH_XXH64_PRIME4 0x85ebca77c2b2ae63ull
+#define HASH_XXH64_PRIME5 0x27d4eb2f165667c5ull
+
+static inline uint64_t hash_xxh64_rotl(uint64_t x, unsigned int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_xxh64_read_u64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash_xxh64_read_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * HASH_XXH64_PRIME2;
+    acc = hash_xxh64_rotl(acc, 31);
+    return acc * HASH_XXH64_PRIME1;
+}
+
+static inline uint64_t hash_xxh64_merge_round(uint64_t acc, uint64_t lane)
+{
+    acc ^= hash_xxh64_round(0, lane);
+    return acc * HASH_XXH64_PRIME1 + HASH_XXH64_PRIME4;
+}
+
+static inline uint64_t hash_xxh64(const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = p + size;
+    uint64_t v1, v2, v3, v4;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        const uint8_t *limit = end - 32;
+
+        v1 = seed + HASH_XXH64_PRIME1 + HASH_XXH64_PRIME2;
+        v2 = seed + HASH_XXH64_PRIME2;
+        v3 = seed;
+        v4 = seed - HASH_XXH64_PRIME1;
+
+        do
+        {
+            v1 = hash_xxh64_round(v1, hash_xxh64_read_u64(p + 0));
+            v2 = hash_xxh64_round(v2, hash_xxh64_read_u64(p + 8));
+            v3 = hash_xxh64_round(v3, hash_xxh64_read_u64(p + 16));
+            v4 = hash_xxh64_round(v4, hash_xxh64_read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = hash_xxh64_rotl(v1, 1) + hash_xxh64_rotl(v2, 7) +
+                hash_xxh64_rotl(v3, 12) + hash_xxh64_rotl(v4, 18);
+        h = hash_xxh64_merge_round(h, v1);
+        h = hash_xxh64_merge_round(h, v2);
+        h = hash_xxh64_merge_round(h, v3);
+        h = hash_xxh64_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + HASH_XXH64_PRIME5;
+    }
+
+    h += size;
+
+    while (p + 8 <= end)
+    {
+        h ^= hash_xxh64_round(0, hash_xxh64_read_u64(p));
+        h = hash_xxh64_rotl(h, 27) * HASH_XXH64_PRIME1 + HASH_XXH64_PRIME4;
+        p += 8;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= hash_xxh64_read_u32(p) * HASH_XXH64_PRIME1;
+        h = hash_xxh64_rotl(h, 23) * HASH_XXH64_PRIME2 + HASH_XXH64_PRIME3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        h ^= *p++ * HASH_XXH64_PRIME5;
+        h = hash_xxh64_rotl(h, 11) * HASH_XXH64_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= HASH_XXH64_PRIME2;
+    h ^= h >> 29;
+    h *= HASH_XXH64_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
 #endif  /* __VKD3D_HASHMAP_H */
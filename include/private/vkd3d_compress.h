@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_COMPRESS_H
+#define __VKD3D_COMPRESS_H
+
+#include "vkd3d_common.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Simple LZ77 block codec in the spirit of LZ4. It is byte oriented and favors decode speed
+ * over ratio, which is what we want for pipeline cache payloads that are written once and read
+ * back on every application launch. Blocks are self-contained, there is no framing. */
+
+/* Worst case size of a compressed block for an input of size bytes. */
+static inline size_t vkd3d_lz_compress_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+/* Returns compressed size, or 0 if the output does not fit in dst_size.
+ * Callers are expected to store the data raw when compression does not make it smaller. */
+size_t vkd3d_lz_compress(void *dst, size_t dst_size, const void *src, size_t src_size);
+
+/* Decodes a block produced by vkd3d_lz_compress(). Fails if the stream is malformed
+ * or if it does not decode to exactly dst_size bytes. */
+bool vkd3d_lz_decompress(void *dst, size_t dst_size, const void *src, size_t src_size);
+
+#endif /* __VKD3D_COMPRESS_H */
@@ -20,6 +20,7 @@
 #define __VKD3D_FILE_UTILS_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 
@@ -32,11 +33,19 @@ struct vkd3d_memory_mapped_file
 /* On failure, ensures the struct is cleared to zero.
  * A reference to the file is kept through the memory mapping. */
 bool vkd3d_file_map_read_only(const char *path, struct vkd3d_memory_mapped_file *file);
+/* Maps the file read-write, shared with every other process mapping the same file.
+ * The file is created if needed and grown to at least size bytes, new space reads as zero.
+ * An existing larger file is mapped in full. On failure, ensures the struct is cleared to zero. */
+bool vkd3d_file_map_shared(const char *path, size_t size, struct vkd3d_memory_mapped_file *file);
 /* Clears out file on unmap. */
 void vkd3d_file_unmap(struct vkd3d_memory_mapped_file *file);
 bool vkd3d_file_rename_overwrite(const char *from_path, const char *to_path);
 bool vkd3d_file_rename_no_replace(const char *from_path, const char *to_path);
 bool vkd3d_file_delete(const char *path);
 FILE *vkd3d_file_open_exclusive_write(const char *path);
+/* Opaque value which changes whenever the file is modified or replaced. */
+bool vkd3d_file_query_identity(const char *path, uint64_t *identity);
+/* Time since the file was last modified. */
+bool vkd3d_file_query_age(const char *path, uint64_t *age_seconds);
 
 #endif
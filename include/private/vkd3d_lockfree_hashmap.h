@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_LOCKFREE_HASHMAP_H
+#define __VKD3D_LOCKFREE_HASHMAP_H
+
+#include <stddef.h>
+
+#include "vkd3d_atomic.h"
+#include "vkd3d_memory.h"
+
+/* Insert-only open-addressing hash map of entry pointers, meant for small read-mostly caches
+ * which are looked up on hot paths from many threads at once.
+ * Lookups do not take any locks. Inserts must be serialized by the caller.
+ * Entries are owned by the caller and must stay alive as long as the map does.
+ * When the map grows, the old storage is retired rather than freed, since readers may still be
+ * probing it. Since storage grows geometrically, this at most doubles the memory footprint. */
+
+struct vkd3d_lockfree_hash_map_entry
+{
+    uint32_t hash_value;
+};
+
+typedef bool (*pfn_vkd3d_lockfree_hash_map_compare_func)(const void *key,
+        const struct vkd3d_lockfree_hash_map_entry *entry);
+typedef void (*pfn_vkd3d_lockfree_hash_map_iterator)(struct vkd3d_lockfree_hash_map_entry *entry, void *userdata);
+
+struct vkd3d_lockfree_hash_map_storage
+{
+    struct vkd3d_lockfree_hash_map_storage *retired;
+    uint32_t used_count;
+    uint32_t mask;
+    struct vkd3d_lockfree_hash_map_entry *entries[];
+};
+
+struct vkd3d_lockfree_hash_map
+{
+    struct vkd3d_lockfree_hash_map_storage *storage;
+    pfn_vkd3d_lockfree_hash_map_compare_func compare_func;
+};
+
+#define VKD3D_LOCKFREE_HASH_MAP_INITIAL_SIZE 16
+
+static inline void vkd3d_lockfree_hash_map_init(struct vkd3d_lockfree_hash_map *hash_map,
+        pfn_vkd3d_lockfree_hash_map_compare_func compare_func)
+{
+    hash_map->storage = NULL;
+    hash_map->compare_func = compare_func;
+}
+
+static inline struct vkd3d_lockfree_hash_map_entry *vkd3d_lockfree_hash_map_find(
+        const struct vkd3d_lockfree_hash_map *hash_map, const void *key, uint32_t hash_value)
+{
+    struct vkd3d_lockfree_hash_map_storage *storage;
+    struct vkd3d_lockfree_hash_map_entry *entry;
+    uint32_t idx;
+
+    if (!(storage = vkd3d_atomic_ptr_load_explicit(&hash_map->storage, vkd3d_memory_order_acquire)))
+        return NULL;
+
+    /* Load factor is kept at or below 1/2, so there is always an empty slot to terminate the probe. */
+    for (idx = hash_value & storage->mask; ; idx = (idx + 1) & storage->mask)
+    {
+        if (!(entry = vkd3d_atomic_ptr_load_explicit(&storage->entries[idx], vkd3d_memory_order_acquire)))
+            return NULL;
+
+        if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
+            return entry;
+    }
+}
+
+static inline void vkd3d_lockfree_hash_map_storage_insert(struct vkd3d_lockfree_hash_map_storage *storage,
+        struct vkd3d_lockfree_hash_map_entry *entry)
+{
+    uint32_t idx = entry->hash_value & storage->mask;
+
+    while (storage->entries[idx])
+        idx = (idx + 1) & storage->mask;
+
+    /* Readers may observe the slot as soon as it is written, so the entry must be complete by now. */
+    vkd3d_atomic_ptr_store_explicit(&storage->entries[idx], entry, vkd3d_memory_order_release);
+    storage->used_count++;
+}
+
+/* The caller is responsible for holding a lock which serializes inserts,
+ * and for checking that the key is not already present. */
+static inline bool vkd3d_lockfree_hash_map_insert_locked(struct vkd3d_lockfree_hash_map *hash_map,
+        struct vkd3d_lockfree_hash_map_entry *entry)
+{
+    struct vkd3d_lockfree_hash_map_storage *storage = hash_map->storage;
+    struct vkd3d_lockfree_hash_map_storage *new_storage;
+    uint32_t new_size, i;
+
+    if (!storage || (storage->used_count + 1) * 2 > storage->mask + 1)
+    {
+        new_size = storage ? 2 * (storage->mask + 1) : VKD3D_LOCKFREE_HASH_MAP_INITIAL_SIZE;
+
+        if (!(new_storage = vkd3d_calloc(1, offsetof(struct vkd3d_lockfree_hash_map_storage, entries) +
+                new_size * sizeof(*new_storage->entries))))
+            return false;
+
+        new_storage->mask = new_size - 1;
+        new_storage->retired = storage;
+
+        if (storage)
+        {
+            for (i = 0; i <= storage->mask; i++)
+                if (storage->entries[i])
+                    vkd3d_lockfree_hash_map_storage_insert(new_storage, storage->entries[i]);
+        }
+
+        vkd3d_atomic_ptr_store_explicit(&hash_map->storage, new_storage, vkd3d_memory_order_release);
+        storage = new_storage;
+    }
+
+    vkd3d_lockfree_hash_map_storage_insert(storage, entry);
+    return true;
+}
+
+/* Not safe against concurrent inserts. */
+static inline void vkd3d_lockfree_hash_map_iter(struct vkd3d_lockfree_hash_map *hash_map,
+        pfn_vkd3d_lockfree_hash_map_iterator iterator, void *userdata)
+{
+    struct vkd3d_lockfree_hash_map_storage *storage = hash_map->storage;
+    uint32_t i;
+
+    if (!storage)
+        return;
+
+    for (i = 0; i <= storage->mask; i++)
+        if (storage->entries[i])
+            iterator(storage->entries[i], userdata);
+}
+
+static inline uint32_t vkd3d_lockfree_hash_map_count(const struct vkd3d_lockfree_hash_map *hash_map)
+{
+    return hash_map->storage ? hash_map->storage->used_count : 0;
+}
+
+/* Frees storage only. Entries are owned by the caller. */
+static inline void vkd3d_lockfree_hash_map_free(struct vkd3d_lockfree_hash_map *hash_map)
+{
+    struct vkd3d_lockfree_hash_map_storage *storage, *retired;
+
+    for (storage = hash_map->storage; storage; storage = retired)
+    {
+        retired = storage->retired;
+        vkd3d_free(storage);
+    }
+
+    hash_map->storage = NULL;
+}
+
+#endif /* __VKD3D_LOCKFREE_HASHMAP_H */
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_LOCKFREE_STACK_H
+#define __VKD3D_LOCKFREE_STACK_H
+
+#include <stdint.h>
+
+#include "vkd3d_atomic.h"
+
+/* Lock-free LIFO of slot indices into a caller-owned array.
+ * The links array holds the next index for every slot, and the head packs the top
+ * index + 1 in the low 32 bits (0 meaning empty) with an ABA tag in the high 32 bits.
+ * A slot must only be pushed by the thread which popped it, so several stacks can share
+ * one links array as long as every slot lives on at most one of them at a time. */
+
+#define VKD3D_LOCKFREE_STACK_INVALID (~0u)
+
+static inline void vkd3d_lockfree_stack_init(UINT64 *head)
+{
+    *head = 0;
+}
+
+static inline uint32_t vkd3d_lockfree_stack_pop(UINT64 *head, uint32_t *links)
+{
+    uint64_t old_head, new_head, prev_head;
+    uint32_t index;
+
+    old_head = vkd3d_atomic_uint64_load_explicit(head, vkd3d_memory_order_acquire);
+
+    for (;;)
+    {
+        if (!(index = (uint32_t)old_head))
+            return VKD3D_LOCKFREE_STACK_INVALID;
+
+        /* If another thread pops the slot under us, the link may be stale,
+         * but the tag has changed by then and the exchange fails. */
+        new_head = (((old_head >> 32) + 1) << 32) |
+                vkd3d_atomic_uint32_load_explicit(&links[index - 1], vkd3d_memory_order_relaxed);
+
+        prev_head = vkd3d_atomic_uint64_compare_exchange(head, old_head, new_head,
+                vkd3d_memory_order_acquire, vkd3d_memory_order_acquire);
+
+        if (prev_head == old_head)
+            return index - 1;
+
+        old_head = prev_head;
+    }
+}
+
+static inline void vkd3d_lockfree_stack_push(UINT64 *head, uint32_t *links, uint32_t index)
+{
+    uint64_t old_head, new_head, prev_head;
+
+    old_head = vkd3d_atomic_uint64_load_explicit(head, vkd3d_memory_order_relaxed);
+
+    for (;;)
+    {
+        vkd3d_atomic_uint32_store_explicit(&links[index], (uint32_t)old_head, vkd3d_memory_order_relaxed);
+        new_head = (((old_head >> 32) + 1) << 32) | (index + 1);
+
+        prev_head = vkd3d_atomic_uint64_compare_exchange(head, old_head, new_head,
+                vkd3d_memory_order_release, vkd3d_memory_order_relaxed);
+
+        if (prev_head == old_head)
+            return;
+
+        old_head = prev_head;
+    }
+}
+
+#endif /* __VKD3D_LOCKFREE_STACK_H */
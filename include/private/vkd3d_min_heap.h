@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_MIN_HEAP_H
+#define __VKD3D_MIN_HEAP_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vkd3d_common.h"
+
+/* Binary min-heap over a plain array of elements, ordered by a uint64_t key embedded in each element
+ * at key_offset. The caller owns the array and is responsible for reserving space before pushing.
+ * Elements are moved with memcpy, so they must not be referenced by pointer while in the heap. */
+
+#define VKD3D_MIN_HEAP_MAX_ELEMENT_SIZE 128
+
+static inline uint64_t vkd3d_min_heap_key(const void *elements, size_t index,
+        size_t element_size, size_t key_offset)
+{
+    uint64_t key;
+    memcpy(&key, (const uint8_t *)elements + index * element_size + key_offset, sizeof(key));
+    return key;
+}
+
+static inline void vkd3d_min_heap_push(void *elements, size_t *count,
+        size_t element_size, size_t key_offset, const void *element)
+{
+    uint8_t *base = elements;
+    size_t hole, parent;
+    uint64_t key;
+
+    memcpy(&key, (const uint8_t *)element + key_offset, sizeof(key));
+
+    /* Sift the hole up, then drop the new element into it. */
+    for (hole = (*count)++; hole; hole = parent)
+    {
+        parent = (hole - 1) / 2;
+        if (vkd3d_min_heap_key(base, parent, element_size, key_offset) <= key)
+            break;
+        memcpy(base + hole * element_size, base + parent * element_size, element_size);
+    }
+
+    memcpy(base + hole * element_size, element, element_size);
+}
+
+/* Heap must not be empty. */
+static inline void vkd3d_min_heap_pop(void *elements, size_t *count,
+        size_t element_size, size_t key_offset, void *element)
+{
+    uint8_t last[VKD3D_MIN_HEAP_MAX_ELEMENT_SIZE];
+    uint8_t *base = elements;
+    size_t hole, child, n;
+    uint64_t key;
+
+    assert(element_size <= sizeof(last));
+
+    memcpy(element, base, element_size);
+    n = --(*count);
+
+    if (!n)
+        return;
+
+    /* Move the last element into the root hole and sift it down. */
+    memcpy(last, base + n * element_size, element_size);
+    memcpy(&key, last + key_offset, sizeof(key));
+
+    for (hole = 0; (child = 2 * hole + 1) < n; hole = child)
+    {
+        if (child + 1 < n && vkd3d_min_heap_key(base, child + 1, element_size, key_offset) <
+                vkd3d_min_heap_key(base, child, element_size, key_offset))
+            child++;
+
+        if (key <= vkd3d_min_heap_key(base, child, element_size, key_offset))
+            break;
+
+        memcpy(base + hole * element_size, base + child * element_size, element_size);
+    }
+
+    memcpy(base + hole * element_size, last, element_size);
+}
+
+#endif /* __VKD3D_MIN_HEAP_H */
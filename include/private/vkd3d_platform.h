@@ -43,4 +43,7 @@ bool vkd3d_get_program_name(char program_name[VKD3D_PATH_MAX]);
 
 bool vkd3d_get_linux_kernel_version(uint32_t *major, uint32_t *minor, uint32_t *patch);
 
+/* Number of online logical CPUs. Always at least 1. */
+uint32_t vkd3d_get_cpu_count(void);
+
 #endif
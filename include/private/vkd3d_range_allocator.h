@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_RANGE_ALLOCATOR_H
+#define __VKD3D_RANGE_ALLOCATOR_H
+
+#include "vkd3d_common.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* TLSF style allocator for ranges in an abstract address space, e.g. a VkDeviceMemory block.
+ * Free ranges are binned in size classes by a two-level bitmap, so allocation and free are O(1)
+ * regardless of how fragmented the space is. Adjacent free ranges are always merged.
+ * The allocator does not touch the memory it manages, bookkeeping lives in a separate node array.
+ * It is not thread-safe. */
+
+#define VKD3D_RANGE_ALLOCATOR_SL_LOG2 4
+#define VKD3D_RANGE_ALLOCATOR_SL_COUNT (1u << VKD3D_RANGE_ALLOCATOR_SL_LOG2)
+#define VKD3D_RANGE_ALLOCATOR_FL_COUNT 64
+#define VKD3D_RANGE_ALLOCATOR_INVALID_NODE UINT32_MAX
+
+struct vkd3d_range_allocator_node
+{
+    uint64_t offset;
+    uint64_t length;
+    /* Neighbors in address order. */
+    uint32_t prev_phys;
+    uint32_t next_phys;
+    /* Neighbors in the free list of the node's size class, or the node free list for unused nodes. */
+    uint32_t prev_free;
+    uint32_t next_free;
+    bool is_free;
+};
+
+struct vkd3d_range_allocator
+{
+    struct vkd3d_range_allocator_node *nodes;
+    size_t nodes_size;
+    size_t nodes_count;
+    uint32_t unused_nodes;
+
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[VKD3D_RANGE_ALLOCATOR_FL_COUNT];
+    uint32_t free_lists[VKD3D_RANGE_ALLOCATOR_FL_COUNT][VKD3D_RANGE_ALLOCATOR_SL_COUNT];
+
+    uint64_t size;
+    uint64_t free_size;
+    uint32_t free_range_count;
+};
+
+bool vkd3d_range_allocator_init(struct vkd3d_range_allocator *allocator, uint64_t size);
+void vkd3d_range_allocator_cleanup(struct vkd3d_range_allocator *allocator);
+
+/* Returns a handle which must be passed to vkd3d_range_allocator_free(). Alignment must be a power of two. */
+bool vkd3d_range_allocator_allocate(struct vkd3d_range_allocator *allocator,
+        uint64_t size, uint64_t alignment, uint64_t *offset, uint32_t *handle);
+void vkd3d_range_allocator_free(struct vkd3d_range_allocator *allocator, uint32_t handle);
+
+/* For statistics. This is O(n) in the number of free ranges in the largest size class. */
+uint64_t vkd3d_range_allocator_get_largest_free_range(const struct vkd3d_range_allocator *allocator);
+
+static inline bool vkd3d_range_allocator_is_empty(const struct vkd3d_range_allocator *allocator)
+{
+    return allocator->free_size == allocator->size;
+}
+
+#endif /* __VKD3D_RANGE_ALLOCATOR_H */
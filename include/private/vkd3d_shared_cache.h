@@ -0,0 +1,81 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_SHARED_CACHE_H
+#define __VKD3D_SHARED_CACHE_H
+
+#include "vkd3d_common.h"
+#include "vkd3d_file_utils.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Insert-only hash table of blobs in a memory mapped file, which any number of processes can
+ * map, look up and publish to concurrently. Blobs are keyed by a 64-bit hash and a type.
+ * There are no locks: space for a blob is reserved with an atomic bump allocator, the blob is
+ * written out, and it is then published by claiming a bucket with compare-and-swap.
+ * A process dying at any point therefore leaves the table consistent, at worst leaking space.
+ * Published blobs are immutable, and are checksummed so that stale or torn data is never returned.
+ * Tables are tagged with a compatibility key, e.g. a driver identifier. An incompatible table
+ * is replaced. */
+
+struct vkd3d_shared_cache_header;
+struct vkd3d_shared_cache_bucket;
+
+struct vkd3d_shared_cache
+{
+    struct vkd3d_memory_mapped_file mapped_file;
+    struct vkd3d_shared_cache_header *header;
+    struct vkd3d_shared_cache_bucket *buckets;
+    uint32_t bucket_mask;
+    uint8_t *data;
+    uint64_t data_size;
+};
+
+struct vkd3d_shared_cache_stats
+{
+    uint64_t entry_count;
+    uint64_t data_used;
+    uint64_t data_size;
+    uint32_t bucket_count;
+    uint32_t failed_publish_count;
+};
+
+/* size is the total size of the table, which is fixed once created. Returns false on failure,
+ * in which case the struct is cleared to zero. */
+bool vkd3d_shared_cache_open(struct vkd3d_shared_cache *cache, const char *path,
+        uint64_t compat_key, size_t size);
+void vkd3d_shared_cache_close(struct vkd3d_shared_cache *cache);
+
+/* The returned pointer stays valid until the cache is closed. */
+bool vkd3d_shared_cache_find(const struct vkd3d_shared_cache *cache, uint64_t hash, uint32_t type,
+        const void **data, size_t *size);
+/* Returns true if the blob is present in the table afterwards, whether this call published it or not. */
+bool vkd3d_shared_cache_publish(struct vkd3d_shared_cache *cache, uint64_t hash, uint32_t type,
+        const void *data, size_t size);
+
+/* Free-form value shared by all users, e.g. to record which archive the table has been populated from. */
+uint64_t vkd3d_shared_cache_get_tag(const struct vkd3d_shared_cache *cache);
+void vkd3d_shared_cache_set_tag(struct vkd3d_shared_cache *cache, uint64_t tag);
+/* data must have been returned by vkd3d_shared_cache_find(). Returns true if the blob was published
+ * before the tag was last set, i.e. it is part of whatever the tag refers to. */
+bool vkd3d_shared_cache_is_tagged(const struct vkd3d_shared_cache *cache, const void *data);
+
+void vkd3d_shared_cache_get_stats(const struct vkd3d_shared_cache *cache, struct vkd3d_shared_cache_stats *stats);
+
+#endif /* __VKD3D_SHARED_CACHE_H */
@@ -121,7 +121,11 @@ struct vkd3d_shader_code_debug
 /* Scans OpCapabilities. */
 void vkd3d_shader_extract_feature_meta(struct vkd3d_shader_code *code);
 
+/* Fast content hash for internal use, e.g. pipeline cache keys. Not stable across versions. */
 vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader);
+/* Byte-wise FNV-1 hash. This is the hash users see in shader dump and replacement file names,
+ * quirk tables and VKD3D_QA_HASHES ranges, so it must not change. */
+vkd3d_shader_hash_t vkd3d_shader_hash_legacy(const struct vkd3d_shader_code *shader);
 
 enum vkd3d_shader_descriptor_type
 {
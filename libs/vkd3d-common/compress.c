@@ -0,0 +1,255 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_compress.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Each sequence is a token byte, where the upper nibble is the literal count and the lower nibble
+ * is the match length minus VKD3D_LZ_MIN_MATCH. A nibble of 15 means the length continues in
+ * the following bytes, 255 at a time. The token is followed by literals, then a little-endian
+ * 16-bit match offset and extended match length. The final sequence only contains literals. */
+#define VKD3D_LZ_MIN_MATCH 4
+#define VKD3D_LZ_LAST_LITERALS 5
+#define VKD3D_LZ_MAX_OFFSET 0xffff
+#define VKD3D_LZ_NIBBLE_MAX 15
+#define VKD3D_LZ_HASH_BITS 12
+#define VKD3D_LZ_WILD_COPY 16
+
+static inline uint32_t vkd3d_lz_read_u32(const uint8_t *ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, sizeof(v));
+    return v;
+}
+
+static inline uint32_t vkd3d_lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - VKD3D_LZ_HASH_BITS);
+}
+
+static uint8_t *vkd3d_lz_write_length(uint8_t *op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+
+    *op++ = length;
+    return op;
+}
+
+static uint8_t *vkd3d_lz_emit_sequence(uint8_t *op, const uint8_t *oend,
+        const uint8_t *literals, size_t literal_count, size_t offset, size_t match_length)
+{
+    size_t required;
+    uint8_t token;
+
+    /* Conservative, but cheap. */
+    required = 1 + literal_count + literal_count / 255 + 1;
+    if (offset)
+        required += 2 + match_length / 255 + 1;
+    if ((size_t)(oend - op) < required)
+        return NULL;
+
+    token = min(literal_count, VKD3D_LZ_NIBBLE_MAX) << 4;
+    if (offset)
+        token |= min(match_length, VKD3D_LZ_NIBBLE_MAX);
+    *op++ = token;
+
+    if (literal_count >= VKD3D_LZ_NIBBLE_MAX)
+        op = vkd3d_lz_write_length(op, literal_count - VKD3D_LZ_NIBBLE_MAX);
+    memcpy(op, literals, literal_count);
+    op += literal_count;
+
+    if (offset)
+    {
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        if (match_length >= VKD3D_LZ_NIBBLE_MAX)
+            op = vkd3d_lz_write_length(op, match_length - VKD3D_LZ_NIBBLE_MAX);
+    }
+
+    return op;
+}
+
+size_t vkd3d_lz_compress(void *dst, size_t dst_size, const void *src, size_t src_size)
+{
+    const uint8_t *search_limit, *match_limit;
+    uint32_t table[1u << VKD3D_LZ_HASH_BITS];
+    const uint8_t *base = src;
+    const uint8_t *iend = base + src_size;
+    const uint8_t *anchor = base;
+    const uint8_t *ip = base;
+    const uint8_t *match_end;
+    uint8_t *op = dst;
+    uint8_t *oend = op + dst_size;
+    const uint8_t *ref;
+    uint32_t seq, h;
+
+    /* Positions are stored as 32-bit. Pipeline blobs are bounded by that anyways. */
+    if (src_size > UINT32_MAX)
+        return 0;
+
+    memset(table, 0, sizeof(table));
+
+    if (src_size >= VKD3D_LZ_MIN_MATCH + VKD3D_LZ_LAST_LITERALS)
+    {
+        search_limit = iend - (VKD3D_LZ_MIN_MATCH + VKD3D_LZ_LAST_LITERALS);
+        match_limit = iend - VKD3D_LZ_LAST_LITERALS;
+
+        while (ip <= search_limit)
+        {
+            seq = vkd3d_lz_read_u32(ip);
+            h = vkd3d_lz_hash(seq);
+            ref = base + table[h];
+            table[h] = ip - base;
+
+            if (ref >= ip || ip - ref > VKD3D_LZ_MAX_OFFSET || vkd3d_lz_read_u32(ref) != seq)
+            {
+                /* Skip ahead faster the longer we go without finding a match,
+                 * so incompressible data does not cost much. */
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            match_end = ip + VKD3D_LZ_MIN_MATCH;
+            while (match_end < match_limit && *match_end == ref[match_end - ip])
+                match_end++;
+
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+
+            if (!(op = vkd3d_lz_emit_sequence(op, oend, anchor, ip - anchor,
+                    ip - ref, match_end - ip - VKD3D_LZ_MIN_MATCH)))
+                return 0;
+
+            ip = match_end;
+            anchor = ip;
+
+            /* Seed the table with the tail of the match so back-to-back repeats are found. */
+            if (ip <= search_limit)
+                table[vkd3d_lz_hash(vkd3d_lz_read_u32(ip - 2))] = ip - 2 - base;
+        }
+    }
+
+    if (!(op = vkd3d_lz_emit_sequence(op, oend, anchor, iend - anchor, 0, 0)))
+        return 0;
+
+    return op - (uint8_t *)dst;
+}
+
+static bool vkd3d_lz_read_length(const uint8_t **ip, const uint8_t *iend, size_t *length)
+{
+    uint8_t v;
+
+    do
+    {
+        if (*ip >= iend)
+            return false;
+        v = *(*ip)++;
+        *length += v;
+    } while (v == 255);
+
+    return true;
+}
+
+bool vkd3d_lz_decompress(void *dst, size_t dst_size, const void *src, size_t src_size)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = ip + src_size;
+    uint8_t *base = dst;
+    uint8_t *oend = base + dst_size;
+    size_t literal_count, match_length;
+    const uint8_t *match;
+    uint8_t *op = base;
+    size_t offset, i;
+    uint8_t token;
+
+    for (;;)
+    {
+        if (ip >= iend)
+            return false;
+
+        token = *ip++;
+
+        literal_count = token >> 4;
+        if (literal_count == VKD3D_LZ_NIBBLE_MAX && !vkd3d_lz_read_length(&ip, iend, &literal_count))
+            return false;
+
+        if (literal_count > (size_t)(iend - ip) || literal_count > (size_t)(oend - op))
+            return false;
+
+        /* Short literal runs are the common case. Copying a fixed 16 bytes is a lot faster
+         * than a variable sized memcpy when there is room to spare in both buffers. */
+        if (literal_count <= VKD3D_LZ_WILD_COPY && iend - ip >= VKD3D_LZ_WILD_COPY && oend - op >= VKD3D_LZ_WILD_COPY)
+            memcpy(op, ip, VKD3D_LZ_WILD_COPY);
+        else
+            memcpy(op, ip, literal_count);
+        op += literal_count;
+        ip += literal_count;
+
+        /* Last sequence has no match. */
+        if (ip == iend)
+            return op == oend;
+
+        if (iend - ip < 2)
+            return false;
+
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (!offset || offset > (size_t)(op - base))
+            return false;
+
+        match_length = token & VKD3D_LZ_NIBBLE_MAX;
+        if (match_length == VKD3D_LZ_NIBBLE_MAX && !vkd3d_lz_read_length(&ip, iend, &match_length))
+            return false;
+        match_length += VKD3D_LZ_MIN_MATCH;
+
+        if (match_length > (size_t)(oend - op))
+            return false;
+
+        match = op - offset;
+
+        if (offset >= VKD3D_LZ_WILD_COPY && (size_t)(oend - op) >= match_length + VKD3D_LZ_WILD_COPY)
+        {
+            /* Copies in 16 byte steps never read bytes they have written themselves,
+             * and may overshoot into output which is overwritten later. */
+            for (i = 0; i < match_length; i += VKD3D_LZ_WILD_COPY)
+                memcpy(op + i, match + i, VKD3D_LZ_WILD_COPY);
+        }
+        else if (offset >= match_length)
+        {
+            memcpy(op, match, match_length);
+        }
+        else
+        {
+            /* Overlapping copy is used to encode runs. */
+            for (i = 0; i < match_length; i++)
+                op[i] = match[i];
+        }
+
+        op += match_length;
+    }
+}
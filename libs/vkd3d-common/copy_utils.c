@@ -0,0 +1,217 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "copy_utils.h"
+#include "vkd3d_common.h"
+#include "vkd3d_platform.h"
+#include "vkd3d_threads.h"
+
+#include <string.h>
+
+/* Spawning threads costs in the order of tens of microseconds,
+ * so only split copies which take at least a millisecond or so per thread. */
+#define VKD3D_COPY_ROWS_MAX_THREADS 4
+#define VKD3D_COPY_ROWS_MIN_BYTES_PER_THREAD (4u * 1024u * 1024u)
+#define VKD3D_COPY_ROWS_SPLIT_ALIGNMENT 4096u
+
+struct vkd3d_copy_rows_layout
+{
+    uint8_t *dst;
+    const uint8_t *src;
+    size_t dst_row_pitch;
+    size_t dst_slice_pitch;
+    size_t src_row_pitch;
+    size_t src_slice_pitch;
+    size_t row_size;
+    size_t row_count;
+    size_t slice_count;
+    uint32_t flags;
+};
+
+struct vkd3d_copy_rows_work
+{
+    const struct vkd3d_copy_rows_layout *layout;
+    size_t begin;
+    size_t end;
+    pthread_t thread;
+};
+
+static void vkd3d_memcpy_non_temporal_unaligned(uint8_t *dst, const uint8_t *src, size_t size)
+{
+#ifdef __SSE2__
+    __m128i a, b, c, d;
+    size_t head;
+
+    /* Streaming stores need an aligned destination. The source can be anywhere. */
+    head = min((size_t)(-(uintptr_t)dst & 15), size);
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, dst += 64, src += 64)
+    {
+        a = _mm_loadu_si128((const __m128i *)src + 0);
+        b = _mm_loadu_si128((const __m128i *)src + 1);
+        c = _mm_loadu_si128((const __m128i *)src + 2);
+        d = _mm_loadu_si128((const __m128i *)src + 3);
+        _mm_stream_si128((__m128i *)dst + 0, a);
+        _mm_stream_si128((__m128i *)dst + 1, b);
+        _mm_stream_si128((__m128i *)dst + 2, c);
+        _mm_stream_si128((__m128i *)dst + 3, d);
+    }
+
+    for (; size >= 16; size -= 16, dst += 16, src += 16)
+        _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+
+    memcpy(dst, src, size);
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+/* Copies bytes [begin, end) of the copy as if all rows were packed back to back. */
+static void vkd3d_copy_rows_range(const struct vkd3d_copy_rows_layout *layout, size_t begin, size_t end)
+{
+    size_t row, offset, size, slice_index, row_index;
+    const uint8_t *src;
+    uint8_t *dst;
+
+    row = begin / layout->row_size;
+    offset = begin % layout->row_size;
+
+    while (begin < end)
+    {
+        slice_index = row / layout->row_count;
+        row_index = row % layout->row_count;
+        size = min(layout->row_size - offset, end - begin);
+
+        dst = layout->dst + slice_index * layout->dst_slice_pitch + row_index * layout->dst_row_pitch + offset;
+        src = layout->src + slice_index * layout->src_slice_pitch + row_index * layout->src_row_pitch + offset;
+
+        if (layout->flags & VKD3D_COPY_ROWS_NON_TEMPORAL)
+            vkd3d_memcpy_non_temporal_unaligned(dst, src, size);
+        else
+            memcpy(dst, src, size);
+
+        begin += size;
+        offset = 0;
+        row++;
+    }
+
+    if (layout->flags & VKD3D_COPY_ROWS_NON_TEMPORAL)
+        vkd3d_memcpy_non_temporal_barrier();
+}
+
+static void *vkd3d_copy_rows_thread_main(void *userarg)
+{
+    struct vkd3d_copy_rows_work *work = userarg;
+    vkd3d_set_thread_name("vkd3d-copy");
+    vkd3d_copy_rows_range(work->layout, work->begin, work->end);
+    return NULL;
+}
+
+static void vkd3d_copy_rows_merge(struct vkd3d_copy_rows_layout *layout)
+{
+    /* Slices which directly follow each other are just more rows. */
+    if (layout->slice_count > 1 &&
+            layout->src_slice_pitch == layout->src_row_pitch * layout->row_count &&
+            layout->dst_slice_pitch == layout->dst_row_pitch * layout->row_count)
+    {
+        layout->row_count *= layout->slice_count;
+        layout->slice_count = 1;
+    }
+
+    /* Tightly packed rows are one large row, and slices become the rows. */
+    if (layout->src_row_pitch == layout->row_size && layout->dst_row_pitch == layout->row_size)
+    {
+        layout->row_size *= layout->row_count;
+        layout->row_count = layout->slice_count;
+        layout->src_row_pitch = layout->src_slice_pitch;
+        layout->dst_row_pitch = layout->dst_slice_pitch;
+        layout->slice_count = 1;
+    }
+}
+
+void vkd3d_copy_rows(uint8_t *dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+        const uint8_t *src, size_t src_row_pitch, size_t src_slice_pitch,
+        size_t row_size, unsigned int row_count, unsigned int slice_count, uint32_t flags)
+{
+    struct vkd3d_copy_rows_work work[VKD3D_COPY_ROWS_MAX_THREADS];
+    bool spawned[VKD3D_COPY_ROWS_MAX_THREADS];
+    struct vkd3d_copy_rows_layout layout;
+    size_t total_size, split;
+    uint32_t thread_count;
+    uint32_t i;
+
+    if (!row_size || !row_count || !slice_count)
+        return;
+
+    layout.dst = dst;
+    layout.src = src;
+    layout.dst_row_pitch = dst_row_pitch;
+    layout.dst_slice_pitch = dst_slice_pitch;
+    layout.src_row_pitch = src_row_pitch;
+    layout.src_slice_pitch = src_slice_pitch;
+    layout.row_size = row_size;
+    layout.row_count = row_count;
+    layout.slice_count = slice_count;
+    layout.flags = flags;
+
+    vkd3d_copy_rows_merge(&layout);
+
+    total_size = layout.row_size * layout.row_count * layout.slice_count;
+    thread_count = min(total_size / VKD3D_COPY_ROWS_MIN_BYTES_PER_THREAD, VKD3D_COPY_ROWS_MAX_THREADS);
+
+    /* Querying the CPU count is not free, so only do it for copies which are worth splitting. */
+    if (thread_count > 1)
+        thread_count = min(thread_count, vkd3d_get_cpu_count());
+
+    if (thread_count <= 1)
+    {
+        vkd3d_copy_rows_range(&layout, 0, total_size);
+        return;
+    }
+
+    /* Split points are in packed space. Rows may be split between threads,
+     * which is what makes a single large merged row parallel as well. */
+    for (i = 0; i < thread_count; i++)
+    {
+        work[i].layout = &layout;
+        split = align((total_size / thread_count) * i, VKD3D_COPY_ROWS_SPLIT_ALIGNMENT);
+        work[i].begin = min(split, total_size);
+        if (i)
+            work[i - 1].end = work[i].begin;
+    }
+    work[thread_count - 1].end = total_size;
+
+    /* The calling thread takes the first range. If we fail to spawn a worker, copy inline. */
+    spawned[0] = false;
+    for (i = 1; i < thread_count; i++)
+        spawned[i] = !pthread_create(&work[i].thread, NULL, vkd3d_copy_rows_thread_main, &work[i]);
+
+    for (i = 0; i < thread_count; i++)
+        if (!spawned[i])
+            vkd3d_copy_rows_range(&layout, work[i].begin, work[i].end);
+
+    for (i = 0; i < thread_count; i++)
+        if (spawned[i])
+            pthread_join(work[i].thread, NULL);
+}
@@ -78,6 +78,282 @@ struct vkd3d_string_stream
 };
 static struct vkd3d_string_stream vkd3d_dbg_buffer;
 
+/* With VKD3D_LOG_ASYNC, logging threads only format the message and copy it into a ring,
+ * and a dedicated thread does all the IO. Rings are sharded by thread ID to avoid contention
+ * between threads. Each ring is a multi-producer, single-consumer queue of variable sized records.
+ * Producers reserve space with a CAS on reserve_offset and publish a record by setting its state.
+ * If a ring is full, the message is dropped and counted rather than blocking the caller. */
+#define VKD3D_DBG_RING_COUNT 8
+#define VKD3D_DBG_RING_RECORD_ALIGNMENT 8
+
+enum vkd3d_dbg_record_state
+{
+    VKD3D_DBG_RECORD_STATE_PENDING = 0,
+    VKD3D_DBG_RECORD_STATE_MESSAGE,
+    VKD3D_DBG_RECORD_STATE_PADDING,
+};
+
+struct vkd3d_dbg_record
+{
+    uint32_t length;
+    uint32_t state;
+};
+
+struct vkd3d_dbg_ring
+{
+    /* Offsets increase monotonically and are masked on use. */
+    uint64_t reserve_offset;
+    char pad0[64 - sizeof(uint64_t)];
+    uint64_t read_offset;
+    uint64_t dropped_count;
+    uint64_t reported_dropped_count;
+    char pad1[64 - 3 * sizeof(uint64_t)];
+    char *data;
+    size_t size;
+};
+
+struct vkd3d_dbg_async
+{
+    struct vkd3d_dbg_ring rings[VKD3D_DBG_RING_COUNT];
+    pthread_t thread;
+
+    /* Serializes consumers, i.e. the writer thread and vkd3d_dbg_flush(). */
+    pthread_mutex_t drain_lock;
+
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake_cond;
+    uint32_t writer_idle;
+    bool shutdown;
+};
+static struct vkd3d_dbg_async *vkd3d_dbg_async;
+
+static FILE *vkd3d_dbg_get_log_file(void)
+{
+    return vkd3d_log_file ? vkd3d_log_file : stderr;
+}
+
+static bool vkd3d_dbg_ring_drain(struct vkd3d_dbg_ring *ring, FILE *log_file)
+{
+    struct vkd3d_dbg_record *record;
+    uint64_t read_offset, reserve_offset;
+    uint64_t dropped_count;
+    bool did_work = false;
+    size_t record_size;
+    uint32_t state;
+
+    read_offset = ring->read_offset;
+    reserve_offset = vkd3d_atomic_uint64_load_explicit(&ring->reserve_offset, vkd3d_memory_order_acquire);
+
+    while (read_offset != reserve_offset)
+    {
+        record = (struct vkd3d_dbg_record *)(ring->data + (read_offset & (ring->size - 1)));
+
+        /* A producer reserved this record, but has not finished writing it yet. Pick it up next time. */
+        if (!(state = vkd3d_atomic_uint32_load_explicit(&record->state, vkd3d_memory_order_acquire)))
+            break;
+
+        record_size = align(sizeof(*record) + record->length, VKD3D_DBG_RING_RECORD_ALIGNMENT);
+
+        if (state == VKD3D_DBG_RECORD_STATE_MESSAGE)
+            fwrite(record + 1, 1, record->length, log_file);
+
+        /* Record boundaries move around as the ring wraps, so a later header may land anywhere in
+         * this span. Clear all of it, so that header reads as PENDING until its producer publishes it. */
+        memset(record, 0, record_size);
+        read_offset += record_size;
+        vkd3d_atomic_uint64_store_explicit(&ring->read_offset, read_offset, vkd3d_memory_order_release);
+        did_work = true;
+    }
+
+    dropped_count = vkd3d_atomic_uint64_load_explicit(&ring->dropped_count, vkd3d_memory_order_relaxed);
+    if (dropped_count != ring->reported_dropped_count)
+    {
+        fprintf(log_file, "vkd3d-proton: Log ring is full, dropped %"PRIu64" messages.\n",
+                dropped_count - ring->reported_dropped_count);
+        ring->reported_dropped_count = dropped_count;
+        did_work = true;
+    }
+
+    return did_work;
+}
+
+static bool vkd3d_dbg_async_drain(struct vkd3d_dbg_async *async)
+{
+    FILE *log_file = vkd3d_dbg_get_log_file();
+    bool did_work = false;
+    unsigned int i;
+
+    pthread_mutex_lock(&async->drain_lock);
+    for (i = 0; i < VKD3D_DBG_RING_COUNT; i++)
+        did_work |= vkd3d_dbg_ring_drain(&async->rings[i], log_file);
+    if (did_work)
+        fflush(log_file);
+    pthread_mutex_unlock(&async->drain_lock);
+
+    return did_work;
+}
+
+static bool vkd3d_dbg_async_is_empty(struct vkd3d_dbg_async *async)
+{
+    const struct vkd3d_dbg_ring *ring;
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_DBG_RING_COUNT; i++)
+    {
+        ring = &async->rings[i];
+        if (vkd3d_atomic_uint64_load_explicit((uint64_t *)&ring->reserve_offset, vkd3d_memory_order_seq_cst) !=
+                vkd3d_atomic_uint64_load_explicit((uint64_t *)&ring->read_offset, vkd3d_memory_order_relaxed))
+            return false;
+    }
+
+    return true;
+}
+
+static void *vkd3d_dbg_async_thread_main(void *userdata)
+{
+    struct vkd3d_dbg_async *async = userdata;
+
+    vkd3d_set_thread_name("vkd3d_log");
+
+    for (;;)
+    {
+        if (vkd3d_dbg_async_drain(async))
+            continue;
+
+        /* Producers only signal if they observe writer_idle, so this must be set before checking for work. */
+        pthread_mutex_lock(&async->wake_lock);
+        if (async->shutdown)
+        {
+            pthread_mutex_unlock(&async->wake_lock);
+            break;
+        }
+        vkd3d_atomic_uint32_store_explicit(&async->writer_idle, 1, vkd3d_memory_order_seq_cst);
+        if (vkd3d_dbg_async_is_empty(async))
+        {
+            while (vkd3d_atomic_uint32_load_explicit(&async->writer_idle, vkd3d_memory_order_acquire) &&
+                    !async->shutdown)
+                pthread_cond_wait(&async->wake_cond, &async->wake_lock);
+        }
+        vkd3d_atomic_uint32_store_explicit(&async->writer_idle, 0, vkd3d_memory_order_relaxed);
+        pthread_mutex_unlock(&async->wake_lock);
+    }
+
+    return NULL;
+}
+
+static void vkd3d_dbg_async_atexit(void)
+{
+    struct vkd3d_dbg_async *async = vkd3d_dbg_async;
+
+    pthread_mutex_lock(&async->wake_lock);
+    async->shutdown = true;
+    pthread_cond_signal(&async->wake_cond);
+    pthread_mutex_unlock(&async->wake_lock);
+    pthread_join(async->thread, NULL);
+
+    /* Other threads may still be logging, so the rings stay alive, and anything
+     * written from here on is picked up by vkd3d_dbg_flush() or dropped. */
+    vkd3d_dbg_async_drain(async);
+}
+
+static void vkd3d_dbg_async_init(unsigned int ring_size)
+{
+    struct vkd3d_dbg_async *async;
+    unsigned int i;
+
+    /* Must be a power of two, and comfortably fit the largest message. */
+    if (!ring_size)
+        ring_size = 256 * 1024;
+    ring_size = 1u << vkd3d_log2i_ceil(min(max(ring_size, 64 * 1024), 64 * 1024 * 1024));
+
+    if (!(async = calloc(1, sizeof(*async))))
+        return;
+
+    for (i = 0; i < VKD3D_DBG_RING_COUNT; i++)
+    {
+        async->rings[i].size = ring_size;
+        if (!(async->rings[i].data = calloc(1, ring_size)))
+            goto fail;
+    }
+
+    pthread_mutex_init(&async->drain_lock, NULL);
+    pthread_mutex_init(&async->wake_lock, NULL);
+    pthread_cond_init(&async->wake_cond, NULL);
+
+    if (pthread_create(&async->thread, NULL, vkd3d_dbg_async_thread_main, async))
+    {
+        pthread_mutex_destroy(&async->drain_lock);
+        pthread_mutex_destroy(&async->wake_lock);
+        pthread_cond_destroy(&async->wake_cond);
+        goto fail;
+    }
+
+    fprintf(stderr, "Using VKD3D_LOG_ASYNC with %u x %u byte rings.\n", VKD3D_DBG_RING_COUNT, ring_size);
+    vkd3d_dbg_async = async;
+    atexit(vkd3d_dbg_async_atexit);
+    return;
+
+fail:
+    for (i = 0; i < VKD3D_DBG_RING_COUNT; i++)
+        free(async->rings[i].data);
+    free(async);
+}
+
+static void vkd3d_dbg_async_write(struct vkd3d_dbg_async *async, unsigned int tid,
+        const char *prefix, size_t prefix_length, const char *message, size_t message_length)
+{
+    struct vkd3d_dbg_ring *ring = &async->rings[tid % VKD3D_DBG_RING_COUNT];
+    uint64_t reserve_offset, read_offset, offset;
+    struct vkd3d_dbg_record *record;
+    size_t record_size, padding;
+
+    record_size = align(sizeof(*record) + prefix_length + message_length, VKD3D_DBG_RING_RECORD_ALIGNMENT);
+
+    reserve_offset = vkd3d_atomic_uint64_load_explicit(&ring->reserve_offset, vkd3d_memory_order_relaxed);
+    for (;;)
+    {
+        /* Records are contiguous in memory, so pad out to the end of the ring if we would straddle it. */
+        offset = reserve_offset & (ring->size - 1);
+        padding = ring->size - offset < record_size ? ring->size - offset : 0;
+
+        read_offset = vkd3d_atomic_uint64_load_explicit(&ring->read_offset, vkd3d_memory_order_acquire);
+        if (reserve_offset + padding + record_size - read_offset > ring->size)
+        {
+            vkd3d_atomic_uint64_increment(&ring->dropped_count, vkd3d_memory_order_relaxed);
+            return;
+        }
+
+        offset = vkd3d_atomic_uint64_compare_exchange(&ring->reserve_offset, reserve_offset,
+                reserve_offset + padding + record_size, vkd3d_memory_order_seq_cst, vkd3d_memory_order_relaxed);
+        if (offset == reserve_offset)
+            break;
+        reserve_offset = offset;
+    }
+
+    if (padding)
+    {
+        record = (struct vkd3d_dbg_record *)(ring->data + (reserve_offset & (ring->size - 1)));
+        record->length = padding - sizeof(*record);
+        vkd3d_atomic_uint32_store_explicit(&record->state, VKD3D_DBG_RECORD_STATE_PADDING, vkd3d_memory_order_release);
+        reserve_offset += padding;
+    }
+
+    record = (struct vkd3d_dbg_record *)(ring->data + (reserve_offset & (ring->size - 1)));
+    record->length = prefix_length + message_length;
+    memcpy(record + 1, prefix, prefix_length);
+    memcpy((char *)(record + 1) + prefix_length, message, message_length);
+    vkd3d_atomic_uint32_store_explicit(&record->state, VKD3D_DBG_RECORD_STATE_MESSAGE, vkd3d_memory_order_seq_cst);
+
+    /* Pairs with the writer thread setting writer_idle before it checks the rings one last time. */
+    if (vkd3d_atomic_uint32_load_explicit(&async->writer_idle, vkd3d_memory_order_seq_cst) &&
+            vkd3d_atomic_uint32_exchange_explicit(&async->writer_idle, 0, vkd3d_memory_order_seq_cst))
+    {
+        pthread_mutex_lock(&async->wake_lock);
+        pthread_cond_signal(&async->wake_cond);
+        pthread_mutex_unlock(&async->wake_lock);
+    }
+}
+
 static void vkd3d_dbg_init_once(void)
 {
     char vkd3d_debug[VKD3D_PATH_MAX];
@@ -126,6 +402,9 @@ static void vkd3d_dbg_init_once(void)
 #endif
     }
 
+    if (vkd3d_get_env_var("VKD3D_LOG_ASYNC", vkd3d_debug, sizeof(vkd3d_debug)))
+        vkd3d_dbg_async_init(strtoul(vkd3d_debug, NULL, 0));
+
     vkd3d_atomic_uint32_store_explicit(&vkd3d_dbg_initialized, 1, vkd3d_memory_order_release);
 }
 
@@ -149,6 +428,9 @@ static spinlock_t vkd3d_debug_buffer_spin;
 
 void vkd3d_dbg_flush(void)
 {
+    if (vkd3d_dbg_async)
+        vkd3d_dbg_async_drain(vkd3d_dbg_async);
+
     if (vkd3d_dbg_buffer.buffer)
     {
         spinlock_acquire(&vkd3d_debug_buffer_spin);
@@ -187,7 +469,30 @@ void vkd3d_dbg_printf(enum vkd3d_dbg_channel channel, enum vkd3d_dbg_level level
     va_start(args, fmt);
     tid = vkd3d_get_current_thread_id();
 
-    if (vkd3d_dbg_buffer.buffer)
+    if (vkd3d_dbg_async)
+    {
+        char prefix_buffer[256];
+        int prefix_buffer_count;
+        char local_buffer[4096];
+        int local_buffer_count;
+
+        prefix_buffer_count = snprintf(prefix_buffer, sizeof(prefix_buffer),
+                "%04x:%s:%s: ", tid, debug_level_names[level], function);
+        local_buffer_count = vsnprintf(local_buffer, sizeof(local_buffer), fmt, args);
+
+        /* Encoding errors return a negative count, log an empty string rather than garbage. */
+        prefix_buffer_count = max(prefix_buffer_count, 0);
+        local_buffer_count = max(local_buffer_count, 0);
+
+        vkd3d_dbg_async_write(vkd3d_dbg_async, tid,
+                prefix_buffer, min(prefix_buffer_count, (int)sizeof(prefix_buffer) - 1),
+                local_buffer, min(local_buffer_count, (int)sizeof(local_buffer) - 1));
+
+        /* Errors tend to be followed by a crash, so make sure they reach the log. */
+        if (level <= VKD3D_DBG_LEVEL_ERR)
+            vkd3d_dbg_async_drain(vkd3d_dbg_async);
+    }
+    else if (vkd3d_dbg_buffer.buffer)
     {
         char prefix_buffer[256];
         int prefix_buffer_count;
@@ -20,6 +20,7 @@
 
 #include "vkd3d_file_utils.h"
 #include "vkd3d_debug.h"
+#include "hashmap.h"
 
 /* For disk cache. */
 #ifdef _WIN32
@@ -33,6 +34,7 @@
 
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <stdio.h>
 
 bool vkd3d_file_rename_overwrite(const char *from_path, const char *to_path)
@@ -186,3 +188,152 @@ out:
         file->mapped_size = 0;
     return file->mapped != NULL;
 }
+
+bool vkd3d_file_map_shared(const char *path, size_t size, struct vkd3d_memory_mapped_file *file)
+{
+#ifdef _WIN32
+    DWORD size_hi, size_lo;
+    HANDLE file_mapping;
+    uint64_t file_size;
+    HANDLE handle;
+#else
+    struct stat stat_buf;
+    int fd;
+#endif
+
+    file->mapped = NULL;
+    file->mapped_size = 0;
+
+#ifdef _WIN32
+    handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, INVALID_HANDLE_VALUE);
+    if (handle == INVALID_HANDLE_VALUE)
+        goto out;
+
+    size_lo = GetFileSize(handle, &size_hi);
+    file_size = size_lo | (((uint64_t)size_hi) << 32);
+    if (file_size < size)
+        file_size = size;
+
+    /* Creating the mapping grows the file as needed. */
+    file_mapping = CreateFileMappingA(handle, NULL, PAGE_READWRITE,
+            (DWORD)(file_size >> 32), (DWORD)file_size, NULL);
+    if (!file_mapping)
+    {
+        ERR("Failed to CreateFileMapping for %s.\n", path);
+        goto out;
+    }
+
+    file->mapped = MapViewOfFile(file_mapping, FILE_MAP_ALL_ACCESS, 0, 0, file_size);
+    CloseHandle(file_mapping);
+    if (!file->mapped)
+    {
+        ERR("Failed to MapViewOfFile for %s.\n", path);
+        goto out;
+    }
+
+    file->mapped_size = file_size;
+
+out:
+    if (handle != INVALID_HANDLE_VALUE)
+        CloseHandle(handle);
+#else
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        goto out;
+
+    if (fstat(fd, &stat_buf) < 0)
+    {
+        ERR("Failed to fstat %s.\n", path);
+        goto out;
+    }
+
+    /* Concurrent processes may race to grow the file, but they all grow it to the same size. */
+    if ((size_t)stat_buf.st_size < size)
+    {
+        if (ftruncate(fd, size) < 0)
+        {
+            ERR("Failed to resize %s, errno %d.\n", path, errno);
+            goto out;
+        }
+        stat_buf.st_size = size;
+    }
+
+    file->mapped = mmap(NULL, stat_buf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (file->mapped != MAP_FAILED)
+        file->mapped_size = stat_buf.st_size;
+    else
+        file->mapped = NULL;
+
+out:
+    if (fd >= 0)
+        close(fd);
+#endif
+
+    if (!file->mapped)
+        file->mapped_size = 0;
+    return file->mapped != NULL;
+}
+
+bool vkd3d_file_query_identity(const char *path, uint64_t *identity)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+        return false;
+
+    *identity = hash_fnv1_init();
+    *identity = hash_fnv1_iterate_u32(*identity, data.nFileSizeLow);
+    *identity = hash_fnv1_iterate_u32(*identity, data.nFileSizeHigh);
+    *identity = hash_fnv1_iterate_u32(*identity, data.ftLastWriteTime.dwLowDateTime);
+    *identity = hash_fnv1_iterate_u32(*identity, data.ftLastWriteTime.dwHighDateTime);
+#else
+    struct stat stat_buf;
+
+    if (stat(path, &stat_buf) < 0)
+        return false;
+
+    /* Replacing the file by renaming over it changes the inode even if size and timestamp match. */
+    *identity = hash_fnv1_init();
+    *identity = hash_fnv1_iterate_u64(*identity, stat_buf.st_ino);
+    *identity = hash_fnv1_iterate_u64(*identity, stat_buf.st_size);
+    *identity = hash_fnv1_iterate_u64(*identity, stat_buf.st_mtim.tv_sec);
+    *identity = hash_fnv1_iterate_u64(*identity, stat_buf.st_mtim.tv_nsec);
+#endif
+
+    return true;
+}
+
+bool vkd3d_file_query_age(const char *path, uint64_t *age_seconds)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    ULARGE_INTEGER write_time, now;
+    FILETIME now_filetime;
+
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+        return false;
+
+    GetSystemTimeAsFileTime(&now_filetime);
+    write_time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+    write_time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+    now.LowPart = now_filetime.dwLowDateTime;
+    now.HighPart = now_filetime.dwHighDateTime;
+
+    /* FILETIME is in units of 100 ns. */
+    *age_seconds = now.QuadPart > write_time.QuadPart ? (now.QuadPart - write_time.QuadPart) / 10000000 : 0;
+#else
+    struct stat stat_buf;
+    time_t now;
+
+    if (stat(path, &stat_buf) < 0)
+        return false;
+
+    now = time(NULL);
+    *age_seconds = now > stat_buf.st_mtime ? (uint64_t)(now - stat_buf.st_mtime) : 0;
+#endif
+
+    return true;
+}
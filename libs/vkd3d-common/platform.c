@@ -41,6 +41,7 @@ static bool vkd3d_parse_linux_release(const char *release, uint32_t *major, uint
 # include <dlfcn.h>
 # include <errno.h>
 # include <sys/utsname.h>
+# include <unistd.h>
 
 vkd3d_module_t vkd3d_dlopen(const char *name)
 {
@@ -109,6 +110,12 @@ bool vkd3d_get_linux_kernel_version(uint32_t *major, uint32_t *minor, uint32_t *
     return vkd3d_parse_linux_release(ver.release, major, minor, patch);
 }
 
+uint32_t vkd3d_get_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
 #elif defined(_WIN32)
 
 # include <windows.h>
@@ -181,6 +188,13 @@ bool vkd3d_get_linux_kernel_version(uint32_t *major, uint32_t *minor, uint32_t *
         return false;
 }
 
+uint32_t vkd3d_get_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max(info.dwNumberOfProcessors, 1);
+}
+
 #else
 
 vkd3d_module_t vkd3d_dlopen(const char *name)
@@ -218,6 +232,11 @@ bool vkd3d_get_linux_kernel_version(uint32_t *major, uint32_t *minor, uint32_t *
     return false;
 }
 
+uint32_t vkd3d_get_cpu_count(void)
+{
+    return 1;
+}
+
 #endif
 
 #if defined(_WIN32)
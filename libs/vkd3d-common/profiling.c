@@ -42,17 +42,77 @@ static pthread_once_t profiling_block_once = PTHREAD_ONCE_INIT;
 static unsigned int profiling_region_count;
 static spinlock_t profiling_lock;
 
+/* The mapped file is laid out as a header, a table of region names,
+ * and then one array of counter blocks per shard. Threads are spread over shards,
+ * and only ever update counters with relaxed atomics, so profiled code never takes a lock.
+ * Readers sum up the shards. */
+#define VKD3D_PROFILING_MAGIC "VKD3DPRF"
+#define VKD3D_PROFILING_VERSION 2
+#define VKD3D_MAX_PROFILING_REGIONS 256
+#define VKD3D_PROFILING_SHARD_COUNT 8
+
+/* Histogram of ticks per sample, with 4 linear sub-buckets per power of two. */
+#define VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2 2
+#define VKD3D_PROFILING_HISTOGRAM_OCTAVES 40
+#define VKD3D_PROFILING_HISTOGRAM_BUCKETS (VKD3D_PROFILING_HISTOGRAM_OCTAVES << VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2)
+
+struct vkd3d_profiling_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t region_count;
+    uint32_t name_size;
+    uint32_t shard_count;
+    uint32_t block_size;
+    uint32_t histogram_sub_buckets_log2;
+    uint32_t histogram_bucket_count;
+    char reserved[64 - 8 - 8 * sizeof(uint32_t)];
+};
+
+struct vkd3d_profiling_name
+{
+    char name[64];
+};
+
 struct vkd3d_profiling_block
 {
     uint64_t ticks_total;
     uint64_t iteration_total;
-    char name[64 - 2 * sizeof(uint64_t)];
+    uint64_t sample_count;
+    uint64_t ticks_max;
+    uint64_t histogram[VKD3D_PROFILING_HISTOGRAM_BUCKETS];
+    /* Pad to a multiple of a cache line. */
+    uint64_t reserved[4];
 };
 
-static struct vkd3d_profiling_block *mapped_blocks;
+struct vkd3d_profiling_map
+{
+    struct vkd3d_profiling_header header;
+    struct vkd3d_profiling_name names[VKD3D_MAX_PROFILING_REGIONS];
+    struct vkd3d_profiling_block shards[VKD3D_PROFILING_SHARD_COUNT][VKD3D_MAX_PROFILING_REGIONS];
+};
 
-#define VKD3D_MAX_PROFILING_REGIONS 256
-static spinlock_t region_locks[VKD3D_MAX_PROFILING_REGIONS];
+STATIC_ASSERT(sizeof(struct vkd3d_profiling_header) == 64);
+STATIC_ASSERT(sizeof(struct vkd3d_profiling_block) % 64 == 0);
+
+static struct vkd3d_profiling_map *mapped_blocks;
+static uint32_t profiling_shard_counter;
+
+static void vkd3d_init_profiling_header(void)
+{
+    struct vkd3d_profiling_header *header = &mapped_blocks->header;
+
+    memcpy(header->magic, VKD3D_PROFILING_MAGIC, sizeof(header->magic));
+    header->version = VKD3D_PROFILING_VERSION;
+    header->header_size = sizeof(*header);
+    header->region_count = VKD3D_MAX_PROFILING_REGIONS;
+    header->name_size = sizeof(struct vkd3d_profiling_name);
+    header->shard_count = VKD3D_PROFILING_SHARD_COUNT;
+    header->block_size = sizeof(struct vkd3d_profiling_block);
+    header->histogram_sub_buckets_log2 = VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2;
+    header->histogram_bucket_count = VKD3D_PROFILING_HISTOGRAM_BUCKETS;
+}
 
 #ifdef _WIN32
 static void vkd3d_init_profiling_path(const char *path)
@@ -73,7 +133,7 @@ static void vkd3d_init_profiling_path(const char *path)
     }
 
     file_view = CreateFileMappingA(profiling_fd, NULL, PAGE_READWRITE, 0,
-            VKD3D_MAX_PROFILING_REGIONS * sizeof(*mapped_blocks), NULL);
+            sizeof(*mapped_blocks), NULL);
     if (file_view == INVALID_HANDLE_VALUE)
     {
         ERR("Failed to create profiling file view.\n");
@@ -82,8 +142,10 @@ static void vkd3d_init_profiling_path(const char *path)
     }
 
     mapped_blocks = MapViewOfFile(file_view, FILE_MAP_ALL_ACCESS, 0, 0,
-            VKD3D_MAX_PROFILING_REGIONS * sizeof(*mapped_blocks));
-    if (!mapped_blocks)
+            sizeof(*mapped_blocks));
+    if (mapped_blocks)
+        vkd3d_init_profiling_header();
+    else
         ERR("Failed to map view of file.\n");
     CloseHandle(file_view);
     CloseHandle(profiling_fd);
@@ -99,21 +161,23 @@ static void vkd3d_init_profiling_path(const char *path)
 
     if (profiling_fd >= 0)
     {
-        if (ftruncate(profiling_fd, VKD3D_MAX_PROFILING_REGIONS * sizeof(*mapped_blocks)) < 0)
+        if (ftruncate(profiling_fd, sizeof(*mapped_blocks)) < 0)
         {
             ERR("Failed to resize profiling FD.\n");
             close(profiling_fd);
             return;
         }
-        mapped_blocks = mmap(NULL, VKD3D_MAX_PROFILING_REGIONS * sizeof(*mapped_blocks),
+        mapped_blocks = mmap(NULL, sizeof(*mapped_blocks),
                 PROT_READ | PROT_WRITE, MAP_SHARED, profiling_fd, 0);
-        if (!mapped_blocks)
+        if (mapped_blocks == MAP_FAILED)
         {
+            mapped_blocks = NULL;
             ERR("Failed to map block.\n");
             close(profiling_fd);
             return;
         }
-        memset(mapped_blocks, 0, VKD3D_MAX_PROFILING_REGIONS * sizeof(*mapped_blocks));
+        memset(mapped_blocks, 0, sizeof(*mapped_blocks));
+        vkd3d_init_profiling_header();
         close(profiling_fd);
     }
     else
@@ -157,7 +221,7 @@ unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock,
         index = ++profiling_region_count;
         if (index <= VKD3D_MAX_PROFILING_REGIONS)
         {
-            strncpy(mapped_blocks[index - 1].name, name, sizeof(mapped_blocks[index - 1].name) - 1);
+            strncpy(mapped_blocks->names[index - 1].name, name, sizeof(mapped_blocks->names[index - 1].name) - 1);
             /* Important to store with release semantics after we've initialized the block. */
             vkd3d_atomic_uint32_store_explicit(latch, index, vkd3d_memory_order_release);
         }
@@ -175,24 +239,57 @@ unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock,
     return index;
 }
 
+static unsigned int vkd3d_profiling_get_shard(void)
+{
+    static VKD3D_THREAD_LOCAL unsigned int shard;
+
+    /* Assign shards round-robin on first use, so that a handful of hot threads end up on different shards. */
+    if (!shard)
+        shard = (vkd3d_atomic_uint32_increment(&profiling_shard_counter, vkd3d_memory_order_relaxed) %
+                VKD3D_PROFILING_SHARD_COUNT) + 1;
+    return shard - 1;
+}
+
+static unsigned int vkd3d_profiling_get_histogram_bucket(uint64_t ticks)
+{
+    unsigned int octave, sub_bucket;
+
+    if (ticks < (1u << VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2))
+        return ticks;
+
+    octave = (ticks >> 32) ? 32 + vkd3d_log2i(ticks >> 32) : vkd3d_log2i(ticks);
+    sub_bucket = (ticks >> (octave - VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2)) &
+            ((1u << VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2) - 1);
+    return min((octave << VKD3D_PROFILING_HISTOGRAM_SUB_BUCKETS_LOG2) + sub_bucket,
+            VKD3D_PROFILING_HISTOGRAM_BUCKETS - 1);
+}
+
 void vkd3d_profiling_notify_work(unsigned int index,
         uint64_t start_ticks, uint64_t end_ticks,
         unsigned int iteration_count)
 {
     struct vkd3d_profiling_block *block;
-    spinlock_t *lock;
+    uint64_t ticks, ticks_max;
 
     if (index == 0 || index > VKD3D_MAX_PROFILING_REGIONS || !mapped_blocks)
         return;
     index--;
 
-    lock = &region_locks[index];
-    block = &mapped_blocks[index];
+    block = &mapped_blocks->shards[vkd3d_profiling_get_shard()][index];
+    ticks = end_ticks - start_ticks;
 
-    spinlock_acquire(lock);
-    block->iteration_total += iteration_count;
-    block->ticks_total += end_ticks - start_ticks;
-    spinlock_release(lock);
+    vkd3d_atomic_uint64_add(&block->iteration_total, iteration_count, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_add(&block->ticks_total, ticks, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_increment(&block->sample_count, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_increment(&block->histogram[vkd3d_profiling_get_histogram_bucket(ticks)],
+            vkd3d_memory_order_relaxed);
+
+    ticks_max = vkd3d_atomic_uint64_load_explicit(&block->ticks_max, vkd3d_memory_order_relaxed);
+    while (ticks > ticks_max)
+    {
+        ticks_max = vkd3d_atomic_uint64_compare_exchange(&block->ticks_max, ticks_max, ticks,
+                vkd3d_memory_order_relaxed, vkd3d_memory_order_relaxed);
+    }
 }
 
 #endif /* VKD3D_ENABLE_PROFILING */
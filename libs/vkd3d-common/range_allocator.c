@@ -0,0 +1,320 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_range_allocator.h"
+#include "vkd3d_memory.h"
+
+#include <string.h>
+
+static inline unsigned int vkd3d_range_allocator_log2(uint64_t v)
+{
+    return (v >> 32) ? 32 + vkd3d_log2i(v >> 32) : vkd3d_log2i((uint32_t)v);
+}
+
+/* Size class which a free range of the given length lives in. */
+static void vkd3d_range_allocator_mapping_insert(uint64_t length, unsigned int *fl, unsigned int *sl)
+{
+    unsigned int l;
+
+    if (length < VKD3D_RANGE_ALLOCATOR_SL_COUNT)
+    {
+        *fl = 0;
+        *sl = length;
+    }
+    else
+    {
+        l = vkd3d_range_allocator_log2(length);
+        *fl = l - VKD3D_RANGE_ALLOCATOR_SL_LOG2 + 1;
+        *sl = (length >> (l - VKD3D_RANGE_ALLOCATOR_SL_LOG2)) - VKD3D_RANGE_ALLOCATOR_SL_COUNT;
+    }
+}
+
+/* Smallest size class where every free range is guaranteed to fit the given length. */
+static void vkd3d_range_allocator_mapping_search(uint64_t length, unsigned int *fl, unsigned int *sl)
+{
+    if (length >= VKD3D_RANGE_ALLOCATOR_SL_COUNT)
+        length += (1ull << (vkd3d_range_allocator_log2(length) - VKD3D_RANGE_ALLOCATOR_SL_LOG2)) - 1;
+    vkd3d_range_allocator_mapping_insert(length, fl, sl);
+}
+
+static uint32_t vkd3d_range_allocator_find_free(const struct vkd3d_range_allocator *allocator, uint64_t length)
+{
+    unsigned int fl, sl;
+    uint64_t fl_map;
+    uint32_t sl_map;
+
+    vkd3d_range_allocator_mapping_search(length, &fl, &sl);
+    if (fl >= VKD3D_RANGE_ALLOCATOR_FL_COUNT)
+        return VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+
+    sl_map = allocator->sl_bitmap[fl] & (~0u << sl);
+
+    if (!sl_map)
+    {
+        if (fl + 1 >= VKD3D_RANGE_ALLOCATOR_FL_COUNT)
+            return VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+
+        if (!(fl_map = allocator->fl_bitmap & (~0ull << (fl + 1))))
+            return VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+
+        fl = vkd3d_bitmask_tzcnt64(fl_map);
+        sl_map = allocator->sl_bitmap[fl];
+    }
+
+    sl = vkd3d_bitmask_tzcnt32(sl_map);
+    return allocator->free_lists[fl][sl];
+}
+
+static void vkd3d_range_allocator_insert_free(struct vkd3d_range_allocator *allocator, uint32_t index)
+{
+    struct vkd3d_range_allocator_node *node = &allocator->nodes[index];
+    unsigned int fl, sl;
+    uint32_t head;
+
+    vkd3d_range_allocator_mapping_insert(node->length, &fl, &sl);
+    head = allocator->free_lists[fl][sl];
+
+    node->is_free = true;
+    node->prev_free = VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+    node->next_free = head;
+    if (head != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+        allocator->nodes[head].prev_free = index;
+
+    allocator->free_lists[fl][sl] = index;
+    allocator->sl_bitmap[fl] |= 1u << sl;
+    allocator->fl_bitmap |= 1ull << fl;
+    allocator->free_range_count++;
+}
+
+static void vkd3d_range_allocator_remove_free(struct vkd3d_range_allocator *allocator, uint32_t index)
+{
+    struct vkd3d_range_allocator_node *node = &allocator->nodes[index];
+    unsigned int fl, sl;
+
+    vkd3d_range_allocator_mapping_insert(node->length, &fl, &sl);
+
+    if (node->prev_free != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+        allocator->nodes[node->prev_free].next_free = node->next_free;
+    else
+        allocator->free_lists[fl][sl] = node->next_free;
+
+    if (node->next_free != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+        allocator->nodes[node->next_free].prev_free = node->prev_free;
+
+    if (allocator->free_lists[fl][sl] == VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+    {
+        allocator->sl_bitmap[fl] &= ~(1u << sl);
+        if (!allocator->sl_bitmap[fl])
+            allocator->fl_bitmap &= ~(1ull << fl);
+    }
+
+    node->is_free = false;
+    allocator->free_range_count--;
+}
+
+/* Callers must have reserved space for the node. */
+static uint32_t vkd3d_range_allocator_alloc_node(struct vkd3d_range_allocator *allocator)
+{
+    uint32_t index;
+
+    if ((index = allocator->unused_nodes) != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+        allocator->unused_nodes = allocator->nodes[index].next_free;
+    else
+        index = allocator->nodes_count++;
+
+    return index;
+}
+
+static void vkd3d_range_allocator_release_node(struct vkd3d_range_allocator *allocator, uint32_t index)
+{
+    allocator->nodes[index].next_free = allocator->unused_nodes;
+    allocator->unused_nodes = index;
+}
+
+static bool vkd3d_range_allocator_node_fits(const struct vkd3d_range_allocator_node *node,
+        uint64_t size, uint64_t alignment)
+{
+    uint64_t aligned_offset = (node->offset + alignment - 1) & ~(alignment - 1);
+    return aligned_offset + size <= node->offset + node->length;
+}
+
+bool vkd3d_range_allocator_init(struct vkd3d_range_allocator *allocator, uint64_t size)
+{
+    struct vkd3d_range_allocator_node *node;
+
+    memset(allocator, 0, sizeof(*allocator));
+    memset(allocator->free_lists, 0xff, sizeof(allocator->free_lists));
+    allocator->unused_nodes = VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+
+    if (!size || !vkd3d_array_reserve((void **)&allocator->nodes, &allocator->nodes_size,
+            1, sizeof(*allocator->nodes)))
+        return false;
+
+    node = &allocator->nodes[vkd3d_range_allocator_alloc_node(allocator)];
+    node->offset = 0;
+    node->length = size;
+    node->prev_phys = VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+    node->next_phys = VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+    vkd3d_range_allocator_insert_free(allocator, 0);
+
+    allocator->size = size;
+    allocator->free_size = size;
+    return true;
+}
+
+void vkd3d_range_allocator_cleanup(struct vkd3d_range_allocator *allocator)
+{
+    vkd3d_free(allocator->nodes);
+    memset(allocator, 0, sizeof(*allocator));
+}
+
+bool vkd3d_range_allocator_allocate(struct vkd3d_range_allocator *allocator,
+        uint64_t size, uint64_t alignment, uint64_t *offset, uint32_t *handle)
+{
+    uint64_t aligned_offset, pad_length, tail_length;
+    struct vkd3d_range_allocator_node *node;
+    uint32_t index, split;
+
+    if (!alignment)
+        alignment = 1;
+
+    if (size > allocator->free_size)
+        return false;
+
+    /* Splitting a range creates at most two new nodes. Reserve up front so we cannot fail halfway. */
+    if (!vkd3d_array_reserve((void **)&allocator->nodes, &allocator->nodes_size,
+            allocator->nodes_count + 2, sizeof(*allocator->nodes)))
+        return false;
+
+    /* Offsets and sizes are almost always multiples of the alignment, so try a plain good fit first.
+     * Only fall back to padding the request when that does not work out. */
+    index = vkd3d_range_allocator_find_free(allocator, size);
+    if (index != VKD3D_RANGE_ALLOCATOR_INVALID_NODE &&
+            !vkd3d_range_allocator_node_fits(&allocator->nodes[index], size, alignment))
+        index = VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+
+    if (index == VKD3D_RANGE_ALLOCATOR_INVALID_NODE && alignment > 1)
+        index = vkd3d_range_allocator_find_free(allocator, size + alignment - 1);
+
+    if (index == VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+        return false;
+
+    vkd3d_range_allocator_remove_free(allocator, index);
+
+    node = &allocator->nodes[index];
+    aligned_offset = (node->offset + alignment - 1) & ~(alignment - 1);
+    pad_length = aligned_offset - node->offset;
+    tail_length = node->offset + node->length - aligned_offset - size;
+
+    /* Physical neighbors of a free range are never free themselves, so split-off ranges need no merging. */
+    if (pad_length)
+    {
+        split = vkd3d_range_allocator_alloc_node(allocator);
+        node = &allocator->nodes[index];
+        allocator->nodes[split].offset = node->offset;
+        allocator->nodes[split].length = pad_length;
+        allocator->nodes[split].prev_phys = node->prev_phys;
+        allocator->nodes[split].next_phys = index;
+        if (node->prev_phys != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+            allocator->nodes[node->prev_phys].next_phys = split;
+        node->prev_phys = split;
+        vkd3d_range_allocator_insert_free(allocator, split);
+    }
+
+    if (tail_length)
+    {
+        split = vkd3d_range_allocator_alloc_node(allocator);
+        node = &allocator->nodes[index];
+        allocator->nodes[split].offset = aligned_offset + size;
+        allocator->nodes[split].length = tail_length;
+        allocator->nodes[split].prev_phys = index;
+        allocator->nodes[split].next_phys = node->next_phys;
+        if (node->next_phys != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+            allocator->nodes[node->next_phys].prev_phys = split;
+        node->next_phys = split;
+        vkd3d_range_allocator_insert_free(allocator, split);
+    }
+
+    node = &allocator->nodes[index];
+    node->offset = aligned_offset;
+    node->length = size;
+    allocator->free_size -= size;
+
+    *offset = aligned_offset;
+    *handle = index;
+    return true;
+}
+
+void vkd3d_range_allocator_free(struct vkd3d_range_allocator *allocator, uint32_t handle)
+{
+    struct vkd3d_range_allocator_node *node, *neighbor;
+    uint32_t index = handle, neighbor_index;
+
+    node = &allocator->nodes[index];
+    allocator->free_size += node->length;
+
+    neighbor_index = node->prev_phys;
+    if (neighbor_index != VKD3D_RANGE_ALLOCATOR_INVALID_NODE && allocator->nodes[neighbor_index].is_free)
+    {
+        neighbor = &allocator->nodes[neighbor_index];
+        vkd3d_range_allocator_remove_free(allocator, neighbor_index);
+        neighbor->length += node->length;
+        neighbor->next_phys = node->next_phys;
+        if (node->next_phys != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+            allocator->nodes[node->next_phys].prev_phys = neighbor_index;
+        vkd3d_range_allocator_release_node(allocator, index);
+
+        index = neighbor_index;
+        node = neighbor;
+    }
+
+    neighbor_index = node->next_phys;
+    if (neighbor_index != VKD3D_RANGE_ALLOCATOR_INVALID_NODE && allocator->nodes[neighbor_index].is_free)
+    {
+        neighbor = &allocator->nodes[neighbor_index];
+        vkd3d_range_allocator_remove_free(allocator, neighbor_index);
+        node->length += neighbor->length;
+        node->next_phys = neighbor->next_phys;
+        if (neighbor->next_phys != VKD3D_RANGE_ALLOCATOR_INVALID_NODE)
+            allocator->nodes[neighbor->next_phys].prev_phys = index;
+        vkd3d_range_allocator_release_node(allocator, neighbor_index);
+    }
+
+    vkd3d_range_allocator_insert_free(allocator, index);
+}
+
+uint64_t vkd3d_range_allocator_get_largest_free_range(const struct vkd3d_range_allocator *allocator)
+{
+    uint64_t largest = 0;
+    unsigned int fl, sl;
+    uint32_t index;
+
+    if (!allocator->fl_bitmap)
+        return 0;
+
+    fl = vkd3d_range_allocator_log2(allocator->fl_bitmap);
+    sl = vkd3d_log2i(allocator->sl_bitmap[fl]);
+
+    for (index = allocator->free_lists[fl][sl]; index != VKD3D_RANGE_ALLOCATOR_INVALID_NODE;
+            index = allocator->nodes[index].next_free)
+        largest = max(largest, allocator->nodes[index].length);
+
+    return largest;
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_shared_cache.h"
+#include "vkd3d_atomic.h"
+#include "vkd3d_debug.h"
+#include "hashmap.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <inttypes.h>
+#include <string.h>
+
+#define VKD3D_SHARED_CACHE_MAGIC (((uint32_t)'V') | ((uint32_t)'K' << 8) | ((uint32_t)'H' << 16) | ((uint32_t)'2' << 24))
+#define VKD3D_SHARED_CACHE_ALIGNMENT 64
+/* Initializing the header is a handful of stores, so this only expires if the initializing process died. */
+#define VKD3D_SHARED_CACHE_INIT_TIMEOUT_NS 1000000000ull
+
+enum vkd3d_shared_cache_state
+{
+    /* A freshly created file reads as zero. */
+    VKD3D_SHARED_CACHE_STATE_EMPTY = 0,
+    VKD3D_SHARED_CACHE_STATE_INITIALIZING = 1,
+    VKD3D_SHARED_CACHE_STATE_READY = 2,
+};
+
+struct vkd3d_shared_cache_header
+{
+    uint32_t magic;
+    uint32_t state;
+    uint64_t compat_key;
+    uint64_t size;
+    uint32_t bucket_count;
+    uint32_t failed_publish_count;
+    uint64_t buckets_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    /* Bump allocator for the data region. May exceed data_size once the table is full. */
+    uint64_t data_used;
+    uint64_t entry_count;
+    uint64_t tag;
+    /* Records allocated below this offset were published before the tag was set. */
+    uint64_t tag_data_used;
+};
+
+struct vkd3d_shared_cache_bucket
+{
+    /* 0 while the bucket is free. Never changes once claimed. */
+    uint64_t key;
+    /* Offset of the record in the data region, 0 until the record is published. */
+    uint64_t record_offset;
+};
+
+struct vkd3d_shared_cache_record
+{
+    uint64_t hash;
+    uint64_t checksum;
+    uint64_t size;
+    uint32_t type;
+    uint32_t reserved;
+    uint8_t data[];
+};
+
+static uint64_t vkd3d_shared_cache_key(uint64_t hash, uint32_t type)
+{
+    uint64_t key = hash ^ ((uint64_t)hash_uint64(type) << 32);
+    /* 0 marks free buckets. */
+    return key ? key : 1;
+}
+
+static uint64_t vkd3d_shared_cache_record_checksum(uint64_t hash, uint32_t type, const void *data, size_t size)
+{
+    return hash_xxh64(data, size, hash ^ type);
+}
+
+static void vkd3d_shared_cache_sleep(void)
+{
+#ifdef _WIN32
+    Sleep(1);
+#else
+    usleep(1000);
+#endif
+}
+
+static bool vkd3d_shared_cache_init_header(struct vkd3d_shared_cache_header *header,
+        uint64_t compat_key, size_t size)
+{
+    uint64_t buckets_size, bucket_count;
+
+    /* Aim for buckets to take about 1/64th of the space. Blobs are typically several KiB,
+     * so the table should never get close to full before the data region does. */
+    bucket_count = 1;
+    while (bucket_count * 2 * 64 * sizeof(struct vkd3d_shared_cache_bucket) <= size && bucket_count < (1u << 30))
+        bucket_count *= 2;
+
+    buckets_size = bucket_count * sizeof(struct vkd3d_shared_cache_bucket);
+    header->buckets_offset = align(sizeof(*header), VKD3D_SHARED_CACHE_ALIGNMENT);
+    header->data_offset = align(header->buckets_offset + buckets_size, VKD3D_SHARED_CACHE_ALIGNMENT);
+
+    if (header->data_offset >= size)
+        return false;
+
+    header->compat_key = compat_key;
+    header->size = size;
+    header->bucket_count = bucket_count;
+    header->failed_publish_count = 0;
+    header->data_size = size - header->data_offset;
+    /* Offset 0 means unpublished, so start allocating after the first alignment unit. */
+    header->data_used = VKD3D_SHARED_CACHE_ALIGNMENT;
+    header->entry_count = 0;
+    header->tag = 0;
+    header->tag_data_used = 0;
+    header->magic = VKD3D_SHARED_CACHE_MAGIC;
+    return true;
+}
+
+static bool vkd3d_shared_cache_wait_ready(struct vkd3d_shared_cache_header *header,
+        uint64_t compat_key, size_t size)
+{
+    uint64_t start_ns = 0;
+    uint32_t state;
+
+    for (;;)
+    {
+        state = vkd3d_atomic_uint32_load_explicit(&header->state, vkd3d_memory_order_acquire);
+
+        if (state == VKD3D_SHARED_CACHE_STATE_READY)
+            return true;
+
+        if (state == VKD3D_SHARED_CACHE_STATE_EMPTY)
+        {
+            /* Whoever wins the race initializes the header, everyone else waits for it. */
+            if (vkd3d_atomic_uint32_compare_exchange(&header->state, VKD3D_SHARED_CACHE_STATE_EMPTY,
+                    VKD3D_SHARED_CACHE_STATE_INITIALIZING, vkd3d_memory_order_acquire,
+                    vkd3d_memory_order_relaxed) == VKD3D_SHARED_CACHE_STATE_EMPTY)
+            {
+                if (!vkd3d_shared_cache_init_header(header, compat_key, size))
+                {
+                    vkd3d_atomic_uint32_store_explicit(&header->state, VKD3D_SHARED_CACHE_STATE_EMPTY,
+                            vkd3d_memory_order_release);
+                    return false;
+                }
+
+                vkd3d_atomic_uint32_store_explicit(&header->state, VKD3D_SHARED_CACHE_STATE_READY,
+                        vkd3d_memory_order_release);
+                return true;
+            }
+
+            continue;
+        }
+
+        if (!start_ns)
+            start_ns = vkd3d_get_current_time_ns();
+        else if (vkd3d_get_current_time_ns() - start_ns > VKD3D_SHARED_CACHE_INIT_TIMEOUT_NS)
+            return false;
+
+        vkd3d_shared_cache_sleep();
+    }
+}
+
+static bool vkd3d_shared_cache_validate(const struct vkd3d_shared_cache_header *header,
+        uint64_t compat_key, size_t mapped_size)
+{
+    if (header->magic != VKD3D_SHARED_CACHE_MAGIC || header->compat_key != compat_key)
+        return false;
+
+    if (header->size > mapped_size || !header->bucket_count || !is_power_of_two(header->bucket_count))
+        return false;
+
+    if (header->buckets_offset < sizeof(*header) || header->data_offset < header->buckets_offset ||
+            header->bucket_count * sizeof(struct vkd3d_shared_cache_bucket) > header->data_offset - header->buckets_offset ||
+            header->data_offset > header->size || header->data_size > header->size - header->data_offset)
+        return false;
+
+    return true;
+}
+
+static bool vkd3d_shared_cache_try_open(struct vkd3d_shared_cache *cache, const char *path,
+        uint64_t compat_key, size_t size)
+{
+    struct vkd3d_shared_cache_header *header;
+
+    if (!vkd3d_file_map_shared(path, size, &cache->mapped_file))
+        return false;
+
+    if (cache->mapped_file.mapped_size < sizeof(*header))
+        goto fail;
+
+    header = cache->mapped_file.mapped;
+
+    if (!vkd3d_shared_cache_wait_ready(header, compat_key, size))
+    {
+        INFO("Shared cache %s was never initialized.\n", path);
+        goto fail;
+    }
+
+    if (!vkd3d_shared_cache_validate(header, compat_key, cache->mapped_file.mapped_size))
+    {
+        INFO("Shared cache %s is not compatible.\n", path);
+        goto fail;
+    }
+
+    cache->header = header;
+    cache->buckets = void_ptr_offset(header, header->buckets_offset);
+    cache->bucket_mask = header->bucket_count - 1;
+    cache->data = void_ptr_offset(header, header->data_offset);
+    cache->data_size = header->data_size;
+    return true;
+
+fail:
+    vkd3d_file_unmap(&cache->mapped_file);
+    return false;
+}
+
+bool vkd3d_shared_cache_open(struct vkd3d_shared_cache *cache, const char *path,
+        uint64_t compat_key, size_t size)
+{
+    memset(cache, 0, sizeof(*cache));
+
+    if (vkd3d_shared_cache_try_open(cache, path, compat_key, size))
+        return true;
+
+    /* Stale table, either from a different driver or abandoned mid-initialization.
+     * Processes which still map the old file keep using it, new processes will use the new file.
+     * This is expected to fail on Windows as long as any other process maps the file. */
+    if (!vkd3d_file_delete(path))
+        return false;
+
+    INFO("Recreating shared cache %s.\n", path);
+    return vkd3d_shared_cache_try_open(cache, path, compat_key, size);
+}
+
+void vkd3d_shared_cache_close(struct vkd3d_shared_cache *cache)
+{
+    vkd3d_file_unmap(&cache->mapped_file);
+    memset(cache, 0, sizeof(*cache));
+}
+
+static const struct vkd3d_shared_cache_record *vkd3d_shared_cache_get_record(
+        const struct vkd3d_shared_cache *cache, uint64_t record_offset)
+{
+    const struct vkd3d_shared_cache_record *record;
+
+    if (record_offset > cache->data_size || cache->data_size - record_offset < sizeof(*record))
+        return NULL;
+
+    record = (const struct vkd3d_shared_cache_record *)(cache->data + record_offset);
+
+    if (record->size > cache->data_size - record_offset - sizeof(*record))
+        return NULL;
+
+    return record;
+}
+
+bool vkd3d_shared_cache_find(const struct vkd3d_shared_cache *cache, uint64_t hash, uint32_t type,
+        const void **data, size_t *size)
+{
+    const struct vkd3d_shared_cache_record *record;
+    struct vkd3d_shared_cache_bucket *bucket;
+    uint64_t key, bucket_key, record_offset;
+    uint32_t i, index;
+
+    if (!cache->header)
+        return false;
+
+    key = vkd3d_shared_cache_key(hash, type);
+
+    for (i = 0, index = key & cache->bucket_mask; i <= cache->bucket_mask; i++, index = (index + 1) & cache->bucket_mask)
+    {
+        bucket = &cache->buckets[index];
+        bucket_key = vkd3d_atomic_uint64_load_explicit(&bucket->key, vkd3d_memory_order_acquire);
+
+        if (!bucket_key)
+            return false;
+        if (bucket_key != key)
+            continue;
+
+        /* Claimed, but the record may not be published yet. If the publishing process died in between,
+         * the key stays unavailable, which is harmless. */
+        record_offset = vkd3d_atomic_uint64_load_explicit(&bucket->record_offset, vkd3d_memory_order_acquire);
+        if (!record_offset || !(record = vkd3d_shared_cache_get_record(cache, record_offset)))
+            return false;
+
+        if (record->hash != hash || record->type != type)
+            return false;
+
+        /* Validate on every lookup since any process can write to the table. */
+        if (record->checksum != vkd3d_shared_cache_record_checksum(hash, type, record->data, record->size))
+        {
+            FIXME("Corrupt shared cache entry %016"PRIx64".\n", hash);
+            return false;
+        }
+
+        if (data)
+            *data = record->data;
+        if (size)
+            *size = record->size;
+        return true;
+    }
+
+    return false;
+}
+
+bool vkd3d_shared_cache_publish(struct vkd3d_shared_cache *cache, uint64_t hash, uint32_t type,
+        const void *data, size_t size)
+{
+    uint64_t key, bucket_key, record_offset, record_size;
+    struct vkd3d_shared_cache_record *record;
+    struct vkd3d_shared_cache_bucket *bucket;
+    uint32_t i, index;
+
+    if (!cache->header)
+        return false;
+
+    if (vkd3d_shared_cache_find(cache, hash, type, NULL, NULL))
+        return true;
+
+    record_size = align(sizeof(*record) + size, VKD3D_SHARED_CACHE_ALIGNMENT);
+    record_offset = vkd3d_atomic_uint64_add(&cache->header->data_used, record_size,
+            vkd3d_memory_order_relaxed) - record_size;
+
+    if (record_offset > cache->data_size || cache->data_size - record_offset < record_size)
+    {
+        vkd3d_atomic_uint32_increment(&cache->header->failed_publish_count, vkd3d_memory_order_relaxed);
+        return false;
+    }
+
+    /* Nobody else can see the record until it is published below. */
+    record = (struct vkd3d_shared_cache_record *)(cache->data + record_offset);
+    record->hash = hash;
+    record->size = size;
+    record->type = type;
+    record->reserved = 0;
+    memcpy(record->data, data, size);
+    record->checksum = vkd3d_shared_cache_record_checksum(hash, type, record->data, size);
+
+    key = vkd3d_shared_cache_key(hash, type);
+
+    for (i = 0, index = key & cache->bucket_mask; i <= cache->bucket_mask; i++, index = (index + 1) & cache->bucket_mask)
+    {
+        bucket = &cache->buckets[index];
+        bucket_key = vkd3d_atomic_uint64_load_explicit(&bucket->key, vkd3d_memory_order_acquire);
+
+        if (!bucket_key)
+        {
+            bucket_key = vkd3d_atomic_uint64_compare_exchange(&bucket->key, 0, key,
+                    vkd3d_memory_order_acq_rel, vkd3d_memory_order_acquire);
+
+            if (!bucket_key)
+            {
+                vkd3d_atomic_uint64_store_explicit(&bucket->record_offset, record_offset, vkd3d_memory_order_release);
+                vkd3d_atomic_uint64_increment(&cache->header->entry_count, vkd3d_memory_order_relaxed);
+                return true;
+            }
+        }
+
+        /* Somebody else got there first, the space reserved for our record is simply lost. */
+        if (bucket_key == key)
+            return true;
+    }
+
+    vkd3d_atomic_uint32_increment(&cache->header->failed_publish_count, vkd3d_memory_order_relaxed);
+    return false;
+}
+
+uint64_t vkd3d_shared_cache_get_tag(const struct vkd3d_shared_cache *cache)
+{
+    if (!cache->header)
+        return 0;
+
+    return vkd3d_atomic_uint64_load_explicit(&cache->header->tag, vkd3d_memory_order_acquire);
+}
+
+void vkd3d_shared_cache_set_tag(struct vkd3d_shared_cache *cache, uint64_t tag)
+{
+    uint64_t data_used;
+
+    if (!cache->header)
+        return;
+
+    data_used = vkd3d_atomic_uint64_load_explicit(&cache->header->data_used, vkd3d_memory_order_acquire);
+    vkd3d_atomic_uint64_store_explicit(&cache->header->tag_data_used, data_used, vkd3d_memory_order_relaxed);
+    vkd3d_atomic_uint64_store_explicit(&cache->header->tag, tag, vkd3d_memory_order_release);
+}
+
+bool vkd3d_shared_cache_is_tagged(const struct vkd3d_shared_cache *cache, const void *data)
+{
+    const struct vkd3d_shared_cache_record *record;
+    uint64_t record_offset;
+
+    if (!cache->header)
+        return false;
+
+    record = (const struct vkd3d_shared_cache_record *)((const uint8_t *)data - offsetof(struct vkd3d_shared_cache_record, data));
+    record_offset = (const uint8_t *)record - cache->data;
+    return record_offset < vkd3d_atomic_uint64_load_explicit(&cache->header->tag_data_used, vkd3d_memory_order_acquire);
+}
+
+void vkd3d_shared_cache_get_stats(const struct vkd3d_shared_cache *cache, struct vkd3d_shared_cache_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    if (!cache->header)
+        return;
+
+    stats->entry_count = vkd3d_atomic_uint64_load_explicit(&cache->header->entry_count, vkd3d_memory_order_relaxed);
+    stats->data_used = vkd3d_atomic_uint64_load_explicit(&cache->header->data_used, vkd3d_memory_order_relaxed);
+    stats->data_size = cache->data_size;
+    stats->bucket_count = cache->bucket_mask + 1;
+    stats->failed_publish_count = vkd3d_atomic_uint32_load_explicit(&cache->header->failed_publish_count,
+            vkd3d_memory_order_relaxed);
+
+    if (stats->data_used > stats->data_size)
+        stats->data_used = stats->data_size;
+}
@@ -832,7 +832,7 @@ int vkd3d_shader_parse_root_signature_raw(const char *data, unsigned int data_si
     if (compatibility_hash)
     {
         struct vkd3d_shader_code code = { data, data_size };
-        *compatibility_hash = vkd3d_shader_hash(&code);
+        *compatibility_hash = vkd3d_shader_hash_legacy(&code);
         vkd3d_shader_dump_shader(*compatibility_hash, &code, "rs");
     }
 
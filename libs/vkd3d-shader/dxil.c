@@ -1455,7 +1455,7 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
 
     dxil_spv_set_thread_log_callback(vkd3d_dxil_log_callback, NULL);
 
-    hash = spirv->meta.hash == 0 ? vkd3d_shader_hash(dxbc) : spirv->meta.hash;
+    hash = spirv->meta.hash == 0 ? vkd3d_shader_hash_legacy(dxbc) : spirv->meta.hash;
     memset(&spirv->meta, 0, sizeof(spirv->meta));
     spirv->meta.hash = hash;
 
@@ -1716,7 +1716,7 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
     dxil_spv_set_thread_log_callback(vkd3d_dxil_log_callback, NULL);
 
     memset(&spirv->meta, 0, sizeof(spirv->meta));
-    hash = vkd3d_shader_hash(dxil);
+    hash = vkd3d_shader_hash_legacy(dxil);
     spirv->meta.hash = hash;
 
     /* For user provided (not mangled) export names, just inherit that name. */
@@ -2308,7 +2308,7 @@ int vkd3d_shader_dxil_append_library_entry_points_and_subobjects(
     memset(&code, 0, sizeof(code));
     code.code = library_desc->DXILLibrary.pShaderBytecode;
     code.size = library_desc->DXILLibrary.BytecodeLength;
-    hash = vkd3d_shader_hash(&code);
+    hash = vkd3d_shader_hash_legacy(&code);
     vkd3d_shader_dump_shader(hash, &code, "lib.dxil");
 
     if (dxil_spv_parse_dxil_blob(
@@ -360,6 +360,11 @@ void vkd3d_shader_free_shader_signature(struct vkd3d_shader_signature *signature
 }
 
 vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader)
+{
+    return hash_xxh64(shader->code, shader->size, 0);
+}
+
+vkd3d_shader_hash_t vkd3d_shader_hash_legacy(const struct vkd3d_shader_code *shader)
 {
     vkd3d_shader_hash_t h = hash_fnv1_init();
     const uint8_t *code = shader->code;
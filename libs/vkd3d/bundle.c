@@ -26,34 +26,88 @@ static inline struct d3d12_bundle_allocator *impl_from_ID3D12CommandAllocator(ID
     return CONTAINING_RECORD(iface, struct d3d12_bundle_allocator, ID3D12CommandAllocator_iface);
 }
 
-static void *d3d12_bundle_allocator_alloc_chunk_data(struct d3d12_bundle_allocator *allocator, size_t size)
+static bool d3d12_bundle_allocator_prepare_chunk(struct d3d12_bundle_allocator *allocator,
+        size_t chunk_index, size_t size)
 {
-    size_t chunk_offset = 0;
-    void *chunk = NULL;
+    struct d3d12_bundle_chunk *chunk;
 
-    size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+    if (chunk_index == allocator->chunks_count)
+    {
+        if (!vkd3d_array_reserve((void **)&allocator->chunks, &allocator->chunks_size,
+                allocator->chunks_count + 1, sizeof(*allocator->chunks)))
+            return false;
 
-    if (allocator->chunks_count)
+        chunk = &allocator->chunks[allocator->chunks_count++];
+        chunk->data = NULL;
+        chunk->size = 0;
+    }
+
+    chunk = &allocator->chunks[chunk_index];
+
+    if (chunk->size < size)
     {
-        chunk = allocator->chunks[allocator->chunks_count - 1];
-        chunk_offset = allocator->chunk_offset;
+        /* Chunks only grow beyond the default size for unusually large commands. */
+        size = max(size, VKD3D_BUNDLE_CHUNK_SIZE);
+        vkd3d_free(chunk->data);
+
+        if (!(chunk->data = vkd3d_malloc(size)))
+        {
+            chunk->size = 0;
+            return false;
+        }
+
+        chunk->size = size;
     }
 
-    if (!chunk || chunk_offset + size > VKD3D_BUNDLE_CHUNK_SIZE)
+    return true;
+}
+
+static void *d3d12_bundle_allocator_alloc_command_data(struct d3d12_bundle_allocator *allocator, size_t size)
+{
+    const size_t jump_size = align(sizeof(struct d3d12_bundle_jump_command), VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+    struct d3d12_bundle_chunk *chunk = NULL;
+    struct d3d12_bundle_jump_command *jump;
+    size_t chunk_index;
+    void *data;
+
+    size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+
+    if (allocator->chunk_index < allocator->chunks_count)
+        chunk = &allocator->chunks[allocator->chunk_index];
+
+    /* Always leave enough space at the end of a chunk to link it to the next one. */
+    if (chunk && allocator->chunk_offset + size + jump_size <= chunk->size)
     {
-        if (!vkd3d_array_reserve((void **)&allocator->chunks, &allocator->chunks_size,
-                allocator->chunks_count + 1, sizeof(*allocator->chunks)))
-            return NULL;
+        data = void_ptr_offset(chunk->data, allocator->chunk_offset);
+        allocator->chunk_offset += size;
+        return data;
+    }
+
+    chunk_index = chunk ? allocator->chunk_index + 1 : allocator->chunk_index;
 
-        if (!(chunk = vkd3d_malloc(VKD3D_BUNDLE_CHUNK_SIZE)))
-            return NULL;
+    if (!d3d12_bundle_allocator_prepare_chunk(allocator, chunk_index, size + jump_size))
+        return NULL;
+
+    data = allocator->chunks[chunk_index].data;
 
-        allocator->chunks[allocator->chunks_count++] = chunk;
-        allocator->chunk_offset = chunk_offset = 0;
+    if (chunk)
+    {
+        jump = void_ptr_offset(allocator->chunks[allocator->chunk_index].data, allocator->chunk_offset);
+        memset(jump, 0, jump_size);
+        jump->command.size = jump_size;
+        jump->command.flags = VKD3D_BUNDLE_COMMAND_JUMP;
+        jump->next = data;
     }
 
-    allocator->chunk_offset = chunk_offset + size;
-    return void_ptr_offset(chunk, chunk_offset);
+    allocator->chunk_index = chunk_index;
+    allocator->chunk_offset = size;
+    return data;
+}
+
+static void d3d12_bundle_allocator_rewind(struct d3d12_bundle_allocator *allocator)
+{
+    allocator->chunk_index = 0;
+    allocator->chunk_offset = 0;
 }
 
 static void d3d12_bundle_allocator_free_chunks(struct d3d12_bundle_allocator *allocator)
@@ -61,13 +115,13 @@ static void d3d12_bundle_allocator_free_chunks(struct d3d12_bundle_allocator *al
     size_t i;
 
     for (i = 0; i < allocator->chunks_count; i++)
-        vkd3d_free(allocator->chunks[i]);
+        vkd3d_free(allocator->chunks[i].data);
 
     vkd3d_free(allocator->chunks);
     allocator->chunks = NULL;
     allocator->chunks_size = 0;
     allocator->chunks_count = 0;
-    allocator->chunk_offset = 0;
+    d3d12_bundle_allocator_rewind(allocator);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_bundle_allocator_QueryInterface(ID3D12CommandAllocator *iface,
@@ -187,10 +241,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_allocator_Reset(ID3D12CommandAlloc
         }
 
         bundle->head = NULL;
-        bundle->tail = NULL;
     }
 
-    d3d12_bundle_allocator_free_chunks(allocator);
+    /* Keep the chunks around, resetting is just a matter of rewinding the allocator. */
+    d3d12_bundle_allocator_rewind(allocator);
     return S_OK;
 }
 
@@ -250,19 +304,100 @@ static inline struct d3d12_bundle *impl_from_ID3D12GraphicsCommandList(d3d12_com
     return CONTAINING_RECORD(iface, struct d3d12_bundle, ID3D12GraphicsCommandList_iface);
 }
 
-void *d3d12_bundle_add_command(struct d3d12_bundle *bundle, pfn_d3d12_bundle_command proc, size_t size)
+/* Classifies recorded commands by the command list state they overwrite, so that Close() can drop
+ * state changes which are overwritten before anything observes them, or which set the value that is
+ * already current. Commands with the same key must fully overwrite the same state. */
+enum vkd3d_bundle_state_type
+{
+    /* May observe or modify any state. */
+    VKD3D_BUNDLE_STATE_OPAQUE = 0,
+    /* Observes state, but does not modify it, e.g. draws. */
+    VKD3D_BUNDLE_STATE_ACTION,
+    VKD3D_BUNDLE_STATE_PIPELINE,
+    VKD3D_BUNDLE_STATE_PRIMITIVE_TOPOLOGY,
+    VKD3D_BUNDLE_STATE_BLEND_FACTOR,
+    VKD3D_BUNDLE_STATE_STENCIL_REF,
+    VKD3D_BUNDLE_STATE_FRONT_AND_BACK_STENCIL_REF,
+    VKD3D_BUNDLE_STATE_DEPTH_BOUNDS,
+    VKD3D_BUNDLE_STATE_DEPTH_BIAS,
+    VKD3D_BUNDLE_STATE_SAMPLE_POSITIONS,
+    VKD3D_BUNDLE_STATE_VIEW_INSTANCE_MASK,
+    VKD3D_BUNDLE_STATE_SHADING_RATE,
+    VKD3D_BUNDLE_STATE_SHADING_RATE_BASE,
+    VKD3D_BUNDLE_STATE_SHADING_RATE_IMAGE,
+    VKD3D_BUNDLE_STATE_INDEX_BUFFER,
+    VKD3D_BUNDLE_STATE_STRIP_CUT_VALUE,
+    VKD3D_BUNDLE_STATE_VERTEX_BUFFERS,
+    VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_SIGNATURE,
+    VKD3D_BUNDLE_STATE_COMPUTE_ROOT_SIGNATURE,
+    /* Root arguments are only meaningful relative to the current root signature of the same bind point. */
+    VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_TABLE,
+    VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_DESCRIPTOR,
+    VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_CONSTANTS,
+    VKD3D_BUNDLE_STATE_COMPUTE_ROOT_TABLE,
+    VKD3D_BUNDLE_STATE_COMPUTE_ROOT_DESCRIPTOR,
+    VKD3D_BUNDLE_STATE_COMPUTE_ROOT_CONSTANTS,
+    VKD3D_BUNDLE_STATE_COUNT
+};
+
+static uint64_t d3d12_bundle_state_key(enum vkd3d_bundle_state_type type,
+        uint32_t index, uint32_t offset, uint32_t count)
+{
+    /* Keys must not alias, so don't bother tracking anything out of range. */
+    if (index > UINT16_MAX || offset > UINT16_MAX || count > UINT16_MAX)
+        return VKD3D_BUNDLE_STATE_OPAQUE;
+
+    return ((uint64_t)type << 48) | ((uint64_t)index << 32) | ((uint64_t)offset << 16) | count;
+}
+
+static enum vkd3d_bundle_state_type d3d12_bundle_state_key_get_type(uint64_t state_key)
+{
+    return state_key >> 48;
+}
+
+/* State types whose keys may partially overlap each other map to the same family. */
+static enum vkd3d_bundle_state_type d3d12_bundle_state_type_get_family(enum vkd3d_bundle_state_type type)
+{
+    switch (type)
+    {
+        case VKD3D_BUNDLE_STATE_FRONT_AND_BACK_STENCIL_REF:
+            return VKD3D_BUNDLE_STATE_STENCIL_REF;
+        case VKD3D_BUNDLE_STATE_SHADING_RATE_BASE:
+            return VKD3D_BUNDLE_STATE_SHADING_RATE;
+        default:
+            return type;
+    }
+}
+
+void *d3d12_bundle_add_command(struct d3d12_bundle *bundle, pfn_d3d12_bundle_command proc,
+        size_t size, uint64_t state_key)
 {
-    struct d3d12_bundle_command *command = d3d12_bundle_allocator_alloc_chunk_data(bundle->allocator, size);
+    struct d3d12_bundle_command *command;
 
+    size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+    command = d3d12_bundle_allocator_alloc_command_data(bundle->allocator, size);
+
+    /* Clear padding so that commands can be compared with memcmp. */
+    memset(command, 0, size);
     command->proc = proc;
-    command->next = NULL;
+    command->state_key = state_key;
+    command->size = size;
 
-    if (bundle->tail)
-        bundle->tail->next = command;
-    else
+    if (!bundle->head)
         bundle->head = command;
 
-    bundle->tail = command;
+    return command;
+}
+
+/* Returns the command following the given one in the stream. The stream ends with a zero-sized command. */
+static struct d3d12_bundle_command *d3d12_bundle_command_next(struct d3d12_bundle_command *command)
+{
+    command = void_ptr_offset(command, command->size);
+
+    /* The jump target is always a regular command, so jumps never chain. */
+    if (command->flags & VKD3D_BUNDLE_COMMAND_JUMP)
+        command = ((struct d3d12_bundle_jump_command *)command)->next;
+
     return command;
 }
 
@@ -389,9 +524,181 @@ static D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE d3d12_bundle_GetType(d3d12_comm
     return D3D12_COMMAND_LIST_TYPE_BUNDLE;
 }
 
+struct d3d12_bundle_state_entry
+{
+    struct hash_map_entry entry;
+    uint64_t state_key;
+    /* Bumped whenever the root signature of the respective bind point changes, since root
+     * arguments recorded against different root signatures do not refer to the same state. */
+    uint32_t generation;
+    /* Last command which modified the state and was not itself redundant. */
+    struct d3d12_bundle_command *command;
+    /* Number of actions recorded before the command, or UINT32_MAX if the state has been observed. */
+    uint32_t action_count;
+    /* Number of writes to the state family up to and including the command. */
+    uint32_t family_write_count;
+};
+
+static uint32_t d3d12_bundle_state_entry_hash(const void *key)
+{
+    const struct d3d12_bundle_state_entry *k = key;
+
+    return hash_combine(hash_uint64(k->state_key), k->generation);
+}
+
+static bool d3d12_bundle_state_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct d3d12_bundle_state_entry *e = (const struct d3d12_bundle_state_entry *)entry;
+    const struct d3d12_bundle_state_entry *k = key;
+
+    return k->state_key == e->state_key && k->generation == e->generation;
+}
+
+static bool d3d12_bundle_commands_are_equal(const struct d3d12_bundle_command *a,
+        const struct d3d12_bundle_command *b)
+{
+    return a->proc == b->proc && a->size == b->size &&
+            !memcmp(a + 1, b + 1, a->size - sizeof(*a));
+}
+
+static void d3d12_bundle_observe_root_signature(struct hash_map *map, enum vkd3d_bundle_state_type type)
+{
+    struct d3d12_bundle_state_entry key, *entry;
+
+    memset(&key, 0, sizeof(key));
+    key.state_key = d3d12_bundle_state_key(type, 0, 0, 0);
+
+    if ((entry = (struct d3d12_bundle_state_entry *)hash_map_find(map, &key)))
+        entry->action_count = UINT32_MAX;
+}
+
+static unsigned int d3d12_bundle_remove_redundant_state(struct d3d12_bundle *bundle)
+{
+    uint32_t graphics_generation = 0, compute_generation = 0, action_count = 0;
+    uint32_t family_write_counts[VKD3D_BUNDLE_STATE_COUNT];
+    enum vkd3d_bundle_state_type type, family;
+    struct d3d12_bundle_state_entry key, *entry;
+    struct d3d12_bundle_command *command;
+    unsigned int redundant_count = 0;
+    struct hash_map map;
+
+    memset(family_write_counts, 0, sizeof(family_write_counts));
+
+    hash_map_init(&map, d3d12_bundle_state_entry_hash, d3d12_bundle_state_entry_compare, sizeof(key));
+    memset(&key, 0, sizeof(key));
+
+    for (command = bundle->head; command->size; command = d3d12_bundle_command_next(command))
+    {
+        type = d3d12_bundle_state_key_get_type(command->state_key);
+        family = d3d12_bundle_state_type_get_family(type);
+        key.state_key = command->state_key;
+        key.generation = 0;
+
+        switch (type)
+        {
+            case VKD3D_BUNDLE_STATE_OPAQUE:
+                hash_map_clear(&map);
+                action_count++;
+                continue;
+
+            case VKD3D_BUNDLE_STATE_ACTION:
+                action_count++;
+                continue;
+
+            case VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_TABLE:
+            case VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_DESCRIPTOR:
+            case VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_CONSTANTS:
+                /* Root arguments are interpreted through the current root signature. */
+                d3d12_bundle_observe_root_signature(&map, VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_SIGNATURE);
+                key.generation = graphics_generation;
+                break;
+
+            case VKD3D_BUNDLE_STATE_COMPUTE_ROOT_TABLE:
+            case VKD3D_BUNDLE_STATE_COMPUTE_ROOT_DESCRIPTOR:
+            case VKD3D_BUNDLE_STATE_COMPUTE_ROOT_CONSTANTS:
+                d3d12_bundle_observe_root_signature(&map, VKD3D_BUNDLE_STATE_COMPUTE_ROOT_SIGNATURE);
+                key.generation = compute_generation;
+                break;
+
+            default:
+                break;
+        }
+
+        if ((entry = (struct d3d12_bundle_state_entry *)hash_map_find(&map, &key)))
+        {
+            /* Setting the current value again is a no-op, unless an overlapping
+             * command modified part of the state in the meantime. */
+            if (entry->family_write_count == family_write_counts[family] &&
+                    d3d12_bundle_commands_are_equal(entry->command, command))
+            {
+                command->flags |= VKD3D_BUNDLE_COMMAND_REDUNDANT;
+                redundant_count++;
+                continue;
+            }
+
+            /* Nothing observed the previous value before it got overwritten. Changing the root signature
+             * has side effects on root arguments though, so never consider that dead. */
+            if (entry->action_count == action_count &&
+                    type != VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_SIGNATURE &&
+                    type != VKD3D_BUNDLE_STATE_COMPUTE_ROOT_SIGNATURE)
+            {
+                entry->command->flags |= VKD3D_BUNDLE_COMMAND_REDUNDANT;
+                redundant_count++;
+            }
+
+            entry->command = command;
+            entry->action_count = action_count;
+            entry->family_write_count = ++family_write_counts[family];
+        }
+        else
+        {
+            key.command = command;
+            key.action_count = action_count;
+            key.family_write_count = ++family_write_counts[family];
+
+            if (!hash_map_insert(&map, &key, &key.entry))
+            {
+                /* Cannot track the state anymore, so stop here. Everything so far is still valid. */
+                break;
+            }
+        }
+
+        /* Setting a different root signature invalidates all root arguments. */
+        if (type == VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_SIGNATURE)
+            graphics_generation++;
+        else if (type == VKD3D_BUNDLE_STATE_COMPUTE_ROOT_SIGNATURE)
+            compute_generation++;
+    }
+
+    hash_map_free(&map);
+    return redundant_count;
+}
+
+static HRESULT d3d12_bundle_end_command_stream(struct d3d12_bundle *bundle)
+{
+    struct d3d12_bundle_command *command;
+    unsigned int redundant_count = 0;
+
+    /* A zero-sized command terminates the stream. */
+    if (!(command = d3d12_bundle_allocator_alloc_command_data(bundle->allocator, sizeof(*command))))
+        return E_OUTOFMEMORY;
+
+    memset(command, 0, sizeof(*command));
+
+    if (!bundle->head)
+        bundle->head = command;
+
+    if (!VKD3D_CONFIG_FLAG_IS_SET(NO_BUNDLE_OPTIMIZE))
+        redundant_count = d3d12_bundle_remove_redundant_state(bundle);
+
+    TRACE("Bundle %p: %u redundant state changes removed.\n", bundle, redundant_count);
+    return S_OK;
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_bundle_Close(d3d12_command_list_iface *iface)
 {
     struct d3d12_bundle *bundle = impl_from_ID3D12GraphicsCommandList(iface);
+    HRESULT hr;
 
     TRACE("iface %p.\n", iface);
 
@@ -402,6 +709,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_Close(d3d12_command_list_iface *if
     }
 
     bundle->is_recording = false;
+
+    if (FAILED(hr = d3d12_bundle_end_command_stream(bundle)))
+        return hr;
+
     return S_OK;
 }
 
@@ -435,7 +746,6 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_Reset(d3d12_command_list_iface *if
     bundle->is_recording = true;
     bundle->allocator = bundle_allocator;
     bundle->head = NULL;
-    bundle->tail = NULL;
 
     bundle_allocator->current_bundle = bundle;
 
@@ -480,7 +790,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_DrawInstanced(d3d12_command_list_ifac
             iface, vertex_count_per_instance, instance_count,
             start_vertex_location, start_instance_location);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_draw_instanced, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_draw_instanced, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->vertex_count = vertex_count_per_instance;
     args->instance_count = instance_count;
     args->first_vertex = start_vertex_location;
@@ -518,7 +829,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_DrawIndexedInstanced(d3d12_command_li
             iface, index_count_per_instance, instance_count, start_vertex_location,
             base_vertex_location, start_instance_location);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_draw_indexed_instanced, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_draw_indexed_instanced, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->index_count = index_count_per_instance;
     args->instance_count = instance_count;
     args->first_index = start_vertex_location;
@@ -547,7 +859,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_Dispatch(d3d12_command_list_iface *if
 
     TRACE("iface %p, x %u, y %u, z %u.\n", iface, x, y, z);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->x = x;
     args->y = y;
     args->z = z;
@@ -615,7 +928,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetPrimitiveTopology(d3d12_command_
 
     TRACE("iface %p, topology %#x.\n", iface, topology);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_primitive_topology, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_primitive_topology, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_PRIMITIVE_TOPOLOGY, 0, 0, 0));
     args->topology = topology;
 }
 
@@ -653,7 +967,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetBlendFactor(d3d12_command_list_i
 
     TRACE("iface %p, blend_factor %p.\n", iface, blend_factor);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_blend_factor, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_blend_factor, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_BLEND_FACTOR, 0, 0, 0));
 
     for (i = 0; i < 4; i++)
         args->blend_factor[i] = blend_factor[i];
@@ -680,7 +995,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetStencilRef(d3d12_command_list_if
 
     TRACE("iface %p, stencil_ref %u.\n", iface, stencil_ref);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_stencil_ref, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_stencil_ref, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_STENCIL_REF, 0, 0, 0));
     args->stencil_ref = stencil_ref;
 }
 
@@ -705,7 +1021,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetPipelineState(d3d12_command_list_i
 
     TRACE("iface %p, pipeline_state %p.\n", iface, pipeline_state);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_PIPELINE, 0, 0, 0));
     args->pipeline_state = pipeline_state;
 }
 
@@ -749,7 +1066,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootSignature(d3d12_command
 
     TRACE("iface %p, root_signature %p.\n", iface, root_signature);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_signature, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_signature, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_SIGNATURE, 0, 0, 0));
     args->root_signature = root_signature;
 }
 
@@ -768,7 +1086,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootSignature(d3d12_comman
 
     TRACE("iface %p, root_signature %p.\n", iface, root_signature);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_signature, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_signature, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_SIGNATURE, 0, 0, 0));
     args->root_signature = root_signature;
 }
 
@@ -795,7 +1114,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootDescriptorTable(d3d12_c
     TRACE("iface %p, root_parameter_index %u, base_descriptor %#"PRIx64".\n",
             iface, root_parameter_index, base_descriptor.ptr);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_descriptor_table, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_descriptor_table, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_TABLE, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->base_descriptor = base_descriptor;
 }
@@ -816,7 +1136,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootDescriptorTable(d3d12_
     TRACE("iface %p, root_parameter_index %u, base_descriptor %#"PRIx64".\n",
             iface, root_parameter_index, base_descriptor.ptr);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_descriptor_table, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_descriptor_table, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_TABLE, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->base_descriptor = base_descriptor;
 }
@@ -845,7 +1166,9 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRoot32BitConstant(d3d12_com
     TRACE("iface %p, root_parameter_index %u, data 0x%08x, dst_offset %u.\n",
             iface, root_parameter_index, data, dst_offset);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constant, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constant, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_CONSTANTS,
+                    root_parameter_index, dst_offset, 1));
     args->parameter_index = root_parameter_index;
     args->data = data;
     args->offset = dst_offset;
@@ -867,7 +1190,9 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRoot32BitConstant(d3d12_co
     TRACE("iface %p, root_parameter_index %u, data 0x%08x, dst_offset %u.\n",
             iface, root_parameter_index, data, dst_offset);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constant, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constant, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_CONSTANTS,
+                    root_parameter_index, dst_offset, 1));
     args->parameter_index = root_parameter_index;
     args->data = data;
     args->offset = dst_offset;
@@ -903,7 +1228,9 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRoot32BitConstants(d3d12_co
         return;
 
     args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constants,
-            sizeof(*args) + sizeof(UINT) * constant_count);
+            sizeof(*args) + sizeof(UINT) * constant_count,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_CONSTANTS,
+                    root_parameter_index, dst_offset, constant_count));
     args->parameter_index = root_parameter_index;
     args->constant_count = constant_count;
     args->offset = dst_offset;
@@ -931,7 +1258,9 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRoot32BitConstants(d3d12_c
         return;
 
     args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constants,
-            sizeof(*args) + sizeof(UINT) * constant_count);
+            sizeof(*args) + sizeof(UINT) * constant_count,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_CONSTANTS,
+                    root_parameter_index, dst_offset, constant_count));
     args->parameter_index = root_parameter_index;
     args->constant_count = constant_count;
     args->offset = dst_offset;
@@ -961,7 +1290,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootConstantBufferView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_cbv, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_cbv, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -982,7 +1312,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootConstantBufferView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_cbv, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_cbv, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -1003,7 +1334,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootShaderResourceView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_srv, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_srv, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -1024,7 +1356,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootShaderResourceView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_srv, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_srv, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -1045,7 +1378,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootUnorderedAccessView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_uav, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_uav, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_COMPUTE_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -1066,7 +1400,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootUnorderedAccessView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_uav, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_uav, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_GRAPHICS_ROOT_DESCRIPTOR, root_parameter_index, 0, 0));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
@@ -1099,13 +1434,15 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetIndexBuffer(d3d12_command_list_i
     if (view)
     {
         struct d3d12_ia_set_index_buffer_command *args;
-        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer, sizeof(*args));
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer, sizeof(*args),
+                d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_INDEX_BUFFER, 0, 0, 0));
         args->view = *view;
     }
     else
     {
         /* Faithfully pass NULL to the command list during replay to avoid potential pitfalls */
-        d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer_null, sizeof(struct d3d12_bundle_command));
+        d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer_null,
+                sizeof(struct d3d12_bundle_command), d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_INDEX_BUFFER, 0, 0, 0));
     }
 }
 
@@ -1136,7 +1473,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetVertexBuffers(d3d12_command_list
         return;
 
     args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_vertex_buffers,
-            sizeof(*args) + sizeof(*views) * view_count);
+            sizeof(*args) + sizeof(*views) * view_count,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_VERTEX_BUFFERS, start_slot, 0, view_count));
     args->start_slot = start_slot;
     args->view_count = view_count;
     memcpy(args->views, views, sizeof(*views) * view_count);
@@ -1247,7 +1585,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetMarker(d3d12_command_list_iface *i
 
     TRACE("iface %p, metadata %u, data %p, size %u.\n", iface, metadata, data, size);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_marker, sizeof(*args) + size);
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_marker, sizeof(*args) + size,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->metadata = metadata;
     args->data_size = size;
     memcpy(args->data, data, size);
@@ -1268,7 +1607,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_BeginEvent(d3d12_command_list_iface *
 
     TRACE("iface %p, metadata %u, data %p, size %u.\n", iface, metadata, data, size);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_begin_event, sizeof(*args) + size);
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_begin_event, sizeof(*args) + size,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->metadata = metadata;
     args->data_size = size;
     memcpy(args->data, data, size);
@@ -1285,7 +1625,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_EndEvent(d3d12_command_list_iface *if
 
     TRACE("iface %p.\n", iface);
 
-    d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_end_event, sizeof(struct d3d12_bundle_command));
+    d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_end_event, sizeof(struct d3d12_bundle_command),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
 }
 
 struct d3d12_execute_indirect_command
@@ -1319,7 +1660,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_ExecuteIndirect(d3d12_command_list_if
             iface, command_signature, max_command_count, arg_buffer, arg_buffer_offset,
             count_buffer, count_buffer_offset);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_execute_indirect, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_execute_indirect, sizeof(*args),
+            VKD3D_BUNDLE_STATE_OPAQUE);
     args->signature = command_signature;
     args->max_count = max_command_count;
     args->arg_buffer = arg_buffer;
@@ -1376,7 +1718,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetDepthBounds(d3d12_command_list_i
 
     TRACE("iface %p, min %.8e, max %.8e.\n", iface, min, max);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_depth_bounds, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_depth_bounds, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_DEPTH_BOUNDS, 0, 0, 0));
     args->min = min;
     args->max = max;
 }
@@ -1409,7 +1752,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetSamplePositions(d3d12_command_list
             iface, sample_count, pixel_count, sample_positions);
 
     args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_sample_positions,
-            sizeof(*args) + sizeof(*sample_positions) * array_size);
+            sizeof(*args) + sizeof(*sample_positions) * array_size,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_SAMPLE_POSITIONS, 0, 0, 0));
     args->sample_count = sample_count;
     args->pixel_count = pixel_count;
     memcpy(args->positions, sample_positions, sizeof(*sample_positions) * array_size);
@@ -1447,7 +1791,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetViewInstanceMask(d3d12_command_lis
 
     TRACE("iface %p, mask %#x.\n", iface, mask);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_view_instance_mask, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_view_instance_mask, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_VIEW_INSTANCE_MASK, 0, 0, 0));
     args->mask = mask;
 }
 
@@ -1455,15 +1800,20 @@ struct d3d12_write_buffer_immediate_command
 {
     struct d3d12_bundle_command command;
     UINT count;
-    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *parameters;
-    D3D12_WRITEBUFFERIMMEDIATE_MODE *modes;
+    bool has_modes;
+    /* Followed by modes if has_modes is set. */
+    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER parameters[];
 };
 
 static void d3d12_bundle_exec_write_buffer_immediate(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_write_buffer_immediate_command *args = args_v;
+    const D3D12_WRITEBUFFERIMMEDIATE_MODE *modes = NULL;
+
+    if (args->has_modes)
+        modes = (const D3D12_WRITEBUFFERIMMEDIATE_MODE *)&args->parameters[args->count];
 
-    ID3D12GraphicsCommandList10_WriteBufferImmediate(list, args->count, args->parameters, args->modes);
+    ID3D12GraphicsCommandList10_WriteBufferImmediate(list, args->count, args->parameters, modes);
 }
 
 static void STDMETHODCALLTYPE d3d12_bundle_WriteBufferImmediate(d3d12_command_list_iface *iface,
@@ -1472,24 +1822,26 @@ static void STDMETHODCALLTYPE d3d12_bundle_WriteBufferImmediate(d3d12_command_li
 {
     struct d3d12_bundle *bundle = impl_from_ID3D12GraphicsCommandList(iface);
     struct d3d12_write_buffer_immediate_command *args;
+    size_t size;
 
     TRACE("iface %p, count %u, parameters %p, modes %p.\n", iface, count, parameters, modes);
 
     if (!count)
         return;
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_write_buffer_immediate, sizeof(*args));
+    size = offsetof(struct d3d12_write_buffer_immediate_command, parameters[count]);
+
+    if (modes)
+        size += sizeof(*modes) * count;
+
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_write_buffer_immediate, size,
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->count = count;
-    args->parameters = d3d12_bundle_allocator_alloc_chunk_data(bundle->allocator, sizeof(*parameters) * count);
+    args->has_modes = !!modes;
     memcpy(args->parameters, parameters, sizeof(*parameters) * count);
 
     if (modes)
-    {
-        args->modes = d3d12_bundle_allocator_alloc_chunk_data(bundle->allocator, sizeof(*modes) * count);
-        memcpy(args->modes, modes, sizeof(*modes) * count);
-    }
-    else
-        args->modes = NULL;
+        memcpy(&args->parameters[count], modes, sizeof(*modes) * count);
 }
 
 static void STDMETHODCALLTYPE d3d12_bundle_SetProtectedResourceSession(d3d12_command_list_iface *iface,
@@ -1570,7 +1922,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetPipelineState1(d3d12_command_list_
 
     TRACE("iface %p, state_object %p.\n", iface, state_object);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state1, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state1, sizeof(*args),
+            VKD3D_BUNDLE_STATE_OPAQUE);
     args->state_object = state_object;
 }
 
@@ -1595,7 +1948,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_DispatchRays(d3d12_command_list_iface
 
     TRACE("iface %p, desc %p\n", iface, desc);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch_rays, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch_rays, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->desc = *desc;
 }
 
@@ -1628,9 +1982,12 @@ static void STDMETHODCALLTYPE d3d12_bundle_RSSetShadingRate(d3d12_command_list_i
 
     TRACE("iface %p, base %#x, combiners %p.\n", iface, base, combiners);
 
+    /* Without combiners, only the base rate is set, so the two forms are tracked as separate state. */
     args = d3d12_bundle_add_command(bundle, combiners
             ? &d3d12_bundle_exec_rs_set_shading_rate
-            : &d3d12_bundle_exec_rs_set_shading_rate_base, sizeof(*args));
+            : &d3d12_bundle_exec_rs_set_shading_rate_base, sizeof(*args),
+            d3d12_bundle_state_key(combiners ? VKD3D_BUNDLE_STATE_SHADING_RATE
+                    : VKD3D_BUNDLE_STATE_SHADING_RATE_BASE, 0, 0, 0));
     args->base = base;
 
     if (combiners)
@@ -1658,7 +2015,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_RSSetShadingRateImage(d3d12_command_l
 
     TRACE("iface %p, image %p.\n", iface, image);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_rs_set_shading_rate_image, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_rs_set_shading_rate_image, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_SHADING_RATE_IMAGE, 0, 0, 0));
     args->image = image;
 }
 
@@ -1676,7 +2034,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_DispatchMesh(d3d12_command_list_iface
 
     TRACE("iface %p, x %u, y %u, z %u.\n", iface, x, y, z);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch_mesh, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_dispatch_mesh, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_ACTION, 0, 0, 0));
     args->x = x;
     args->y = y;
     args->z = z;
@@ -1709,7 +2068,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetFrontAndBackStencilRef(d3d12_com
 
     TRACE("iface %p, FrontStencilRef %u, BackStencilRef %u.\n", iface, FrontStencilRef, BackStencilRef);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_front_and_back_stencil_ref, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_front_and_back_stencil_ref, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_FRONT_AND_BACK_STENCIL_REF, 0, 0, 0));
     args->stencil_ref_front = FrontStencilRef;
     args->stencil_ref_back = BackStencilRef;
 }
@@ -1737,7 +2097,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_RSSetDepthBias(d3d12_command_list_ifa
 
     TRACE("iface %p, DepthBias %f, DepthBiasClamp %f, SlopeScaledDepthBias %f.\n", iface, DepthBias, DepthBiasClamp, SlopeScaledDepthBias);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_rs_set_depth_bias, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_rs_set_depth_bias, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_DEPTH_BIAS, 0, 0, 0));
     args->constant_factor = DepthBias;
     args->clamp = DepthBiasClamp;
     args->slope_factor = SlopeScaledDepthBias;
@@ -1775,7 +2136,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetIndexBufferStripCutValue(d3d12_c
 
     TRACE("iface %p, IBStripCutValue %u.\n", iface, IBStripCutValue);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer_strip_cut_value, sizeof(*args));
+    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_index_buffer_strip_cut_value, sizeof(*args),
+            d3d12_bundle_state_key(VKD3D_BUNDLE_STATE_STRIP_CUT_VALUE, 0, 0, 0));
     args->strip_cut_value = IBStripCutValue;
 }
 
@@ -1911,12 +2273,22 @@ HRESULT d3d12_bundle_create(struct d3d12_device *device,
 
 void d3d12_bundle_execute(struct d3d12_bundle *bundle, d3d12_command_list_iface *list)
 {
-    struct d3d12_bundle_command *command = bundle->head;
+    const struct d3d12_bundle_command *command = bundle->head, *next;
 
-    while (command)
+    if (!command)
+        return;
+
+    while (command->size)
     {
-        command->proc(list, command);
-        command = command->next;
+        /* Compute the next record up front so that walking the stream does not wait for the callee. */
+        next = (const void *)((const uint8_t *)command + command->size);
+
+        if (command->flags & VKD3D_BUNDLE_COMMAND_JUMP)
+            next = ((const struct d3d12_bundle_jump_command *)command)->next;
+        else if (!(command->flags & VKD3D_BUNDLE_COMMAND_REDUNDANT))
+            command->proc(list, command);
+
+        command = next;
     }
 }
 
@@ -21,6 +21,7 @@
 
 #include "vkd3d_private.h"
 #include "vkd3d_shader.h"
+#include "vkd3d_compress.h"
 
 struct vkd3d_cached_pipeline_key
 {
@@ -181,7 +182,7 @@ VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
     return VK_CALL(vkCreatePipelineCache(device->vk_device, &info, NULL, cache));
 }
 
-#define VKD3D_CACHE_BLOB_VERSION MAKE_MAGIC('V','K','B',4)
+#define VKD3D_CACHE_BLOB_VERSION MAKE_MAGIC('V','K','B',6)
 
 enum vkd3d_pipeline_blob_chunk_type
 {
@@ -200,6 +201,8 @@ enum vkd3d_pipeline_blob_chunk_type
     VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PSO_COMPAT = 5,
     /* VkShaderStage is stored in upper 16 bits. */
     VKD3D_PIPELINE_BLOB_CHUNK_TYPE_SHADER_IDENTIFIER = 6,
+    /* Array of vkd3d_pipeline_blob_chunk_variant. Fallback pipelines which were needed at draw time. */
+    VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_VARIANTS = 7,
     VKD3D_PIPELINE_BLOB_CHUNK_TYPE_MASK = 0xffff,
     VKD3D_PIPELINE_BLOB_CHUNK_INDEX_SHIFT = 16,
 };
@@ -211,13 +214,33 @@ struct vkd3d_pipeline_blob_chunk
     uint8_t data[] vkd3d_counted_by(size); /* struct vkd3d_pipeline_blob_chunk_*. */
 };
 
+enum vkd3d_pipeline_blob_compression
+{
+    VKD3D_PIPELINE_BLOB_COMPRESSION_NONE = 0,
+    /* vkd3d_lz_compress(). */
+    VKD3D_PIPELINE_BLOB_COMPRESSION_LZ = 1,
+};
+
+/* Payloads smaller than this are not worth the decode overhead. */
+#define VKD3D_PIPELINE_BLOB_COMPRESSION_MIN_SIZE 256
+
 struct vkd3d_pipeline_blob_chunk_spirv
 {
     uint32_t decompressed_spirv_size;
+    uint32_t varint_spirv_size; /* Size of the VARINT stream before compression. */
     uint32_t compressed_spirv_size; /* Size of data[]. */
+    uint32_t compression; /* enum vkd3d_pipeline_blob_compression. */
     uint8_t data[] vkd3d_counted_by(compressed_spirv_size);
 };
 
+/* Pipeline cache payload of internal blobs. Size of data[] is implied by the blob size. */
+struct vkd3d_pipeline_blob_driver_cache
+{
+    uint32_t decompressed_size;
+    uint32_t compression; /* enum vkd3d_pipeline_blob_compression. */
+    uint8_t data[];
+};
+
 struct vkd3d_pipeline_blob_chunk_link
 {
     uint64_t hash;
@@ -233,10 +256,23 @@ struct vkd3d_pipeline_blob_chunk_pso_compat
     struct vkd3d_pipeline_cache_compatibility compat;
 };
 
+struct vkd3d_pipeline_blob_chunk_variant
+{
+    uint32_t topology; /* D3D12_PRIMITIVE_TOPOLOGY */
+    uint32_t vk_dsv_format;
+    uint32_t dxgi_dsv_format;
+    uint32_t rasterization_samples;
+    uint32_t view_mask;
+    uint32_t dynamic_topology;
+};
+
 STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk) == 8);
 STATIC_ASSERT(offsetof(struct vkd3d_pipeline_blob_chunk, data) == 8);
-STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk_spirv) == 8);
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk_spirv) == 16);
 STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk_spirv) == offsetof(struct vkd3d_pipeline_blob_chunk_spirv, data));
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_driver_cache) == 8);
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_driver_cache) == offsetof(struct vkd3d_pipeline_blob_driver_cache, data));
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_chunk_variant) == 24);
 
 struct vkd3d_pipeline_blob
 {
@@ -254,7 +290,7 @@ struct vkd3d_pipeline_blob
 struct vkd3d_pipeline_blob_internal
 {
     uint32_t checksum; /* Simple checksum for data[] as a sanity check. */
-    uint8_t data[]; /* Either raw uint8_t for pipeline cache, or vkd3d_pipeline_blob_chunk_spirv. */
+    uint8_t data[]; /* Either vkd3d_pipeline_blob_driver_cache for pipeline cache, or vkd3d_pipeline_blob_chunk_spirv. */
 };
 
 STATIC_ASSERT(offsetof(struct vkd3d_pipeline_blob, data) == (32 + VK_UUID_SIZE));
@@ -301,6 +337,19 @@ static bool vkd3d_serialized_pipeline_stream_entry_validate(const uint8_t *data,
     return checksum == entry->checksum;
 }
 
+struct vkd3d_serialized_pipeline_index_entry;
+static const struct vkd3d_serialized_pipeline_index_entry *d3d12_pipeline_library_find_indexed_archive_entry(
+        struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash);
+static bool d3d12_pipeline_library_find_indexed_archive_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void **data, size_t *size);
+static bool d3d12_pipeline_library_find_shared_cache_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void **data, size_t *size);
+static bool d3d12_pipeline_library_find_persisted_shared_cache_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash);
+static void vkd3d_pipeline_library_disk_cache_persist_shared_blob(struct vkd3d_pipeline_library_disk_cache *cache,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void *data);
+
 static const struct vkd3d_pipeline_blob_chunk *find_blob_chunk_masked(const struct vkd3d_pipeline_blob_chunk *chunk,
         size_t size, uint32_t type, uint32_t mask)
 {
@@ -534,11 +583,13 @@ static struct vkd3d_pipeline_blob_chunk *finish_and_iterate_blob_chunk(struct vk
 }
 
 static bool d3d12_pipeline_library_find_internal_blob(struct d3d12_pipeline_library *pipeline_library,
-        const struct hash_map *map, uint64_t hash, const void **data, size_t *size)
+        const struct hash_map *map, enum vkd3d_serialized_pipeline_stream_entry_type type,
+        uint64_t hash, const void **data, size_t *size)
 {
     const struct vkd3d_pipeline_blob_internal *internal;
     const struct vkd3d_cached_pipeline_entry *entry;
     struct vkd3d_cached_pipeline_key key;
+    size_t blob_length;
     uint32_t checksum;
     bool ret = false;
 
@@ -554,14 +605,35 @@ static bool d3d12_pipeline_library_find_internal_blob(struct d3d12_pipeline_libr
     if (entry)
     {
         internal = entry->data.blob;
-        if (entry->data.blob_length < sizeof(*internal))
+        blob_length = entry->data.blob_length;
+    }
+    else if (d3d12_pipeline_library_find_indexed_archive_blob(pipeline_library, type, hash,
+            (const void **)&internal, &blob_length))
+    {
+        /* Already persisted in our own archive. */
+    }
+    else if (d3d12_pipeline_library_find_shared_cache_blob(pipeline_library, type, hash,
+            (const void **)&internal, &blob_length))
+    {
+        if (pipeline_library->disk_cache_listener)
+        {
+            vkd3d_pipeline_library_disk_cache_persist_shared_blob(pipeline_library->disk_cache_listener,
+                    type, hash, internal);
+        }
+    }
+    else
+        internal = NULL;
+
+    if (internal)
+    {
+        if (blob_length < sizeof(*internal))
         {
             FIXME("Internal blob length is too small.\n");
             goto out;
         }
 
         *data = internal->data;
-        *size = entry->data.blob_length - sizeof(*internal);
+        *size = blob_length - sizeof(*internal);
 
         /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
         if (!(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
@@ -582,6 +654,107 @@ out:
     return ret;
 }
 
+static bool d3d12_pipeline_library_has_internal_blob(struct d3d12_pipeline_library *pipeline_library,
+        const struct hash_map *map, enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash)
+{
+    struct vkd3d_cached_pipeline_key key;
+    bool ret;
+
+    /* Only blobs in our own archives count. A blob which only exists in the shared cache
+     * still has to be written out, or it would never make it to this application's disk cache. */
+    if (d3d12_pipeline_library_find_indexed_archive_entry(pipeline_library, type, hash) ||
+            d3d12_pipeline_library_find_persisted_shared_cache_blob(pipeline_library, type, hash))
+        return true;
+
+    if (rwlock_lock_read(&pipeline_library->internal_hashmap_mutex))
+        return false;
+
+    key.name_length = 0;
+    key.name = NULL;
+    key.internal_key_hash = hash;
+    ret = !!hash_map_find(map, &key);
+
+    rwlock_unlock_read(&pipeline_library->internal_hashmap_mutex);
+    return ret;
+}
+
+static uint8_t *vkd3d_pipeline_blob_compress_payload(const void *data, size_t size, size_t *compressed_size)
+{
+    uint8_t *compressed;
+    size_t max_size;
+
+    if (size < VKD3D_PIPELINE_BLOB_COMPRESSION_MIN_SIZE)
+        return NULL;
+
+    /* Only accept the compressed stream if it is a meaningful improvement,
+     * otherwise we just pay decode cost for nothing. */
+    max_size = size - size / 8;
+    if (!(compressed = vkd3d_malloc(max_size)))
+        return NULL;
+
+    if (!(*compressed_size = vkd3d_lz_compress(compressed, max_size, data, size)))
+    {
+        vkd3d_free(compressed);
+        return NULL;
+    }
+
+    return compressed;
+}
+
+static bool vkd3d_pipeline_blob_decode_driver_cache(const void *blob, size_t blob_size,
+        const void **data, size_t *size, void **allocation)
+{
+    const struct vkd3d_pipeline_blob_driver_cache *driver_cache = blob;
+    size_t payload_size;
+    void *decompressed;
+
+    *allocation = NULL;
+
+    if (blob_size < sizeof(*driver_cache))
+    {
+        FIXME("Unexpected low internal blob size.\n");
+        return false;
+    }
+
+    payload_size = blob_size - sizeof(*driver_cache);
+
+    switch (driver_cache->compression)
+    {
+        case VKD3D_PIPELINE_BLOB_COMPRESSION_NONE:
+            if (payload_size != driver_cache->decompressed_size)
+            {
+                FIXME("Mismatch in pipeline cache size %u != %u.\n",
+                        (unsigned int)payload_size, driver_cache->decompressed_size);
+                return false;
+            }
+
+            *data = driver_cache->data;
+            *size = payload_size;
+            return true;
+
+        case VKD3D_PIPELINE_BLOB_COMPRESSION_LZ:
+            if (!(decompressed = vkd3d_malloc(driver_cache->decompressed_size)))
+                return false;
+
+            if (!vkd3d_lz_decompress(decompressed, driver_cache->decompressed_size,
+                    driver_cache->data, payload_size))
+            {
+                FIXME("Failed to decompress pipeline cache.\n");
+                vkd3d_free(decompressed);
+                return false;
+            }
+
+            *data = decompressed;
+            *size = driver_cache->decompressed_size;
+            *allocation = decompressed;
+            return true;
+
+        default:
+            FIXME("Unrecognized compression type %u.\n", driver_cache->compression);
+            return false;
+    }
+}
+
 HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state, VkPipelineCache *cache)
 {
@@ -589,7 +762,11 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
     const struct vkd3d_pipeline_blob_chunk_link *link;
     const struct vkd3d_pipeline_blob_chunk *chunk;
     uint32_t pipeline_library_flags;
+    void *decoded_data = NULL;
+    const void *internal_data;
+    size_t internal_size;
     size_t payload_size;
+    uint64_t begin_ts;
     const void *data;
     size_t size;
     VkResult vr;
@@ -626,7 +803,8 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         link = CONST_CAST_CHUNK_DATA(chunk, link);
 
         if (!d3d12_pipeline_library_find_internal_blob(state->library,
-                &state->library->driver_cache_map, link->hash, &data, &size))
+                &state->library->driver_cache_map, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE,
+                link->hash, &internal_data, &internal_size))
         {
             if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
                 INFO("Did not find internal PSO cache reference %016"PRIx64".\n", link->hash);
@@ -634,6 +812,19 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
             data = NULL;
             size = 0;
         }
+        else
+        {
+            begin_ts = vkd3d_get_current_time_ns();
+
+            if (!vkd3d_pipeline_blob_decode_driver_cache(internal_data, internal_size,
+                    &data, &size, &decoded_data))
+            {
+                data = NULL;
+                size = 0;
+            }
+
+            vkd3d_pipeline_library_stats_add_time(&device->pipeline_library_stats.decode_ns, begin_ts);
+        }
     }
     else
     {
@@ -641,11 +832,74 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         size = 0;
     }
 
+    vkd3d_pipeline_library_stats_record_lookup(&device->pipeline_library_stats,
+            VKD3D_PIPELINE_LIBRARY_TIER_DRIVER_CACHE, !!data, size);
+
     vr = vkd3d_create_pipeline_cache(device, size, data, cache);
+    vkd3d_free(decoded_data);
     return hresult_from_vk_result(vr);
 }
 
-HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
+uint32_t vkd3d_get_cached_pipeline_variants_from_d3d12_desc(const struct d3d12_cached_pipeline_state *state,
+        struct vkd3d_pipeline_variant_desc *variants, uint32_t max_count)
+{
+    const struct vkd3d_pipeline_blob *blob = state->blob.pCachedBlob;
+    const struct vkd3d_pipeline_blob_chunk_variant *variant;
+    const struct vkd3d_pipeline_blob_chunk *chunk;
+    size_t payload_size;
+    uint32_t count, i;
+
+    if (!state->blob.CachedBlobSizeInBytes)
+        return 0;
+
+    payload_size = state->blob.CachedBlobSizeInBytes - offsetof(struct vkd3d_pipeline_blob, data);
+
+    if (!(chunk = find_blob_chunk(CONST_CAST_CHUNK_BASE(blob), payload_size,
+            VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_VARIANTS)))
+        return 0;
+
+    variant = CONST_CAST_CHUNK_DATA(chunk, variant);
+    count = min(chunk->size / sizeof(*variant), max_count);
+
+    for (i = 0; i < count; i++)
+    {
+        memset(&variants[i].key, 0, sizeof(variants[i].key));
+        variants[i].key.topology = variant[i].topology;
+        variants[i].key.dsv_format = variant[i].vk_dsv_format;
+        variants[i].key.rasterization_samples = variant[i].rasterization_samples;
+        variants[i].key.view_mask = variant[i].view_mask;
+        variants[i].key.dynamic_topology = !!variant[i].dynamic_topology;
+        variants[i].dsv_format = variant[i].dxgi_dsv_format;
+    }
+
+    return count;
+}
+
+static void vkd3d_serialize_pipeline_variants(struct vkd3d_pipeline_blob_chunk *chunk,
+        const struct vkd3d_pipeline_variant_desc *variants, uint32_t count)
+{
+    struct vkd3d_pipeline_blob_chunk_variant *variant;
+    uint32_t i;
+
+    /* Only useful when the application serializes a PSO after drawing with it.
+     * The disk cache serializes PSOs right after creation, before any variant exists,
+     * and never replaces a stored blob, so its blobs never carry this chunk. */
+    chunk->type = VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_VARIANTS;
+    chunk->size = count * sizeof(*variant);
+    variant = CAST_CHUNK_DATA(chunk, variant);
+
+    for (i = 0; i < count; i++)
+    {
+        variant[i].topology = variants[i].key.topology;
+        variant[i].vk_dsv_format = variants[i].key.dsv_format;
+        variant[i].dxgi_dsv_format = variants[i].dsv_format;
+        variant[i].rasterization_samples = variants[i].key.rasterization_samples;
+        variant[i].view_mask = variants[i].key.view_mask;
+        variant[i].dynamic_topology = variants[i].key.dynamic_topology;
+    }
+}
+
+HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state,
         VkShaderStageFlagBits stage,
         struct vkd3d_shader_code *spirv_code,
@@ -656,9 +910,12 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     const struct vkd3d_pipeline_blob_chunk_spirv *spirv;
     const struct vkd3d_pipeline_blob_chunk_link *link;
     const struct vkd3d_pipeline_blob_chunk *chunk;
+    uint8_t *decompressed_varint = NULL;
+    const uint8_t *varint_data;
     size_t internal_blob_size;
     size_t payload_size;
     void *duped_code;
+    uint64_t begin_ts;
 
     if (!state->blob.CachedBlobSizeInBytes)
         return E_FAIL;
@@ -685,6 +942,8 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
             identifier->pIdentifier = chunk->data;
             spirv_code->size = 0;
             spirv_code->code = NULL;
+            vkd3d_pipeline_library_stats_record_lookup(&device->pipeline_library_stats,
+                    VKD3D_PIPELINE_LIBRARY_TIER_SPIRV, true, chunk->size);
             return S_OK;
         }
     }
@@ -702,7 +961,8 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     {
         link = CONST_CAST_CHUNK_DATA(chunk, link);
         if (!d3d12_pipeline_library_find_internal_blob(state->library, &state->library->spirv_cache_map,
-                link->hash, (const void **)&spirv, &internal_blob_size))
+                VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV, link->hash,
+                (const void **)&spirv, &internal_blob_size))
         {
             FIXME("Did not find internal SPIR-V reference %016"PRIx64".\n", link->hash);
             spirv = NULL;
@@ -720,22 +980,65 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     else
         spirv = NULL;
 
+    vkd3d_pipeline_library_stats_record_lookup(&device->pipeline_library_stats, VKD3D_PIPELINE_LIBRARY_TIER_SPIRV,
+            !!spirv, spirv ? sizeof(*spirv) + spirv->compressed_spirv_size : 0);
+
     if (!spirv)
         return E_FAIL;
 
+    begin_ts = vkd3d_get_current_time_ns();
+
+    switch (spirv->compression)
+    {
+        case VKD3D_PIPELINE_BLOB_COMPRESSION_NONE:
+            if (spirv->compressed_spirv_size != spirv->varint_spirv_size)
+            {
+                FIXME("Mismatch in VARINT size %u != %u.\n",
+                        spirv->compressed_spirv_size, spirv->varint_spirv_size);
+                return E_INVALIDARG;
+            }
+            varint_data = spirv->data;
+            break;
+
+        case VKD3D_PIPELINE_BLOB_COMPRESSION_LZ:
+            if (!(decompressed_varint = vkd3d_malloc(spirv->varint_spirv_size)))
+                return E_OUTOFMEMORY;
+
+            if (!vkd3d_lz_decompress(decompressed_varint, spirv->varint_spirv_size,
+                    spirv->data, spirv->compressed_spirv_size))
+            {
+                FIXME("Failed to decompress SPIR-V.\n");
+                vkd3d_free(decompressed_varint);
+                return E_INVALIDARG;
+            }
+            varint_data = decompressed_varint;
+            break;
+
+        default:
+            FIXME("Unrecognized compression type %u.\n", spirv->compression);
+            return E_INVALIDARG;
+    }
+
     duped_code = vkd3d_malloc(spirv->decompressed_spirv_size);
     if (!duped_code)
+    {
+        vkd3d_free(decompressed_varint);
         return E_OUTOFMEMORY;
+    }
 
     if (!vkd3d_decode_varint(duped_code,
             spirv->decompressed_spirv_size / sizeof(uint32_t),
-            spirv->data, spirv->compressed_spirv_size))
+            varint_data, spirv->varint_spirv_size))
     {
         FIXME("Failed to decode VARINT.\n");
+        vkd3d_free(decompressed_varint);
         vkd3d_free(duped_code);
         return E_INVALIDARG;
     }
 
+    vkd3d_free(decompressed_varint);
+    vkd3d_pipeline_library_stats_add_time(&device->pipeline_library_stats.decode_ns, begin_ts);
+
     spirv_code->code = duped_code;
     spirv_code->size = spirv->decompressed_spirv_size;
 
@@ -845,9 +1148,12 @@ static void vkd3d_shader_code_serialize_inline(const struct vkd3d_shader_code *c
         chunk->type = VKD3D_PIPELINE_BLOB_CHUNK_TYPE_VARINT_SPIRV | (stage << VKD3D_PIPELINE_BLOB_CHUNK_INDEX_SHIFT);
         chunk->size = sizeof(struct vkd3d_pipeline_blob_chunk_spirv) + varint_size;
 
+        /* GetCachedBlob() sizes the blob up front, so inline SPIR-V is never compressed. */
         spirv = CAST_CHUNK_DATA(chunk, spirv);
-        spirv->compressed_spirv_size = varint_size;
         spirv->decompressed_spirv_size = code->size;
+        spirv->varint_spirv_size = varint_size;
+        spirv->compressed_spirv_size = varint_size;
+        spirv->compression = VKD3D_PIPELINE_BLOB_COMPRESSION_NONE;
 
         vkd3d_encode_varint(spirv->data, code->code, code->size / sizeof(uint32_t));
         chunk = finish_and_iterate_blob_chunk(chunk);
@@ -890,7 +1196,7 @@ static void vkd3d_shader_code_serialize_identifier(struct d3d12_pipeline_library
     *inout_chunk = chunk;
 }
 
-static void vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library *pipeline_library,
+static VkResult vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library *pipeline_library,
         const struct vkd3d_shader_code *code,
         VkShaderStageFlagBits stage, size_t varint_size,
         struct vkd3d_pipeline_blob_chunk **inout_chunk)
@@ -901,8 +1207,9 @@ static void vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library
     struct vkd3d_pipeline_blob_internal *internal;
     struct vkd3d_pipeline_blob_chunk_link *link;
     struct vkd3d_cached_pipeline_entry entry;
+    size_t wrapped_varint_size, payload_size;
+    uint8_t *varint, *compressed;
     struct vkd3d_shader_code blob;
-    size_t wrapped_varint_size;
 
     if (code->size && !(code->meta.flags & VKD3D_SHADER_META_FLAG_REPLACED))
     {
@@ -911,40 +1218,73 @@ static void vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library
         entry.data.is_new = 1;
         entry.data.state = NULL;
 
-        wrapped_varint_size = sizeof(struct vkd3d_pipeline_blob_chunk_spirv) + varint_size;
-        entry.data.blob_length = sizeof(*internal) + wrapped_varint_size;
-        internal = vkd3d_malloc(entry.data.blob_length);
-
-        spirv = CAST_CHUNK_DATA(internal, spirv);
-        spirv->compressed_spirv_size = varint_size;
-        spirv->decompressed_spirv_size = code->size;
-        vkd3d_encode_varint(spirv->data, code->code, code->size / sizeof(uint32_t));
+        if (!(varint = vkd3d_malloc(varint_size)))
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        vkd3d_encode_varint(varint, code->code, code->size / sizeof(uint32_t));
 
-        entry.data.blob = internal;
-        blob.code = spirv->data;
+        /* Hash the VARINT stream, so the key does not depend on whether we compressed or not. */
+        blob.code = varint;
         blob.size = varint_size;
         entry.key.internal_key_hash = vkd3d_shader_hash(&blob);
 
-        /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
-        if (!pipeline_library || !(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
-            internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data, wrapped_varint_size);
-        else
-            internal->checksum = 0;
-
-        /* For duplicate, we won't insert. Just free the blob. */
-        if (!d3d12_pipeline_library_insert_hash_map_blob_internal(pipeline_library,
-                &pipeline_library->spirv_cache_map, &entry))
-        {
-            vkd3d_free(internal);
-        }
-        else if (pipeline_library->disk_cache_listener)
+        /* For duplicate, we won't insert. Blobs which are already present in
+         * an indexed archive do not need to be written out again either.
+         * Check early so we don't spend time compressing duplicates. */
+        if (!d3d12_pipeline_library_has_internal_blob(pipeline_library, &pipeline_library->spirv_cache_map,
+                VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV, entry.key.internal_key_hash))
         {
-            vkd3d_pipeline_library_disk_cache_notify_blob_insert(pipeline_library->disk_cache_listener,
-                    entry.key.internal_key_hash,
-                    VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV,
-                    entry.data.blob, entry.data.blob_length);
+            compressed = vkd3d_pipeline_blob_compress_payload(varint, varint_size, &payload_size);
+            if (!compressed)
+                payload_size = varint_size;
+
+            wrapped_varint_size = sizeof(struct vkd3d_pipeline_blob_chunk_spirv) + payload_size;
+            entry.data.blob_length = sizeof(*internal) + wrapped_varint_size;
+            if (!(internal = vkd3d_malloc(entry.data.blob_length)))
+            {
+                vkd3d_free(compressed);
+                vkd3d_free(varint);
+                return VK_ERROR_OUT_OF_HOST_MEMORY;
+            }
+
+            spirv = CAST_CHUNK_DATA(internal, spirv);
+            spirv->decompressed_spirv_size = code->size;
+            spirv->varint_spirv_size = varint_size;
+            spirv->compressed_spirv_size = payload_size;
+            spirv->compression = compressed ? VKD3D_PIPELINE_BLOB_COMPRESSION_LZ : VKD3D_PIPELINE_BLOB_COMPRESSION_NONE;
+            memcpy(spirv->data, compressed ? compressed : varint, payload_size);
+            vkd3d_free(compressed);
+
+            entry.data.blob = internal;
+
+            /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
+            if (!pipeline_library || !(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
+                internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data, wrapped_varint_size);
+            else
+                internal->checksum = 0;
+
+            /* We may have raced with another thread inserting the same blob. */
+            if (!d3d12_pipeline_library_insert_hash_map_blob_internal(pipeline_library,
+                    &pipeline_library->spirv_cache_map, &entry))
+            {
+                vkd3d_free(internal);
+            }
+            else
+            {
+                vkd3d_atomic_uint32_increment(&pipeline_library->spirv_unique_count, vkd3d_memory_order_relaxed);
+
+                if (pipeline_library->disk_cache_listener)
+                {
+                    vkd3d_pipeline_library_disk_cache_notify_blob_insert(pipeline_library->disk_cache_listener,
+                            entry.key.internal_key_hash,
+                            VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV,
+                            entry.data.blob, entry.data.blob_length);
+                }
+            }
         }
 
+        vkd3d_free(varint);
+        vkd3d_atomic_uint32_increment(&pipeline_library->spirv_reference_count, vkd3d_memory_order_relaxed);
+
         chunk->type = VKD3D_PIPELINE_BLOB_CHUNK_TYPE_VARINT_SPIRV_LINK | (stage << VKD3D_PIPELINE_BLOB_CHUNK_INDEX_SHIFT);
         chunk->size = sizeof(*link);
 
@@ -961,6 +1301,7 @@ static void vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library
     }
 
     *inout_chunk = chunk;
+    return VK_SUCCESS;
 }
 
 static VkResult vkd3d_serialize_pipeline_state_inline(const struct d3d12_pipeline_state *state,
@@ -1021,11 +1362,14 @@ static VkResult vkd3d_serialize_pipeline_state_referenced(struct d3d12_pipeline_
         size_t vk_pipeline_cache_size, const size_t *varint_size)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    struct vkd3d_pipeline_blob_driver_cache *driver_cache;
     struct vkd3d_pipeline_blob_internal *internal;
     struct vkd3d_pipeline_blob_chunk_link *link;
     struct vkd3d_cached_pipeline_entry entry;
+    uint8_t *cache_data, *compressed;
     struct vkd3d_shader_code blob;
     size_t reference_size;
+    size_t payload_size;
     unsigned int i;
     VkResult vr;
 
@@ -1036,17 +1380,17 @@ static VkResult vkd3d_serialize_pipeline_state_referenced(struct d3d12_pipeline_
 
     if (state->vk_pso_cache && (pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_SAVE_PSO_BLOB))
     {
-        entry.data.blob_length = sizeof(*internal) + vk_pipeline_cache_size;
-        internal = vkd3d_malloc(entry.data.blob_length);
-        entry.data.blob = internal;
+        if (!(cache_data = vkd3d_malloc(vk_pipeline_cache_size)))
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
 
         reference_size = vk_pipeline_cache_size;
         /* In case driver leaves uninitialized memory for blob data. */
-        memset(internal->data, 0, vk_pipeline_cache_size);
+        memset(cache_data, 0, vk_pipeline_cache_size);
         if ((vr = VK_CALL(vkGetPipelineCacheData(state->device->vk_device, state->vk_pso_cache,
-                &reference_size, internal->data))))
+                &reference_size, cache_data))))
         {
             FIXME("Failed to serialize pipeline cache data, vr %d.\n", vr);
+            vkd3d_free(cache_data);
             return vr;
         }
 
@@ -1057,30 +1401,62 @@ static VkResult vkd3d_serialize_pipeline_state_referenced(struct d3d12_pipeline_
                     (unsigned int)vk_pipeline_cache_size);
         }
 
-        blob.code = internal->data;
+        /* Hash the raw pipeline cache, so the key does not depend on whether we compressed or not. */
+        blob.code = cache_data;
         blob.size = vk_pipeline_cache_size;
         entry.key.internal_key_hash = vkd3d_shader_hash(&blob);
 
-        /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
-        if (!pipeline_library || !(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
-            internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(blob.code, blob.size);
-        else
-            internal->checksum = 0;
-
-        /* For duplicate, we won't insert. Just free the blob. */
-        if (!d3d12_pipeline_library_insert_hash_map_blob_internal(pipeline_library,
-                &pipeline_library->driver_cache_map, &entry))
-        {
-            vkd3d_free(internal);
-        }
-        else if (pipeline_library->disk_cache_listener)
+        /* For duplicate, we won't insert. Blobs which are already present in
+         * an indexed archive do not need to be written out again either.
+         * Check early so we don't spend time compressing duplicates. */
+        if (!d3d12_pipeline_library_has_internal_blob(pipeline_library, &pipeline_library->driver_cache_map,
+                VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE, entry.key.internal_key_hash))
         {
-            vkd3d_pipeline_library_disk_cache_notify_blob_insert(pipeline_library->disk_cache_listener,
-                    entry.key.internal_key_hash,
-                    VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE,
-                    entry.data.blob, entry.data.blob_length);
+            compressed = vkd3d_pipeline_blob_compress_payload(cache_data, vk_pipeline_cache_size, &payload_size);
+            if (!compressed)
+                payload_size = vk_pipeline_cache_size;
+
+            entry.data.blob_length = sizeof(*internal) + sizeof(*driver_cache) + payload_size;
+            if (!(internal = vkd3d_malloc(entry.data.blob_length)))
+            {
+                vkd3d_free(compressed);
+                vkd3d_free(cache_data);
+                return VK_ERROR_OUT_OF_HOST_MEMORY;
+            }
+            entry.data.blob = internal;
+
+            driver_cache = (struct vkd3d_pipeline_blob_driver_cache *)internal->data;
+            driver_cache->decompressed_size = vk_pipeline_cache_size;
+            driver_cache->compression = compressed ? VKD3D_PIPELINE_BLOB_COMPRESSION_LZ : VKD3D_PIPELINE_BLOB_COMPRESSION_NONE;
+            memcpy(driver_cache->data, compressed ? compressed : cache_data, payload_size);
+            vkd3d_free(compressed);
+
+            /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
+            if (!pipeline_library || !(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
+            {
+                internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data,
+                        entry.data.blob_length - sizeof(*internal));
+            }
+            else
+                internal->checksum = 0;
+
+            /* We may have raced with another thread inserting the same blob. */
+            if (!d3d12_pipeline_library_insert_hash_map_blob_internal(pipeline_library,
+                    &pipeline_library->driver_cache_map, &entry))
+            {
+                vkd3d_free(internal);
+            }
+            else if (pipeline_library->disk_cache_listener)
+            {
+                vkd3d_pipeline_library_disk_cache_notify_blob_insert(pipeline_library->disk_cache_listener,
+                        entry.key.internal_key_hash,
+                        VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE,
+                        entry.data.blob, entry.data.blob_length);
+            }
         }
 
+        vkd3d_free(cache_data);
+
         /* Store PSO cache, or link to it if using pipeline cache. */
         chunk->type = VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_CACHE_LINK;
         chunk->size = sizeof(*link);
@@ -1097,16 +1473,18 @@ static VkResult vkd3d_serialize_pipeline_state_referenced(struct d3d12_pipeline_
         {
             for (i = 0; i < state->graphics.stage_count; i++)
             {
-                vkd3d_shader_code_serialize_referenced(pipeline_library,
+                if ((vr = vkd3d_shader_code_serialize_referenced(pipeline_library,
                         &state->graphics.code[i], state->graphics.stages[i].stage,
-                        varint_size[i], &chunk);
+                        varint_size[i], &chunk)))
+                    return vr;
             }
         }
         else if (d3d12_pipeline_state_is_compute(state))
         {
-            vkd3d_shader_code_serialize_referenced(pipeline_library,
+            if ((vr = vkd3d_shader_code_serialize_referenced(pipeline_library,
                     &state->compute.code, VK_SHADER_STAGE_COMPUTE_BIT,
-                    varint_size[0], &chunk);
+                    varint_size[0], &chunk)))
+                return vr;
         }
     }
 
@@ -1138,9 +1516,11 @@ VkResult vkd3d_serialize_pipeline_state(struct d3d12_pipeline_library *pipeline_
         const struct d3d12_pipeline_state *state, size_t *size, void *data)
 {
     const VkPhysicalDeviceProperties *device_properties = &state->device->device_info.properties2.properties;
+    struct vkd3d_pipeline_variant_desc variants[VKD3D_MAX_SERIALIZED_PIPELINE_VARIANTS];
     const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
     struct vkd3d_pipeline_blob_chunk_pso_compat *pso_compat;
     size_t varint_size[VKD3D_MAX_SHADER_STAGES];
+    uint32_t variant_count = 0;
     struct vkd3d_pipeline_blob *blob = data;
     struct vkd3d_pipeline_blob_chunk *chunk;
     size_t vk_blob_size_pipeline_cache = 0;
@@ -1213,6 +1593,24 @@ VkResult vkd3d_serialize_pipeline_state(struct d3d12_pipeline_library *pipeline_
         }
     }
 
+    if (d3d12_pipeline_state_is_graphics(state))
+    {
+        variant_count = d3d12_pipeline_state_get_pipeline_variants((struct d3d12_pipeline_state *)state,
+                variants, ARRAY_SIZE(variants));
+
+        /* Other threads may compile new variants between querying the size and serializing.
+         * Store whatever still fits instead of failing. */
+        if (blob)
+        {
+            while (variant_count && *size < total_size + vk_blob_size +
+                    VKD3D_PIPELINE_BLOB_CHUNK_SIZE_RAW(variant_count * sizeof(struct vkd3d_pipeline_blob_chunk_variant)))
+                variant_count--;
+        }
+
+        if (variant_count)
+            vk_blob_size += VKD3D_PIPELINE_BLOB_CHUNK_SIZE_RAW(variant_count * sizeof(struct vkd3d_pipeline_blob_chunk_variant));
+    }
+
     total_size += vk_blob_size;
 
     if (blob && *size < total_size)
@@ -1245,17 +1643,26 @@ VkResult vkd3d_serialize_pipeline_state(struct d3d12_pipeline_library *pipeline_
         pso_compat->compat = state->pipeline_cache_compat;
         chunk = finish_and_iterate_blob_chunk(chunk);
 
+        if (variant_count)
+        {
+            vkd3d_serialize_pipeline_variants(chunk, variants, variant_count);
+            chunk = finish_and_iterate_blob_chunk(chunk);
+        }
+
         if (pipeline_library)
         {
-            vkd3d_serialize_pipeline_state_referenced(pipeline_library, state, chunk,
+            vr = vkd3d_serialize_pipeline_state_referenced(pipeline_library, state, chunk,
                     vk_blob_size_pipeline_cache, varint_size);
         }
         else
         {
-            vkd3d_serialize_pipeline_state_inline(state, chunk,
+            vr = vkd3d_serialize_pipeline_state_inline(state, chunk,
                     vk_blob_size_pipeline_cache, varint_size);
         }
 
+        if (vr)
+            return vr;
+
         /* In stream archives, checksums are handled at the outer layer, just ignore them here. */
         if (!pipeline_library || !(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE))
             blob->checksum = vkd3d_pipeline_blob_compute_data_checksum(blob->data, vk_blob_size);
@@ -1314,8 +1721,9 @@ struct vkd3d_serialized_pipeline_toc_entry
 };
 STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_toc_entry) == 16);
 
-#define VKD3D_PIPELINE_LIBRARY_VERSION_TOC MAKE_MAGIC('V','K','L',4)
-#define VKD3D_PIPELINE_LIBRARY_VERSION_STREAM MAKE_MAGIC('V','K','S',4)
+#define VKD3D_PIPELINE_LIBRARY_VERSION_TOC MAKE_MAGIC('V','K','L',6)
+#define VKD3D_PIPELINE_LIBRARY_VERSION_STREAM MAKE_MAGIC('V','K','S',6)
+#define VKD3D_PIPELINE_LIBRARY_VERSION_INDEXED MAKE_MAGIC('V','K','I',6)
 
 struct vkd3d_serialized_pipeline_library_toc
 {
@@ -1397,6 +1805,44 @@ STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_library_stream) ==
         offsetof(struct vkd3d_serialized_pipeline_library_stream, entries));
 STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_library_stream) == 32 + VK_UUID_SIZE);
 
+/* The indexed variant. All entry headers are hoisted into an index table up front,
+ * grouped by entry type in the same order as the TOC format, and sorted by hash within each group.
+ * Lookups binary search the index directly from the mmap-ed archive, so we avoid a full linear pass
+ * and hash map rebuild at startup, and only fault in the blob pages we actually need.
+ * This format cannot be appended to, so the write-only archive is always a stream archive,
+ * and it is converted into the indexed format when merging. */
+struct vkd3d_serialized_pipeline_index_entry
+{
+    uint64_t hash;
+    uint64_t checksum; /* Same checksum as vkd3d_serialized_pipeline_stream_entry. */
+    uint64_t blob_offset; /* Relative to start of archive. */
+    uint32_t size;
+    enum vkd3d_serialized_pipeline_stream_entry_type type;
+};
+STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_index_entry) == 32);
+
+struct vkd3d_serialized_pipeline_library_indexed
+{
+    /* Shares layout with vkd3d_serialized_pipeline_library_stream up until the entry counts. */
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t reserved;
+    uint64_t vkd3d_build;
+    uint64_t vkd3d_shader_interface_key;
+    uint8_t cache_uuid[VK_UUID_SIZE];
+    uint32_t spirv_count;
+    uint32_t driver_cache_count;
+    uint32_t pipeline_count;
+    uint32_t reserved1;
+    struct vkd3d_serialized_pipeline_index_entry entries[];
+};
+STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_library_indexed) ==
+        offsetof(struct vkd3d_serialized_pipeline_library_indexed, entries));
+STATIC_ASSERT(offsetof(struct vkd3d_serialized_pipeline_library_indexed, spirv_count) ==
+        sizeof(struct vkd3d_serialized_pipeline_library_stream));
+STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_library_indexed) == 48 + VK_UUID_SIZE);
+
 /* ID3D12PipelineLibrary */
 static inline struct d3d12_pipeline_library *impl_from_ID3D12PipelineLibrary(d3d12_pipeline_library_iface *iface)
 {
@@ -1446,6 +1892,13 @@ static void d3d12_pipeline_library_cleanup_map(struct hash_map *map)
 
 static void d3d12_pipeline_library_cleanup(struct d3d12_pipeline_library *pipeline_library, struct d3d12_device *device)
 {
+    if (pipeline_library->spirv_reference_count && VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
+    {
+        INFO("SPIR-V de-duplication: %u references to %u new unique modules (ratio %.3f).\n",
+                pipeline_library->spirv_reference_count, pipeline_library->spirv_unique_count,
+                (double)pipeline_library->spirv_reference_count / max(pipeline_library->spirv_unique_count, 1));
+    }
+
     d3d12_pipeline_library_cleanup_map(&pipeline_library->pso_map);
     d3d12_pipeline_library_cleanup_map(&pipeline_library->driver_cache_map);
     d3d12_pipeline_library_cleanup_map(&pipeline_library->spirv_cache_map);
@@ -1718,9 +2171,14 @@ static HRESULT d3d12_pipeline_library_load_pipeline(struct d3d12_pipeline_librar
     {
         WARN("Pipeline %s does not exist.\n", debugstr_w(name));
         rwlock_unlock_read(&pipeline_library->mutex);
+        vkd3d_pipeline_library_stats_record_lookup(&pipeline_library->device->pipeline_library_stats,
+                VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, false, 0);
         return E_INVALIDARG;
     }
 
+    vkd3d_pipeline_library_stats_record_lookup(&pipeline_library->device->pipeline_library_stats,
+            VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, true, e->data.blob_length);
+
     /* Docs say that applications have to consider thread safety here:
      * https://docs.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-id3d12device1-createpipelinelibrary#thread-safety.
      * However, it seems questionable to rely on that, so just do cmpxchg replacements. */
@@ -2211,13 +2669,14 @@ static HRESULT d3d12_pipeline_library_unserialize_hash_map(
     return S_OK;
 }
 
-static HRESULT d3d12_pipeline_library_validate_stream_format_header(struct d3d12_pipeline_library *pipeline_library,
-        struct d3d12_device *device, const void *blob, size_t blob_length)
+static HRESULT d3d12_pipeline_library_validate_archive_header(struct d3d12_pipeline_library *pipeline_library,
+        struct d3d12_device *device, const void *blob, size_t blob_length, uint32_t version)
 {
     const VkPhysicalDeviceProperties *device_properties = &device->device_info.properties2.properties;
+    /* Indexed archives share the stream header layout. */
     const struct vkd3d_serialized_pipeline_library_stream *header = blob;
 
-    if (blob_length < sizeof(*header) || header->version != VKD3D_PIPELINE_LIBRARY_VERSION_STREAM)
+    if (blob_length < sizeof(*header) || header->version != version)
         return D3D12_ERROR_DRIVER_VERSION_MISMATCH;
 
     if (header->device_id != device_properties->deviceID || header->vendor_id != device_properties->vendorID)
@@ -2247,115 +2706,466 @@ static HRESULT d3d12_pipeline_library_validate_stream_format_header(struct d3d12
     return S_OK;
 }
 
-static HRESULT d3d12_pipeline_library_read_blob_stream_format(struct d3d12_pipeline_library *pipeline_library,
+static HRESULT d3d12_pipeline_library_validate_stream_format_header(struct d3d12_pipeline_library *pipeline_library,
         struct d3d12_device *device, const void *blob, size_t blob_length)
 {
-    const struct vkd3d_serialized_pipeline_library_stream *header = blob;
-    const struct vkd3d_serialized_pipeline_stream_entry *entries;
-    struct vkd3d_cached_pipeline_entry entry;
-    uint64_t blob_length_saved = blob_length;
-    uint32_t driver_cache_count = 0;
-    uint32_t pipeline_count = 0;
-    bool early_teardown = false;
-    uint32_t spirv_count = 0;
-    uint32_t aligned_size;
-    struct hash_map *map;
+    return d3d12_pipeline_library_validate_archive_header(pipeline_library, device,
+            blob, blob_length, VKD3D_PIPELINE_LIBRARY_VERSION_STREAM);
+}
+
+static HRESULT d3d12_pipeline_library_validate_indexed_format_header(struct d3d12_pipeline_library *pipeline_library,
+        struct d3d12_device *device, const void *blob, size_t blob_length)
+{
+    const struct vkd3d_serialized_pipeline_library_indexed *header = blob;
+    uint64_t total_entries;
     HRESULT hr;
 
-    if (FAILED(hr = d3d12_pipeline_library_validate_stream_format_header(pipeline_library, device, blob, blob_length)))
+    if (FAILED(hr = d3d12_pipeline_library_validate_archive_header(pipeline_library, device,
+            blob, blob_length, VKD3D_PIPELINE_LIBRARY_VERSION_INDEXED)))
         return hr;
 
-    entries = (const struct vkd3d_serialized_pipeline_stream_entry *)header->entries;
-    blob_length -= offsetof(struct vkd3d_serialized_pipeline_library_stream, entries);
+    if (blob_length < sizeof(*header))
+        return D3D12_ERROR_DRIVER_VERSION_MISMATCH;
 
-    while (blob_length >= sizeof(*entries))
-    {
-        /* Parsing this can take a long time. Tear down as quick as we can. */
-        if (vkd3d_atomic_uint32_load_explicit(&pipeline_library->stream_archive_cancellation_point,
-                vkd3d_memory_order_relaxed))
-        {
-            INFO("Device teardown request received, stopping parse early.\n");
-            early_teardown = true;
-            break;
-        }
+    /* Only the index table itself is validated here. Blobs are validated on first lookup. */
+    total_entries = (uint64_t)header->spirv_count + header->driver_cache_count + header->pipeline_count;
+    if (total_entries > (blob_length - sizeof(*header)) / sizeof(struct vkd3d_serialized_pipeline_index_entry))
+        return E_INVALIDARG;
 
-        blob_length -= sizeof(*entries);
-        aligned_size = align(entries->size, VKD3D_PIPELINE_BLOB_ALIGN);
+    return S_OK;
+}
 
-        /* Sliced files are expected to work since application may terminate in the middle of writing. */
-        if (blob_length < aligned_size)
-        {
-            INFO("Sliced stream cache entry detected. Ignoring rest of archive.\n");
+#define VKD3D_INDEXED_ARCHIVE_ENTRY_VALIDATED 1u
+#define VKD3D_INDEXED_ARCHIVE_ENTRY_INVALID 2u
+#define VKD3D_INDEXED_ARCHIVE_ENTRY_STATE_BITS 2u
+#define VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD (32u / VKD3D_INDEXED_ARCHIVE_ENTRY_STATE_BITS)
+
+static bool vkd3d_serialized_pipeline_index_entry_in_bounds(size_t archive_size,
+        const struct vkd3d_serialized_pipeline_index_entry *index_entry)
+{
+    return index_entry->blob_offset <= archive_size && index_entry->size <= archive_size - index_entry->blob_offset;
+}
+
+static bool vkd3d_serialized_pipeline_index_entry_validate(const uint8_t *archive,
+        const struct vkd3d_serialized_pipeline_index_entry *index_entry)
+{
+    struct vkd3d_serialized_pipeline_stream_entry stream_entry;
+
+    stream_entry.hash = index_entry->hash;
+    stream_entry.checksum = index_entry->checksum;
+    stream_entry.size = index_entry->size;
+    stream_entry.type = index_entry->type;
+
+    return vkd3d_serialized_pipeline_stream_entry_validate(archive + index_entry->blob_offset, &stream_entry);
+}
+
+static HRESULT d3d12_pipeline_library_read_blob_indexed_format(struct d3d12_pipeline_library *pipeline_library,
+        struct d3d12_device *device, const void *blob, size_t blob_length)
+{
+    const struct vkd3d_serialized_pipeline_library_indexed *header = blob;
+    unsigned int invalid_count;
+    size_t total_entries, i;
+    uint32_t *entry_state;
+    HRESULT hr;
+
+    if (FAILED(hr = d3d12_pipeline_library_validate_indexed_format_header(pipeline_library, device, blob, blob_length)))
+        return hr;
+
+    /* Checksumming every blob up front would make loading scale with the size of the archive,
+     * so only the index is checked here, and blobs are checksummed the first time they are looked up.
+     * A single corrupt entry does not invalidate the rest, it is simply treated as missing,
+     * which means it will be written to the write cache again and repaired on the next merge. */
+    total_entries = (size_t)header->spirv_count + header->driver_cache_count + header->pipeline_count;
+    if (!(entry_state = vkd3d_calloc((total_entries + VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD - 1) /
+            VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD, sizeof(*entry_state))))
+        return E_OUTOFMEMORY;
+
+    invalid_count = 0;
+
+    for (i = 0; i < total_entries; i++)
+    {
+        if (vkd3d_serialized_pipeline_index_entry_in_bounds(blob_length, &header->entries[i]))
+            continue;
+
+        entry_state[i / VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD] |=
+                (VKD3D_INDEXED_ARCHIVE_ENTRY_VALIDATED | VKD3D_INDEXED_ARCHIVE_ENTRY_INVALID) <<
+                ((i % VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD) * VKD3D_INDEXED_ARCHIVE_ENTRY_STATE_BITS);
+        invalid_count++;
+    }
+
+    if (invalid_count)
+        FIXME("Found %u out of bounds entries in indexed archive.\n", invalid_count);
+
+    /* Lookups happen without locks, publish the archive last. */
+    pipeline_library->indexed_archive_entry_state = entry_state;
+    pipeline_library->indexed_archive_size = blob_length;
+    vkd3d_atomic_ptr_store_explicit(&pipeline_library->indexed_archive, header, vkd3d_memory_order_release);
+
+    if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
+    {
+        INFO("Loading indexed pipeline library (%"PRIu64" bytes):\n"
+                "  D3D12 PSO count: %u\n"
+                "  Unique SPIR-V count: %u\n"
+                "  Unique VkPipelineCache count: %u\n",
+                (uint64_t)blob_length,
+                header->pipeline_count,
+                header->spirv_count,
+                header->driver_cache_count);
+    }
+
+    return S_OK;
+}
+
+static const struct vkd3d_serialized_pipeline_index_entry *d3d12_pipeline_library_find_indexed_archive_entry(
+        struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash)
+{
+    const struct vkd3d_serialized_pipeline_library_indexed *archive;
+    const struct vkd3d_serialized_pipeline_index_entry *entries;
+    size_t lo, hi, mid, count, index;
+    uint32_t state, shift;
+
+    archive = vkd3d_atomic_ptr_load_explicit(&pipeline_library->indexed_archive, vkd3d_memory_order_acquire);
+    if (!archive)
+        return NULL;
+
+    entries = archive->entries;
+
+    switch (type)
+    {
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV:
+            count = archive->spirv_count;
+            break;
+
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE:
+            entries += archive->spirv_count;
+            count = archive->driver_cache_count;
             break;
+
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE:
+            entries += archive->spirv_count + archive->driver_cache_count;
+            count = archive->pipeline_count;
+            break;
+
+        default:
+            return NULL;
+    }
+
+    lo = 0;
+    hi = count;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (entries[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == count || entries[lo].hash != hash || entries[lo].type != type)
+        return NULL;
+
+    index = &entries[lo] - archive->entries;
+    shift = (index % VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD) * VKD3D_INDEXED_ARCHIVE_ENTRY_STATE_BITS;
+    state = vkd3d_atomic_uint32_load_explicit(
+            &pipeline_library->indexed_archive_entry_state[index / VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD],
+            vkd3d_memory_order_relaxed) >> shift;
+
+    /* Racing threads compute the same result, so there is no need to synchronize beyond the atomic OR.
+     * Entries which are out of bounds were flagged when loading the archive. */
+    if (!(state & VKD3D_INDEXED_ARCHIVE_ENTRY_VALIDATED))
+    {
+        state = VKD3D_INDEXED_ARCHIVE_ENTRY_VALIDATED;
+        if (!vkd3d_serialized_pipeline_index_entry_validate((const uint8_t *)archive, &entries[lo]))
+        {
+            FIXME("Corrupt entry %zu in indexed archive.\n", index);
+            state |= VKD3D_INDEXED_ARCHIVE_ENTRY_INVALID;
         }
 
-        if (!vkd3d_serialized_pipeline_stream_entry_validate(entries->data, entries))
+        vkd3d_atomic_uint32_or(
+                &pipeline_library->indexed_archive_entry_state[index / VKD3D_INDEXED_ARCHIVE_ENTRIES_PER_WORD],
+                state << shift, vkd3d_memory_order_relaxed);
+    }
+
+    if (state & VKD3D_INDEXED_ARCHIVE_ENTRY_INVALID)
+        return NULL;
+
+    return &entries[lo];
+}
+
+static bool d3d12_pipeline_library_find_indexed_archive_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void **data, size_t *size)
+{
+    const struct vkd3d_serialized_pipeline_index_entry *index_entry;
+
+    /* Entries are bounds checked and checksummed by the lookup. */
+    if (!(index_entry = d3d12_pipeline_library_find_indexed_archive_entry(pipeline_library, type, hash)))
+        return false;
+
+    *data = (const uint8_t *)pipeline_library->indexed_archive + index_entry->blob_offset;
+    *size = index_entry->size;
+    return true;
+}
+
+static bool d3d12_pipeline_library_find_shared_cache_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void **data, size_t *size)
+{
+    const struct vkd3d_shared_cache *shared_cache;
+
+    /* Entries are validated by the shared cache itself, since other processes can write to it. */
+    shared_cache = vkd3d_atomic_ptr_load_explicit(&pipeline_library->shared_cache, vkd3d_memory_order_acquire);
+    return shared_cache && vkd3d_shared_cache_find(shared_cache, hash, type, data, size);
+}
+
+static bool vkd3d_pipeline_library_disk_cache_is_shared_blob_persisted(
+        const struct vkd3d_pipeline_library_disk_cache *cache, const void *data)
+{
+    /* Blobs which were in the shared cache when it was tagged with our read archive are already on disk.
+     * Anything newer was published by another process, and might not be in any archive we own. */
+    return cache->shared_cache_tagged && vkd3d_shared_cache_is_tagged(&cache->shared_cache, data);
+}
+
+static bool d3d12_pipeline_library_find_persisted_shared_cache_blob(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash)
+{
+    const void *data;
+    size_t size;
+
+    return pipeline_library->disk_cache_listener &&
+            d3d12_pipeline_library_find_shared_cache_blob(pipeline_library, type, hash, &data, &size) &&
+            vkd3d_pipeline_library_disk_cache_is_shared_blob_persisted(pipeline_library->disk_cache_listener, data);
+}
+
+/* Validating checksums of every entry dominates parse time of large stream archives,
+ * so it is split into contiguous ranges which are validated on a small worker pool. */
+#define VKD3D_STREAM_ARCHIVE_MAX_PARSE_THREADS 16
+#define VKD3D_STREAM_ARCHIVE_MIN_ENTRIES_PER_THREAD 1024
+/* Number of entries to insert per lock acquisition when parsing asynchronously. */
+#define VKD3D_STREAM_ARCHIVE_INSERT_BATCH_SIZE 256
+
+struct d3d12_pipeline_library_stream_validate_work
+{
+    struct d3d12_pipeline_library *pipeline_library;
+    const struct vkd3d_serialized_pipeline_stream_entry * const *entries;
+    size_t begin;
+    size_t end;
+    size_t first_invalid;
+    pthread_t thread;
+};
+
+static void d3d12_pipeline_library_validate_stream_entries(struct d3d12_pipeline_library_stream_validate_work *work)
+{
+    const struct vkd3d_serialized_pipeline_stream_entry *entry;
+    size_t i;
+
+    for (i = work->begin; i < work->end; i++)
+    {
+        /* Parsing this can take a long time. Tear down as quick as we can. */
+        if (vkd3d_atomic_uint32_load_explicit(&work->pipeline_library->stream_archive_cancellation_point,
+                vkd3d_memory_order_relaxed))
+            break;
+
+        entry = work->entries[i];
+        if (!vkd3d_serialized_pipeline_stream_entry_validate(entry->data, entry))
+            break;
+    }
+
+    work->first_invalid = i;
+}
+
+static void *d3d12_pipeline_library_validate_stream_entries_main(void *userarg)
+{
+    vkd3d_set_thread_name("vkd3d-disk-val");
+    d3d12_pipeline_library_validate_stream_entries(userarg);
+    return NULL;
+}
+
+static size_t d3d12_pipeline_library_validate_stream_entries_parallel(struct d3d12_pipeline_library *pipeline_library,
+        const struct vkd3d_serialized_pipeline_stream_entry * const *entries, size_t count)
+{
+    struct d3d12_pipeline_library_stream_validate_work work[VKD3D_STREAM_ARCHIVE_MAX_PARSE_THREADS];
+    bool spawned[VKD3D_STREAM_ARCHIVE_MAX_PARSE_THREADS];
+    size_t valid_count = count;
+    uint32_t thread_count;
+    uint32_t i;
+
+    thread_count = min(vkd3d_get_cpu_count(), VKD3D_STREAM_ARCHIVE_MAX_PARSE_THREADS);
+    thread_count = min(thread_count, count / VKD3D_STREAM_ARCHIVE_MIN_ENTRIES_PER_THREAD);
+    thread_count = max(thread_count, 1);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        work[i].pipeline_library = pipeline_library;
+        work[i].entries = entries;
+        work[i].begin = (count * i) / thread_count;
+        work[i].end = (count * (i + 1)) / thread_count;
+        work[i].first_invalid = work[i].end;
+    }
+
+    /* The calling thread takes the first range. If we fail to spawn a worker, validate inline. */
+    spawned[0] = false;
+    for (i = 1; i < thread_count; i++)
+    {
+        spawned[i] = !pthread_create(&work[i].thread, NULL,
+                d3d12_pipeline_library_validate_stream_entries_main, &work[i]);
+    }
+
+    for (i = 0; i < thread_count; i++)
+        if (!spawned[i])
+            d3d12_pipeline_library_validate_stream_entries(&work[i]);
+
+    for (i = 0; i < thread_count; i++)
+        if (spawned[i])
+            pthread_join(work[i].thread, NULL);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        /* Everything after the first invalid entry is ignored, same as a serial parse. */
+        if (work[i].first_invalid != work[i].end)
         {
-            INFO("Corrupt stream cache entry detected. Ignoring rest of archive.\n");
+            valid_count = work[i].first_invalid;
             break;
         }
+    }
 
-        entry.key.name_length = 0;
-        entry.key.name = NULL;
-        entry.key.internal_key_hash = entries->hash;
-        entry.data.blob_length = entries->size;
-        entry.data.blob = entries->data;
-        /* The read-only portion of the stream archive is backed by mmap so we avoid committing too much memory.
-         * Similar idea as normal application pipeline libraries. */
-        entry.data.is_new = 0;
-        entry.data.state = NULL;
+    if (thread_count > 1 && VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
+        INFO("Validated %zu stream archive entries using %u threads.\n", count, thread_count);
 
-        switch (entries->type)
-        {
-            case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV:
-                map = &pipeline_library->spirv_cache_map;
-                spirv_count++;
-                break;
+    return valid_count;
+}
 
-            case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE:
-                map = &pipeline_library->driver_cache_map;
-                driver_cache_count++;
-                break;
+static struct hash_map *d3d12_pipeline_library_get_stream_entry_map(struct d3d12_pipeline_library *pipeline_library,
+        enum vkd3d_serialized_pipeline_stream_entry_type type)
+{
+    switch (type)
+    {
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV:
+            return &pipeline_library->spirv_cache_map;
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE:
+            return &pipeline_library->driver_cache_map;
+        case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE:
+            return &pipeline_library->pso_map;
+        default:
+            FIXME("Unrecognized type %u.\n", type);
+            return NULL;
+    }
+}
 
-            case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE:
-                map = &pipeline_library->pso_map;
-                pipeline_count++;
-                break;
+static HRESULT d3d12_pipeline_library_read_blob_stream_format(struct d3d12_pipeline_library *pipeline_library,
+        struct d3d12_device *device, const void *blob, size_t blob_length)
+{
+    const struct vkd3d_serialized_pipeline_library_stream *header = blob;
+    const struct vkd3d_serialized_pipeline_stream_entry **parsed_entries = NULL;
+    const struct vkd3d_serialized_pipeline_stream_entry *entries;
+    uint32_t counts[VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE + 1];
+    struct vkd3d_cached_pipeline_entry entry;
+    uint64_t blob_length_saved = blob_length;
+    size_t parsed_entries_count = 0;
+    size_t parsed_entries_size = 0;
+    bool early_teardown = false;
+    size_t batch_end, i, j;
+    uint32_t aligned_size;
+    struct hash_map *map;
+    bool needs_lock;
+    HRESULT hr;
 
-            default:
-                FIXME("Unrecognized type %u.\n", entries->type);
-                map = NULL;
-                break;
+    if (FAILED(hr = d3d12_pipeline_library_validate_stream_format_header(pipeline_library, device, blob, blob_length)))
+        return hr;
+
+    entries = (const struct vkd3d_serialized_pipeline_stream_entry *)header->entries;
+    blob_length -= offsetof(struct vkd3d_serialized_pipeline_library_stream, entries);
+    memset(counts, 0, sizeof(counts));
+
+    /* First, find entry boundaries. This only touches headers and is cheap. */
+    while (blob_length >= sizeof(*entries))
+    {
+        blob_length -= sizeof(*entries);
+        aligned_size = align(entries->size, VKD3D_PIPELINE_BLOB_ALIGN);
+
+        /* Sliced files are expected to work since application may terminate in the middle of writing. */
+        if (blob_length < aligned_size)
+        {
+            INFO("Sliced stream cache entry detected. Ignoring rest of archive.\n");
+            break;
         }
 
-        if (map)
+        if (!vkd3d_array_reserve((void **)&parsed_entries, &parsed_entries_size,
+                parsed_entries_count + 1, sizeof(*parsed_entries)))
         {
-            /* If async flag is set it means we're parsing from a thread, and we must lock since application
-             * might be busy trying to create pipelines at this time.
-             * If we're parsing at device init, we don't need to lock. */
-            if (pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE_PARSE_ASYNC)
-            {
-                if (entries->type == VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE)
-                {
-                    /* Pipeline entries are handled with the main mutex. */
-                    rwlock_lock_write(&pipeline_library->mutex);
-                    d3d12_pipeline_library_insert_hash_map_blob_locked(pipeline_library, map, &entry);
-                    rwlock_unlock_write(&pipeline_library->mutex);
-                }
-                else
-                {
-                    /* Non-PSO caches use the internal lock implicitly here. */
-                    d3d12_pipeline_library_insert_hash_map_blob_internal(pipeline_library, map, &entry);
-                }
-            }
-            else
-                d3d12_pipeline_library_insert_hash_map_blob_locked(pipeline_library, map, &entry);
+            vkd3d_free(parsed_entries);
+            return E_OUTOFMEMORY;
         }
 
+        parsed_entries[parsed_entries_count++] = entries;
         blob_length -= aligned_size;
         entries = (const struct vkd3d_serialized_pipeline_stream_entry *)&entries->data[aligned_size];
     }
 
+    /* Then validate checksums in parallel. */
+    i = d3d12_pipeline_library_validate_stream_entries_parallel(pipeline_library,
+            parsed_entries, parsed_entries_count);
+
+    if (vkd3d_atomic_uint32_load_explicit(&pipeline_library->stream_archive_cancellation_point,
+            vkd3d_memory_order_relaxed))
+    {
+        INFO("Device teardown request received, stopping parse early.\n");
+        early_teardown = true;
+    }
+    else if (i != parsed_entries_count)
+    {
+        INFO("Corrupt stream cache entry detected. Ignoring rest of archive.\n");
+        parsed_entries_count = i;
+    }
+
+    /* If async flag is set it means we're parsing from a thread, and we must lock since application
+     * might be busy trying to create pipelines at this time.
+     * If we're parsing at device init, we don't need to lock.
+     * Insert in batches so we don't bounce the locks for every entry,
+     * but still let application threads in regularly. */
+    needs_lock = !!(pipeline_library->flags & VKD3D_PIPELINE_LIBRARY_FLAG_STREAM_ARCHIVE_PARSE_ASYNC);
+
+    for (i = 0; i < parsed_entries_count && !early_teardown; i = batch_end)
+    {
+        batch_end = min(i + VKD3D_STREAM_ARCHIVE_INSERT_BATCH_SIZE, parsed_entries_count);
+
+        if (needs_lock)
+        {
+            /* Same lock order as serialization. */
+            rwlock_lock_write(&pipeline_library->mutex);
+            rwlock_lock_write(&pipeline_library->internal_hashmap_mutex);
+        }
+
+        for (j = i; j < batch_end; j++)
+        {
+            entries = parsed_entries[j];
+
+            if (!(map = d3d12_pipeline_library_get_stream_entry_map(pipeline_library, entries->type)))
+                continue;
+
+            entry.key.name_length = 0;
+            entry.key.name = NULL;
+            entry.key.internal_key_hash = entries->hash;
+            entry.data.blob_length = entries->size;
+            entry.data.blob = entries->data;
+            /* The read-only portion of the stream archive is backed by mmap so we avoid committing too much memory.
+             * Similar idea as normal application pipeline libraries. */
+            entry.data.is_new = 0;
+            entry.data.state = NULL;
+
+            d3d12_pipeline_library_insert_hash_map_blob_locked(pipeline_library, map, &entry);
+            counts[entries->type]++;
+        }
+
+        if (needs_lock)
+        {
+            rwlock_unlock_write(&pipeline_library->internal_hashmap_mutex);
+            rwlock_unlock_write(&pipeline_library->mutex);
+        }
+    }
+
+    vkd3d_free(parsed_entries);
+
     if (!early_teardown && VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
     {
         INFO("Loading stream pipeline library (%"PRIu64" bytes):\n"
@@ -2363,9 +3173,9 @@ static HRESULT d3d12_pipeline_library_read_blob_stream_format(struct d3d12_pipel
                 "  Unique SPIR-V count: %u\n"
                 "  Unique VkPipelineCache count: %u\n",
                 blob_length_saved,
-                pipeline_count,
-                spirv_count,
-                driver_cache_count);
+                counts[VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE],
+                counts[VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV],
+                counts[VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE]);
     }
 
     return S_OK;
@@ -2753,8 +3563,9 @@ void vkd3d_pipeline_cache_compat_from_state_desc(struct vkd3d_pipeline_cache_com
         {
             const struct vkd3d_shader_code dxbc = { code_list[i]->pShaderBytecode, code_list[i]->BytecodeLength };
             compat->dxbc_blob_hashes[output_index] = vkd3d_shader_hash(&dxbc);
+            /* Log the hash used by VKD3D_SHADER_DUMP_PATH and shader overrides, not the compat hash. */
             if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
-                INFO("Shader hash: %016"PRIx64".\n", compat->dxbc_blob_hashes[output_index]);
+                INFO("Shader hash: %016"PRIx64".\n", vkd3d_shader_hash_legacy(&dxbc));
             compat->dxbc_blob_hashes[output_index] = hash_fnv1_iterate_u8(compat->dxbc_blob_hashes[output_index], i);
             output_index++;
         }
@@ -2774,6 +3585,63 @@ uint64_t vkd3d_pipeline_cache_compatibility_condense(const struct vkd3d_pipeline
     return h;
 }
 
+static HRESULT vkd3d_pipeline_library_disk_cache_save_shared_blob(struct vkd3d_pipeline_library_disk_cache *cache,
+        const struct vkd3d_pipeline_library_disk_cache_item *item)
+{
+    struct d3d12_pipeline_library *library = cache->library;
+    struct vkd3d_cached_pipeline_entry entry;
+    const void *data;
+    void *new_blob;
+    size_t size;
+    bool ret;
+    int rc;
+
+    if (!d3d12_pipeline_library_find_shared_cache_blob(library, item->shared_type, item->shared_hash, &data, &size))
+        return E_INVALIDARG;
+
+    if (!(new_blob = vkd3d_malloc(size)))
+        return E_OUTOFMEMORY;
+    memcpy(new_blob, data, size);
+
+    entry.key.name_length = 0;
+    entry.key.name = NULL;
+    entry.key.internal_key_hash = item->shared_hash;
+    entry.data.blob = new_blob;
+    entry.data.blob_length = size;
+    entry.data.is_new = 1;
+    entry.data.state = NULL;
+
+    /* Inserting into our own maps first drops duplicate requests. */
+    if (item->shared_type == VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE)
+    {
+        if ((rc = rwlock_lock_write(&library->mutex)))
+        {
+            ERR("Failed to lock mutex, rc %d.\n", rc);
+            vkd3d_free(new_blob);
+            return hresult_from_errno(rc);
+        }
+
+        ret = d3d12_pipeline_library_insert_hash_map_blob_locked(library, &library->pso_map, &entry);
+        rwlock_unlock_write(&library->mutex);
+    }
+    else
+    {
+        ret = d3d12_pipeline_library_insert_hash_map_blob_internal(library,
+                item->shared_type == VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV ?
+                &library->spirv_cache_map : &library->driver_cache_map, &entry);
+    }
+
+    if (!ret)
+    {
+        vkd3d_free(new_blob);
+        return E_INVALIDARG;
+    }
+
+    vkd3d_pipeline_library_disk_cache_notify_blob_insert(cache, item->shared_hash, item->shared_type,
+            entry.data.blob, entry.data.blob_length);
+    return S_OK;
+}
+
 static HRESULT vkd3d_pipeline_library_disk_cache_save_pipeline_state(struct vkd3d_pipeline_library_disk_cache *cache,
         const struct vkd3d_pipeline_library_disk_cache_item *item)
 {
@@ -2783,6 +3651,9 @@ static HRESULT vkd3d_pipeline_library_disk_cache_save_pipeline_state(struct vkd3
     VkResult vr;
     int rc;
 
+    if (!item->state)
+        return vkd3d_pipeline_library_disk_cache_save_shared_blob(cache, item);
+
     /* Try to avoid taking writer locks until we're absolutely forced to.
      * It's fairly likely we'll see duplicates here, so we should avoid stalling
      * when multiple threads are hammering us with PSO creation. */
@@ -2797,7 +3668,11 @@ static HRESULT vkd3d_pipeline_library_disk_cache_save_pipeline_state(struct vkd3
         return hresult_from_errno(rc);
     }
 
-    if (hash_map_find(&library->pso_map, &entry.key))
+    if (hash_map_find(&library->pso_map, &entry.key) ||
+            d3d12_pipeline_library_find_indexed_archive_entry(library,
+                    VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE, entry.key.internal_key_hash) ||
+            d3d12_pipeline_library_find_persisted_shared_cache_blob(library,
+                    VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE, entry.key.internal_key_hash))
     {
         /* This could happen if a parallel thread tried to create the same PSO.
          * In a single threaded scenario we would find the PSO when creating the PSO,
@@ -2878,6 +3753,28 @@ HRESULT vkd3d_pipeline_library_store_pipeline_to_disk_cache(
     return S_OK;
 }
 
+static void vkd3d_pipeline_library_disk_cache_persist_shared_blob(struct vkd3d_pipeline_library_disk_cache *cache,
+        enum vkd3d_serialized_pipeline_stream_entry_type type, uint64_t hash, const void *data)
+{
+    struct vkd3d_pipeline_library_disk_cache_item *item;
+
+    if (vkd3d_pipeline_library_disk_cache_is_shared_blob_persisted(cache, data))
+        return;
+
+    /* The disk$ thread drops duplicates, so it's fine if this is queued up more than once. */
+    pthread_mutex_lock(&cache->lock);
+    if (vkd3d_array_reserve((void**)&cache->items, &cache->items_size,
+            cache->items_count + 1, sizeof(*cache->items)))
+    {
+        item = &cache->items[cache->items_count++];
+        item->state = NULL;
+        item->shared_hash = hash;
+        item->shared_type = type;
+        condvar_reltime_signal(&cache->cond);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
 HRESULT vkd3d_pipeline_library_find_cached_blob_from_disk_cache(struct vkd3d_pipeline_library_disk_cache *cache,
         const struct vkd3d_pipeline_cache_compatibility *compat,
         struct d3d12_cached_pipeline_state *cached_state)
@@ -2885,21 +3782,53 @@ HRESULT vkd3d_pipeline_library_find_cached_blob_from_disk_cache(struct vkd3d_pip
     struct d3d12_pipeline_library *library = cache->library;
     const struct vkd3d_cached_pipeline_entry *e;
     struct vkd3d_cached_pipeline_key key;
+    const void *blob;
+    size_t blob_size;
     int rc;
 
-    if ((rc = rwlock_lock_read(&library->mutex)))
+    key.name_length = 0;
+    key.name = NULL;
+    key.internal_key_hash = vkd3d_pipeline_cache_compatibility_condense(compat);
+
+    /* The indexed archive is insert-only, so we can look it up without taking any locks. */
+    if (d3d12_pipeline_library_find_indexed_archive_blob(library, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE,
+            key.internal_key_hash, &blob, &blob_size))
+    {
+        cached_state->blob.CachedBlobSizeInBytes = blob_size;
+        cached_state->blob.pCachedBlob = blob;
+        cached_state->library = library;
+        vkd3d_pipeline_library_stats_record_lookup(&library->device->pipeline_library_stats,
+                VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, true, blob_size);
+        return S_OK;
+    }
+
+    if ((rc = rwlock_lock_read(&library->mutex)))
     {
         ERR("Failed to lock mutex, rc %d.\n", rc);
         return hresult_from_errno(rc);
     }
 
-    key.name_length = 0;
-    key.name = NULL;
-    key.internal_key_hash = vkd3d_pipeline_cache_compatibility_condense(compat);
-
     if (!(e = (const struct vkd3d_cached_pipeline_entry*)hash_map_find(&library->pso_map, &key)))
     {
         rwlock_unlock_read(&library->mutex);
+
+        /* A PSO which only exists in the shared cache is copied to our own archive,
+         * after which the pso_map lookup above finds it. */
+        if (d3d12_pipeline_library_find_shared_cache_blob(library, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE,
+                key.internal_key_hash, &blob, &blob_size))
+        {
+            vkd3d_pipeline_library_disk_cache_persist_shared_blob(cache,
+                    VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE, key.internal_key_hash, blob);
+            cached_state->blob.CachedBlobSizeInBytes = blob_size;
+            cached_state->blob.pCachedBlob = blob;
+            cached_state->library = library;
+            vkd3d_pipeline_library_stats_record_lookup(&library->device->pipeline_library_stats,
+                    VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, true, blob_size);
+            return S_OK;
+        }
+
+        vkd3d_pipeline_library_stats_record_lookup(&library->device->pipeline_library_stats,
+                VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, false, 0);
         return E_INVALIDARG;
     }
 
@@ -2907,9 +3836,60 @@ HRESULT vkd3d_pipeline_library_find_cached_blob_from_disk_cache(struct vkd3d_pip
     cached_state->blob.pCachedBlob = e->data.blob;
     cached_state->library = library;
     rwlock_unlock_read(&library->mutex);
+    vkd3d_pipeline_library_stats_record_lookup(&library->device->pipeline_library_stats,
+            VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE, true, e->data.blob_length);
     return S_OK;
 }
 
+void vkd3d_pipeline_library_stats_record_lookup(struct vkd3d_pipeline_library_stats *stats,
+        enum vkd3d_pipeline_library_tier tier, bool hit, size_t size)
+{
+    struct vkd3d_pipeline_library_tier_stats *tier_stats = &stats->tiers[tier];
+
+    if (hit)
+    {
+        vkd3d_atomic_uint64_add(&tier_stats->hit_count, 1, vkd3d_memory_order_relaxed);
+        vkd3d_atomic_uint64_add(&tier_stats->bytes_read, size, vkd3d_memory_order_relaxed);
+    }
+    else
+        vkd3d_atomic_uint64_add(&tier_stats->miss_count, 1, vkd3d_memory_order_relaxed);
+}
+
+void vkd3d_pipeline_library_stats_report(struct vkd3d_pipeline_library_stats *stats)
+{
+    static const char *tier_names[] = { "SPIR-V", "Driver cache", "D3D12 PSO" };
+    struct vkd3d_pipeline_library_tier_stats *tier_stats;
+    uint64_t hit_count, miss_count, count;
+    unsigned int i;
+
+    STATIC_ASSERT(ARRAY_SIZE(tier_names) == VKD3D_PIPELINE_LIBRARY_TIER_COUNT);
+
+    INFO("Pipeline library statistics:\n");
+
+    for (i = 0; i < VKD3D_PIPELINE_LIBRARY_TIER_COUNT; i++)
+    {
+        tier_stats = &stats->tiers[i];
+        hit_count = vkd3d_atomic_uint64_load_explicit(&tier_stats->hit_count, vkd3d_memory_order_relaxed);
+        miss_count = vkd3d_atomic_uint64_load_explicit(&tier_stats->miss_count, vkd3d_memory_order_relaxed);
+
+        INFO("  %s: %"PRIu64" hits, %"PRIu64" misses (%.1f %% hit rate), %"PRIu64" bytes read.\n",
+                tier_names[i], hit_count, miss_count,
+                hit_count + miss_count ? 100.0 * (double)hit_count / (double)(hit_count + miss_count) : 0.0,
+                vkd3d_atomic_uint64_load_explicit(&tier_stats->bytes_read, vkd3d_memory_order_relaxed));
+    }
+
+    INFO("  Validate: %.3f ms, decode: %.3f ms.\n",
+            1e-6 * (double)vkd3d_atomic_uint64_load_explicit(&stats->validate_ns, vkd3d_memory_order_relaxed),
+            1e-6 * (double)vkd3d_atomic_uint64_load_explicit(&stats->decode_ns, vkd3d_memory_order_relaxed));
+
+    count = vkd3d_atomic_uint64_load_explicit(&stats->cached_compile_count, vkd3d_memory_order_relaxed);
+    INFO("  Compile with cached blob: %"PRIu64" PSOs, %.3f ms.\n", count,
+            1e-6 * (double)vkd3d_atomic_uint64_load_explicit(&stats->cached_compile_ns, vkd3d_memory_order_relaxed));
+    count = vkd3d_atomic_uint64_load_explicit(&stats->uncached_compile_count, vkd3d_memory_order_relaxed);
+    INFO("  Compile without cached blob: %"PRIu64" PSOs, %.3f ms.\n", count,
+            1e-6 * (double)vkd3d_atomic_uint64_load_explicit(&stats->uncached_compile_ns, vkd3d_memory_order_relaxed));
+}
+
 static void *vkd3d_pipeline_library_disk_thread_main(void *userarg);
 
 struct disk_cache_entry_key
@@ -3160,17 +4140,635 @@ out_cancellation:
     vkd3d_free(tmp_buffer);
 }
 
+struct vkd3d_pipeline_library_merge_entry
+{
+    struct vkd3d_serialized_pipeline_index_entry index;
+    const uint8_t *data;
+};
+
+struct vkd3d_pipeline_library_merge_state
+{
+    struct hash_map map;
+    struct vkd3d_pipeline_library_merge_entry *entries;
+    size_t entries_count;
+    size_t entries_size;
+};
+
+static bool vkd3d_pipeline_library_merge_state_add(struct vkd3d_pipeline_library_merge_state *merge,
+        const struct vkd3d_serialized_pipeline_stream_entry *stream_entry, const uint8_t *data)
+{
+    struct vkd3d_pipeline_library_merge_entry *merge_entry;
+    struct disk_cache_entry entry;
+
+    /* Sorting relies on known types only. */
+    if (stream_entry->type > VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE)
+        return false;
+
+    entry.key.hash = stream_entry->hash;
+    entry.key.type = stream_entry->type;
+    if (hash_map_find(&merge->map, &entry.key) || !hash_map_insert(&merge->map, &entry.key, &entry.entry))
+        return false;
+
+    if (!vkd3d_array_reserve((void **)&merge->entries, &merge->entries_size,
+            merge->entries_count + 1, sizeof(*merge->entries)))
+        return false;
+
+    merge_entry = &merge->entries[merge->entries_count++];
+    merge_entry->index.hash = stream_entry->hash;
+    merge_entry->index.checksum = stream_entry->checksum;
+    merge_entry->index.size = stream_entry->size;
+    merge_entry->index.type = stream_entry->type;
+    merge_entry->index.blob_offset = 0;
+    merge_entry->data = data;
+    return true;
+}
+
+static bool vkd3d_pipeline_library_merge_state_add_stream_archive(struct vkd3d_pipeline_library_disk_cache *cache,
+        struct vkd3d_pipeline_library_merge_state *merge, const void *blob, size_t blob_length,
+        unsigned int *added_entries)
+{
+    const struct vkd3d_serialized_pipeline_library_stream *header = blob;
+    const struct vkd3d_serialized_pipeline_stream_entry *entries;
+    size_t aligned_size;
+
+    entries = (const struct vkd3d_serialized_pipeline_stream_entry *)header->entries;
+    blob_length -= sizeof(*header);
+
+    while (blob_length >= sizeof(*entries))
+    {
+        /* Don't want to throw away the disk caches here. Try again next time. */
+        if (vkd3d_atomic_uint32_load_explicit(&cache->library->stream_archive_cancellation_point,
+                vkd3d_memory_order_relaxed))
+        {
+            INFO("Device teardown request received, stopping parse early.\n");
+            return false;
+        }
+
+        blob_length -= sizeof(*entries);
+        aligned_size = align(entries->size, VKD3D_PIPELINE_BLOB_ALIGN);
+
+        if (blob_length < aligned_size)
+        {
+            INFO("Stream archive entry is sliced. Ignoring rest of archive.\n");
+            break;
+        }
+
+        if (!vkd3d_serialized_pipeline_stream_entry_validate(entries->data, entries))
+        {
+            INFO("Found corrupt entry in stream archive. Ignoring rest of archive.\n");
+            break;
+        }
+
+        if (vkd3d_pipeline_library_merge_state_add(merge, entries, entries->data))
+            (*added_entries)++;
+
+        blob_length -= aligned_size;
+        entries = (const struct vkd3d_serialized_pipeline_stream_entry *)&entries->data[aligned_size];
+    }
+
+    return true;
+}
+
+static bool vkd3d_pipeline_library_merge_state_add_indexed_archive(struct vkd3d_pipeline_library_disk_cache *cache,
+        struct vkd3d_pipeline_library_merge_state *merge, const void *blob, size_t blob_length,
+        unsigned int *added_entries)
+{
+    const struct vkd3d_serialized_pipeline_library_indexed *header = blob;
+    const struct vkd3d_serialized_pipeline_index_entry *index_entry;
+    struct vkd3d_serialized_pipeline_stream_entry stream_entry;
+    const uint8_t *data;
+    size_t total_entries;
+    size_t i;
+
+    total_entries = header->spirv_count + header->driver_cache_count + header->pipeline_count;
+
+    for (i = 0; i < total_entries; i++)
+    {
+        /* Don't want to throw away the disk caches here. Try again next time. */
+        if (vkd3d_atomic_uint32_load_explicit(&cache->library->stream_archive_cancellation_point,
+                vkd3d_memory_order_relaxed))
+        {
+            INFO("Device teardown request received, stopping parse early.\n");
+            return false;
+        }
+
+        index_entry = &header->entries[i];
+
+        if (index_entry->blob_offset > blob_length || index_entry->size > blob_length - index_entry->blob_offset)
+        {
+            INFO("Found out of bounds entry in indexed archive. Skipping it.\n");
+            continue;
+        }
+
+        stream_entry.hash = index_entry->hash;
+        stream_entry.checksum = index_entry->checksum;
+        stream_entry.size = index_entry->size;
+        stream_entry.type = index_entry->type;
+        data = (const uint8_t *)blob + index_entry->blob_offset;
+
+        /* Unlike stream archives, a single corrupt entry does not invalidate the rest. */
+        if (!vkd3d_serialized_pipeline_stream_entry_validate(data, &stream_entry))
+        {
+            INFO("Found corrupt entry in indexed archive. Skipping it.\n");
+            continue;
+        }
+
+        if (vkd3d_pipeline_library_merge_state_add(merge, &stream_entry, data))
+            (*added_entries)++;
+    }
+
+    return true;
+}
+
+static int vkd3d_pipeline_library_merge_entry_compare(const void *a_, const void *b_)
+{
+    const struct vkd3d_pipeline_library_merge_entry *a = a_;
+    const struct vkd3d_pipeline_library_merge_entry *b = b_;
+
+    if (a->index.type != b->index.type)
+        return a->index.type < b->index.type ? -1 : 1;
+    if (a->index.hash != b->index.hash)
+        return a->index.hash < b->index.hash ? -1 : 1;
+    return 0;
+}
+
+static bool vkd3d_pipeline_library_merge_state_write_indexed_archive(struct vkd3d_pipeline_library_disk_cache *cache,
+        struct vkd3d_pipeline_library_merge_state *merge, FILE *file)
+{
+    struct vkd3d_serialized_pipeline_library_stream stream_header;
+    struct vkd3d_serialized_pipeline_library_indexed header;
+    struct vkd3d_pipeline_library_merge_entry *merge_entry;
+    uint8_t zero_array[VKD3D_PIPELINE_BLOB_ALIGN];
+    uint32_t padding_size;
+    uint64_t blob_offset;
+    size_t i;
+
+    /* Groups entries by type in index order, and sorts each group by hash for binary search. */
+    qsort(merge->entries, merge->entries_count, sizeof(*merge->entries), vkd3d_pipeline_library_merge_entry_compare);
+
+    d3d12_pipeline_library_serialize_stream_archive_header(cache->library, &stream_header);
+    memset(&header, 0, sizeof(header));
+    memcpy(&header, &stream_header, sizeof(stream_header));
+    header.version = VKD3D_PIPELINE_LIBRARY_VERSION_INDEXED;
+
+    blob_offset = sizeof(header) + merge->entries_count * sizeof(struct vkd3d_serialized_pipeline_index_entry);
+
+    for (i = 0; i < merge->entries_count; i++)
+    {
+        merge_entry = &merge->entries[i];
+        merge_entry->index.blob_offset = blob_offset;
+        blob_offset += align(merge_entry->index.size, VKD3D_PIPELINE_BLOB_ALIGN);
+
+        switch (merge_entry->index.type)
+        {
+            case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV:
+                header.spirv_count++;
+                break;
+
+            case VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE:
+                header.driver_cache_count++;
+                break;
+
+            default:
+                header.pipeline_count++;
+                break;
+        }
+    }
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        ERR("Failed to write indexed archive header.\n");
+        return false;
+    }
+
+    for (i = 0; i < merge->entries_count; i++)
+    {
+        if (fwrite(&merge->entries[i].index, sizeof(merge->entries[i].index), 1, file) != 1)
+        {
+            ERR("Failed to write indexed archive entry.\n");
+            return false;
+        }
+    }
+
+    memset(zero_array, 0, sizeof(zero_array));
+
+    for (i = 0; i < merge->entries_count; i++)
+    {
+        merge_entry = &merge->entries[i];
+        padding_size = align(merge_entry->index.size, VKD3D_PIPELINE_BLOB_ALIGN) - merge_entry->index.size;
+
+        if (fwrite(merge_entry->data, 1, merge_entry->index.size, file) != merge_entry->index.size ||
+                fwrite(zero_array, 1, padding_size, file) != padding_size)
+        {
+            ERR("Failed to write indexed archive blob.\n");
+            return false;
+        }
+    }
+
+    INFO("Wrote indexed archive: %u SPIR-V, %u VkPipelineCache, %u PSO entries (%"PRIu64" bytes).\n",
+            header.spirv_count, header.driver_cache_count, header.pipeline_count, blob_offset);
+    return true;
+}
+
+static void vkd3d_pipeline_library_merge_state_mark_links(struct hash_map *referenced,
+        const struct vkd3d_pipeline_library_merge_entry *merge_entry, uint32_t *spirv_link_count)
+{
+    const struct vkd3d_pipeline_blob *blob = (const struct vkd3d_pipeline_blob *)merge_entry->data;
+    const struct vkd3d_pipeline_blob_chunk_link *link;
+    const struct vkd3d_pipeline_blob_chunk *chunk;
+    struct disk_cache_entry entry;
+    size_t aligned_chunk_size;
+    size_t size;
+
+    if (merge_entry->index.size < sizeof(*blob))
+        return;
+
+    chunk = CONST_CAST_CHUNK_BASE(blob);
+    size = merge_entry->index.size - sizeof(*blob);
+
+    while (size >= sizeof(*chunk))
+    {
+        aligned_chunk_size = align(chunk->size + sizeof(*chunk), VKD3D_PIPELINE_BLOB_CHUNK_ALIGN);
+        if (aligned_chunk_size > size)
+            break;
+
+        entry.key.type = VKD3D_SERIALIZED_PIPELINE_STREAM_MAX_INT;
+
+        if (chunk->size >= sizeof(*link))
+        {
+            switch (chunk->type & VKD3D_PIPELINE_BLOB_CHUNK_TYPE_MASK)
+            {
+                case VKD3D_PIPELINE_BLOB_CHUNK_TYPE_VARINT_SPIRV_LINK:
+                    entry.key.type = VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV;
+                    (*spirv_link_count)++;
+                    break;
+
+                case VKD3D_PIPELINE_BLOB_CHUNK_TYPE_PIPELINE_CACHE_LINK:
+                    entry.key.type = VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        if (entry.key.type != VKD3D_SERIALIZED_PIPELINE_STREAM_MAX_INT)
+        {
+            link = CONST_CAST_CHUNK_DATA(chunk, link);
+            entry.key.hash = link->hash;
+            if (!hash_map_find(referenced, &entry.key))
+                hash_map_insert(referenced, &entry.key, &entry.entry);
+        }
+
+        chunk = (const struct vkd3d_pipeline_blob_chunk *)&chunk->data[align(chunk->size, VKD3D_PIPELINE_BLOB_CHUNK_ALIGN)];
+        size -= aligned_chunk_size;
+    }
+}
+
+static void vkd3d_pipeline_library_merge_state_collect_garbage(struct vkd3d_pipeline_library_merge_state *merge)
+{
+    struct vkd3d_pipeline_library_merge_entry *merge_entry;
+    uint32_t spirv_link_count = 0;
+    uint32_t spirv_unique_count = 0;
+    uint64_t collected_size = 0;
+    struct disk_cache_entry_key key;
+    uint32_t collected_count = 0;
+    struct hash_map referenced;
+    size_t i, new_count;
+
+    /* Internal blobs are only reachable through links in PSO blobs.
+     * Anything left unreferenced after a merge can never be used again, so drop it while we're rewriting anyway. */
+    hash_map_init(&referenced, disk_cache_entry_key_cb, disk_cache_entry_compare_cb, sizeof(struct disk_cache_entry));
+
+    for (i = 0; i < merge->entries_count; i++)
+    {
+        if (merge->entries[i].index.type == VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE)
+            vkd3d_pipeline_library_merge_state_mark_links(&referenced, &merge->entries[i], &spirv_link_count);
+    }
+
+    for (i = 0, new_count = 0; i < merge->entries_count; i++)
+    {
+        merge_entry = &merge->entries[i];
+
+        if (merge_entry->index.type != VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE)
+        {
+            key.hash = merge_entry->index.hash;
+            key.type = merge_entry->index.type;
+
+            if (!hash_map_find(&referenced, &key))
+            {
+                collected_size += merge_entry->index.size;
+                collected_count++;
+                continue;
+            }
+
+            if (merge_entry->index.type == VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV)
+                spirv_unique_count++;
+        }
+
+        merge->entries[new_count++] = *merge_entry;
+    }
+
+    merge->entries_count = new_count;
+    hash_map_free(&referenced);
+
+    INFO("Collected %u unreferenced internal blobs (%"PRIu64" bytes).\n", collected_count, collected_size);
+    INFO("SPIR-V de-duplication: %u references to %u unique modules (ratio %.3f).\n",
+            spirv_link_count, spirv_unique_count, (double)spirv_link_count / max(spirv_unique_count, 1));
+}
+
+/* Merging takes seconds at most, so a merge file this old cannot belong to a live process. */
+#define VKD3D_PIPELINE_LIBRARY_STALE_MERGE_AGE (10 * 60)
+
+static void vkd3d_pipeline_library_disk_cache_merge_indexed(struct vkd3d_pipeline_library_disk_cache *cache,
+        const char *read_path, const char *write_path)
+{
+    struct vkd3d_memory_mapped_file mapped_write_cache;
+    struct vkd3d_memory_mapped_file mapped_read_cache;
+    struct vkd3d_pipeline_library_merge_state merge;
+    struct d3d12_pipeline_library *library;
+    char merge_path[VKD3D_PATH_MAX];
+    unsigned int existing_entries;
+    uint64_t merge_file_age;
+    unsigned int new_entries;
+    bool has_write_cache;
+    FILE *merge_file;
+    bool success;
+    HRESULT hr;
+
+    library = cache->library;
+    existing_entries = 0;
+    new_entries = 0;
+    memset(&merge, 0, sizeof(merge));
+    hash_map_init(&merge.map, disk_cache_entry_key_cb, disk_cache_entry_compare_cb, sizeof(struct disk_cache_entry));
+    snprintf(merge_path, sizeof(merge_path), "%s.merge", read_path);
+
+    vkd3d_file_map_read_only(read_path, &mapped_read_cache);
+    has_write_cache = vkd3d_file_map_read_only(write_path, &mapped_write_cache);
+
+    if (mapped_read_cache.mapped)
+    {
+        success = true;
+
+        if (SUCCEEDED(d3d12_pipeline_library_validate_indexed_format_header(library, library->device,
+                mapped_read_cache.mapped, mapped_read_cache.mapped_size)))
+        {
+            if (!has_write_cache)
+            {
+                INFO("Read-only cache is already indexed and no write cache exists. No need to merge any disk caches.\n");
+                goto out_cancellation;
+            }
+
+            success = vkd3d_pipeline_library_merge_state_add_indexed_archive(cache, &merge,
+                    mapped_read_cache.mapped, mapped_read_cache.mapped_size, &existing_entries);
+        }
+        else if (SUCCEEDED(d3d12_pipeline_library_validate_stream_format_header(library, library->device,
+                mapped_read_cache.mapped, mapped_read_cache.mapped_size)))
+        {
+            INFO("Converting stream archive to indexed archive.\n");
+            success = vkd3d_pipeline_library_merge_state_add_stream_archive(cache, &merge,
+                    mapped_read_cache.mapped, mapped_read_cache.mapped_size, &existing_entries);
+        }
+        else
+            INFO("Read-only cache is out of date, discarding it.\n");
+
+        if (!success)
+            goto out_cancellation;
+    }
+
+    if (has_write_cache)
+    {
+        if (FAILED(hr = d3d12_pipeline_library_validate_stream_format_header(library, library->device,
+                mapped_write_cache.mapped, mapped_write_cache.mapped_size)))
+        {
+            INFO("Write cache is invalid (hr #%x), nuking it.\n", (int)hr);
+        }
+        else if (!vkd3d_pipeline_library_merge_state_add_stream_archive(cache, &merge,
+                mapped_write_cache.mapped, mapped_write_cache.mapped_size, &new_entries))
+        {
+            goto out_cancellation;
+        }
+    }
+
+    vkd3d_pipeline_library_merge_state_collect_garbage(&merge);
+
+    if (!merge.entries_count)
+    {
+        INFO("No valid disk cache entries found. No need to write an indexed cache.\n");
+        goto out;
+    }
+
+    /* A merge file which has not been touched for a long time was left behind by a process which was killed
+     * while merging. Nothing else removes it, and it would block merging forever. */
+    if (vkd3d_file_query_age(merge_path, &merge_file_age) && merge_file_age >= VKD3D_PIPELINE_LIBRARY_STALE_MERGE_AGE)
+    {
+        INFO("Removing stale merge cache.\n");
+        vkd3d_file_delete(merge_path);
+    }
+
+    /* Exclusive creation of the merge file ensures we don't race with other processes merging concurrently.
+     * The merge file and write cache belong to the other process in that case, so leave everything alone. */
+    if (!(merge_file = vkd3d_file_open_exclusive_write(merge_path)))
+    {
+        INFO("Cannot exclusively create merge cache. Likely a race condition with multiple processes.\n");
+        goto out_cancellation;
+    }
+
+    success = vkd3d_pipeline_library_merge_state_write_indexed_archive(cache, &merge, merge_file);
+    fclose(merge_file);
+
+    /* The read cache is referenced by merge entries, so we can only unmap it after writing everything out.
+     * It must also be unmapped before we can replace it. */
+    vkd3d_file_unmap(&mapped_read_cache);
+
+    INFO("Done merging shader caches, existing entries: %u, new entries: %u.\n", existing_entries, new_entries);
+
+    if (success && vkd3d_file_rename_overwrite(merge_path, read_path))
+    {
+        INFO("Successfully replaced shader cache with indexed cache.\n");
+    }
+    else
+    {
+        INFO("Failed to replace shader cache.\n");
+        /* We own the merge file, so it's safe to remove. */
+        vkd3d_file_delete(merge_path);
+    }
+
+out:
+    /* There shouldn't be any write cache left after merging. */
+    vkd3d_file_unmap(&mapped_write_cache);
+    vkd3d_file_delete(write_path);
+
+out_cancellation:
+    vkd3d_file_unmap(&mapped_write_cache);
+    vkd3d_file_unmap(&mapped_read_cache);
+    hash_map_free(&merge.map);
+    vkd3d_free(merge.entries);
+}
+
+static uint32_t vkd3d_pipeline_library_disk_cache_peek_version(const char *path)
+{
+    uint32_t version = 0;
+    FILE *file;
+
+    if ((file = fopen(path, "rb")))
+    {
+        if (fread(&version, sizeof(version), 1, file) != 1)
+            version = 0;
+        fclose(file);
+    }
+
+    return version;
+}
+
+/* Fixed size of the shared cache file. It is sparse on most file systems, so unused space is cheap. */
+#define VKD3D_PIPELINE_LIBRARY_SHARED_CACHE_SIZE (256ull * 1024 * 1024)
+
+static bool vkd3d_pipeline_library_disk_cache_publish_hash_map(struct vkd3d_pipeline_library_disk_cache *cache,
+        rwlock_t *lock, const struct hash_map *map, enum vkd3d_serialized_pipeline_stream_entry_type type)
+{
+    const struct vkd3d_cached_pipeline_entry *e;
+    bool success = true;
+    uint32_t i;
+
+    if (rwlock_lock_read(lock))
+        return false;
+
+    for (i = 0; i < map->entry_count; i++)
+    {
+        e = (const struct vkd3d_cached_pipeline_entry *)hash_map_get_entry(map, i);
+
+        if ((e->entry.flags & HASH_MAP_ENTRY_OCCUPIED) &&
+                !vkd3d_shared_cache_publish(&cache->shared_cache, e->key.internal_key_hash, type,
+                        e->data.blob, e->data.blob_length))
+            success = false;
+    }
+
+    rwlock_unlock_read(lock);
+    return success;
+}
+
+static bool vkd3d_pipeline_library_disk_cache_publish_indexed_archive(struct vkd3d_pipeline_library_disk_cache *cache)
+{
+    const struct vkd3d_serialized_pipeline_library_indexed *archive = cache->library->indexed_archive;
+    const struct vkd3d_serialized_pipeline_index_entry *index_entry;
+    bool success = true;
+    const void *data;
+    size_t i, count;
+    size_t size;
+
+    if (!archive)
+        return true;
+
+    count = (size_t)archive->spirv_count + archive->driver_cache_count + archive->pipeline_count;
+
+    for (i = 0; i < count; i++)
+    {
+        index_entry = &archive->entries[i];
+
+        /* Goes through the regular lookup, so that only validated blobs end up in the shared cache. */
+        if (!d3d12_pipeline_library_find_indexed_archive_blob(cache->library, index_entry->type,
+                index_entry->hash, &data, &size) ||
+                !vkd3d_shared_cache_publish(&cache->shared_cache, index_entry->hash, index_entry->type, data, size))
+            success = false;
+    }
+
+    return success;
+}
+
+/* Returns true if the shared cache is already populated from the current on-disk archive,
+ * in which case the archive does not need to be parsed at all. */
+static bool vkd3d_pipeline_library_disk_cache_open_shared_cache(struct vkd3d_pipeline_library_disk_cache *cache)
+{
+    struct vkd3d_serialized_pipeline_library_stream stream_header;
+    char shared_path[VKD3D_PATH_MAX];
+    uint64_t identity, compat_key;
+
+    snprintf(shared_path, sizeof(shared_path), "%s.shared", cache->read_path);
+
+    /* Entries are only compatible with the driver and vkd3d-proton build that produced them. */
+    d3d12_pipeline_library_serialize_stream_archive_header(cache->library, &stream_header);
+    compat_key = hash_xxh64(&stream_header, sizeof(stream_header), 0);
+
+    if (!vkd3d_shared_cache_open(&cache->shared_cache, shared_path, compat_key,
+            VKD3D_PIPELINE_LIBRARY_SHARED_CACHE_SIZE))
+    {
+        INFO("Failed to open shared cache: %s.\n", shared_path);
+        return false;
+    }
+
+    vkd3d_atomic_ptr_store_explicit(&cache->library->shared_cache, &cache->shared_cache, vkd3d_memory_order_release);
+
+    /* A pending write archive has to be merged first. */
+    if (vkd3d_file_query_identity(cache->write_path, &identity))
+        return false;
+
+    return vkd3d_file_query_identity(cache->read_path, &identity) &&
+            vkd3d_shared_cache_get_tag(&cache->shared_cache) == identity;
+}
+
+static void vkd3d_pipeline_library_disk_cache_populate_shared_cache(struct vkd3d_pipeline_library_disk_cache *cache)
+{
+    struct d3d12_pipeline_library *library = cache->library;
+    struct vkd3d_shared_cache_stats stats;
+    uint64_t begin_ts, end_ts;
+    uint64_t identity;
+    bool success;
+
+    begin_ts = vkd3d_get_current_time_ns();
+
+    success = vkd3d_pipeline_library_disk_cache_publish_indexed_archive(cache);
+    success = vkd3d_pipeline_library_disk_cache_publish_hash_map(cache, &library->internal_hashmap_mutex,
+            &library->spirv_cache_map, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_SPIRV) && success;
+    success = vkd3d_pipeline_library_disk_cache_publish_hash_map(cache, &library->internal_hashmap_mutex,
+            &library->driver_cache_map, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_DRIVER_CACHE) && success;
+    success = vkd3d_pipeline_library_disk_cache_publish_hash_map(cache, &library->mutex,
+            &library->pso_map, VKD3D_SERIALIZED_PIPELINE_STREAM_ENTRY_PIPELINE) && success;
+
+    /* Only mark the shared cache as complete if everything made it in,
+     * otherwise the next process has to parse the archive again. */
+    if (success && vkd3d_file_query_identity(cache->read_path, &identity))
+    {
+        vkd3d_shared_cache_set_tag(&cache->shared_cache, identity);
+        cache->shared_cache_tagged = true;
+    }
+
+    end_ts = vkd3d_get_current_time_ns();
+    INFO("Populating shared cache took %.3f ms.\n", 1e-6 * (double)(end_ts - begin_ts));
+
+    vkd3d_shared_cache_get_stats(&cache->shared_cache, &stats);
+    INFO("Shared cache: %"PRIu64" entries, %"PRIu64" / %"PRIu64" bytes used, %u failed publishes.\n",
+            stats.entry_count, stats.data_used, stats.data_size, stats.failed_publish_count);
+}
+
 static void vkd3d_pipeline_library_disk_cache_initial_setup(struct vkd3d_pipeline_library_disk_cache *cache)
 {
     uint64_t begin_ts;
     uint64_t end_ts;
+    bool indexed;
     HRESULT hr;
 
+    if (VKD3D_CONFIG_FLAG_IS_SET(SHADER_CACHE_SHARED) &&
+            vkd3d_pipeline_library_disk_cache_open_shared_cache(cache))
+    {
+        INFO("Shared cache is up to date, skipping load of %s.\n", cache->read_path);
+        cache->shared_cache_tagged = true;
+        cache->library->disk_cache_listener = cache;
+        return;
+    }
+
     begin_ts = vkd3d_get_current_time_ns();
 
+    /* Once an archive is indexed, keep it indexed, since it cannot be appended to. */
+    indexed = VKD3D_CONFIG_FLAG_IS_SET(SHADER_CACHE_INDEXED) ||
+            vkd3d_pipeline_library_disk_cache_peek_version(cache->read_path) == VKD3D_PIPELINE_LIBRARY_VERSION_INDEXED;
+
     /* Fairly complex operation. Ideally, Steam handles this.
      * After this operation, only read_path should remain, and write_path (and temporary merge path) is deleted. */
-    vkd3d_pipeline_library_disk_cache_merge(cache, cache->read_path, cache->write_path);
+    if (indexed)
+        vkd3d_pipeline_library_disk_cache_merge_indexed(cache, cache->read_path, cache->write_path);
+    else
+        vkd3d_pipeline_library_disk_cache_merge(cache, cache->read_path, cache->write_path);
 
     end_ts = vkd3d_get_current_time_ns();
 
@@ -3188,10 +4786,22 @@ static void vkd3d_pipeline_library_disk_cache_initial_setup(struct vkd3d_pipelin
         INFO("Mapping read-only cache took %.3f ms.\n", 1e-6 * (double)(end_ts - begin_ts));
 
         begin_ts = vkd3d_get_current_time_ns();
-        hr = d3d12_pipeline_library_read_blob_stream_format(cache->library, cache->library->device,
-                cache->mapped_file.mapped, cache->mapped_file.mapped_size);
-        end_ts = vkd3d_get_current_time_ns();
-        INFO("Parsing stream archive took %.3f ms.\n", 1e-6 * (double)(end_ts - begin_ts));
+
+        if (cache->mapped_file.mapped_size >= sizeof(uint32_t) &&
+                *(const uint32_t *)cache->mapped_file.mapped == VKD3D_PIPELINE_LIBRARY_VERSION_INDEXED)
+        {
+            hr = d3d12_pipeline_library_read_blob_indexed_format(cache->library, cache->library->device,
+                    cache->mapped_file.mapped, cache->mapped_file.mapped_size);
+            end_ts = vkd3d_get_current_time_ns();
+            INFO("Loading indexed archive took %.3f ms.\n", 1e-6 * (double)(end_ts - begin_ts));
+        }
+        else
+        {
+            hr = d3d12_pipeline_library_read_blob_stream_format(cache->library, cache->library->device,
+                    cache->mapped_file.mapped, cache->mapped_file.mapped_size);
+            end_ts = vkd3d_get_current_time_ns();
+            INFO("Parsing stream archive took %.3f ms.\n", 1e-6 * (double)(end_ts - begin_ts));
+        }
 
         if (hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH)
             INFO("Cannot load existing on-disk cache due to driver version mismatch.\n");
@@ -3201,6 +4811,9 @@ static void vkd3d_pipeline_library_disk_cache_initial_setup(struct vkd3d_pipelin
             INFO("Failed to load driver cache with hr #%x, falling back to empty cache.\n", (int)hr);
     }
 
+    if (cache->library->shared_cache)
+        vkd3d_pipeline_library_disk_cache_populate_shared_cache(cache);
+
     /* When we add new internal blobs from this point,
      * we'll be notified where we can write out a stream blob to disk.
      * This all happens within the disk$ thread. */
@@ -3363,10 +4976,18 @@ void vkd3d_pipeline_library_flush_disk_cache(struct vkd3d_pipeline_library_disk_
     if (cache->library)
     {
         cache->library->stream_archive_cancellation_point = 0;
+        /* Backed by mapped_file. */
+        cache->library->indexed_archive = NULL;
+        cache->library->indexed_archive_size = 0;
+        vkd3d_free(cache->library->indexed_archive_entry_state);
+        cache->library->indexed_archive_entry_state = NULL;
+        /* Backed by shared_cache. */
+        cache->library->shared_cache = NULL;
         d3d12_pipeline_library_dec_ref(cache->library);
     }
 
     vkd3d_file_unmap(&cache->mapped_file);
+    vkd3d_shared_cache_close(&cache->shared_cache);
 }
 
 void vkd3d_pipeline_library_disk_cache_notify_blob_insert(struct vkd3d_pipeline_library_disk_cache *disk_cache,
@@ -3379,6 +5000,11 @@ void vkd3d_pipeline_library_disk_cache_notify_blob_insert(struct vkd3d_pipeline_
     uint8_t zero_array[VKD3D_PIPELINE_BLOB_ALIGN];
     uint32_t padding_size;
 
+    /* Make the blob visible to other processes right away. The write archive is still needed for persistence,
+     * since the shared cache is rebuilt whenever the driver changes. */
+    if (disk_cache->library->shared_cache)
+        vkd3d_shared_cache_publish(&disk_cache->shared_cache, hash, type, data, size);
+
     /* On first write (new blob), create a new file. */
     if (!disk_cache->stream_archive_attempted_write)
     {
@@ -3489,7 +5115,8 @@ static void *vkd3d_pipeline_library_disk_thread_main(void *userarg)
                 INFO("Pipeline cache marked dirty. Flush is scheduled.\n");
             }
 
-            d3d12_pipeline_state_dec_ref(tmp_items[i].state);
+            if (tmp_items[i].state)
+                d3d12_pipeline_state_dec_ref(tmp_items[i].state);
         }
         tmp_items_count = 0;
 
@@ -3527,7 +5154,8 @@ static void *vkd3d_pipeline_library_disk_thread_main(void *userarg)
         else
             dirty = true;
 
-        d3d12_pipeline_state_dec_ref(tmp_items[i].state);
+        if (tmp_items[i].state)
+            d3d12_pipeline_state_dec_ref(tmp_items[i].state);
     }
 
     for (i = 0; i < cache->items_count; i++)
@@ -3541,7 +5169,8 @@ static void *vkd3d_pipeline_library_disk_thread_main(void *userarg)
         else
             dirty = true;
 
-        d3d12_pipeline_state_dec_ref(cache->items[i].state);
+        if (cache->items[i].state)
+            d3d12_pipeline_state_dec_ref(cache->items[i].state);
     }
 
     if (cache->stream_archive_write_file)
@@ -29,7 +29,7 @@
 #endif
 
 static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, struct vkd3d_fence_worker *worker, uint64_t value);
-static void d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
+static HRESULT d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
         const struct d3d12_command_queue_submission *sub);
 static void d3d12_fence_inc_ref(struct d3d12_fence *fence);
 static void d3d12_fence_dec_ref(struct d3d12_fence *fence);
@@ -1155,32 +1155,29 @@ static HRESULT vkd3d_waiting_event_signal(struct d3d12_device *device, struct vk
     return hr;
 }
 
+static void d3d12_fence_push_event_locked(struct d3d12_fence *fence, const struct vkd3d_waiting_event *event)
+{
+    vkd3d_min_heap_push(fence->events, &fence->event_count, sizeof(*fence->events),
+            offsetof(struct vkd3d_waiting_event, value), event);
+}
+
 static void d3d12_fence_signal_external_events_locked(struct d3d12_fence *fence, struct vkd3d_fence_worker *worker)
 {
     bool signal_null_event_cond = false;
-    unsigned int i, j;
+    struct vkd3d_waiting_event current;
 
-    for (i = 0, j = 0; i < fence->event_count; ++i)
+    /* Events are kept in a min-heap ordered by value, so we only touch the events which actually complete. */
+    while (fence->event_count && fence->events[0].value <= fence->virtual_value)
     {
-        struct vkd3d_waiting_event *current = &fence->events[i];
+        vkd3d_min_heap_pop(fence->events, &fence->event_count, sizeof(*fence->events),
+                offsetof(struct vkd3d_waiting_event, value), &current);
 
-        if (current->value <= fence->virtual_value)
-        {
-            vkd3d_waiting_event_signal(fence->device, worker, current);
+        vkd3d_waiting_event_signal(fence->device, worker, &current);
 
-            if (!vkd3d_native_sync_handle_is_valid(current->handle))
-                signal_null_event_cond = true;
-        }
-        else
-        {
-            if (i != j)
-                fence->events[j] = *current;
-            ++j;
-        }
+        if (!vkd3d_native_sync_handle_is_valid(current.handle))
+            signal_null_event_cond = true;
     }
 
-    fence->event_count = j;
-
     if (signal_null_event_cond)
         pthread_cond_broadcast(&fence->null_event_cond);
 }
@@ -1351,7 +1348,7 @@ static HRESULT d3d12_fence_signal_cpu_timeline_semaphore(struct d3d12_fence *fen
         return hresult_from_errno(rc);
     }
 
-    fence->virtual_value = value;
+    vkd3d_atomic_uint64_store_explicit(&fence->virtual_value, value, vkd3d_memory_order_release);
     d3d12_fence_signal_external_events_locked(fence, NULL);
     d3d12_fence_update_wait_tickets_locked(fence);
     d3d12_fence_update_pending_value_locked_and_broadcast(fence);
@@ -1433,7 +1430,8 @@ static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, struct vkd3d_fence_
         {
             if (fence->signal_count == fence->pending_updates[i].update_count)
             {
-                fence->virtual_value = fence->pending_updates[i].virtual_value;
+                vkd3d_atomic_uint64_store_explicit(&fence->virtual_value,
+                        fence->pending_updates[i].virtual_value, vkd3d_memory_order_release);
                 d3d12_fence_signal_external_events_locked(fence, worker);
                 d3d12_fence_update_wait_tickets_locked(fence);
                 fence->pending_updates[i] = fence->pending_updates[--fence->pending_updates_count];
@@ -1574,19 +1572,13 @@ static HRESULT STDMETHODCALLTYPE d3d12_fence_GetDevice(d3d12_fence_iface *iface,
 static UINT64 STDMETHODCALLTYPE d3d12_fence_GetCompletedValue(d3d12_fence_iface *iface)
 {
     struct d3d12_fence *fence = impl_from_ID3D12Fence1(iface);
-    uint64_t completed_value;
-    int rc;
 
     TRACE("iface %p.\n", iface);
 
-    if ((rc = pthread_mutex_lock(&fence->mutex)))
-    {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return 0;
-    }
-    completed_value = fence->virtual_value;
-    pthread_mutex_unlock(&fence->mutex);
-    return completed_value;
+    /* Applications tend to spin on this, so avoid contending on the fence mutex.
+     * virtual_value is only ever written under the lock with release semantics,
+     * which pairs with this acquire load. */
+    return vkd3d_atomic_uint64_load_explicit(&fence->virtual_value, vkd3d_memory_order_acquire);
 }
 
 static HRESULT d3d12_fence_set_native_sync_handle_on_completion_explicit(struct d3d12_fence *fence,
@@ -1644,7 +1636,7 @@ static HRESULT d3d12_fence_set_native_sync_handle_on_completion_explicit(struct
         return E_OUTOFMEMORY;
     }
 
-    fence->events[fence->event_count++] = event;
+    d3d12_fence_push_event_locked(fence, &event);
 
     /* If event is NULL, we need to block until the fence value completes.
      * Implement this in a uniform way where we pretend we have a dummy event.
@@ -3011,6 +3003,7 @@ static ULONG d3d12_command_allocator_dec_ref(struct d3d12_command_allocator *all
         {
             for (j = 0; j < allocator->scratch_pools[i].scratch_buffer_count; j++)
                 d3d12_device_return_scratch_buffer(device, i, &allocator->scratch_pools[i].scratch_buffers[j]);
+            d3d12_device_scratch_pool_release_magazine(device, i, allocator->scratch_pools[i].magazine_size);
             vkd3d_free(allocator->scratch_pools[i].scratch_buffers);
         }
 
@@ -3103,13 +3096,49 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_GetDevice(ID3D12Command
     return d3d12_device_query_interface(allocator->device, iid, device);
 }
 
+/* Keep a small magazine of scratch buffers across Reset(), so that steady state recording
+ * does not have to go back to the device pool at all. The rest is returned to the device.
+ * Magazines are also counted against a device-wide budget, so that many idle allocators
+ * cannot pin an unbounded amount of scratch memory between them. */
+static void d3d12_command_allocator_recycle_scratch_buffers(struct d3d12_command_allocator *allocator,
+        enum vkd3d_scratch_pool_kind kind)
+{
+    struct d3d12_command_allocator_scratch_pool *pool = &allocator->scratch_pools[kind];
+    struct d3d12_device *device = allocator->device;
+    VkDeviceSize kept_size = 0, size;
+    size_t i, kept_count = 0;
+    bool low_on_budget;
+
+    low_on_budget = d3d12_device_scratch_pool_is_low_on_budget(device, kind);
+
+    d3d12_device_scratch_pool_release_magazine(device, kind, pool->magazine_size);
+
+    for (i = 0; i < pool->scratch_buffer_count; i++)
+    {
+        size = pool->scratch_buffers[i].allocation.resource.size;
+
+        if (!low_on_budget && kept_size + size <= VKD3D_SCRATCH_MAGAZINE_SIZE &&
+                d3d12_device_scratch_pool_reserve_magazine(device, kind, size))
+        {
+            kept_size += size;
+            pool->scratch_buffers[kept_count] = pool->scratch_buffers[i];
+            pool->scratch_buffers[kept_count++].offset = 0;
+        }
+        else
+            d3d12_device_return_scratch_buffer(device, kind, &pool->scratch_buffers[i]);
+    }
+
+    pool->scratch_buffer_count = kept_count;
+    pool->magazine_size = kept_size;
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_Reset(ID3D12CommandAllocator *iface)
 {
     struct d3d12_command_allocator *allocator = impl_from_ID3D12CommandAllocator(iface);
     struct d3d12_command_list *list;
     struct d3d12_device *device;
     LONG internal_refs;
-    size_t i, j;
+    size_t i;
     HRESULT hr;
 
     TRACE("iface %p.\n", iface);
@@ -3155,13 +3184,8 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_Reset(ID3D12CommandAllo
     if (FAILED(hr = d3d12_command_allocator_reset_command_pool(device, &allocator->fallback_pool)))
         return hr;
 
-    /* Return scratch buffers to the device */
     for (i = 0; i < VKD3D_SCRATCH_POOL_KIND_COUNT; i++)
-    {
-        for (j = 0; j < allocator->scratch_pools[i].scratch_buffer_count; j++)
-            d3d12_device_return_scratch_buffer(device, i, &allocator->scratch_pools[i].scratch_buffers[j]);
-        allocator->scratch_pools[i].scratch_buffer_count = 0;
-    }
+        d3d12_command_allocator_recycle_scratch_buffers(allocator, i);
 
 #ifdef VKD3D_ENABLE_BREADCRUMBS
     if (VKD3D_CONFIG_FLAG_IS_SET(BREADCRUMBS))
@@ -7349,6 +7373,10 @@ static void d3d12_command_list_reset_internal_state(struct d3d12_command_list *l
     list->transfer_batch.read_after_write_hazard_stages = VK_PIPELINE_STAGE_NONE;
     list->transfer_batch.shader_resource_execution_stages_are_idle = VK_PIPELINE_STAGE_NONE;
     list->wbi_batch.batch_len = 0;
+    list->root_uniform_upload.chunk_offset = 0;
+    list->root_uniform_upload.chunk_size = 0;
+    list->root_uniform_upload.last_block.host_ptr = NULL;
+    list->root_uniform_upload.last_block_size = 0;
     list->query_resolve_count = 0;
     list->submit_allocator = NULL;
     list->dgc_batch.draws_count = 0;
@@ -8223,6 +8251,71 @@ void d3d12_command_list_fetch_root_parameter_data(struct d3d12_command_list *lis
     d3d12_command_list_fetch_root_parameter_uniform_block_data(list, bindings, dst_data);
 }
 
+static bool d3d12_command_list_allocate_root_uniform_block(struct d3d12_command_list *list,
+        struct vkd3d_scratch_allocation *alloc)
+{
+    struct d3d12_root_uniform_upload_state *state = &list->root_uniform_upload;
+    const VkDeviceSize block_size = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+    VkDeviceSize chunk_size;
+
+    if (state->chunk_offset + block_size > state->chunk_size)
+    {
+        /* Start small so that lists with few draws do not hog scratch memory. */
+        chunk_size = state->chunk_size ? min(state->chunk_size * 2, VKD3D_ROOT_UNIFORM_UPLOAD_MAX_CHUNK_SIZE) :
+                VKD3D_ROOT_UNIFORM_UPLOAD_MIN_CHUNK_SIZE;
+
+        if (!d3d12_command_allocator_allocate_scratch_memory(list->allocator,
+                VKD3D_SCRATCH_POOL_KIND_UNIFORM_UPLOAD, chunk_size,
+                D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, ~0u, &state->chunk))
+        {
+            ERR("Failed to allocate root parameter uniform block.\n");
+            state->chunk_offset = 0;
+            state->chunk_size = 0;
+            return false;
+        }
+
+        state->chunk_offset = 0;
+        state->chunk_size = chunk_size;
+    }
+
+    alloc->buffer = state->chunk.buffer;
+    alloc->offset = state->chunk.offset + state->chunk_offset;
+    alloc->va = state->chunk.va + state->chunk_offset;
+    alloc->host_ptr = void_ptr_offset(state->chunk.host_ptr, state->chunk_offset);
+    state->chunk_offset += block_size;
+    return true;
+}
+
+static bool d3d12_command_list_upload_root_uniform_block(struct d3d12_command_list *list,
+        const struct d3d12_root_signature *root_signature, const union vkd3d_root_parameter_data *data,
+        struct vkd3d_scratch_allocation *alloc)
+{
+    struct d3d12_root_uniform_upload_state *state = &list->root_uniform_upload;
+    uint32_t size;
+
+    /* Root descriptors, root constants and table offsets are tightly packed in that order. */
+    size = root_signature->descriptor_table_offset + root_signature->descriptor_table_count * sizeof(uint32_t);
+
+    /* Blocks are never overwritten while recording, so if the contents did not change,
+     * e.g. the application re-set the same descriptor tables, just bind the previous block again. */
+    if (state->last_block.host_ptr && state->last_block_size == size &&
+            !memcmp(state->last_block_data, data->root_constants, size))
+    {
+        *alloc = state->last_block;
+        return true;
+    }
+
+    if (!d3d12_command_list_allocate_root_uniform_block(list, alloc))
+        return false;
+
+    /* Only write what the shaders can access, upload memory is likely write-combined. */
+    memcpy(alloc->host_ptr, data->root_constants, size);
+    memcpy(state->last_block_data, data->root_constants, size);
+    state->last_block = *alloc;
+    state->last_block_size = size;
+    return true;
+}
+
 static void d3d12_command_list_update_root_descriptors(struct d3d12_command_list *list,
         struct vkd3d_pipeline_bindings *bindings, VkPipelineBindPoint vk_bind_point,
         VkPipelineLayout layout, VkShaderStageFlags push_stages, uint32_t root_signature_flags)
@@ -8231,7 +8324,6 @@ static void d3d12_command_list_update_root_descriptors(struct d3d12_command_list
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
     VkWriteDescriptorSet descriptor_writes[D3D12_MAX_ROOT_COST / 2];
     const struct vkd3d_shader_root_parameter *root_parameter;
-    union vkd3d_root_parameter_data *ptr_root_parameter_data;
     union vkd3d_root_parameter_data root_parameter_data;
     unsigned int descriptor_write_count = 0;
     struct vkd3d_scratch_allocation alloc;
@@ -8242,24 +8334,17 @@ static void d3d12_command_list_update_root_descriptors(struct d3d12_command_list
 
     if (root_signature_flags & VKD3D_ROOT_SIGNATURE_USE_PUSH_CONSTANT_UNIFORM_BLOCK)
     {
-        d3d12_command_allocator_allocate_scratch_memory(list->allocator,
-                VKD3D_SCRATCH_POOL_KIND_UNIFORM_UPLOAD, sizeof(root_parameter_data),
-                D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, ~0u, &alloc);
-        ptr_root_parameter_data = alloc.host_ptr;
-
         /* Dirty all state that enters push UBO block to make sure it's emitted.
          * Push descriptors that are not raw VA can be emitted on a partial basis.
          * Root constants and tables are always considered dirty here, so omit that. */
         bindings->root_descriptor_dirty_mask |= root_signature->root_descriptor_raw_va_mask;
     }
-    else
-        ptr_root_parameter_data = &root_parameter_data;
 
     if (bindings->root_descriptor_dirty_mask)
     {
         /* If any raw VA descriptor is dirty, we need to update all of them. */
         if (root_signature->root_descriptor_raw_va_mask & bindings->root_descriptor_dirty_mask)
-            va_count = d3d12_command_list_fetch_root_descriptor_vas(list, bindings, ptr_root_parameter_data);
+            va_count = d3d12_command_list_fetch_root_descriptor_vas(list, bindings, &root_parameter_data);
 
         /* TODO bind null descriptors for inactive root descriptors. */
         dirty_push_mask =
@@ -8284,18 +8369,21 @@ static void d3d12_command_list_update_root_descriptors(struct d3d12_command_list
 
     if (root_signature_flags & VKD3D_ROOT_SIGNATURE_USE_PUSH_CONSTANT_UNIFORM_BLOCK)
     {
-        d3d12_command_list_fetch_root_parameter_uniform_block_data(list, bindings, ptr_root_parameter_data);
+        d3d12_command_list_fetch_root_parameter_uniform_block_data(list, bindings, &root_parameter_data);
 
         /* Reset dirty flags to avoid redundant updates in the future.
          * We consume all constants / tables here regardless of dirty state. */
         bindings->dirty_flags &= ~VKD3D_PIPELINE_DIRTY_DESCRIPTOR_TABLE_OFFSETS;
         bindings->root_constant_dirty_mask = 0;
 
-        vk_write_descriptor_set_from_scratch_push_ubo(&descriptor_writes[descriptor_write_count],
-                &buffer_info, &alloc, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
-                root_signature->push_constant_ubo_binding.binding);
+        if (d3d12_command_list_upload_root_uniform_block(list, root_signature, &root_parameter_data, &alloc))
+        {
+            vk_write_descriptor_set_from_scratch_push_ubo(&descriptor_writes[descriptor_write_count],
+                    &buffer_info, &alloc, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
+                    root_signature->push_constant_ubo_binding.binding);
 
-        descriptor_write_count += 1;
+            descriptor_write_count += 1;
+        }
     }
     else if (va_count)
     {
@@ -23063,7 +23151,11 @@ VKD3D_METHODENTRY(void) d3d12_command_queue_UpdateTileMappings(ID3D12CommandQueu
     vkd3d_free(bound_tiles);
 
     d3d12_resource_incref(res);
-    d3d12_command_queue_add_submission(command_queue, &sub);
+    if (FAILED(d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_resource_decref(res);
+        vkd3d_free(sub.bind_sparse.bind_infos);
+    }
     return;
 
 fail:
@@ -23119,7 +23211,11 @@ VKD3D_METHODENTRY(void) d3d12_command_queue_CopyTileMappings(ID3D12CommandQueue
     }
 
     d3d12_resource_incref(dst_res);
-    d3d12_command_queue_add_submission(command_queue, &sub);
+    if (FAILED(d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_resource_decref(dst_res);
+        goto fail;
+    }
     return;
 
 fail:
@@ -23608,7 +23704,21 @@ VKD3D_METHODENTRY(void) d3d12_command_queue_ExecuteCommandLists(ID3D12CommandQue
     sub.execute.breadcrumb_indices_count = breadcrumb_indices ? command_list_count : 0;
 #endif
     sub.execute.timeline_cookie = timeline_cookie;
-    d3d12_command_queue_add_submission(command_queue, &sub);
+
+    if (FAILED(d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        for (i = 0; i < command_list_count; i++)
+            d3d12_command_allocator_dec_ref(allocators[i]);
+        vkd3d_free(allocators);
+        vkd3d_free(buffers);
+        vkd3d_free(cmd_cost);
+        vkd3d_free(sub.execute.transitions);
+#ifdef VKD3D_ENABLE_BREADCRUMBS
+        vkd3d_free(breadcrumb_indices);
+#endif
+        vkd3d_queue_timeline_trace_complete_execute(&command_queue->device->queue_timeline_trace,
+                NULL, timeline_cookie);
+    }
 }
 
 VKD3D_METHODENTRY(void) d3d12_command_queue_SetMarker(ID3D12CommandQueue *iface,
@@ -23635,6 +23745,7 @@ VKD3D_METHODENTRY(HRESULT) d3d12_command_queue_Signal(ID3D12CommandQueue *iface,
 {
     struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
     struct d3d12_command_queue_submission sub;
+    HRESULT hr;
 
     TRACE("iface %p, fence %p, value %#"PRIx64".\n", iface, fence_iface, value);
 
@@ -23643,7 +23754,13 @@ VKD3D_METHODENTRY(HRESULT) d3d12_command_queue_Signal(ID3D12CommandQueue *iface,
     sub.type = VKD3D_SUBMISSION_SIGNAL;
     sub.signal.fence = (d3d12_fence_iface *)fence_iface;
     sub.signal.value = value;
-    d3d12_command_queue_add_submission(command_queue, &sub);
+
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_fence_iface_dec_ref((d3d12_fence_iface *)fence_iface);
+        return hr;
+    }
+
     return S_OK;
 }
 
@@ -23653,6 +23770,7 @@ VKD3D_METHODENTRY(HRESULT) d3d12_command_queue_Wait(ID3D12CommandQueue *iface,
     struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
     struct d3d12_command_queue_submission sub;
     uint64_t ticket = 0;
+    HRESULT hr;
 
     TRACE("iface %p, fence %p, value %#"PRIx64".\n", iface, fence_iface, value);
 
@@ -23668,7 +23786,14 @@ VKD3D_METHODENTRY(HRESULT) d3d12_command_queue_Wait(ID3D12CommandQueue *iface,
     sub.wait.fence = (d3d12_fence_iface *)fence_iface;
     sub.wait.value = value;
     sub.wait.wait_ticket = ticket;
-    d3d12_command_queue_add_submission(command_queue, &sub);
+
+    /* The device is lost at this point, so don't bother retiring the ticket. */
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_fence_iface_dec_ref((d3d12_fence_iface *)fence_iface);
+        return hr;
+    }
+
     return S_OK;
 }
 
@@ -25609,36 +25734,89 @@ void d3d12_command_queue_submit_stop(struct d3d12_command_queue *queue)
     d3d12_command_queue_add_submission(queue, &sub);
 }
 
-void d3d12_command_queue_enqueue_callback(struct d3d12_command_queue *queue, void (*callback)(void *), void *userdata)
+HRESULT d3d12_command_queue_enqueue_callback(struct d3d12_command_queue *queue, void (*callback)(void *), void *userdata)
 {
     struct d3d12_command_queue_submission sub;
     sub.type = VKD3D_SUBMISSION_QUEUE_USING_CALLBACK;
     sub.callback.callback = callback;
     sub.callback.userdata = userdata;
-    d3d12_command_queue_add_submission(queue, &sub);
+    return d3d12_command_queue_add_submission(queue, &sub);
 }
 
-void d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
-                                               const struct d3d12_command_queue_submission *sub)
+HRESULT d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
+                                                  const struct d3d12_command_queue_submission *sub)
 {
+    size_t old_size;
+
+    if (queue->submissions_count == queue->submissions_size)
+    {
+        /* Grow rather than block. Producers may hold queue_lock while waiting for the
+         * submission thread, e.g. in acquire_serialized, so a bounded ring could deadlock.
+         * Reserving twice the current size keeps the capacity a power of two. */
+        old_size = queue->submissions_size;
+        if (vkd3d_array_reserve((void **)&queue->submissions, &queue->submissions_size,
+                old_size * 2, sizeof(*queue->submissions)))
+        {
+            /* The ring is full, so anything before head has wrapped around. Move it after the old end,
+             * doubling guarantees there is room for it. */
+            memcpy(queue->submissions + old_size, queue->submissions,
+                    queue->submissions_head * sizeof(*queue->submissions));
+        }
+        else if (sub->type == VKD3D_SUBMISSION_STOP || sub->type == VKD3D_SUBMISSION_DRAIN)
+        {
+            /* Callers of these wait for the submission thread to process them, and cannot back out.
+             * They do not hold any other lock here, so wait for the submission thread to make room. */
+            ERR("Failed to grow submission queue, waiting for room.\n");
+            queue->submission_space_waiters++;
+            while (queue->submissions_count == queue->submissions_size)
+                pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
+            queue->submission_space_waiters--;
+        }
+        else
+        {
+            /* Dropping the submission would break ordering with everything queued after it,
+             * e.g. a lost signal hangs waiters forever, so there is no way to recover. */
+            d3d12_device_mark_as_removed(queue->device, E_OUTOFMEMORY, "Failed to grow submission queue.\n");
+            return E_OUTOFMEMORY;
+        }
+    }
+
     vkd3d_atomic_uint32_increment(&queue->inflight_submissions, vkd3d_memory_order_relaxed);
-    vkd3d_array_reserve((void**)&queue->submissions, &queue->submissions_size,
-                        queue->submissions_count + 1, sizeof(*queue->submissions));
-    queue->submissions[queue->submissions_count++] = *sub;
+    queue->submissions[(queue->submissions_head + queue->submissions_count++) & (queue->submissions_size - 1)] = *sub;
     pthread_cond_signal(&queue->queue_cond);
+    return S_OK;
+}
+
+static size_t d3d12_command_queue_pop_submissions_locked(struct d3d12_command_queue *queue,
+        struct d3d12_command_queue_submission *submissions, size_t max_count)
+{
+    size_t count, first_count;
+
+    count = min(queue->submissions_count, max_count);
+    first_count = min(count, queue->submissions_size - queue->submissions_head);
+
+    memcpy(submissions, queue->submissions + queue->submissions_head, first_count * sizeof(*submissions));
+    memcpy(submissions + first_count, queue->submissions, (count - first_count) * sizeof(*submissions));
+
+    queue->submissions_head = (queue->submissions_head + count) & (queue->submissions_size - 1);
+    queue->submissions_count -= count;
+    return count;
 }
 
-static void d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
+static HRESULT d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
         const struct d3d12_command_queue_submission *sub)
 {
+    HRESULT hr;
+
     /* Ensure that any non-temporal writes from CopyDescriptors are ordered properly
      * with the submission thread that calls vkQueueSubmit. */
     if (d3d12_device_use_embedded_mutable_descriptors(queue->device))
         vkd3d_memcpy_non_temporal_barrier();
 
     pthread_mutex_lock(&queue->queue_lock);
-    d3d12_command_queue_add_submission_locked(queue, sub);
+    hr = d3d12_command_queue_add_submission_locked(queue, sub);
     pthread_mutex_unlock(&queue->queue_lock);
+    return hr;
 }
 
 static void d3d12_command_queue_acquire_serialized(struct d3d12_command_queue *queue)
@@ -25689,14 +25867,108 @@ static bool d3d12_command_queue_exec_submit_needs_fallback_queue(
     return false;
 }
 
+/* Number of submissions the submission thread pulls off the queue at a time. */
+#define VKD3D_SUBMISSION_BATCH_SIZE 32
+/* Initial capacity of the submission ring. Must be a power of two. */
+#define VKD3D_SUBMISSION_QUEUE_INITIAL_SIZE 16
+
+static bool d3d12_command_queue_merge_execute(struct d3d12_command_queue *queue,
+        struct d3d12_command_queue_submission_execute *execute,
+        const struct d3d12_command_queue_submission *next)
+{
+    const struct d3d12_command_queue_submission_execute *next_execute = &next->execute;
+    struct d3d12_command_allocator **command_allocators;
+    VkCommandBufferSubmitInfo *cmd;
+    uint32_t *cmd_cost;
+#ifdef VKD3D_ENABLE_BREADCRUMBS
+    unsigned int *breadcrumb_indices;
+#endif
+
+    if (next->type != VKD3D_SUBMISSION_EXECUTE)
+        return false;
+
+    /* Initial transitions of the next submission must not be hoisted above command lists of the current one,
+     * since an ExecuteCommandLists boundary is enough to separate aliased resources. */
+    if (next_execute->transition_count)
+        return false;
+
+    if (execute->debug_capture || next_execute->debug_capture ||
+            execute->split_submission != next_execute->split_submission ||
+            execute->low_latency_frame_id != next_execute->low_latency_frame_id)
+        return false;
+
+    if (next_execute->cmd_count)
+    {
+        if (!(cmd = vkd3d_realloc(execute->cmd, (execute->cmd_count + next_execute->cmd_count) * sizeof(*cmd))))
+            return false;
+        execute->cmd = cmd;
+
+        if (!(cmd_cost = vkd3d_realloc(execute->cmd_cost,
+                (execute->cmd_count + next_execute->cmd_count) * sizeof(*cmd_cost))))
+            return false;
+        execute->cmd_cost = cmd_cost;
+    }
+
+    if (next_execute->num_command_allocators)
+    {
+        if (!(command_allocators = vkd3d_realloc(execute->command_allocators,
+                (execute->num_command_allocators + next_execute->num_command_allocators) * sizeof(*command_allocators))))
+            return false;
+        execute->command_allocators = command_allocators;
+    }
+
+#ifdef VKD3D_ENABLE_BREADCRUMBS
+    if (next_execute->breadcrumb_indices_count)
+    {
+        if (!(breadcrumb_indices = vkd3d_realloc(execute->breadcrumb_indices,
+                (execute->breadcrumb_indices_count + next_execute->breadcrumb_indices_count) * sizeof(*breadcrumb_indices))))
+            return false;
+        execute->breadcrumb_indices = breadcrumb_indices;
+        memcpy(execute->breadcrumb_indices + execute->breadcrumb_indices_count, next_execute->breadcrumb_indices,
+                next_execute->breadcrumb_indices_count * sizeof(*breadcrumb_indices));
+        execute->breadcrumb_indices_count += next_execute->breadcrumb_indices_count;
+    }
+    vkd3d_free(next_execute->breadcrumb_indices);
+#endif
+
+    /* Each submission ends with the full barrier command buffer if one is needed,
+     * so concatenating the command buffers preserves ordering between the submissions. */
+    if (next_execute->cmd_count)
+    {
+        memcpy(execute->cmd + execute->cmd_count, next_execute->cmd, next_execute->cmd_count * sizeof(*cmd));
+        memcpy(execute->cmd_cost + execute->cmd_count, next_execute->cmd_cost,
+                next_execute->cmd_count * sizeof(*cmd_cost));
+        execute->cmd_count += next_execute->cmd_count;
+    }
+
+    if (next_execute->num_command_allocators)
+    {
+        memcpy(execute->command_allocators + execute->num_command_allocators, next_execute->command_allocators,
+                next_execute->num_command_allocators * sizeof(*command_allocators));
+        execute->num_command_allocators += next_execute->num_command_allocators;
+    }
+
+    vkd3d_queue_timeline_trace_merge_execute(&queue->device->queue_timeline_trace,
+            execute->timeline_cookie, next_execute->timeline_cookie);
+
+    vkd3d_free(next_execute->cmd);
+    vkd3d_free(next_execute->cmd_cost);
+    vkd3d_free(next_execute->command_allocators);
+    vkd3d_free(next_execute->transitions);
+    return true;
+}
+
 static void *d3d12_command_queue_submission_worker_main(void *userdata)
 {
+    struct d3d12_command_queue_submission batch[VKD3D_SUBMISSION_BATCH_SIZE];
     struct d3d12_command_queue_submission submission;
     struct d3d12_command_queue_transition_pool pool;
     struct vkd3d_queue_timeline_trace_cookie cookie;
     struct d3d12_command_queue *queue = userdata;
     VkSemaphoreSubmitInfo transition_semaphore;
+    size_t batch_count, batch_index;
     VkCommandBufferSubmitInfo transition_cmd;
+    uint32_t submission_count;
     VKD3D_UNUSED unsigned int i;
     HRESULT hr;
 
@@ -25710,16 +25982,27 @@ static void *d3d12_command_queue_submission_worker_main(void *userdata)
     if (FAILED(hr = d3d12_command_queue_transition_pool_init(&pool, queue)))
         ERR("Failed to initialize transition pool.\n");
 
+    batch_count = 0;
+    batch_index = 0;
+
     for (;;)
     {
-        pthread_mutex_lock(&queue->queue_lock);
-        while (queue->submissions_count == 0)
-            pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
+        /* Drain the queue in batches to reduce lock traffic with producers. */
+        if (batch_index == batch_count)
+        {
+            pthread_mutex_lock(&queue->queue_lock);
+            while (queue->submissions_count == 0)
+                pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
+            batch_count = d3d12_command_queue_pop_submissions_locked(queue, batch, ARRAY_SIZE(batch));
+            /* Drain waiters share the condition variable, so wake everyone. */
+            if (queue->submission_space_waiters)
+                pthread_cond_broadcast(&queue->queue_cond);
+            pthread_mutex_unlock(&queue->queue_lock);
+            batch_index = 0;
+        }
 
-        queue->submissions_count--;
-        submission = queue->submissions[0];
-        memmove(queue->submissions, queue->submissions + 1, queue->submissions_count * sizeof(submission));
-        pthread_mutex_unlock(&queue->queue_lock);
+        submission = batch[batch_index++];
+        submission_count = 1;
 
         if (submission.type != VKD3D_SUBMISSION_BIND_SPARSE)
             d3d12_command_queue_flush_bind_sparse(queue);
@@ -25763,6 +26046,15 @@ static void *d3d12_command_queue_submission_worker_main(void *userdata)
             VKD3D_REGION_BEGIN(queue_execute);
             cookie = vkd3d_queue_timeline_trace_register_generic_region(&queue->device->queue_timeline_trace, "EXECUTE");
 
+            /* If the application got ahead of us, fold back-to-back ExecuteCommandLists into one
+             * vkQueueSubmit2. We never wait for more work, so this does not add latency. */
+            while (batch_index < batch_count &&
+                    d3d12_command_queue_merge_execute(queue, &submission.execute, &batch[batch_index]))
+            {
+                batch_index++;
+                submission_count++;
+            }
+
             memset(&transition_cmd, 0, sizeof(transition_cmd));
             transition_cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
 
@@ -25826,7 +26118,11 @@ static void *d3d12_command_queue_submission_worker_main(void *userdata)
 
             pthread_mutex_lock(&queue->queue_lock);
             queue->queue_drain_count++;
-            pthread_cond_signal(&queue->queue_cond);
+            /* A plain signal could wake a thread waiting for room rather than the drain waiter. */
+            if (queue->submission_space_waiters)
+                pthread_cond_broadcast(&queue->queue_cond);
+            else
+                pthread_cond_signal(&queue->queue_cond);
             pthread_mutex_unlock(&queue->queue_lock);
             break;
 
@@ -25846,7 +26142,7 @@ static void *d3d12_command_queue_submission_worker_main(void *userdata)
             break;
         }
 
-        vkd3d_atomic_uint32_decrement(&queue->inflight_submissions, vkd3d_memory_order_release);
+        vkd3d_atomic_uint32_sub(&queue->inflight_submissions, submission_count, vkd3d_memory_order_release);
         vkd3d_queue_timeline_trace_complete_execute(&queue->device->queue_timeline_trace, &queue->fence_worker, cookie);
     }
 
@@ -25881,11 +26177,21 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
 
     queue->vkd3d_queue = d3d12_device_allocate_vkd3d_queue(family_info, queue);
     queue->submissions = NULL;
+    queue->submissions_head = 0;
     queue->submissions_count = 0;
     queue->submissions_size = 0;
+    queue->submission_space_waiters = 0;
     queue->drain_count = 0;
     queue->queue_drain_count = 0;
 
+    /* Never start out empty, so that STOP and DRAIN can always wait for room in the ring. */
+    if (!vkd3d_array_reserve((void **)&queue->submissions, &queue->submissions_size,
+            VKD3D_SUBMISSION_QUEUE_INITIAL_SIZE, sizeof(*queue->submissions)))
+    {
+        hr = E_OUTOFMEMORY;
+        goto fail;
+    }
+
     if ((rc = pthread_mutex_init(&queue->queue_lock, NULL)) < 0)
     {
         hr = hresult_from_errno(rc);
@@ -25944,6 +26250,7 @@ fail_create_semaphore:
 fail_pthread_cond:
     pthread_mutex_destroy(&queue->queue_lock);
 fail:
+    vkd3d_free(queue->submissions);
     d3d12_device_unmap_vkd3d_queue(queue->vkd3d_queue, queue);
     return hr;
 }
@@ -26075,7 +26382,9 @@ void vkd3d_enqueue_initial_transition(ID3D12CommandQueue *queue, ID3D12Resource
     sub.execute.transitions[0].type = VKD3D_INITIAL_TRANSITION_TYPE_RESOURCE;
     sub.execute.transitions[0].resource.resource = d3d12_resource;
     sub.execute.transitions[0].resource.perform_initial_transition = true;
-    d3d12_command_queue_add_submission(d3d12_queue, &sub);
+
+    if (FAILED(d3d12_command_queue_add_submission(d3d12_queue, &sub)))
+        vkd3d_free(sub.execute.transitions);
 }
 
 /* ID3D12CommandSignature */
@@ -598,7 +598,7 @@ uint32_t vkd3d_descriptor_debug_get_shader_interface_flags(
 
     dxbc.code = code;
     dxbc.size = size;
-    hash = vkd3d_shader_hash(&dxbc);
+    hash = vkd3d_shader_hash_legacy(&dxbc);
 
     if (global_info->qa_range_count)
     {
@@ -4400,70 +4400,189 @@ static void d3d12_device_destroy_scratch_buffer(struct d3d12_device *device, con
     vkd3d_free_memory(device, &device->memory_allocator, &scratch->allocation);
 }
 
+static bool d3d12_device_scratch_pool_pop(struct d3d12_device_scratch_pool *pool, struct vkd3d_scratch_buffer *scratch)
+{
+    uint32_t index;
+
+    if ((index = vkd3d_lockfree_stack_pop(&pool->full_head, pool->next_slot)) == VKD3D_LOCKFREE_STACK_INVALID)
+        return false;
+
+    vkd3d_atomic_uint32_decrement(&pool->scratch_buffer_count, vkd3d_memory_order_relaxed);
+    *scratch = pool->scratch_buffers[index];
+    vkd3d_lockfree_stack_push(&pool->free_head, pool->next_slot, index);
+    return true;
+}
+
+static void d3d12_device_scratch_pool_trim(struct d3d12_device *device,
+        struct d3d12_device_scratch_pool *pool, uint32_t limit)
+{
+    struct vkd3d_scratch_buffer scratch;
+
+    while (vkd3d_atomic_uint32_load_explicit(&pool->scratch_buffer_count, vkd3d_memory_order_relaxed) > limit &&
+            d3d12_device_scratch_pool_pop(pool, &scratch))
+        d3d12_device_destroy_scratch_buffer(device, &scratch);
+}
+
+static void d3d12_device_scratch_pool_update_budget(struct d3d12_device *device,
+        enum vkd3d_scratch_pool_kind kind, const struct vkd3d_scratch_buffer *scratch)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_info;
+    VkPhysicalDeviceMemoryProperties2 props2;
+    uint32_t heap_index, limit, old_limit;
+    VkDeviceSize budget;
+
+    if (!device->vk_info.EXT_memory_budget)
+        return;
+
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    props2.pNext = &budget_info;
+    budget_info.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    budget_info.pNext = NULL;
+
+    VK_CALL(vkGetPhysicalDeviceMemoryProperties2(device->vk_physical_device, &props2));
+
+    heap_index = props2.memoryProperties.memoryTypes[scratch->allocation.device_allocation.vk_memory_type].heapIndex;
+    budget = budget_info.heapBudget[heap_index];
+
+    /* Recycled scratch buffers are pure overhead to the application, so only keep a handful around
+     * once the heap gets close to its budget. Allow some hysteresis before growing the cache again. */
+    old_limit = vkd3d_atomic_uint32_load_explicit(&pool->cache_limit, vkd3d_memory_order_relaxed);
+
+    if (budget_info.heapUsage[heap_index] > budget - budget / 8)
+        limit = VKD3D_SCRATCH_BUFFER_COUNT_LOW_BUDGET;
+    else if (budget_info.heapUsage[heap_index] < budget - budget / 4)
+        limit = pool->scratch_buffer_size;
+    else
+        limit = old_limit;
+
+    if (limit == old_limit)
+        return;
+
+    vkd3d_atomic_uint32_store_explicit(&pool->cache_limit, limit, vkd3d_memory_order_relaxed);
+
+    if (limit < old_limit)
+    {
+        WARN("Memory heap %u is close to budget (%"PRIu64" / %"PRIu64" MiB), trimming scratch buffers of kind %u.\n",
+                heap_index, budget_info.heapUsage[heap_index] / (1024 * 1024), budget / (1024 * 1024), kind);
+        d3d12_device_scratch_pool_trim(device, pool, limit);
+    }
+}
+
+static HRESULT d3d12_device_create_scratch_buffer_in_budget(struct d3d12_device *device,
+        enum vkd3d_scratch_pool_kind kind, VkDeviceSize size, uint32_t memory_types, struct vkd3d_scratch_buffer *scratch)
+{
+    unsigned int i;
+    HRESULT hr;
+
+    if (FAILED(hr = d3d12_device_create_scratch_buffer(device, kind, size, memory_types, scratch)))
+    {
+        /* Give back everything we are sitting on and try again. */
+        for (i = 0; i < VKD3D_SCRATCH_POOL_KIND_COUNT; i++)
+        {
+            vkd3d_atomic_uint32_store_explicit(&device->scratch_pools[i].cache_limit,
+                    VKD3D_SCRATCH_BUFFER_COUNT_LOW_BUDGET, vkd3d_memory_order_relaxed);
+            d3d12_device_scratch_pool_trim(device, &device->scratch_pools[i], 0);
+        }
+
+        if (FAILED(hr = d3d12_device_create_scratch_buffer(device, kind, size, memory_types, scratch)))
+            return hr;
+    }
+
+    d3d12_device_scratch_pool_update_budget(device, kind, scratch);
+    return hr;
+}
+
 HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
         VkDeviceSize min_size, uint32_t memory_types, struct vkd3d_scratch_buffer *scratch)
 {
     struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
-    struct vkd3d_scratch_buffer *candidate;
-    size_t i;
 
     if (min_size > pool->block_size)
     {
         FIXME("Requesting scratch buffer kind %u larger than limit (%"PRIu64" > %"PRIu64"). Expect bad performance.\n",
                 kind, min_size, pool->block_size);
-        return d3d12_device_create_scratch_buffer(device, kind, min_size, memory_types, scratch);
+        return d3d12_device_create_scratch_buffer_in_budget(device, kind, min_size, memory_types, scratch);
     }
 
-    pthread_mutex_lock(&device->mutex);
-
-    for (i = pool->scratch_buffer_count; i; i--)
+    if (d3d12_device_scratch_pool_pop(pool, scratch))
     {
-        candidate = &pool->scratch_buffers[i - 1];
-
         /* Extremely unlikely to fail since we have separate lists per pool kind, but to be 100% correct ... */
-        if (memory_types & (1u << candidate->allocation.device_allocation.vk_memory_type))
+        if (memory_types & (1u << scratch->allocation.device_allocation.vk_memory_type))
         {
-            *scratch = *candidate;
             scratch->offset = 0;
-            pool->scratch_buffers[i - 1] = pool->scratch_buffers[--pool->scratch_buffer_count];
-            pthread_mutex_unlock(&device->mutex);
             return S_OK;
         }
+
+        d3d12_device_return_scratch_buffer(device, kind, scratch);
     }
 
-    pthread_mutex_unlock(&device->mutex);
-    return d3d12_device_create_scratch_buffer(device, kind, pool->block_size, memory_types, scratch);
+    return d3d12_device_create_scratch_buffer_in_budget(device, kind, pool->block_size, memory_types, scratch);
 }
 
 void d3d12_device_return_scratch_buffer(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
         const struct vkd3d_scratch_buffer *scratch)
 {
     struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
-    pthread_mutex_lock(&device->mutex);
+    uint32_t count, index, high_water_mark;
 
-    if (scratch->allocation.resource.size == pool->block_size &&
-            pool->scratch_buffer_count < pool->scratch_buffer_size)
+    if (scratch->allocation.resource.size == pool->block_size)
     {
-        pool->scratch_buffers[pool->scratch_buffer_count++] = *scratch;
-        if (pool->scratch_buffer_count > pool->high_water_mark)
+        /* Reserve room first so that concurrent returns cannot overshoot the limit. */
+        count = vkd3d_atomic_uint32_increment(&pool->scratch_buffer_count, vkd3d_memory_order_relaxed);
+
+        if (count <= vkd3d_atomic_uint32_load_explicit(&pool->cache_limit, vkd3d_memory_order_relaxed) &&
+                (index = vkd3d_lockfree_stack_pop(&pool->free_head, pool->next_slot)) != VKD3D_LOCKFREE_STACK_INVALID)
         {
-            pool->high_water_mark = pool->scratch_buffer_count;
+            pool->scratch_buffers[index] = *scratch;
+            vkd3d_lockfree_stack_push(&pool->full_head, pool->next_slot, index);
 
-            /* Warn if we're starting to fill up. Potential performance issue afoot. */
-            if (pool->high_water_mark > pool->scratch_buffer_size / 2)
+            high_water_mark = vkd3d_atomic_uint32_load_explicit(&pool->high_water_mark, vkd3d_memory_order_relaxed);
+            if (count > high_water_mark && vkd3d_atomic_uint32_compare_exchange(&pool->high_water_mark,
+                    high_water_mark, count, vkd3d_memory_order_relaxed, vkd3d_memory_order_relaxed) == high_water_mark)
             {
-                WARN("New high water mark: %u scratch buffers in flight for kind %u (%"PRIu64" bytes).\n",
-                        pool->high_water_mark, kind, pool->high_water_mark * pool->block_size);
+                /* Warn if we're starting to fill up. Potential performance issue afoot. */
+                if (count > pool->scratch_buffer_size / 2)
+                {
+                    WARN("New high water mark: %u scratch buffers in flight for kind %u (%"PRIu64" bytes).\n",
+                            count, kind, count * pool->block_size);
+                }
             }
+            return;
         }
-        pthread_mutex_unlock(&device->mutex);
-    }
-    else
-    {
-        pthread_mutex_unlock(&device->mutex);
-        d3d12_device_destroy_scratch_buffer(device, scratch);
-        WARN("Too many scratch buffers in flight, cannot recycle kind %u.\n", kind);
+
+        vkd3d_atomic_uint32_decrement(&pool->scratch_buffer_count, vkd3d_memory_order_relaxed);
     }
+
+    d3d12_device_destroy_scratch_buffer(device, scratch);
+    WARN("Too many scratch buffers in flight, cannot recycle kind %u.\n", kind);
+}
+
+bool d3d12_device_scratch_pool_is_low_on_budget(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind)
+{
+    struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
+    return vkd3d_atomic_uint32_load_explicit(&pool->cache_limit, vkd3d_memory_order_relaxed) < pool->scratch_buffer_size;
+}
+
+bool d3d12_device_scratch_pool_reserve_magazine(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
+        VkDeviceSize size)
+{
+    struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
+
+    if (vkd3d_atomic_uint64_add(&pool->magazine_size, size, vkd3d_memory_order_relaxed) <=
+            VKD3D_SCRATCH_MAGAZINE_DEVICE_BUDGET)
+        return true;
+
+    d3d12_device_scratch_pool_release_magazine(device, kind, size);
+    return false;
+}
+
+void d3d12_device_scratch_pool_release_magazine(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
+        VkDeviceSize size)
+{
+    struct d3d12_device_scratch_pool *pool = &device->scratch_pools[kind];
+    vkd3d_atomic_uint64_add(&pool->magazine_size, -size, vkd3d_memory_order_relaxed);
 }
 
 uint64_t d3d12_device_get_descriptor_heap_gpu_va(struct d3d12_device *device, D3D12_DESCRIPTOR_HEAP_TYPE type)
@@ -4846,16 +4965,18 @@ static void vkd3d_null_rtas_allocation_cleanup(
 static void d3d12_device_destroy(struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    size_t i, j;
+    size_t i;
 
     d3d_destruction_notifier_free(&device->destruction_notifier);
 
+    /* Drain this first, since pending jobs hold references to pipeline states. */
+    vkd3d_pipeline_variant_queue_cleanup(&device->pipeline_variants);
+
     if (device->internal_sparse_queue)
         d3d12_device_unmap_vkd3d_queue(device->internal_sparse_queue, NULL);
 
     for (i = 0; i < VKD3D_SCRATCH_POOL_KIND_COUNT; i++)
-        for (j = 0; j < device->scratch_pools[i].scratch_buffer_count; j++)
-            d3d12_device_destroy_scratch_buffer(device, &device->scratch_pools[i].scratch_buffers[j]);
+        d3d12_device_scratch_pool_trim(device, &device->scratch_pools[i], 0);
 
     for (i = 0; i < device->query_pool_count; i++)
         d3d12_device_destroy_query_pool(device, &device->query_pools[i]);
@@ -4881,8 +5002,11 @@ static void d3d12_device_destroy(struct d3d12_device *device)
         vkd3d_breadcrumb_tracer_cleanup(&device->breadcrumb_tracer, device);
 #endif
     vkd3d_pipeline_library_flush_disk_cache(&device->disk_cache);
+    if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
+        vkd3d_pipeline_library_stats_report(&device->pipeline_library_stats);
     vkd3d_sampler_state_cleanup(&device->sampler_state, device);
     vkd3d_view_map_destroy(&device->sampler_map.map, device);
+    vkd3d_image_allocation_info_cache_cleanup(&device->allocation_info_cache);
     vkd3d_meta_ops_cleanup(&device->meta_ops, device);
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
     d3d12_device_destroy_vkd3d_queues(device);
@@ -6873,6 +6997,36 @@ static inline void d3d12_device_copy_descriptors_cbv_srv_uav_sampler(struct d3d1
     }
 }
 
+static inline void d3d12_device_copy_descriptor_run(struct d3d12_device *device,
+        D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, bool embedded)
+{
+    if (heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV || heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_DSV)
+    {
+        d3d12_rtv_desc_copy(d3d12_rtv_desc_from_cpu_handle(dst),
+                d3d12_rtv_desc_from_cpu_handle(src), count);
+    }
+    else if (embedded)
+        d3d12_desc_copy(dst.ptr, src.ptr, count, heap_type, device);
+    else
+        d3d12_device_copy_descriptors_cbv_srv_uav_sampler(device, dst, src, heap_type, count);
+}
+
+static inline bool d3d12_device_can_extend_descriptor_run(D3D12_CPU_DESCRIPTOR_HANDLE run_start,
+        D3D12_CPU_DESCRIPTOR_HANDLE run_end, D3D12_CPU_DESCRIPTOR_HANDLE next, bool legacy)
+{
+    if (run_end.ptr != next.ptr)
+        return false;
+
+    /* Embedded descriptors and RTV/DSV descriptors are plain arrays in memory, and a heap is always followed
+     * by something that is not another heap's descriptors (metadata or the next heap's header),
+     * so address contiguity is enough. Legacy handles encode the heap in the upper bits,
+     * and a heap allocated right after another one would decode as contiguous. */
+    return !legacy || d3d12_desc_decode_va(run_start.ptr).heap == d3d12_desc_decode_va(next.ptr).heap;
+}
+
+#define VKD3D_COPY_DESCRIPTORS_PREFETCH_DISTANCE 4
+
 static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
         UINT dst_descriptor_range_count, const D3D12_CPU_DESCRIPTOR_HANDLE *dst_descriptor_range_offsets,
         const UINT *dst_descriptor_range_sizes,
@@ -6880,12 +7034,41 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
         const UINT *src_descriptor_range_sizes,
         D3D12_DESCRIPTOR_HEAP_TYPE descriptor_heap_type)
 {
+    D3D12_CPU_DESCRIPTOR_HANDLE dst, src, dst_start, src_start, run_dst, run_src;
     unsigned int dst_range_idx, dst_idx, src_range_idx, src_idx;
-    D3D12_CPU_DESCRIPTOR_HANDLE dst, src, dst_start, src_start;
     unsigned int dst_range_size, src_range_size, copy_count;
-    unsigned int increment;
+    unsigned int increment, run_count;
+    bool prefetch_src, embedded, legacy;
+
+    switch (descriptor_heap_type)
+    {
+        case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+        case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+        case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
+        case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
+            break;
+        default:
+            ERR("Unhandled descriptor heap type %u.\n", descriptor_heap_type);
+            return;
+    }
 
     increment = d3d12_device_get_descriptor_handle_increment_size(device, descriptor_heap_type);
+    embedded = d3d12_device_use_embedded_mutable_descriptors(device);
+    legacy = !embedded && (descriptor_heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ||
+            descriptor_heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    /* Scattered source ranges tend to miss cache on every range.
+     * Embedded descriptors are plain memory, so we can kick off loads for upcoming ranges
+     * while copying the current one. Prefetching only the next range is too late to help. */
+    prefetch_src = descriptor_heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV &&
+            src_descriptor_range_count > VKD3D_COPY_DESCRIPTORS_PREFETCH_DISTANCE && embedded;
+
+    /* Applications tend to pass lots of single descriptor ranges, many of which are adjacent
+     * in both source and destination. Merge those into runs so we only pay for decoding handles,
+     * metadata copies and set iteration once per run rather than once per range.
+     * Ranges are not reordered since overlapping destinations must resolve in API order. */
+    run_dst.ptr = run_src.ptr = 0;
+    run_count = 0;
 
     dst_range_idx = dst_idx = 0;
     src_range_idx = src_idx = 0;
@@ -6902,21 +7085,29 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
         dst = d3d12_advance_cpu_descriptor_handle(dst_start, increment, dst_idx);
         src = d3d12_advance_cpu_descriptor_handle(src_start, increment, src_idx);
 
-        switch (descriptor_heap_type)
+        if (prefetch_src && src_idx == 0 &&
+                src_range_idx + VKD3D_COPY_DESCRIPTORS_PREFETCH_DISTANCE < src_descriptor_range_count)
         {
-            case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
-            case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
-                d3d12_desc_copy(dst.ptr, src.ptr, copy_count,
-                        descriptor_heap_type, device);
-                break;
-            case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
-            case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
-                d3d12_rtv_desc_copy(d3d12_rtv_desc_from_cpu_handle(dst),
-                        d3d12_rtv_desc_from_cpu_handle(src), copy_count);
-                break;
-            default:
-                ERR("Unhandled descriptor heap type %u.\n", descriptor_heap_type);
-                return;
+            d3d12_desc_prefetch_embedded_resource(
+                    src_descriptor_range_offsets[src_range_idx + VKD3D_COPY_DESCRIPTORS_PREFETCH_DISTANCE].ptr);
+        }
+
+        if (run_count &&
+                d3d12_device_can_extend_descriptor_run(run_dst,
+                        d3d12_advance_cpu_descriptor_handle(run_dst, increment, run_count), dst, legacy) &&
+                d3d12_device_can_extend_descriptor_run(run_src,
+                        d3d12_advance_cpu_descriptor_handle(run_src, increment, run_count), src, legacy))
+        {
+            run_count += copy_count;
+        }
+        else
+        {
+            if (run_count)
+                d3d12_device_copy_descriptor_run(device, run_dst, run_src, run_count, descriptor_heap_type, embedded);
+
+            run_dst = dst;
+            run_src = src;
+            run_count = copy_count;
         }
 
         dst_idx += copy_count;
@@ -6933,6 +7124,9 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
             src_idx = 0;
         }
     }
+
+    if (run_count)
+        d3d12_device_copy_descriptor_run(device, run_dst, run_src, run_count, descriptor_heap_type, embedded);
 }
 
 static void STDMETHODCALLTYPE d3d12_device_CopyDescriptors(d3d12_device_iface *iface,
@@ -9233,6 +9427,58 @@ static void STDMETHODCALLTYPE d3d12_device_CreateSamplerFeedbackUnorderedAccessV
     d3d12_desc_create_uav_heap(descriptor.ptr, device, feedback, NULL, &uav_desc);
 }
 
+/* Footprints only depend on the plane and mip level, so they are computed once per
+ * plane and mip level rather than once per subresource. Deeper mip chains are not valid
+ * for any real texture, but are handled without the table just in case. */
+#define VKD3D_FOOTPRINT_TABLE_MAX_PLANES 3
+#define VKD3D_FOOTPRINT_TABLE_MAX_LEVELS 16
+
+struct vkd3d_subresource_footprint
+{
+    D3D12_SUBRESOURCE_FOOTPRINT footprint;
+    UINT row_count;
+    UINT64 row_size;
+    UINT64 size;
+};
+
+static void vkd3d_compute_subresource_footprint(const D3D12_RESOURCE_DESC1 *desc,
+        const struct vkd3d_format *format, unsigned int plane_idx, unsigned int mip_level,
+        struct vkd3d_subresource_footprint *footprint)
+{
+    unsigned int num_subresources_per_plane, row_pitch, row_count, row_size;
+    struct vkd3d_format_footprint plane_footprint;
+    unsigned int num_planes = format->plane_count;
+    VkExtent3D extent;
+    uint64_t size;
+
+    num_subresources_per_plane = d3d12_resource_desc_get_sub_resource_count_per_plane(desc);
+    extent = d3d12_resource_desc_get_subresource_extent(desc, format,
+            plane_idx * num_subresources_per_plane + mip_level);
+    plane_footprint = vkd3d_format_footprint_for_plane(format, plane_idx);
+
+    extent.width = align(extent.width, plane_footprint.block_width);
+    extent.height = align(extent.height, plane_footprint.block_height);
+
+    row_count = extent.height / plane_footprint.block_height;
+    row_size = (extent.width / plane_footprint.block_width) * plane_footprint.block_byte_count;
+
+    /* For whatever reason, we need to use 512 bytes of alignment for depth-stencil formats.
+     * This is not documented, but it is observed behavior on both NV and WARP drivers.
+     * See test_get_copyable_footprints_planar(). */
+    row_pitch = align(row_size, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * num_planes);
+
+    footprint->footprint.Format = plane_footprint.dxgi_format;
+    footprint->footprint.Width = extent.width;
+    footprint->footprint.Height = extent.height;
+    footprint->footprint.Depth = extent.depth;
+    footprint->footprint.RowPitch = row_pitch;
+    footprint->row_count = row_count;
+    footprint->row_size = row_size;
+
+    size = max(0, row_count - 1) * row_pitch + row_size;
+    footprint->size = max(0, extent.depth - 1) * align(size, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * num_planes) + size;
+}
+
 static void STDMETHODCALLTYPE d3d12_device_GetCopyableFootprints1(d3d12_device_iface *iface,
         const D3D12_RESOURCE_DESC1 *desc, UINT first_sub_resource, UINT sub_resource_count,
         UINT64 base_offset, D3D12_PLACED_SUBRESOURCE_FOOTPRINT *layouts, UINT *row_counts,
@@ -9242,26 +9488,21 @@ static void STDMETHODCALLTYPE d3d12_device_GetCopyableFootprints1(d3d12_device_i
     static const struct vkd3d_format vkd3d_format_unknown
             = {DXGI_FORMAT_UNKNOWN, VK_FORMAT_UNDEFINED, 1, 1, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT, 1};
 
-    unsigned int i, sub_resource_idx, row_count, row_size, row_pitch;
-    unsigned int num_subresources_per_plane, plane_idx;
-    struct vkd3d_format_footprint plane_footprint;
-    unsigned int num_planes, num_subresources;
+    struct vkd3d_subresource_footprint footprints[VKD3D_FOOTPRINT_TABLE_MAX_PLANES][VKD3D_FOOTPRINT_TABLE_MAX_LEVELS];
+    uint32_t footprint_mask[VKD3D_FOOTPRINT_TABLE_MAX_PLANES] = { 0 };
+    unsigned int i, sub_resource_idx, mip_level, plane_idx;
+    struct vkd3d_subresource_footprint deep_footprint;
+    struct vkd3d_subresource_footprint *footprint;
+    unsigned int num_subresources_per_plane;
+    unsigned int num_subresources;
     const struct vkd3d_format *format;
-    uint64_t offset, size, total;
-    VkExtent3D extent;
+    uint64_t offset, total;
 
     TRACE("iface %p, desc %p, first_sub_resource %u, sub_resource_count %u, base_offset %#"PRIx64", "
             "layouts %p, row_counts %p, row_sizes %p, total_bytes %p.\n",
             iface, desc, first_sub_resource, sub_resource_count, base_offset,
             layouts, row_counts, row_sizes, total_bytes);
 
-    if (layouts)
-        memset(layouts, 0xff, sizeof(*layouts) * sub_resource_count);
-    if (row_counts)
-        memset(row_counts, 0xff, sizeof(*row_counts) * sub_resource_count);
-    if (row_sizes)
-        memset(row_sizes, 0xff, sizeof(*row_sizes) * sub_resource_count);
-
     total = ~(uint64_t)0;
 
     if (desc->Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
@@ -9271,16 +9512,15 @@ static void STDMETHODCALLTYPE d3d12_device_GetCopyableFootprints1(d3d12_device_i
     else if (!(format = vkd3d_format_from_d3d12_resource_desc(device, desc, 0)))
     {
         WARN("Invalid format %#x.\n", desc->Format);
-        goto end;
+        goto fail;
     }
 
     if (FAILED(d3d12_resource_validate_desc(desc, 0, NULL, device)))
     {
         WARN("Invalid resource desc.\n");
-        goto end;
+        goto fail;
     }
 
-    num_planes = format->plane_count;
     num_subresources_per_plane = d3d12_resource_desc_get_sub_resource_count_per_plane(desc);
     num_subresources = d3d12_resource_desc_get_sub_resource_count(device, desc);
 
@@ -9288,7 +9528,7 @@ static void STDMETHODCALLTYPE d3d12_device_GetCopyableFootprints1(d3d12_device_i
             || sub_resource_count > num_subresources - first_sub_resource)
     {
         WARN("Invalid sub-resource range %u-%u for resource.\n", first_sub_resource, sub_resource_count);
-        goto end;
+        goto fail;
     }
 
     offset = 0;
@@ -9296,44 +9536,50 @@ static void STDMETHODCALLTYPE d3d12_device_GetCopyableFootprints1(d3d12_device_i
     for (i = 0; i < sub_resource_count; ++i)
     {
         sub_resource_idx = first_sub_resource + i;
-        extent = d3d12_resource_desc_get_subresource_extent(desc, format, sub_resource_idx);
-
         plane_idx = sub_resource_idx / num_subresources_per_plane;
-        plane_footprint = vkd3d_format_footprint_for_plane(format, plane_idx);
+        mip_level = sub_resource_idx % desc->MipLevels;
 
-        extent.width = align(extent.width, plane_footprint.block_width);
-        extent.height = align(extent.height, plane_footprint.block_height);
-
-        row_count = extent.height / plane_footprint.block_height;
-        row_size = (extent.width / plane_footprint.block_width) * plane_footprint.block_byte_count;
-
-        /* For whatever reason, we need to use 512 bytes of alignment for depth-stencil formats.
-         * This is not documented, but it is observed behavior on both NV and WARP drivers.
-         * See test_get_copyable_footprints_planar(). */
-        row_pitch = align(row_size, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * num_planes);
+        if (plane_idx < VKD3D_FOOTPRINT_TABLE_MAX_PLANES && mip_level < VKD3D_FOOTPRINT_TABLE_MAX_LEVELS)
+        {
+            footprint = &footprints[plane_idx][mip_level];
+            if (!(footprint_mask[plane_idx] & (1u << mip_level)))
+            {
+                vkd3d_compute_subresource_footprint(desc, format, plane_idx, mip_level, footprint);
+                footprint_mask[plane_idx] |= 1u << mip_level;
+            }
+        }
+        else
+        {
+            vkd3d_compute_subresource_footprint(desc, format, plane_idx, mip_level, &deep_footprint);
+            footprint = &deep_footprint;
+        }
 
         if (layouts)
         {
             layouts[i].Offset = base_offset + offset;
-            layouts[i].Footprint.Format = plane_footprint.dxgi_format;
-            layouts[i].Footprint.Width = extent.width;
-            layouts[i].Footprint.Height = extent.height;
-            layouts[i].Footprint.Depth = extent.depth;
-            layouts[i].Footprint.RowPitch = row_pitch;
+            layouts[i].Footprint = footprint->footprint;
         }
         if (row_counts)
-            row_counts[i] = row_count;
+            row_counts[i] = footprint->row_count;
         if (row_sizes)
-            row_sizes[i] = row_size;
+            row_sizes[i] = footprint->row_size;
 
-        size = max(0, row_count - 1) * row_pitch + row_size;
-        size = max(0, extent.depth - 1) * align(size, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * num_planes) + size;
-
-        total = offset + size;
+        total = offset + footprint->size;
         offset = align(total, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
     }
 
-end:
+    if (total_bytes)
+        *total_bytes = total;
+    return;
+
+fail:
+    /* Outputs are only cleared on failure, since every element is written otherwise. */
+    if (layouts)
+        memset(layouts, 0xff, sizeof(*layouts) * sub_resource_count);
+    if (row_counts)
+        memset(row_counts, 0xff, sizeof(*row_counts) * sub_resource_count);
+    if (row_sizes)
+        memset(row_sizes, 0xff, sizeof(*row_sizes) * sub_resource_count);
     if (total_bytes)
         *total_bytes = total;
 }
@@ -11427,7 +11673,8 @@ extern CONST_VTBL struct IAmdExtAntiLagApiVtbl d3d_amd_ext_anti_lag_vtbl;
 
 static void vkd3d_scratch_pool_init(struct d3d12_device *device)
 {
-    unsigned int i;
+    struct d3d12_device_scratch_pool *pool;
+    unsigned int i, j;
 
     for (i = 0; i < VKD3D_SCRATCH_POOL_KIND_COUNT; i++)
     {
@@ -11456,6 +11703,20 @@ static void vkd3d_scratch_pool_init(struct d3d12_device *device)
      * Tuned for Starfield which is the "worst case scenario" so far. */
     device->scratch_pools[VKD3D_SCRATCH_POOL_KIND_INDIRECT_PREPROCESS].scratch_buffer_size =
             VKD3D_SCRATCH_BUFFER_COUNT_INDIRECT_PREPROCESS;
+
+    for (i = 0; i < VKD3D_SCRATCH_POOL_KIND_COUNT; i++)
+    {
+        pool = &device->scratch_pools[i];
+        vkd3d_lockfree_stack_init(&pool->full_head);
+        vkd3d_lockfree_stack_init(&pool->free_head);
+        pool->scratch_buffer_count = 0;
+        pool->cache_limit = pool->scratch_buffer_size;
+        pool->high_water_mark = 0;
+        pool->magazine_size = 0;
+
+        for (j = VKD3D_MAX_SCRATCH_BUFFER_COUNT; j; j--)
+            vkd3d_lockfree_stack_push(&pool->free_head, pool->next_slot, j - 1);
+    }
 }
 
 static HRESULT d3d12_device_create_sparse_init_timeline(struct d3d12_device *device)
@@ -11543,9 +11804,12 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     if (FAILED(hr = vkd3d_memory_transfer_queue_init(&device->memory_transfers, device)))
         goto out_free_private_store;
 
-    if (FAILED(hr = vkd3d_memory_allocator_init(&device->memory_allocator, device)))
+    if (FAILED(hr = vkd3d_pipeline_variant_queue_init(&device->pipeline_variants)))
         goto out_free_memory_transfers;
 
+    if (FAILED(hr = vkd3d_memory_allocator_init(&device->memory_allocator, device)))
+        goto out_free_pipeline_variants;
+
     if (FAILED(hr = vkd3d_init_format_info(device)))
         goto out_free_memory_allocator;
 
@@ -11614,6 +11878,8 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
             vkd3d_fragment_output_pipeline_desc_compare,
             sizeof(struct vkd3d_fragment_output_pipeline));
 
+    vkd3d_image_allocation_info_cache_init(&device->allocation_info_cache);
+
     if ((device->parent = create_info->parent))
         IUnknown_AddRef(device->parent);
 
@@ -11622,6 +11888,8 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     vkd3d_init_shader_extensions(device);
     vkd3d_compute_shader_interface_key(device);
 
+    memset(&device->pipeline_library_stats, 0, sizeof(device->pipeline_library_stats));
+
     /* Make sure all extensions and shader interface keys are computed. */
     if (FAILED(hr = vkd3d_pipeline_library_init_disk_cache(&device->disk_cache, device)))
         goto out_cleanup_descriptor_qa_global_info;
@@ -11670,6 +11938,8 @@ out_cleanup_format_info:
     vkd3d_cleanup_format_info(device);
 out_free_memory_allocator:
     vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
+out_free_pipeline_variants:
+    vkd3d_pipeline_variant_queue_cleanup(&device->pipeline_variants);
 out_free_memory_transfers:
     vkd3d_memory_transfer_queue_cleanup(&device->memory_transfers);
 out_free_private_store:
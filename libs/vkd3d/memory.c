@@ -1572,178 +1572,31 @@ static HRESULT vkd3d_memory_allocation_init(struct vkd3d_memory_allocation *allo
     return S_OK;
 }
 
-static void vkd3d_memory_chunk_insert_range(struct vkd3d_memory_chunk *chunk,
-        size_t index, VkDeviceSize offset, VkDeviceSize length)
-{
-    if (!vkd3d_array_reserve((void**)&chunk->free_ranges, &chunk->free_ranges_size,
-            chunk->free_ranges_count + 1, sizeof(*chunk->free_ranges)))
-    {
-        ERR("Failed to insert free range.\n");
-        return;
-    }
-
-    memmove(&chunk->free_ranges[index + 1], &chunk->free_ranges[index],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
-
-    chunk->free_ranges[index].offset = offset;
-    chunk->free_ranges[index].length = length;
-    chunk->free_ranges_count++;
-}
-
-static void vkd3d_memory_chunk_remove_range(struct vkd3d_memory_chunk *chunk, size_t index)
-{
-    chunk->free_ranges_count--;
-
-    memmove(&chunk->free_ranges[index], &chunk->free_ranges[index + 1],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
-}
-
 static HRESULT vkd3d_memory_chunk_allocate_range(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements,
         struct vkd3d_memory_allocation *allocation)
 {
-    struct vkd3d_memory_free_range *pick_range;
-    VkDeviceSize l_length, r_length;
-    size_t i, pick_index;
-
-    if (!chunk->free_ranges_count)
-        return E_OUTOFMEMORY;
-
-    pick_index = chunk->free_ranges_count;
-    pick_range = NULL;
-
-    for (i = 0; i < chunk->free_ranges_count; i++)
-    {
-        struct vkd3d_memory_free_range *range = &chunk->free_ranges[i];
-
-        if (range->offset + range->length < align(range->offset, memory_requirements->alignment) + memory_requirements->size)
-            continue;
-
-        /* Exact fit leaving no gaps */
-        if (range->length == memory_requirements->size)
-        {
-            pick_index = i;
-            pick_range = range;
-            break;
-        }
+    uint64_t offset;
+    uint32_t range;
 
-        /* Alignment is almost always going to be 64 KiB, so
-         * don't worry too much about misalignment gaps here */
-        if (!pick_range || range->length > pick_range->length)
-        {
-            pick_index = i;
-            pick_range = range;
-        }
-    }
-
-    if (!pick_range)
+    if (!vkd3d_range_allocator_allocate(&chunk->ranges, memory_requirements->size,
+            memory_requirements->alignment, &offset, &range))
         return E_OUTOFMEMORY;
 
     /* Adjust offsets and addresses of the base allocation */
-    vkd3d_memory_allocation_slice(allocation, &chunk->allocation,
-            align(pick_range->offset, memory_requirements->alignment),
-            memory_requirements->size);
+    vkd3d_memory_allocation_slice(allocation, &chunk->allocation, offset, memory_requirements->size);
     allocation->chunk = chunk;
-
-    /* Remove allocated range from the free list */
-    l_length = allocation->offset - pick_range->offset;
-    r_length = pick_range->offset + pick_range->length
-            - allocation->offset - allocation->resource.size;
-
-    if (l_length)
-    {
-        pick_range->length = l_length;
-
-        if (r_length)
-        {
-            vkd3d_memory_chunk_insert_range(chunk, pick_index + 1,
-                allocation->offset + allocation->resource.size, r_length);
-        }
-    }
-    else if (r_length)
-    {
-        pick_range->offset = allocation->offset + allocation->resource.size;
-        pick_range->length = r_length;
-    }
-    else
-    {
-        vkd3d_memory_chunk_remove_range(chunk, pick_index);
-    }
-
+    allocation->chunk_range = range;
     return S_OK;
 }
 
-static size_t vkd3d_memory_chunk_find_range(struct vkd3d_memory_chunk *chunk, VkDeviceSize offset)
-{
-    struct vkd3d_memory_free_range *range;
-    size_t index, hi, lo;
-
-    lo = 0;
-    hi = chunk->free_ranges_count;
-
-    while (lo < hi)
-    {
-        index = lo + (hi - lo) / 2;
-        range = &chunk->free_ranges[index];
-
-        if (range->offset > offset)
-            hi = index;
-        else
-            lo = index + 1;
-    }
-
-    return lo;
-}
-
 static void vkd3d_memory_chunk_free_range(struct vkd3d_memory_chunk *chunk, const struct vkd3d_memory_allocation *allocation)
 {
-    struct vkd3d_memory_free_range *range;
-    bool adjacent_l, adjacent_r;
-    size_t index;
-
-    index = vkd3d_memory_chunk_find_range(chunk, allocation->offset);
-
-    adjacent_l = false;
-    adjacent_r = false;
-
-    if (index > 0)
-    {
-        range = &chunk->free_ranges[index - 1];
-        adjacent_l = range->offset + range->length == allocation->offset;
-    }
-
-    if (index < chunk->free_ranges_count)
-    {
-        range = &chunk->free_ranges[index];
-        adjacent_r = range->offset == allocation->offset + allocation->resource.size;
-    }
-
-    if (adjacent_l)
-    {
-        range = &chunk->free_ranges[index - 1];
-        range->length += allocation->resource.size;
-
-        if (adjacent_r)
-        {
-            range->length += chunk->free_ranges[index].length;
-            vkd3d_memory_chunk_remove_range(chunk, index);
-        }
-    }
-    else if (adjacent_r)
-    {
-        range = &chunk->free_ranges[index];
-        range->offset = allocation->offset;
-        range->length += allocation->resource.size;
-    }
-    else
-    {
-        vkd3d_memory_chunk_insert_range(chunk, index,
-                allocation->offset, allocation->resource.size);
-    }
+    vkd3d_range_allocator_free(&chunk->ranges, allocation->chunk_range);
 }
 
 static bool vkd3d_memory_chunk_is_free(struct vkd3d_memory_chunk *chunk)
 {
-    return chunk->free_ranges_count == 1 && chunk->free_ranges[0].length == chunk->allocation.resource.size;
+    return vkd3d_range_allocator_is_empty(&chunk->ranges);
 }
 
 static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
@@ -1774,7 +1627,13 @@ static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd
                 VK_OBJECT_TYPE_DEVICE_MEMORY, name_buffer);
     }
 
-    vkd3d_memory_chunk_insert_range(object, 0, 0, object->allocation.resource.size);
+    if (!vkd3d_range_allocator_init(&object->ranges, object->allocation.resource.size))
+    {
+        vkd3d_memory_allocation_free(&object->allocation, device, allocator);
+        vkd3d_free(object);
+        return E_OUTOFMEMORY;
+    }
+
     *chunk = object;
 
     TRACE("Created chunk %p (allocation %p).\n", object, &object->allocation);
@@ -1789,34 +1648,40 @@ static void vkd3d_memory_chunk_destroy(struct vkd3d_memory_chunk *chunk, struct
         vkd3d_memory_transfer_queue_wait_allocation(&device->memory_transfers, &chunk->allocation);
 
     vkd3d_memory_allocation_free(&chunk->allocation, device, allocator);
-    vkd3d_free(chunk->free_ranges);
+    vkd3d_range_allocator_cleanup(&chunk->ranges);
     vkd3d_free(chunk);
 }
 
-static void vkd3d_memory_allocator_remove_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device, struct vkd3d_memory_chunk *chunk)
+static void vkd3d_memory_chunk_list_remove_chunk(struct vkd3d_memory_chunk_list *list, struct vkd3d_memory_chunk *chunk)
 {
     size_t i;
 
-    for (i = 0; i < allocator->chunks_count; i++)
+    for (i = 0; i < list->chunks_count; i++)
     {
-        if (allocator->chunks[i] == chunk)
+        if (list->chunks[i] == chunk)
         {
-            allocator->chunks[i] = allocator->chunks[--allocator->chunks_count];
+            list->chunks[i] = list->chunks[--list->chunks_count];
             break;
         }
     }
-
-    vkd3d_memory_chunk_destroy(chunk, device, allocator);
 }
 
 HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
+    unsigned int i;
     int rc;
 
     memset(allocator, 0, sizeof(*allocator));
 
-    if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
-        return hresult_from_errno(rc);
+    for (i = 0; i < ARRAY_SIZE(allocator->chunk_lists); i++)
+    {
+        if ((rc = pthread_mutex_init(&allocator->chunk_lists[i].mutex, NULL)))
+        {
+            while (i--)
+                pthread_mutex_destroy(&allocator->chunk_lists[i].mutex);
+            return hresult_from_errno(rc);
+        }
+    }
 
     vkd3d_va_map_init(&allocator->va_map);
     return S_OK;
@@ -1824,18 +1689,25 @@ HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, st
 
 void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
-    size_t i;
+    struct vkd3d_memory_chunk_list *list;
+    size_t i, j;
 
     for (i = 0; i < ARRAY_SIZE(allocator->sparse_pending_destroy); i++)
         if (allocator->sparse_pending_destroy[i])
             d3d12_resource_decref(allocator->sparse_pending_destroy[i]);
 
-    for (i = 0; i < allocator->chunks_count; i++)
-        vkd3d_memory_chunk_destroy(allocator->chunks[i], device, allocator);
+    for (i = 0; i < ARRAY_SIZE(allocator->chunk_lists); i++)
+    {
+        list = &allocator->chunk_lists[i];
+
+        for (j = 0; j < list->chunks_count; j++)
+            vkd3d_memory_chunk_destroy(list->chunks[j], device, allocator);
+
+        vkd3d_free(list->chunks);
+        pthread_mutex_destroy(&list->mutex);
+    }
 
-    vkd3d_free(allocator->chunks);
     vkd3d_va_map_cleanup(&allocator->va_map);
-    pthread_mutex_destroy(&allocator->mutex);
 }
 
 static HRESULT vkd3d_memory_allocator_try_add_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device,
@@ -1874,17 +1746,10 @@ static HRESULT vkd3d_memory_allocator_try_add_chunk(struct vkd3d_memory_allocato
         alloc_info.explicit_global_buffer_usage = explicit_global_buffer_usage;
     }
 
-    if (!vkd3d_array_reserve((void**)&allocator->chunks, &allocator->chunks_size,
-            allocator->chunks_count + 1, sizeof(*allocator->chunks)))
-    {
-        ERR("Failed to allocate space for new chunk.\n");
-        return E_OUTOFMEMORY;
-    }
-
     if (FAILED(hr = vkd3d_memory_chunk_create(device, allocator, &alloc_info, &object)))
         return hr;
 
-    allocator->chunks[allocator->chunks_count++] = *chunk = object;
+    *chunk = object;
     return S_OK;
 }
 
@@ -1900,8 +1765,10 @@ static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory
             D3D12_HEAP_FLAG_ALLOW_SHADER_ATOMICS |
             D3D12_HEAP_FLAG_ALLOW_DISPLAY);
 
+    struct vkd3d_memory_chunk_list *list;
     D3D12_HEAP_TYPE normalized_heap_type;
     struct vkd3d_memory_chunk *chunk;
+    uint32_t type_iter;
     HRESULT hr;
     size_t i;
 
@@ -1909,34 +1776,66 @@ static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory
     type_mask &= memory_requirements->memoryTypeBits;
     normalized_heap_type = vkd3d_normalize_heap_type(heap_properties);
 
-    for (i = 0; i < allocator->chunks_count; i++)
+    /* Filter out unsupported memory types */
+    type_iter = type_mask;
+    while (type_iter)
     {
-        chunk = allocator->chunks[i];
+        list = &allocator->chunk_lists[vkd3d_bitmask_iter32(&type_iter)];
+        pthread_mutex_lock(&list->mutex);
 
-        /* Match heap type so that we know we get the appropriate memory property flags.
-         * These types are normalized, so that different CUSTOM heaps will be considered to be different heap types.
-         * Beyond that, there's just a distinction which explicit global buffer usage we have.
-         * In practice, we're toggling between BUFFER heaps and non-BUFFER heaps here. */
-        if (chunk->allocation.heap_type != normalized_heap_type ||
-                chunk->allocation.explicit_global_buffer_usage != explicit_global_buffer_usage)
-            continue;
+        for (i = 0; i < list->chunks_count; i++)
+        {
+            chunk = list->chunks[i];
 
-        /* Filter out unsupported memory types */
-        if (!(type_mask & (1u << chunk->allocation.device_allocation.vk_memory_type)))
-            continue;
+            /* Match heap type so that we know we get the appropriate memory property flags.
+             * These types are normalized, so that different CUSTOM heaps will be considered to be different heap types.
+             * Beyond that, there's just a distinction which explicit global buffer usage we have.
+             * In practice, we're toggling between BUFFER heaps and non-BUFFER heaps here. */
+            if (chunk->allocation.heap_type != normalized_heap_type ||
+                    chunk->allocation.explicit_global_buffer_usage != explicit_global_buffer_usage)
+                continue;
 
-        if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
-            return hr;
+            if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
+            {
+                pthread_mutex_unlock(&list->mutex);
+                return hr;
+            }
+        }
+
+        pthread_mutex_unlock(&list->mutex);
     }
 
     /* Try allocating a new chunk on one of the supported memory type
-     * before the caller falls back to potentially slower memory */
+     * before the caller falls back to potentially slower memory.
+     * The chunk is created without holding any lock, so concurrent allocations may
+     * end up creating one chunk each. Redundant chunks are freed again once they drain. */
     if (FAILED(hr = vkd3d_memory_allocator_try_add_chunk(allocator, device, heap_properties,
             heap_flags, type_mask, optional_properties,
             explicit_global_buffer_usage, memory_requirements->size, &chunk)))
         return hr;
 
-    return vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation);
+    /* Nobody else can see the chunk yet, so this cannot fail unless the request does not fit a chunk. */
+    if (FAILED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
+    {
+        vkd3d_memory_chunk_destroy(chunk, device, allocator);
+        return hr;
+    }
+
+    list = &allocator->chunk_lists[chunk->allocation.device_allocation.vk_memory_type];
+    pthread_mutex_lock(&list->mutex);
+
+    if (!vkd3d_array_reserve((void**)&list->chunks, &list->chunks_size,
+            list->chunks_count + 1, sizeof(*list->chunks)))
+    {
+        pthread_mutex_unlock(&list->mutex);
+        ERR("Failed to allocate space for new chunk.\n");
+        vkd3d_memory_chunk_destroy(chunk, device, allocator);
+        return E_OUTOFMEMORY;
+    }
+
+    list->chunks[list->chunks_count++] = chunk;
+    pthread_mutex_unlock(&list->mutex);
+    return S_OK;
 }
 
 void vkd3d_free_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
@@ -1950,12 +1849,22 @@ void vkd3d_free_memory(struct d3d12_device *device, struct vkd3d_memory_allocato
 
     if (allocation->chunk)
     {
-        pthread_mutex_lock(&allocator->mutex);
-        vkd3d_memory_chunk_free_range(allocation->chunk, allocation);
+        struct vkd3d_memory_chunk *chunk = allocation->chunk;
+        struct vkd3d_memory_chunk_list *list;
+        bool destroy_chunk;
+
+        list = &allocator->chunk_lists[chunk->allocation.device_allocation.vk_memory_type];
 
-        if (vkd3d_memory_chunk_is_free(allocation->chunk))
-            vkd3d_memory_allocator_remove_chunk(allocator, device, allocation->chunk);
-        pthread_mutex_unlock(&allocator->mutex);
+        pthread_mutex_lock(&list->mutex);
+        vkd3d_memory_chunk_free_range(chunk, allocation);
+
+        if ((destroy_chunk = vkd3d_memory_chunk_is_free(chunk)))
+            vkd3d_memory_chunk_list_remove_chunk(list, chunk);
+        pthread_mutex_unlock(&list->mutex);
+
+        /* Once removed from the list, nobody else can observe the chunk. */
+        if (destroy_chunk)
+            vkd3d_memory_chunk_destroy(chunk, device, allocator);
     }
     else
         vkd3d_memory_allocation_free(allocation, device, allocator);
@@ -1977,8 +1886,6 @@ static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3
     required_mask = vkd3d_find_memory_types_with_flags(device, type_flags & ~optional_flags);
     optional_mask = vkd3d_find_memory_types_with_flags(device, type_flags);
 
-    pthread_mutex_lock(&allocator->mutex);
-
     hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
             &memory_requirements, optional_mask, 0, &info->heap_properties,
             info->heap_flags, info->explicit_global_buffer_usage, allocation);
@@ -1992,7 +1899,6 @@ static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3
                 allocation);
     }
 
-    pthread_mutex_unlock(&allocator->mutex);
     return hr;
 }
 
@@ -305,6 +305,7 @@ vkd3d_queue_timeline_trace_register_execute(struct vkd3d_queue_timeline_trace *t
     state = &trace->state[cookie.index];
     state->type = VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_SUBMISSION;
     state->start_ts = vkd3d_get_current_time_ns();
+    state->merged_count = 0;
     snprintf(state->desc, sizeof(state->desc), "SUBMIT #%"PRIu64" (%u lists)", submission_count, count);
 
     /* Might be useful later. */
@@ -619,6 +620,8 @@ void vkd3d_queue_timeline_trace_complete_execute(struct vkd3d_queue_timeline_tra
 {
     double end_ts, start_submit_ts, start_ts, overhead_start_ts, overhead_end_ts;
     const struct vkd3d_queue_timeline_trace_state *state;
+    char merged_desc[sizeof(state->desc) + 32];
+    const char *desc;
     unsigned int pid;
     const char *tid;
     double *ts_lock;
@@ -638,6 +641,13 @@ void vkd3d_queue_timeline_trace_complete_execute(struct vkd3d_queue_timeline_tra
         if (state->type == VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_SUBMISSION)
             vkd3d_queue_timeline_trace_flush_instantaneous(trace, worker);
 
+        desc = state->desc;
+        if (state->type == VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_SUBMISSION && state->merged_count)
+        {
+            snprintf(merged_desc, sizeof(merged_desc), "%s +%"PRIu64" merged", state->desc, state->merged_count);
+            desc = merged_desc;
+        }
+
         tid = worker->timeline.tid;
         if (state->type == VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_GENERIC_REGION)
             tid = "regions";
@@ -647,7 +657,7 @@ void vkd3d_queue_timeline_trace_complete_execute(struct vkd3d_queue_timeline_tra
         if (state->type == VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_SUBMISSION)
         {
             fprintf(trace->file, "{ \"name\": \"%s\", \"ph\": \"i\", \"tid\": \"cpu\", \"pid\": \"0x%04x\", \"ts\": %f, \"s\": \"t\" },\n",
-                    state->desc, pid, start_ts);
+                    desc, pid, start_ts);
 
             if (start_ts < worker->timeline.lock_end_cpu_ts)
                 start_ts = worker->timeline.lock_end_cpu_ts;
@@ -667,17 +677,17 @@ void vkd3d_queue_timeline_trace_complete_execute(struct vkd3d_queue_timeline_tra
         }
 
         fprintf(trace->file, "{ \"name\": \"%s\", \"ph\": \"X\", \"tid\": \"%s\", \"pid\": \"0x%04x\", \"ts\": %f, \"dur\": %f },\n",
-                state->desc, tid, pid, start_submit_ts, end_ts - start_submit_ts);
+                desc, tid, pid, start_submit_ts, end_ts - start_submit_ts);
 
         if (state->type == VKD3D_QUEUE_TIMELINE_TRACE_STATE_TYPE_SUBMISSION)
         {
             worker->timeline.lock_end_cpu_ts = start_submit_ts;
             fprintf(trace->file,
                     "{ \"name\": \"%s\", \"ph\": \"X\", \"tid\": \"submit\", \"pid\": \"0x%04x\", \"ts\": %f, \"dur\": %f },\n",
-                    state->desc, pid, start_ts, start_submit_ts - start_ts);
+                    desc, pid, start_ts, start_submit_ts - start_ts);
             fprintf(trace->file,
                     "{ \"name\": \"%s\", \"ph\": \"X\", \"tid\": \"overhead\", \"pid\": \"0x%04x\", \"ts\": %f, \"dur\": %f },\n",
-                    state->desc, pid, overhead_start_ts, overhead_end_ts - overhead_start_ts);
+                    desc, pid, overhead_start_ts, overhead_end_ts - overhead_start_ts);
         }
     }
 
@@ -695,6 +705,20 @@ void vkd3d_queue_timeline_trace_begin_execute(struct vkd3d_queue_timeline_trace
     state->start_submit_ts = vkd3d_get_current_time_ns();
 }
 
+void vkd3d_queue_timeline_trace_merge_execute(struct vkd3d_queue_timeline_trace *trace,
+        struct vkd3d_queue_timeline_trace_cookie cookie,
+        struct vkd3d_queue_timeline_trace_cookie merged_cookie)
+{
+    if (!trace->active)
+        return;
+
+    if (cookie.index)
+        trace->state[cookie.index].merged_count += 1 + (merged_cookie.index ? trace->state[merged_cookie.index].merged_count : 0);
+
+    if (merged_cookie.index)
+        vkd3d_queue_timeline_trace_free_index(trace, merged_cookie.index);
+}
+
 void vkd3d_queue_timeline_trace_begin_execute_overhead(struct vkd3d_queue_timeline_trace *trace,
         struct vkd3d_queue_timeline_trace_cookie cookie)
 {
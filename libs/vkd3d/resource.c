@@ -1214,7 +1214,7 @@ static HRESULT vkd3d_create_image(struct d3d12_device *device,
 static size_t vkd3d_compute_resource_layouts_from_desc(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC1 *desc, struct vkd3d_subresource_layout *layouts);
 
-HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
+static HRESULT vkd3d_query_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC1 *desc,
         UINT num_castable_formats, const DXGI_FORMAT *castable_formats,
         D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
@@ -1229,9 +1229,6 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
     bool pad_allocation;
     HRESULT hr;
 
-    assert(desc->Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
-    assert(d3d12_resource_validate_desc(desc, num_castable_formats, castable_formats, device) == S_OK);
-
     if (!desc->MipLevels)
     {
         validated_desc = *desc;
@@ -1342,6 +1339,135 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
     return hr;
 }
 
+static uint32_t vkd3d_image_allocation_info_key_hash(const void *key)
+{
+    const struct vkd3d_image_allocation_info_key *k = key;
+    uint64_t hash = hash_xxh64(k, sizeof(*k), 0);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static bool vkd3d_image_allocation_info_key_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_image_allocation_info_entry *e = (const struct vkd3d_image_allocation_info_entry *)entry;
+    return !memcmp(key, &e->key, sizeof(e->key));
+}
+
+static bool vkd3d_image_allocation_info_key_init(struct vkd3d_image_allocation_info_key *key,
+        const D3D12_RESOURCE_DESC1 *desc, UINT num_castable_formats, const DXGI_FORMAT *castable_formats)
+{
+    unsigned int i;
+
+    /* Long format lists are rare enough that they are not worth a variable sized key. */
+    if (num_castable_formats > ARRAY_SIZE(key->castable_formats))
+        return false;
+
+    /* Keys are hashed and compared as raw memory, so padding must be cleared as well. */
+    memset(key, 0, sizeof(*key));
+    key->width = desc->Width;
+    key->alignment = desc->Alignment;
+    key->dimension = desc->Dimension;
+    key->height = desc->Height;
+    key->depth_or_array_size = desc->DepthOrArraySize;
+    key->mip_levels = desc->MipLevels ? desc->MipLevels : max_miplevel_count(desc);
+    key->format = desc->Format;
+    key->sample_count = desc->SampleDesc.Count;
+    key->sample_quality = desc->SampleDesc.Quality;
+    key->layout = desc->Layout;
+    key->flags = desc->Flags;
+    key->mip_region[0] = desc->SamplerFeedbackMipRegion.Width;
+    key->mip_region[1] = desc->SamplerFeedbackMipRegion.Height;
+    key->mip_region[2] = desc->SamplerFeedbackMipRegion.Depth;
+    key->castable_format_count = num_castable_formats;
+
+    for (i = 0; i < num_castable_formats; i++)
+        key->castable_formats[i] = castable_formats[i];
+
+    return true;
+}
+
+void vkd3d_image_allocation_info_cache_init(struct vkd3d_image_allocation_info_cache *cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(cache->stripes); i++)
+    {
+        spinlock_init(&cache->stripes[i].spinlock);
+        hash_map_init(&cache->stripes[i].map, vkd3d_image_allocation_info_key_hash,
+                vkd3d_image_allocation_info_key_compare, sizeof(struct vkd3d_image_allocation_info_entry));
+    }
+}
+
+void vkd3d_image_allocation_info_cache_cleanup(struct vkd3d_image_allocation_info_cache *cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(cache->stripes); i++)
+        hash_map_free(&cache->stripes[i].map);
+}
+
+HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
+        const D3D12_RESOURCE_DESC1 *desc,
+        UINT num_castable_formats, const DXGI_FORMAT *castable_formats,
+        D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
+{
+    struct vkd3d_image_allocation_info_cache *cache = &device->allocation_info_cache;
+    const struct vkd3d_image_allocation_info_entry *e;
+    struct vkd3d_image_allocation_info_entry entry;
+    uint32_t hash, stripe_index = 0;
+    bool cacheable;
+    HRESULT hr;
+
+    VKD3D_REGION_DECL(image_allocation_info_hit);
+    VKD3D_REGION_DECL(image_allocation_info_miss);
+
+    assert(desc->Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
+    assert(d3d12_resource_validate_desc(desc, num_castable_formats, castable_formats, device) == S_OK);
+
+    VKD3D_REGION_BEGIN(image_allocation_info_hit);
+
+    cacheable = vkd3d_image_allocation_info_key_init(&entry.key, desc, num_castable_formats, castable_formats);
+
+    if (cacheable)
+    {
+        hash = vkd3d_image_allocation_info_key_hash(&entry.key);
+        /* Control tags in the hash map only depend on the low bits, so pick stripes from the high bits. */
+        stripe_index = hash >> (32 - vkd3d_log2i(VKD3D_IMAGE_ALLOCATION_INFO_CACHE_STRIPE_COUNT));
+
+        rw_spinlock_acquire_read(&cache->stripes[stripe_index].spinlock);
+        if ((e = (const struct vkd3d_image_allocation_info_entry *)hash_map_find_with_hash(
+                &cache->stripes[stripe_index].map, &entry.key, hash)))
+            *allocation_info = e->allocation_info;
+        rw_spinlock_release_read(&cache->stripes[stripe_index].spinlock);
+
+        if (e)
+        {
+            VKD3D_REGION_END(image_allocation_info_hit);
+            return S_OK;
+        }
+    }
+
+    VKD3D_REGION_BEGIN(image_allocation_info_miss);
+
+    if (FAILED(hr = vkd3d_query_image_allocation_info(device, desc, num_castable_formats, castable_formats,
+            allocation_info)))
+        return hr;
+
+    if (cacheable)
+    {
+        entry.allocation_info = *allocation_info;
+
+        /* If a stripe fills up, stop caching new descs rather than evicting. Apps which
+         * create that many distinct textures are not the ones this cache helps. */
+        rw_spinlock_acquire_write(&cache->stripes[stripe_index].spinlock);
+        if (cache->stripes[stripe_index].map.used_count < VKD3D_IMAGE_ALLOCATION_INFO_CACHE_STRIPE_MAX_ENTRIES)
+            hash_map_insert(&cache->stripes[stripe_index].map, &entry.key, &entry.entry);
+        rw_spinlock_release_write(&cache->stripes[stripe_index].spinlock);
+    }
+
+    VKD3D_REGION_END(image_allocation_info_miss);
+    return S_OK;
+}
+
 struct vkd3d_view_entry
 {
     struct hash_map_entry entry;
@@ -2337,7 +2463,8 @@ static void d3d12_device_add_queue_timeline_deferred_decref(struct d3d12_device
                     d3d12_resource_incref(resource);
                     sub.type = VKD3D_SUBMISSION_RESOURCE_RETAIN;
                     sub.resource = resource;
-                    d3d12_command_queue_add_submission_locked(queue, &sub);
+                    if (FAILED(d3d12_command_queue_add_submission_locked(queue, &sub)))
+                        d3d12_resource_decref(resource);
                 }
                 pthread_mutex_unlock(&queue->queue_lock);
             }
@@ -2672,8 +2799,9 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(d3d12_resourc
     const struct vkd3d_vk_device_procs *vk_procs;
     VkMappedMemoryRange mapped_range = { 0 };
     struct vkd3d_format_footprint footprint;
+    VkMemoryPropertyFlags memory_flags;
     const struct vkd3d_format *format;
-    uint32_t plane_idx;
+    uint32_t plane_idx, copy_flags;
     VkExtent3D extent;
     VkOffset3D offset;
     uint8_t *dst_data;
@@ -2741,8 +2869,13 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(d3d12_resourc
     dst_data += subresource_layout->offset + vkd3d_format_get_data_offset(format,
             subresource_layout->row_pitch, subresource_layout->depth_pitch, offset.x, offset.y, offset.z);
 
+    /* Uncached memory is write-combined, so stream the data out rather than pulling it into the cache. */
+    memory_flags = device->memory_properties.memoryTypes[resource->mem.device_allocation.vk_memory_type].propertyFlags;
+    copy_flags = (memory_flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? 0 : VKD3D_COPY_ROWS_NON_TEMPORAL;
+
     vkd3d_format_copy_data(format, src_data, src_row_pitch, src_slice_pitch, dst_data,
-            subresource_layout->row_pitch, subresource_layout->depth_pitch, extent.width, extent.height, extent.depth);
+            subresource_layout->row_pitch, subresource_layout->depth_pitch, extent.width, extent.height, extent.depth,
+            copy_flags);
 
     mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
     mapped_range.memory = resource->mem.device_allocation.vk_memory;
@@ -2835,7 +2968,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_ReadFromSubresource(d3d12_resour
 
     vkd3d_format_copy_data(format, src_data, subresource_layout->row_pitch,
             subresource_layout->depth_pitch, dst_data, dst_row_pitch, dst_slice_pitch,
-            src_box->right - src_box->left, src_box->bottom - src_box->top, src_box->back - src_box->front);
+            src_box->right - src_box->left, src_box->bottom - src_box->top, src_box->back - src_box->front, 0);
 
     return S_OK;
 }
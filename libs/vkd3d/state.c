@@ -2643,12 +2643,59 @@ HRESULT vkd3d_pipeline_state_desc_from_d3d12_stream_desc(struct d3d12_pipeline_s
 
 struct vkd3d_compiled_pipeline
 {
-    struct list entry;
+    struct vkd3d_lockfree_hash_map_entry entry;
     struct vkd3d_pipeline_key key;
-    VkPipeline vk_pipeline;
+    DXGI_FORMAT dsv_format;
     uint32_t dynamic_state_flags;
+    /* VK_NULL_HANDLE while the variant is being compiled asynchronously.
+     * Written after dynamic_state_flags with release semantics, since lookups do not take locks. */
+    VkPipeline vk_pipeline;
+    /* Set while an asynchronous compile is queued or running. Entries cannot be removed from the map,
+     * so a failed compile clears this instead, and the next draw which needs the variant queues it again. */
+    uint32_t pending;
 };
 
+static inline VkPipeline vkd3d_compiled_pipeline_load(const struct vkd3d_compiled_pipeline *compiled_pipeline)
+{
+    return (VkPipeline)vkd3d_atomic_uint64_load_explicit((uint64_t *)&compiled_pipeline->vk_pipeline,
+            vkd3d_memory_order_acquire);
+}
+
+static inline void vkd3d_compiled_pipeline_store(struct vkd3d_compiled_pipeline *compiled_pipeline,
+        VkPipeline vk_pipeline)
+{
+    vkd3d_atomic_uint64_store_explicit((uint64_t *)&compiled_pipeline->vk_pipeline,
+            (uint64_t)vk_pipeline, vkd3d_memory_order_release);
+}
+
+static uint32_t vkd3d_pipeline_key_hash(const struct vkd3d_pipeline_key *key)
+{
+    uint64_t h = hash_fnv1_init();
+
+    h = hash_fnv1_iterate_u32(h, key->topology);
+    h = hash_fnv1_iterate_u32(h, key->dsv_format);
+    h = hash_fnv1_iterate_u32(h, key->rasterization_samples);
+    h = hash_fnv1_iterate_u32(h, key->view_mask);
+    h = hash_fnv1_iterate_u8(h, key->dynamic_topology);
+    return hash_uint64(h);
+}
+
+static bool vkd3d_compiled_pipeline_compare(const void *key, const struct vkd3d_lockfree_hash_map_entry *entry)
+{
+    const struct vkd3d_compiled_pipeline *compiled_pipeline = (const struct vkd3d_compiled_pipeline *)entry;
+    return !memcmp(&compiled_pipeline->key, key, sizeof(compiled_pipeline->key));
+}
+
+static void vkd3d_compiled_pipeline_destroy(struct vkd3d_lockfree_hash_map_entry *entry, void *userdata)
+{
+    struct vkd3d_compiled_pipeline *compiled_pipeline = (struct vkd3d_compiled_pipeline *)entry;
+    struct d3d12_device *device = userdata;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    VK_CALL(vkDestroyPipeline(device->vk_device, compiled_pipeline->vk_pipeline, NULL));
+    vkd3d_free(compiled_pipeline);
+}
+
 /* ID3D12PipelineState */
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_QueryInterface(ID3D12PipelineState *iface,
         REFIID riid, void **object)
@@ -2790,15 +2837,11 @@ static void d3d12_pipeline_state_destroy_graphics(struct d3d12_pipeline_state *s
 {
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct vkd3d_compiled_pipeline *current, *e;
 
     d3d12_pipeline_state_destroy_shader_modules(state, device);
 
-    LIST_FOR_EACH_ENTRY_SAFE(current, e, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
-    {
-        VK_CALL(vkDestroyPipeline(device->vk_device, current->vk_pipeline, NULL));
-        vkd3d_free(current);
-    }
+    vkd3d_lockfree_hash_map_iter(&graphics->compiled_fallback_pipelines, vkd3d_compiled_pipeline_destroy, device);
+    vkd3d_lockfree_hash_map_free(&graphics->compiled_fallback_pipelines);
 
     VK_CALL(vkDestroyPipeline(device->vk_device, graphics->pipeline, NULL));
     VK_CALL(vkDestroyPipeline(device->vk_device, graphics->library, NULL));
@@ -3051,7 +3094,7 @@ static HRESULT vkd3d_load_spirv_from_cached_state(struct d3d12_device *device,
     if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_IGNORE_SPIRV))
         return E_FAIL;
 
-    hr = vkd3d_get_cached_spirv_code_from_d3d12_desc(cached_state, stage, spirv_code, identifier);
+    hr = vkd3d_get_cached_spirv_code_from_d3d12_desc(device, cached_state, stage, spirv_code, identifier);
 
     if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
     {
@@ -6249,7 +6292,7 @@ static HRESULT d3d12_pipeline_state_finish_graphics(struct d3d12_pipeline_state
         }
     }
 
-    list_init(&graphics->compiled_fallback_pipelines);
+    vkd3d_lockfree_hash_map_init(&graphics->compiled_fallback_pipelines, vkd3d_compiled_pipeline_compare);
     if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
         return hr;
 
@@ -6351,6 +6394,9 @@ static HRESULT d3d12_pipeline_create_private_root_signature(struct d3d12_device
     return S_OK;
 }
 
+static void d3d12_pipeline_state_prewarm_pipeline_variants(struct d3d12_pipeline_state *state,
+        const struct d3d12_cached_pipeline_state *cached_state);
+
 HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindPoint bind_point,
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state)
 {
@@ -6358,6 +6404,7 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
     const struct d3d12_cached_pipeline_state *desc_cached_pso;
     struct d3d12_cached_pipeline_state cached_pso;
     struct d3d12_pipeline_state *object;
+    uint64_t begin_ts;
     HRESULT hr;
 
     if (!(object = vkd3d_malloc(sizeof(*object))))
@@ -6401,7 +6448,9 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
 
     if (desc->cached_pso.blob.CachedBlobSizeInBytes)
     {
+        begin_ts = vkd3d_get_current_time_ns();
         hr = d3d12_cached_pipeline_state_validate(device, &desc->cached_pso, &object->pipeline_cache_compat);
+        vkd3d_pipeline_library_stats_add_time(&device->pipeline_library_stats.validate_ns, begin_ts);
 
         if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_IGNORE_MISMATCH_DRIVER) &&
                 (hr == D3D12_ERROR_ADAPTER_NOT_FOUND || hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH))
@@ -6466,6 +6515,8 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
      * Ideally there would be a flag to disable in-memory caching (but retain on-disk cache),
      * but that's extremely specific, so do what we gotta do. */
 
+    begin_ts = vkd3d_get_current_time_ns();
+
     if (SUCCEEDED(hr))
     {
         switch (bind_point)
@@ -6491,6 +6542,20 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        if (desc_cached_pso->blob.CachedBlobSizeInBytes)
+        {
+            vkd3d_atomic_uint64_add(&device->pipeline_library_stats.cached_compile_count, 1, vkd3d_memory_order_relaxed);
+            vkd3d_pipeline_library_stats_add_time(&device->pipeline_library_stats.cached_compile_ns, begin_ts);
+        }
+        else
+        {
+            vkd3d_atomic_uint64_add(&device->pipeline_library_stats.uncached_compile_count, 1, vkd3d_memory_order_relaxed);
+            vkd3d_pipeline_library_stats_add_time(&device->pipeline_library_stats.uncached_compile_ns, begin_ts);
+        }
+    }
+
     if (FAILED(hr))
     {
         if (object->root_signature)
@@ -6542,6 +6607,9 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
         /* Set this explicitly so we avoid attempting to touch code[i] when serializing the PSO blob.
          * We are at risk of compiling code on the fly in some upcoming situations. */
         object->pso_is_loaded_from_cached_blob = true;
+
+        if (d3d12_pipeline_state_is_graphics(object) && !object->pso_is_fully_dynamic)
+            d3d12_pipeline_state_prewarm_pipeline_variants(object, desc_cached_pso);
     }
     else if (device->disk_cache.library)
     {
@@ -6562,57 +6630,343 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
 }
 
 static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, uint32_t *dynamic_state_flags)
+        const struct vkd3d_pipeline_key *key, uint32_t *dynamic_state_flags, bool *pending)
 {
     const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct vkd3d_compiled_pipeline *current;
-    VkPipeline vk_pipeline = VK_NULL_HANDLE;
+    const struct vkd3d_compiled_pipeline *compiled_pipeline;
+    VkPipeline vk_pipeline;
 
-    rwlock_lock_read(&state->lock);
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    /* This is called for every draw which needs a variant, so avoid taking state->lock here.
+     * Entries are never removed while the PSO is alive. */
+    if (!(compiled_pipeline = (const struct vkd3d_compiled_pipeline *)vkd3d_lockfree_hash_map_find(
+            &graphics->compiled_fallback_pipelines, key, vkd3d_pipeline_key_hash(key))))
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
-        {
-            vk_pipeline = current->vk_pipeline;
-            *dynamic_state_flags = current->dynamic_state_flags;
-            break;
-        }
+        *pending = false;
+        return VK_NULL_HANDLE;
     }
-    rwlock_unlock_read(&state->lock);
 
+    if ((vk_pipeline = vkd3d_compiled_pipeline_load(compiled_pipeline)))
+        *dynamic_state_flags = compiled_pipeline->dynamic_state_flags;
+
+    *pending = !vk_pipeline && vkd3d_atomic_uint32_load_explicit(
+            &compiled_pipeline->pending, vkd3d_memory_order_relaxed);
     return vk_pipeline;
 }
 
 static bool d3d12_pipeline_state_put_pipeline_to_cache(struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline, uint32_t dynamic_state_flags)
+        const struct vkd3d_pipeline_key *key, const struct vkd3d_format *dsv_format,
+        VkPipeline vk_pipeline, uint32_t dynamic_state_flags)
 {
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct vkd3d_compiled_pipeline *compiled_pipeline, *current;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+    uint32_t hash_value;
+    bool inserted;
 
     if (!(compiled_pipeline = vkd3d_malloc(sizeof(*compiled_pipeline))))
         return false;
 
+    hash_value = vkd3d_pipeline_key_hash(key);
+    compiled_pipeline->entry.hash_value = hash_value;
     compiled_pipeline->key = *key;
-    compiled_pipeline->vk_pipeline = vk_pipeline;
+    compiled_pipeline->dsv_format = dsv_format ? dsv_format->dxgi_format : DXGI_FORMAT_UNKNOWN;
     compiled_pipeline->dynamic_state_flags = dynamic_state_flags;
+    compiled_pipeline->vk_pipeline = vk_pipeline;
+    compiled_pipeline->pending = !vk_pipeline;
 
     rwlock_lock_write(&state->lock);
 
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    inserted = !vkd3d_lockfree_hash_map_find(&graphics->compiled_fallback_pipelines, key, hash_value) &&
+            vkd3d_lockfree_hash_map_insert_locked(&graphics->compiled_fallback_pipelines, &compiled_pipeline->entry);
+
+    rwlock_unlock_write(&state->lock);
+
+    if (!inserted)
+        vkd3d_free(compiled_pipeline);
+    return inserted;
+}
+
+static void d3d12_pipeline_state_resolve_pending_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline, uint32_t dynamic_state_flags)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+
+    /* Each pending variant is resolved by exactly one worker, so there is no writer to race against. */
+    compiled_pipeline = (struct vkd3d_compiled_pipeline *)vkd3d_lockfree_hash_map_find(
+            &graphics->compiled_fallback_pipelines, key, vkd3d_pipeline_key_hash(key));
+
+    assert(compiled_pipeline && !compiled_pipeline->vk_pipeline);
+    compiled_pipeline->dynamic_state_flags = dynamic_state_flags;
+    vkd3d_compiled_pipeline_store(compiled_pipeline, vk_pipeline);
+}
+
+static void d3d12_pipeline_state_abandon_pending_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+
+    compiled_pipeline = (struct vkd3d_compiled_pipeline *)vkd3d_lockfree_hash_map_find(
+            &graphics->compiled_fallback_pipelines, key, vkd3d_pipeline_key_hash(key));
+
+    assert(compiled_pipeline && !compiled_pipeline->vk_pipeline);
+    vkd3d_atomic_uint32_store_explicit(&compiled_pipeline->pending, 0, vkd3d_memory_order_relaxed);
+}
+
+static bool d3d12_pipeline_state_reclaim_abandoned_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+
+    if (!(compiled_pipeline = (struct vkd3d_compiled_pipeline *)vkd3d_lockfree_hash_map_find(
+            &graphics->compiled_fallback_pipelines, key, vkd3d_pipeline_key_hash(key))))
+        return false;
+
+    /* Only one thread gets to queue the variant again. */
+    return !vkd3d_compiled_pipeline_load(compiled_pipeline) &&
+            vkd3d_atomic_uint32_compare_exchange(&compiled_pipeline->pending, 0, 1,
+                    vkd3d_memory_order_relaxed, vkd3d_memory_order_relaxed) == 0;
+}
+
+static void d3d12_pipeline_state_queue_pipeline_variant(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, const struct vkd3d_format *dsv_format)
+{
+    struct vkd3d_pipeline_variant_queue *queue = &state->device->pipeline_variants;
+    struct vkd3d_pipeline_variant_job *job;
+    uint32_t dynamic_state_flags;
+    VkPipeline vk_pipeline;
+
+    /* The pending entry ensures that a variant is only queued once. Draws which need it
+     * are skipped until the worker thread has filled in the pipeline. */
+    if (!d3d12_pipeline_state_put_pipeline_to_cache(state, key, dsv_format, VK_NULL_HANDLE, 0) &&
+            !d3d12_pipeline_state_reclaim_abandoned_pipeline(state, key))
+        return;
+
+    d3d12_pipeline_state_inc_ref(state);
+
+    pthread_mutex_lock(&queue->mutex);
+
+    if (!vkd3d_array_reserve((void **)&queue->jobs, &queue->jobs_size,
+            queue->jobs_count + 1, sizeof(*queue->jobs)))
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
+        pthread_mutex_unlock(&queue->mutex);
+        d3d12_pipeline_state_dec_ref(state);
+
+        ERR("Failed to queue pipeline variant, compiling synchronously.\n");
+        if ((vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
+                key, dsv_format, VK_NULL_HANDLE, 0, &dynamic_state_flags)))
+            d3d12_pipeline_state_resolve_pending_pipeline(state, key, vk_pipeline, dynamic_state_flags);
+        else
+            d3d12_pipeline_state_abandon_pending_pipeline(state, key);
+        return;
+    }
+
+    job = &queue->jobs[queue->jobs_count++];
+    job->state = state;
+    job->key = *key;
+    job->dsv_format = dsv_format;
+
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void d3d12_pipeline_state_compile_pipeline_variant(const struct vkd3d_pipeline_variant_job *job)
+{
+    struct d3d12_pipeline_state *state = job->state;
+    uint32_t dynamic_state_flags;
+    VkPipeline vk_pipeline;
+
+    if (!(vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
+            &job->key, job->dsv_format, VK_NULL_HANDLE, 0, &dynamic_state_flags)))
+    {
+        ERR("Failed to create pipeline variant asynchronously.\n");
+        d3d12_pipeline_state_abandon_pending_pipeline(state, &job->key);
+        return;
+    }
+
+    d3d12_pipeline_state_resolve_pending_pipeline(state, &job->key, vk_pipeline, dynamic_state_flags);
+}
+
+static void *vkd3d_pipeline_variant_queue_run_thread(void *userdata)
+{
+    struct vkd3d_pipeline_variant_queue *queue = userdata;
+    struct vkd3d_pipeline_variant_job job;
+
+    vkd3d_set_thread_name("vkd3d-pso-async");
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->mutex);
+
+        while (!queue->jobs_count && !queue->should_exit)
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+
+        if (queue->should_exit)
         {
-            vkd3d_free(compiled_pipeline);
-            compiled_pipeline = NULL;
+            pthread_mutex_unlock(&queue->mutex);
             break;
         }
+
+        /* Most recently requested variants are likely the ones the application is about to draw with. */
+        job = queue->jobs[--queue->jobs_count];
+        pthread_mutex_unlock(&queue->mutex);
+
+        d3d12_pipeline_state_compile_pipeline_variant(&job);
+        d3d12_pipeline_state_dec_ref(job.state);
     }
 
-    if (compiled_pipeline)
-        list_add_tail(&graphics->compiled_fallback_pipelines, &compiled_pipeline->entry);
+    return NULL;
+}
 
-    rwlock_unlock_write(&state->lock);
-    return compiled_pipeline;
+void vkd3d_pipeline_variant_queue_cleanup(struct vkd3d_pipeline_variant_queue *queue)
+{
+    uint32_t i;
+    size_t j;
+
+    if (!queue->thread_count)
+        return;
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->should_exit = true;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+
+    for (i = 0; i < queue->thread_count; i++)
+        pthread_join(queue->threads[i], NULL);
+
+    /* Variants which never got compiled are simply dropped. */
+    for (j = 0; j < queue->jobs_count; j++)
+        d3d12_pipeline_state_dec_ref(queue->jobs[j].state);
+
+    vkd3d_free(queue->jobs);
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->mutex);
+}
+
+HRESULT vkd3d_pipeline_variant_queue_init(struct vkd3d_pipeline_variant_queue *queue)
+{
+    uint32_t thread_count;
+    int rc;
+
+    memset(queue, 0, sizeof(*queue));
+
+    if (!VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_ASYNC_FALLBACK))
+        return S_OK;
+
+    if ((rc = pthread_mutex_init(&queue->mutex, NULL)))
+        return hresult_from_errno(rc);
+
+    if ((rc = pthread_cond_init(&queue->cond, NULL)))
+    {
+        pthread_mutex_destroy(&queue->mutex);
+        return hresult_from_errno(rc);
+    }
+
+    /* Leave plenty of headroom for the application's own threads. */
+    thread_count = min(max(vkd3d_get_cpu_count() / 4, 1), VKD3D_MAX_PIPELINE_VARIANT_THREADS);
+
+    for (queue->thread_count = 0; queue->thread_count < thread_count; queue->thread_count++)
+    {
+        if ((rc = pthread_create(&queue->threads[queue->thread_count], NULL,
+                vkd3d_pipeline_variant_queue_run_thread, queue)))
+        {
+            ERR("Failed to create pipeline variant thread, rc %d.\n", rc);
+            break;
+        }
+    }
+
+    if (!queue->thread_count)
+    {
+        pthread_cond_destroy(&queue->cond);
+        pthread_mutex_destroy(&queue->mutex);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+struct d3d12_pipeline_state_variant_iter
+{
+    struct vkd3d_pipeline_variant_desc *variants;
+    uint32_t max_count;
+    uint32_t count;
+};
+
+static void d3d12_pipeline_state_get_pipeline_variant(struct vkd3d_lockfree_hash_map_entry *entry, void *userdata)
+{
+    const struct vkd3d_compiled_pipeline *compiled_pipeline = (const struct vkd3d_compiled_pipeline *)entry;
+    struct d3d12_pipeline_state_variant_iter *iter = userdata;
+
+    /* Pending variants are recorded as well, since they were needed all the same. */
+    if (iter->count < iter->max_count)
+    {
+        iter->variants[iter->count].key = compiled_pipeline->key;
+        iter->variants[iter->count].dsv_format = compiled_pipeline->dsv_format;
+        iter->count++;
+    }
+}
+
+uint32_t d3d12_pipeline_state_get_pipeline_variants(struct d3d12_pipeline_state *state,
+        struct vkd3d_pipeline_variant_desc *variants, uint32_t max_count)
+{
+    struct d3d12_pipeline_state_variant_iter iter;
+
+    iter.variants = variants;
+    iter.max_count = max_count;
+    iter.count = 0;
+
+    /* Inserts hold the writer lock, so this is enough to iterate safely. */
+    rwlock_lock_read(&state->lock);
+    vkd3d_lockfree_hash_map_iter(&state->graphics.compiled_fallback_pipelines,
+            d3d12_pipeline_state_get_pipeline_variant, &iter);
+    rwlock_unlock_read(&state->lock);
+
+    return iter.count;
+}
+
+static void d3d12_pipeline_state_prewarm_pipeline_variants(struct d3d12_pipeline_state *state,
+        const struct d3d12_cached_pipeline_state *cached_state)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    struct vkd3d_pipeline_variant_desc variants[VKD3D_MAX_SERIALIZED_PIPELINE_VARIANTS];
+    struct d3d12_device *device = state->device;
+    const struct vkd3d_format *dsv_format;
+    uint32_t dynamic_state_flags;
+    uint32_t count, i;
+    VkPipeline vk_pipeline;
+
+    count = vkd3d_get_cached_pipeline_variants_from_d3d12_desc(cached_state, variants, ARRAY_SIZE(variants));
+
+    for (i = 0; i < count; i++)
+    {
+        dsv_format = NULL;
+        if (variants[i].dsv_format != DXGI_FORMAT_UNKNOWN)
+            dsv_format = vkd3d_get_format(device, variants[i].dsv_format, true);
+
+        if ((dsv_format ? dsv_format->vk_format : VK_FORMAT_UNDEFINED) != variants[i].key.dsv_format)
+        {
+            WARN("DSV format %u of cached pipeline variant does not match, skipping.\n", variants[i].dsv_format);
+            continue;
+        }
+
+        if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_LIBRARY_LOG))
+            INFO("Pre-compiling pipeline variant %u for PSO %p.\n", i, state);
+
+        if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_ASYNC_FALLBACK))
+        {
+            d3d12_pipeline_state_queue_pipeline_variant(state, &variants[i].key, dsv_format);
+            continue;
+        }
+
+        if (!(vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
+                &variants[i].key, dsv_format, VK_NULL_HANDLE, 0, &dynamic_state_flags)))
+            continue;
+
+        if (!d3d12_pipeline_state_put_pipeline_to_cache(state, &variants[i].key, dsv_format,
+                vk_pipeline, dynamic_state_flags))
+            VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
+    }
 }
 
 static void d3d12_pipeline_state_log_graphics_state(const struct d3d12_pipeline_state *state)
@@ -7155,6 +7509,7 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     struct d3d12_device *device = state->device;
     struct vkd3d_pipeline_key pipeline_key;
     VkPipeline vk_pipeline;
+    bool pending;
 
     assert(d3d12_pipeline_state_is_graphics(state));
 
@@ -7182,11 +7537,23 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
               ? dyn_state->rasterization_samples : graphics->ms_desc.rasterizationSamples;
     }
 
-    if ((vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, dynamic_state_flags)))
+    if ((vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, dynamic_state_flags, &pending)))
     {
         return vk_pipeline;
     }
 
+    if (VKD3D_CONFIG_FLAG_IS_SET(PIPELINE_ASYNC_FALLBACK))
+    {
+        if (pending)
+            return VK_NULL_HANDLE;
+
+        /* Every member of the key is baked into the pipeline in a way which affects compatibility
+         * with the current render pass or draw, so there is no other variant we could substitute.
+         * Skip the draw instead of stalling the recording thread. */
+        d3d12_pipeline_state_queue_pipeline_variant(state, &pipeline_key, dsv_format);
+        return VK_NULL_HANDLE;
+    }
+
     FIXME("Compiling a fallback pipeline late!\n");
 
     vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
@@ -7198,12 +7565,12 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
         return VK_NULL_HANDLE;
     }
 
-    if (d3d12_pipeline_state_put_pipeline_to_cache(state, &pipeline_key, vk_pipeline, *dynamic_state_flags))
+    if (d3d12_pipeline_state_put_pipeline_to_cache(state, &pipeline_key, dsv_format, vk_pipeline, *dynamic_state_flags))
         return vk_pipeline;
 
     /* Other thread compiled the pipeline before us. */
     VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
-    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, dynamic_state_flags);
+    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, dynamic_state_flags, &pending);
     if (!vk_pipeline)
         ERR("Could not get the pipeline compiled by other thread from the cache.\n");
     return vk_pipeline;
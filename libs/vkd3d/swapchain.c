@@ -1124,6 +1124,7 @@ static HRESULT STDMETHODCALLTYPE dxgi_vk_swap_chain_Present(IDXGIVkSwapChain2 *i
     struct dxgi_vk_swap_chain_present_request *request;
     struct vkd3d_queue_timeline_trace_cookie cookie;
     bool low_latency_enable;
+    HRESULT hr;
 
     TRACE("iface %p, SyncInterval %u, PresentFlags #%x, pPresentParameters %p.\n",
             iface, SyncInterval, PresentFlags, pPresentParameters);
@@ -1213,7 +1214,12 @@ static HRESULT STDMETHODCALLTYPE dxgi_vk_swap_chain_Present(IDXGIVkSwapChain2 *i
     /* Need to process this task in queue thread to deal with wait-before-signal.
      * All interesting works happens in the callback. */
     chain->user.blit_count += 1;
-    d3d12_command_queue_enqueue_callback(chain->queue, dxgi_vk_swap_chain_present_callback, chain);
+    if (FAILED(hr = d3d12_command_queue_enqueue_callback(chain->queue, dxgi_vk_swap_chain_present_callback, chain)))
+    {
+        chain->user.blit_count -= 1;
+        chain->user.present_count -= 1;
+        return hr;
+    }
 
     chain->user.index = (chain->user.index + 1) % chain->desc.BufferCount;
 
@@ -868,6 +868,53 @@ static void vkd3d_cleanup_formats(struct d3d12_device *device)
     device->formats = NULL;
 }
 
+/* We use overrides for depth/stencil formats. This is required in order to
+ * properly support typeless formats because depth/stencil formats are only
+ * compatible with themselves in Vulkan.
+ * Which of the two tables to pick only depends on the DXGI format and whether
+ * a depth-stencil format is requested, so resolve that once for every format. */
+static HRESULT vkd3d_init_format_lookup(struct d3d12_device *device)
+{
+    const struct vkd3d_format *color_format, *depth_stencil_format;
+    const struct vkd3d_format **lookup;
+    unsigned int i;
+
+    if (!(lookup = vkd3d_calloc(2 * (VKD3D_MAX_DXGI_FORMAT + 1), sizeof(*lookup))))
+        return E_OUTOFMEMORY;
+
+    device->format_lookup[0] = lookup;
+    device->format_lookup[1] = lookup + VKD3D_MAX_DXGI_FORMAT + 1;
+
+    for (i = 0; i <= VKD3D_MAX_DXGI_FORMAT; i++)
+    {
+        color_format = device->formats[i].dxgi_format ? &device->formats[i] : NULL;
+        depth_stencil_format = device->depth_stencil_formats[i].dxgi_format ? &device->depth_stencil_formats[i] : NULL;
+
+        /* If we request a depth-stencil format (or typeless variant) that is planar,
+         * there cannot be any ambiguity which format to select, we must choose a depth-stencil format.
+         * For single aspect formats,
+         * there are cases where we need to choose either COLOR or DEPTH aspect variants based on depth_stencil argument,
+         * but there cannot be any such issue for DEPTH_STENCIL types.
+         * This fixes issues where e.g. R24_UNORM_X8_TYPELESS format is used without ALLOW_DEPTH_STENCIL. */
+        if (depth_stencil_format && depth_stencil_format->plane_count > 1)
+            device->format_lookup[0][i] = depth_stencil_format;
+        else
+            device->format_lookup[0][i] = color_format;
+
+        device->format_lookup[1][i] = depth_stencil_format ? depth_stencil_format : color_format;
+    }
+
+    return S_OK;
+}
+
+static void vkd3d_cleanup_format_lookup(struct d3d12_device *device)
+{
+    vkd3d_free((void *)device->format_lookup[0]);
+
+    device->format_lookup[0] = NULL;
+    device->format_lookup[1] = NULL;
+}
+
 HRESULT vkd3d_init_format_info(struct d3d12_device *device)
 {
     HRESULT hr;
@@ -885,6 +932,14 @@ HRESULT vkd3d_init_format_info(struct d3d12_device *device)
     {
         vkd3d_cleanup_depth_stencil_formats(device);
         vkd3d_cleanup_format_compatibility_lists(device);
+        return hr;
+    }
+
+    if (FAILED(hr = vkd3d_init_format_lookup(device)))
+    {
+        vkd3d_cleanup_depth_stencil_formats(device);
+        vkd3d_cleanup_format_compatibility_lists(device);
+        vkd3d_cleanup_formats(device);
     }
 
     return hr;
@@ -892,50 +947,27 @@ HRESULT vkd3d_init_format_info(struct d3d12_device *device)
 
 void vkd3d_cleanup_format_info(struct d3d12_device *device)
 {
+    vkd3d_cleanup_format_lookup(device);
     vkd3d_cleanup_depth_stencil_formats(device);
     vkd3d_cleanup_format_compatibility_lists(device);
     vkd3d_cleanup_formats(device);
 }
 
-/* We use overrides for depth/stencil formats. This is required in order to
- * properly support typeless formats because depth/stencil formats are only
- * compatible with themselves in Vulkan.
- */
-static const struct vkd3d_format *vkd3d_get_depth_stencil_format(const struct d3d12_device *device,
-        DXGI_FORMAT dxgi_format)
-{
-    const struct vkd3d_format *format;
-
-    assert(device);
-    format = &device->depth_stencil_formats[dxgi_format];
-
-    return format->dxgi_format ? format : NULL;
-}
-
 const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format, bool depth_stencil)
 {
     const struct vkd3d_format *format;
 
-    if (!is_valid_format(dxgi_format))
-    {
-        ERR("Invalid format %d.\n", dxgi_format);
-        return NULL;
-    }
+    assert(device);
 
-    /* If we request a depth-stencil format (or typeless variant) that is planar,
-     * there cannot be any ambiguity which format to select, we must choose a depth-stencil format.
-     * For single aspect formats,
-     * there are cases where we need to choose either COLOR or DEPTH aspect variants based on depth_stencil argument,
-     * but there cannot be any such issue for DEPTH_STENCIL types.
-     * This fixes issues where e.g. R24_UNORM_X8_TYPELESS format is used without ALLOW_DEPTH_STENCIL. */
-    format = vkd3d_get_depth_stencil_format(device, dxgi_format);
-    if (format && (depth_stencil || format->plane_count > 1))
+    if ((unsigned int)dxgi_format <= VKD3D_MAX_DXGI_FORMAT &&
+            (format = device->format_lookup[depth_stencil][dxgi_format]))
         return format;
 
-    format = &device->formats[dxgi_format];
+    if (!is_valid_format(dxgi_format))
+        ERR("Invalid format %d.\n", dxgi_format);
 
-    return format->dxgi_format ? format : NULL;
+    return NULL;
 }
 
 struct vkd3d_format_footprint vkd3d_format_footprint_for_plane(const struct vkd3d_format *format, unsigned int plane_idx)
@@ -969,39 +1001,37 @@ VkFormat vkd3d_internal_get_vk_format(const struct d3d12_device *device, DXGI_FO
 
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d)
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d, uint32_t copy_flags)
 {
-    unsigned int row_block_count, row_count, row_size, slice, row;
-    unsigned int slice_count = d;
-    const uint8_t *src_row;
-    uint8_t *dst_row;
+    unsigned int row_block_count, row_count, row_size;
 
     row_block_count = (w + format->block_width - 1) / format->block_width;
     row_count = (h + format->block_height - 1) / format->block_height;
     row_size = row_block_count * format->byte_count * format->block_byte_count;
 
-    for (slice = 0; slice < slice_count; ++slice)
-    {
-        for (row = 0; row < row_count; ++row)
-        {
-            src_row = &src[slice * src_slice_pitch + row * src_row_pitch];
-            dst_row = &dst[slice * dst_slice_pitch + row * dst_row_pitch];
-            memcpy(dst_row, src_row, row_size);
-        }
-    }
+    vkd3d_copy_rows(dst, dst_row_pitch, dst_slice_pitch, src, src_row_pitch, src_slice_pitch,
+            row_size, row_count, d, copy_flags);
 }
 
-VkFormat vkd3d_get_vk_format(DXGI_FORMAT format)
+static VkFormat vkd3d_vk_format_lookup[VKD3D_MAX_DXGI_FORMAT + 1];
+static pthread_once_t vkd3d_vk_format_lookup_once = PTHREAD_ONCE_INIT;
+
+static void vkd3d_init_vk_format_lookup_once(void)
 {
     unsigned int i;
 
-    for (i = 0; i < ARRAY_SIZE(vkd3d_formats); ++i)
-    {
-        if (vkd3d_formats[i].dxgi_format == format)
-            return vkd3d_formats[i].vk_format;
-    }
+    /* Iterate backwards so that the first entry for a format wins, as with a linear search. */
+    for (i = ARRAY_SIZE(vkd3d_formats); i; --i)
+        vkd3d_vk_format_lookup[vkd3d_formats[i - 1].dxgi_format] = vkd3d_formats[i - 1].vk_format;
+}
 
-    return VK_FORMAT_UNDEFINED;
+VkFormat vkd3d_get_vk_format(DXGI_FORMAT format)
+{
+    if ((unsigned int)format > VKD3D_MAX_DXGI_FORMAT)
+        return VK_FORMAT_UNDEFINED;
+
+    pthread_once(&vkd3d_vk_format_lookup_once, vkd3d_init_vk_format_lookup_once);
+    return vkd3d_vk_format_lookup[format];
 }
 
 /* Get some size-based low bits for memory prioritization in the same
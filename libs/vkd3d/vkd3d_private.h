@@ -26,6 +26,10 @@
 #include "vkd3d_memory.h"
 #include "vkd3d_utf8.h"
 #include "hashmap.h"
+#include "vkd3d_lockfree_hashmap.h"
+#include "vkd3d_lockfree_stack.h"
+#include "vkd3d_range_allocator.h"
+#include "vkd3d_min_heap.h"
 #include "list.h"
 #include "rbtree.h"
 
@@ -41,6 +45,7 @@
 #include "vkd3d_device_vkd3d_ext.h"
 #include "vkd3d_string.h"
 #include "vkd3d_file_utils.h"
+#include "vkd3d_shared_cache.h"
 #include "vkd3d_native_sync_handle.h"
 #include "config_flags.h"
 #include "copy_utils.h"
@@ -875,6 +880,7 @@ struct vkd3d_memory_allocation
     uint64_t clear_semaphore_value;
 
     struct vkd3d_memory_chunk *chunk;
+    uint32_t chunk_range;
 };
 
 static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation *dst,
@@ -889,18 +895,10 @@ static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation
         dst->cpu_address = void_ptr_offset(dst->cpu_address, offset);
 }
 
-struct vkd3d_memory_free_range
-{
-    VkDeviceSize offset;
-    VkDeviceSize length;
-};
-
 struct vkd3d_memory_chunk
 {
     struct vkd3d_memory_allocation allocation;
-    struct vkd3d_memory_free_range *free_ranges;
-    size_t free_ranges_size;
-    size_t free_ranges_count;
+    struct vkd3d_range_allocator ranges;
 };
 
 #define VKD3D_MEMORY_TRANSFER_COMMAND_BUFFER_COUNT (16u)
@@ -973,13 +971,19 @@ bool vkd3d_memory_transfer_queue_poll_allocation_idle(struct vkd3d_memory_transf
 bool vkd3d_memory_transfer_queue_clear_in_flight(struct vkd3d_memory_transfer_queue *queue,
         const struct vkd3d_memory_allocation *allocation);
 
-struct vkd3d_memory_allocator
+/* Chunks are grouped by memory type, so that allocations from different memory types
+ * do not contend on the same lock. */
+struct vkd3d_memory_chunk_list
 {
     pthread_mutex_t mutex;
-
     struct vkd3d_memory_chunk **chunks;
     size_t chunks_size;
     size_t chunks_count;
+};
+
+struct vkd3d_memory_allocator
+{
+    struct vkd3d_memory_chunk_list chunk_lists[VK_MAX_MEMORY_TYPES];
 
     struct vkd3d_va_map va_map;
 
@@ -1310,6 +1314,50 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         UINT num_castable_formats, const DXGI_FORMAT *castable_formats,
         D3D12_RESOURCE_ALLOCATION_INFO *allocation_info);
 
+/* Applications tend to query allocation info for the same handful of texture descs over and over,
+ * so memoize the result of vkd3d_get_image_allocation_info() per device.
+ * The map is split into stripes, each with its own lock, to keep resource creation threads apart. */
+#define VKD3D_IMAGE_ALLOCATION_INFO_CACHE_STRIPE_COUNT 16u
+#define VKD3D_IMAGE_ALLOCATION_INFO_CACHE_STRIPE_MAX_ENTRIES 1024u
+#define VKD3D_IMAGE_ALLOCATION_INFO_CACHE_MAX_CASTABLE_FORMATS 8u
+
+struct vkd3d_image_allocation_info_key
+{
+    uint64_t width;
+    uint64_t alignment;
+    uint32_t dimension;
+    uint32_t height;
+    uint32_t depth_or_array_size;
+    uint32_t mip_levels;
+    uint32_t format;
+    uint32_t sample_count;
+    uint32_t sample_quality;
+    uint32_t layout;
+    uint32_t flags;
+    uint32_t mip_region[3];
+    uint32_t castable_format_count;
+    uint32_t castable_formats[VKD3D_IMAGE_ALLOCATION_INFO_CACHE_MAX_CASTABLE_FORMATS];
+};
+
+struct vkd3d_image_allocation_info_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_image_allocation_info_key key;
+    D3D12_RESOURCE_ALLOCATION_INFO allocation_info;
+};
+
+struct vkd3d_image_allocation_info_cache
+{
+    struct
+    {
+        spinlock_t spinlock;
+        struct hash_map map;
+    } stripes[VKD3D_IMAGE_ALLOCATION_INFO_CACHE_STRIPE_COUNT];
+};
+
+void vkd3d_image_allocation_info_cache_init(struct vkd3d_image_allocation_info_cache *cache);
+void vkd3d_image_allocation_info_cache_cleanup(struct vkd3d_image_allocation_info_cache *cache);
+
 enum vkd3d_view_type
 {
     VKD3D_VIEW_TYPE_BUFFER,
@@ -1792,6 +1840,13 @@ static inline void d3d12_desc_copy_embedded_resource(vkd3d_cpu_descriptor_va_t d
     }
 }
 
+static inline void d3d12_desc_prefetch_embedded_resource(vkd3d_cpu_descriptor_va_t va)
+{
+    /* Only the payload is prefetched. Metadata is only touched for CPU -> CPU copies,
+     * where the source is in cached memory anyway. */
+    vkd3d_prefetch(d3d12_desc_decode_embedded_resource_va(va).payload);
+}
+
 static inline void d3d12_desc_copy_embedded_resource_single_32(vkd3d_cpu_descriptor_va_t dst_va,
         vkd3d_cpu_descriptor_va_t src_va)
 {
@@ -2351,7 +2406,7 @@ struct d3d12_graphics_pipeline_state
     VkPipeline library;
     VkGraphicsPipelineLibraryFlagsEXT library_flags;
     VkPipelineCreateFlags2 library_create_flags;
-    struct list compiled_fallback_pipelines;
+    struct vkd3d_lockfree_hash_map compiled_fallback_pipelines;
 
     unsigned int xfb_buffer_count;
 
@@ -2519,6 +2574,42 @@ struct vkd3d_pipeline_key
     bool dynamic_topology;
 };
 
+/* Fallback pipeline variant which was needed at draw time. The DXGI format is kept around
+ * so the variant can be recreated from a serialized PSO blob. */
+struct vkd3d_pipeline_variant_desc
+{
+    struct vkd3d_pipeline_key key;
+    DXGI_FORMAT dsv_format;
+};
+
+#define VKD3D_MAX_SERIALIZED_PIPELINE_VARIANTS 16
+
+struct vkd3d_pipeline_variant_job
+{
+    struct d3d12_pipeline_state *state;
+    struct vkd3d_pipeline_key key;
+    const struct vkd3d_format *dsv_format;
+};
+
+#define VKD3D_MAX_PIPELINE_VARIANT_THREADS 4
+
+/* Compiles fallback pipeline variants in the background with VKD3D_CONFIG=pipeline_async_fallback. */
+struct vkd3d_pipeline_variant_queue
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t threads[VKD3D_MAX_PIPELINE_VARIANT_THREADS];
+    uint32_t thread_count;
+
+    struct vkd3d_pipeline_variant_job *jobs;
+    size_t jobs_size;
+    size_t jobs_count;
+    bool should_exit;
+};
+
+HRESULT vkd3d_pipeline_variant_queue_init(struct vkd3d_pipeline_variant_queue *queue);
+void vkd3d_pipeline_variant_queue_cleanup(struct vkd3d_pipeline_variant_queue *queue);
+
 bool d3d12_pipeline_state_has_replaced_shaders(struct d3d12_pipeline_state *state);
 HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindPoint bind_point,
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state);
@@ -2531,6 +2622,8 @@ VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
 VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_state *state,
         const struct vkd3d_pipeline_key *key, const struct vkd3d_format *dsv_format,
         VkPipelineCache vk_cache, VkGraphicsPipelineLibraryFlagsEXT library_flags, uint32_t *dynamic_state_flags);
+uint32_t d3d12_pipeline_state_get_pipeline_variants(struct d3d12_pipeline_state *state,
+        struct vkd3d_pipeline_variant_desc *variants, uint32_t max_count);
 
 static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12PipelineState *iface)
 {
@@ -2544,9 +2637,41 @@ static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12P
 /* ID3D12PipelineLibrary */
 typedef ID3D12PipelineLibrary1 d3d12_pipeline_library_iface;
 
+/* Tiers of cached data a PSO can be created from. */
+enum vkd3d_pipeline_library_tier
+{
+    VKD3D_PIPELINE_LIBRARY_TIER_SPIRV = 0,
+    VKD3D_PIPELINE_LIBRARY_TIER_DRIVER_CACHE,
+    VKD3D_PIPELINE_LIBRARY_TIER_PIPELINE,
+    VKD3D_PIPELINE_LIBRARY_TIER_COUNT
+};
+
+struct vkd3d_pipeline_library_tier_stats
+{
+    uint64_t hit_count;
+    uint64_t miss_count;
+    uint64_t bytes_read;
+};
+
+/* Device-wide counters of how effective pipeline caching is.
+ * Updated with relaxed atomics from any thread, and reported on device destruction with PIPELINE_LIBRARY_LOG. */
+struct vkd3d_pipeline_library_stats
+{
+    struct vkd3d_pipeline_library_tier_stats tiers[VKD3D_PIPELINE_LIBRARY_TIER_COUNT];
+    uint64_t validate_ns;
+    uint64_t decode_ns;
+    uint64_t cached_compile_count;
+    uint64_t cached_compile_ns;
+    uint64_t uncached_compile_count;
+    uint64_t uncached_compile_ns;
+};
+
 struct vkd3d_pipeline_library_disk_cache_item
 {
     struct d3d12_pipeline_state *state;
+    /* If state is NULL, copies a blob which was only found in the shared cache to our own archive. */
+    uint64_t shared_hash;
+    uint32_t shared_type;
 };
 
 struct vkd3d_pipeline_library_disk_cache
@@ -2573,6 +2698,11 @@ struct vkd3d_pipeline_library_disk_cache
      * on demand. */
     FILE *stream_archive_write_file;
     bool stream_archive_attempted_write;
+
+    /* Optional cross-process index of every blob in the cache, see SHADER_CACHE_SHARED. */
+    struct vkd3d_shared_cache shared_cache;
+    /* The shared cache is tagged with our read archive, so blobs published before the tag are in it. */
+    bool shared_cache_tagged;
 };
 
 struct d3d12_pipeline_library
@@ -2602,6 +2732,20 @@ struct d3d12_pipeline_library
      * If we want to tear down device immediately after device creation (not too uncommon),
      * we can end up blocking for a long time. */
     uint32_t stream_archive_cancellation_point;
+    /* Read-only indexed archive backed by the disk cache mapping.
+     * Published once with release semantics and looked up without locks. */
+    const struct vkd3d_serialized_pipeline_library_indexed *indexed_archive;
+    size_t indexed_archive_size;
+    /* Two bits per index entry, VKD3D_INDEXED_ARCHIVE_ENTRY_*. Blobs are checksummed on first lookup. */
+    uint32_t *indexed_archive_entry_state;
+    /* Non-owned shared cache of the disk cache. Published once with release semantics.
+     * Other processes may publish to it at any time, but it is looked up without locks. */
+    const struct vkd3d_shared_cache *shared_cache;
+
+    /* SPIR-V de-duplication statistics, reported with PIPELINE_LIBRARY_LOG.
+     * Every serialized shader stage is a reference, but only the first one stores the module. */
+    uint32_t spirv_reference_count;
+    uint32_t spirv_unique_count;
 
     struct vkd3d_private_store private_store;
     struct d3d_destruction_notifier destruction_notifier;
@@ -2630,7 +2774,7 @@ VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
         size_t size, const void *data, VkPipelineCache *cache);
 HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state, VkPipelineCache *cache);
-HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
+HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state,
         VkShaderStageFlagBits stage,
         struct vkd3d_shader_code *spirv_code,
@@ -2641,6 +2785,8 @@ HRESULT d3d12_cached_pipeline_state_validate(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state,
         const struct vkd3d_pipeline_cache_compatibility *compat);
 bool d3d12_cached_pipeline_state_is_dummy(const struct d3d12_cached_pipeline_state *state);
+uint32_t vkd3d_get_cached_pipeline_variants_from_d3d12_desc(const struct d3d12_cached_pipeline_state *state,
+        struct vkd3d_pipeline_variant_desc *variants, uint32_t max_count);
 void vkd3d_pipeline_cache_compat_from_state_desc(struct vkd3d_pipeline_cache_compatibility *compat,
         const struct d3d12_pipeline_state_desc *desc);
 uint64_t vkd3d_pipeline_cache_compatibility_condense(const struct vkd3d_pipeline_cache_compatibility *compat);
@@ -2666,6 +2812,15 @@ HRESULT vkd3d_pipeline_library_init_disk_cache(struct vkd3d_pipeline_library_dis
 /* Called on device destroy. */
 void vkd3d_pipeline_library_flush_disk_cache(struct vkd3d_pipeline_library_disk_cache *cache);
 
+void vkd3d_pipeline_library_stats_record_lookup(struct vkd3d_pipeline_library_stats *stats,
+        enum vkd3d_pipeline_library_tier tier, bool hit, size_t size);
+void vkd3d_pipeline_library_stats_report(struct vkd3d_pipeline_library_stats *stats);
+
+static inline void vkd3d_pipeline_library_stats_add_time(uint64_t *counter, uint64_t begin_ts)
+{
+    vkd3d_atomic_uint64_add(counter, vkd3d_get_current_time_ns() - begin_ts, vkd3d_memory_order_relaxed);
+}
+
 struct vkd3d_buffer
 {
     VkBuffer vk_buffer;
@@ -2690,6 +2845,12 @@ struct d3d12_descriptor_pool_cache
 #define VKD3D_SCRATCH_BUFFER_COUNT_DEFAULT (32u)
 #define VKD3D_SCRATCH_BUFFER_COUNT_INDIRECT_PREPROCESS (128u)
 #define VKD3D_MAX_SCRATCH_BUFFER_COUNT (128u)
+#define VKD3D_SCRATCH_BUFFER_COUNT_LOW_BUDGET (4u)
+/* Command allocators hold on to this many bytes of scratch buffers per kind across Reset(). */
+#define VKD3D_SCRATCH_MAGAZINE_SIZE (4ull << 20)
+/* Upper bound on scratch bytes held in allocator magazines per kind across the whole device.
+ * Applications can create any number of allocators, so the magazines must not grow with them. */
+#define VKD3D_SCRATCH_MAGAZINE_DEVICE_BUDGET (32ull << 20)
 
 struct vkd3d_scratch_buffer
 {
@@ -2720,6 +2881,8 @@ struct d3d12_command_allocator_scratch_pool
     struct vkd3d_scratch_buffer *scratch_buffers;
     size_t scratch_buffers_size;
     size_t scratch_buffer_count;
+    /* Bytes reserved against the device magazine budget on the last Reset(). */
+    VkDeviceSize magazine_size;
 };
 
 enum vkd3d_scratch_pool_kind
@@ -3143,6 +3306,24 @@ struct d3d12_wbi_batch_state
     size_t batch_len;
 };
 
+/* Root parameter blocks for VKD3D_ROOT_SIGNATURE_USE_PUSH_CONSTANT_UNIFORM_BLOCK are linearly
+ * sub-allocated from chunks of UNIFORM_UPLOAD scratch memory, which grow with use. */
+#define VKD3D_ROOT_UNIFORM_UPLOAD_MIN_CHUNK_SIZE (4u * 1024u)
+#define VKD3D_ROOT_UNIFORM_UPLOAD_MAX_CHUNK_SIZE (64u * 1024u)
+
+struct d3d12_root_uniform_upload_state
+{
+    struct vkd3d_scratch_allocation chunk;
+    VkDeviceSize chunk_offset;
+    VkDeviceSize chunk_size;
+
+    /* Shadow copy of the last uploaded block, so that redundant uploads
+     * can be detected without reading back from uncached memory. */
+    struct vkd3d_scratch_allocation last_block;
+    uint32_t last_block_size;
+    uint32_t last_block_data[D3D12_MAX_ROOT_COST];
+};
+
 struct d3d12_rtas_batch_state
 {
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE build_type;
@@ -3499,6 +3680,7 @@ struct d3d12_command_list
 
     struct d3d12_transfer_batch_state transfer_batch;
     struct d3d12_wbi_batch_state wbi_batch;
+    struct d3d12_root_uniform_upload_state root_uniform_upload;
     struct d3d12_rtas_batch_state rtas_batch;
     struct vkd3d_queue_timeline_trace_cookie timeline_cookie;
 
@@ -3590,14 +3772,22 @@ static inline struct vkd3d_pipeline_bindings *d3d12_command_list_get_bindings(
 #define VKD3D_BUNDLE_CHUNK_SIZE (256 << 10)
 #define VKD3D_BUNDLE_COMMAND_ALIGNMENT (sizeof(UINT64))
 
+struct d3d12_bundle_chunk
+{
+    void *data;
+    size_t size;
+};
+
 struct d3d12_bundle_allocator
 {
     ID3D12CommandAllocator ID3D12CommandAllocator_iface;
     LONG refcount;
 
-    void **chunks;
+    /* Chunks are kept around on Reset() and are reused in order. */
+    struct d3d12_bundle_chunk *chunks;
     size_t chunks_size;
     size_t chunks_count;
+    size_t chunk_index;
     size_t chunk_offset;
 
     struct d3d12_bundle *current_bundle;
@@ -3612,9 +3802,29 @@ HRESULT d3d12_bundle_allocator_create(struct d3d12_device *device,
 
 typedef void (*pfn_d3d12_bundle_command)(d3d12_command_list_iface *command_list, const void *args);
 
+enum vkd3d_bundle_command_flag
+{
+    /* Dropped on Close(), skipped during replay. */
+    VKD3D_BUNDLE_COMMAND_REDUNDANT = (1u << 0),
+    /* Recording continues in the next chunk, see struct d3d12_bundle_jump_command. */
+    VKD3D_BUNDLE_COMMAND_JUMP = (1u << 1),
+};
+
+/* Bundles are recorded as a packed stream of variable-sized records in the allocator's chunks.
+ * Each record starts with this header, and the next record follows at size bytes.
+ * A record with size 0 terminates the stream. */
 struct d3d12_bundle_command
 {
     pfn_d3d12_bundle_command proc;
+    /* Identifies the piece of command list state the command overwrites, see d3d12_bundle_state_key(). */
+    uint64_t state_key;
+    uint32_t size;
+    uint32_t flags;
+};
+
+struct d3d12_bundle_jump_command
+{
+    struct d3d12_bundle_command command;
     struct d3d12_bundle_command *next;
 };
 
@@ -3628,7 +3838,6 @@ struct d3d12_bundle
     struct d3d12_device *device;
     struct d3d12_bundle_allocator *allocator;
     struct d3d12_bundle_command *head;
-    struct d3d12_bundle_command *tail;
 
     struct vkd3d_private_store private_store;
     struct d3d_destruction_notifier destruction_notifier;
@@ -3882,9 +4091,14 @@ struct d3d12_command_queue
     pthread_cond_t queue_cond;
     pthread_t submission_thread;
 
+    /* Ring buffer of pending submissions, consumed by the submission thread.
+     * submissions_size is always a power of two. */
     struct d3d12_command_queue_submission *submissions;
+    size_t submissions_head;
     size_t submissions_count;
     size_t submissions_size;
+    /* Number of STOP or DRAIN producers waiting for room after the ring failed to grow. */
+    uint32_t submission_space_waiters;
     uint64_t drain_count;
     uint64_t queue_drain_count;
 
@@ -3938,9 +4152,9 @@ HRESULT d3d12_command_queue_create(struct d3d12_device *device,
         const D3D12_COMMAND_QUEUE_DESC *desc, uint32_t vk_family_index, struct d3d12_command_queue **queue);
 void d3d12_command_queue_submit_stop(struct d3d12_command_queue *queue);
 void d3d12_command_queue_signal_inline(struct d3d12_command_queue *queue, d3d12_fence_iface *fence, uint64_t value);
-void d3d12_command_queue_enqueue_callback(struct d3d12_command_queue *queue, void (*callback)(void *), void *userdata);
-void d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
-                                               const struct d3d12_command_queue_submission *sub);
+HRESULT d3d12_command_queue_enqueue_callback(struct d3d12_command_queue *queue, void (*callback)(void *), void *userdata);
+HRESULT d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
+                                                  const struct d3d12_command_queue_submission *sub);
 
 struct vkd3d_execute_indirect_info
 {
@@ -5497,13 +5711,24 @@ typedef ID3D12DXVKInteropDevice3 d3d12_dxvk_interop_device_iface;
 /* ID3DLowLatencyDevice */
 typedef ID3DLowLatencyDevice d3d_low_latency_device_iface;
 
+/* Recycled scratch buffers live in fixed slots. Two lock-free stacks link the slots,
+ * one for slots holding a buffer and one for empty slots. Stack heads pack a slot index + 1
+ * in the low 32 bits with an ABA tag in the high 32 bits, and next_slot holds the links. */
 struct d3d12_device_scratch_pool
 {
     struct vkd3d_scratch_buffer scratch_buffers[VKD3D_MAX_SCRATCH_BUFFER_COUNT];
-    size_t scratch_buffer_count;
+    uint32_t next_slot[VKD3D_MAX_SCRATCH_BUFFER_COUNT];
+    UINT64 full_head;
+    UINT64 free_head;
+    /* Number of buffers in the full stack. Buffers beyond cache_limit are freed when returned.
+     * The limit drops to VKD3D_SCRATCH_BUFFER_COUNT_LOW_BUDGET while the memory heap is close to its budget. */
+    uint32_t scratch_buffer_count;
+    uint32_t cache_limit;
     size_t scratch_buffer_size;
     VkDeviceSize block_size;
-    unsigned int high_water_mark;
+    uint32_t high_water_mark;
+    /* Bytes held in command allocator magazines, bounded by VKD3D_SCRATCH_MAGAZINE_DEVICE_BUDGET. */
+    UINT64 magazine_size;
 };
 
 enum vkd3d_queue_timeline_trace_state_type
@@ -5555,9 +5780,10 @@ struct vkd3d_queue_timeline_trace_state
     uint64_t start_submit_ts;
     uint64_t record_end_ts;
     uint64_t record_cookie;
+    uint64_t merged_count;
     uint32_t overhead_start_offset;
     uint32_t overhead_end_offset;
-    char desc[128 - 6 * sizeof(uint64_t)];
+    char desc[128 - 7 * sizeof(uint64_t)];
 };
 
 struct vkd3d_queue_timeline_trace
@@ -5643,6 +5869,9 @@ void vkd3d_queue_timeline_trace_close_command_list(struct vkd3d_queue_timeline_t
         struct vkd3d_queue_timeline_trace_cookie cookie);
 void vkd3d_queue_timeline_trace_begin_execute(struct vkd3d_queue_timeline_trace *trace,
         struct vkd3d_queue_timeline_trace_cookie cookie);
+void vkd3d_queue_timeline_trace_merge_execute(struct vkd3d_queue_timeline_trace *trace,
+        struct vkd3d_queue_timeline_trace_cookie cookie,
+        struct vkd3d_queue_timeline_trace_cookie merged_cookie);
 void vkd3d_queue_timeline_trace_begin_execute_overhead(struct vkd3d_queue_timeline_trace *trace,
         struct vkd3d_queue_timeline_trace_cookie cookie);
 void vkd3d_queue_timeline_trace_end_execute_overhead(struct vkd3d_queue_timeline_trace *trace,
@@ -5813,6 +6042,7 @@ struct d3d12_device
     struct d3d12_caps d3d12_caps;
 
     struct vkd3d_memory_transfer_queue memory_transfers;
+    struct vkd3d_pipeline_variant_queue pipeline_variants;
     struct vkd3d_memory_allocator memory_allocator;
     struct vkd3d_null_rtas_allocation null_rtas_allocation;
 
@@ -5837,6 +6067,8 @@ struct d3d12_device
 
     const struct vkd3d_format *formats;
     const struct vkd3d_format *depth_stencil_formats;
+    /* Indexed by DXGI format, with and without a depth-stencil format requested. */
+    const struct vkd3d_format **format_lookup[2];
     unsigned int format_compatibility_list_count;
     const struct vkd3d_format_compatibility_list *format_compatibility_lists;
     struct vkd3d_bindless_state bindless_state;
@@ -5844,9 +6076,11 @@ struct d3d12_device
     struct vkd3d_memory_info memory_info;
     struct vkd3d_meta_ops meta_ops;
     struct vkd3d_sampler_view_map sampler_map;
+    struct vkd3d_image_allocation_info_cache allocation_info_cache;
     struct vkd3d_sampler_state sampler_state;
     struct vkd3d_shader_debug_ring debug_ring;
     struct vkd3d_pipeline_library_disk_cache disk_cache;
+    struct vkd3d_pipeline_library_stats pipeline_library_stats;
     struct vkd3d_global_descriptor_buffer global_descriptor_buffer;
     struct vkd3d_address_binding_tracker address_binding_tracker;
     rwlock_t vertex_input_lock;
@@ -5943,6 +6177,11 @@ HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, enum vkd3d_
         VkDeviceSize min_size, uint32_t memory_types, struct vkd3d_scratch_buffer *scratch);
 void d3d12_device_return_scratch_buffer(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
         const struct vkd3d_scratch_buffer *scratch);
+bool d3d12_device_scratch_pool_is_low_on_budget(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind);
+bool d3d12_device_scratch_pool_reserve_magazine(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
+        VkDeviceSize size);
+void d3d12_device_scratch_pool_release_magazine(struct d3d12_device *device, enum vkd3d_scratch_pool_kind kind,
+        VkDeviceSize size);
 
 HRESULT d3d12_device_get_query_pool(struct d3d12_device *device, uint32_t type_index, struct vkd3d_query_pool *pool);
 void d3d12_device_return_query_pool(struct d3d12_device *device, const struct vkd3d_query_pool *pool);
@@ -6623,7 +6862,7 @@ static inline bool vkd3d_format_is_compressed(const struct vkd3d_format *format)
 
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d);
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d, uint32_t copy_flags);
 
 const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format, bool depth_stencil);
@@ -0,0 +1,489 @@
+#!/usr/bin/env python3
+
+"""
+Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+"""
+
+"""
+Offline inspection, compaction and pruning of vkd3d-proton pipeline library archives.
+Understands the TOC format (ID3D12PipelineLibrary blobs) as well as the stream and indexed
+formats used for the internal disk cache. The layouts must match libs/vkd3d/cache.c.
+"""
+
+import sys
+import argparse
+import collections
+import struct
+
+def make_magic(a, b, c, d):
+    return ord(a) | (ord(b) << 8) | (ord(c) << 16) | (d << 24)
+
+VERSION_TOC = make_magic('V', 'K', 'L', 6)
+VERSION_STREAM = make_magic('V', 'K', 'S', 6)
+VERSION_INDEXED = make_magic('V', 'K', 'I', 6)
+CACHE_BLOB_VERSION = make_magic('V', 'K', 'B', 6)
+
+UUID_SIZE = 16
+BLOB_ALIGN = 8
+CHUNK_ALIGN = 8
+
+# struct vkd3d_serialized_pipeline_library_stream, prefix of every archive except TOC.
+ARCHIVE_HEADER = struct.Struct('=IIIIQQ16s')
+# struct vkd3d_serialized_pipeline_library_toc.
+TOC_HEADER = struct.Struct('=IIIIIIQQ16s')
+TOC_ENTRY = struct.Struct('=QII')
+# Entry counts following ARCHIVE_HEADER in struct vkd3d_serialized_pipeline_library_indexed.
+INDEXED_COUNTS = struct.Struct('=IIII')
+INDEX_ENTRY = struct.Struct('=QQQII')
+STREAM_ENTRY = struct.Struct('=QQII')
+# struct vkd3d_pipeline_blob, without the checksum.
+PIPELINE_BLOB_HEADER = struct.Struct('=IIIIQQ16s')
+BLOB_CHUNK = struct.Struct('=II')
+
+ENTRY_SPIRV = 0
+ENTRY_DRIVER_CACHE = 1
+ENTRY_PIPELINE = 2
+ENTRY_TYPES = (ENTRY_SPIRV, ENTRY_DRIVER_CACHE, ENTRY_PIPELINE)
+ENTRY_TYPE_NAMES = { ENTRY_SPIRV : 'SPIR-V', ENTRY_DRIVER_CACHE : 'Driver cache', ENTRY_PIPELINE : 'D3D12 PSO' }
+ENTRY_TYPE_ARGS = { 'spirv' : ENTRY_SPIRV, 'driver-cache' : ENTRY_DRIVER_CACHE, 'pipeline' : ENTRY_PIPELINE }
+
+CHUNK_TYPE_PIPELINE_CACHE_LINK = 2
+CHUNK_TYPE_VARINT_SPIRV_LINK = 3
+CHUNK_TYPE_MASK = 0xffff
+
+MASK64 = (1 << 64) - 1
+
+Entry = collections.namedtuple('Entry', 'type hash name data valid')
+Archive = collections.namedtuple('Archive', 'version header entries trailing_bytes')
+
+try:
+    import xxhash
+
+    def xxh64(data):
+        return xxhash.xxh64_intdigest(data)
+except ImportError:
+    XXH64_PRIME1 = 0x9e3779b185ebca87
+    XXH64_PRIME2 = 0xc2b2ae3d27d4eb4f
+    XXH64_PRIME3 = 0x165667b19e3779f9
+    XXH64_PRIME4 = 0x85ebca77c2b2ae63
+    XXH64_PRIME5 = 0x27d4eb2f165667c5
+
+    def rotl64(x, r):
+        return ((x << r) | (x >> (64 - r))) & MASK64
+
+    def xxh64_round(acc, lane):
+        acc = (acc + lane * XXH64_PRIME2) & MASK64
+        return (rotl64(acc, 31) * XXH64_PRIME1) & MASK64
+
+    def xxh64_merge_round(acc, val):
+        acc ^= xxh64_round(0, val)
+        return (acc * XXH64_PRIME1 + XXH64_PRIME4) & MASK64
+
+    # Slow, but only needed when the xxhash module is not installed.
+    def xxh64(data):
+        size = len(data)
+        offset = 0
+
+        if size >= 32:
+            v1 = (XXH64_PRIME1 + XXH64_PRIME2) & MASK64
+            v2 = XXH64_PRIME2
+            v3 = 0
+            v4 = (-XXH64_PRIME1) & MASK64
+            offset = size & ~31
+            for a, b, c, d in struct.iter_unpack('<4Q', data[0 : offset]):
+                v1 = xxh64_round(v1, a)
+                v2 = xxh64_round(v2, b)
+                v3 = xxh64_round(v3, c)
+                v4 = xxh64_round(v4, d)
+            h = (rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18)) & MASK64
+            for v in (v1, v2, v3, v4):
+                h = xxh64_merge_round(h, v)
+        else:
+            h = XXH64_PRIME5
+
+        h = (h + size) & MASK64
+
+        while offset + 8 <= size:
+            h ^= xxh64_round(0, struct.unpack_from('<Q', data, offset)[0])
+            h = (rotl64(h, 27) * XXH64_PRIME1 + XXH64_PRIME4) & MASK64
+            offset += 8
+
+        if offset + 4 <= size:
+            h ^= (struct.unpack_from('<I', data, offset)[0] * XXH64_PRIME1) & MASK64
+            h = (rotl64(h, 23) * XXH64_PRIME2 + XXH64_PRIME3) & MASK64
+            offset += 4
+
+        while offset < size:
+            h ^= (data[offset] * XXH64_PRIME5) & MASK64
+            h = (rotl64(h, 11) * XXH64_PRIME1) & MASK64
+            offset += 1
+
+        h ^= h >> 33
+        h = (h * XXH64_PRIME2) & MASK64
+        h ^= h >> 29
+        h = (h * XXH64_PRIME3) & MASK64
+        h ^= h >> 32
+        return h
+
+
+def fnv1_iterate_u32(h, value):
+    return ((h * 0x100000001b3) & MASK64) ^ value
+
+
+def stream_entry_checksum(entry_hash, entry_type, data):
+    # vkd3d_serialized_pipeline_stream_entry_compute_checksum().
+    h = xxh64(data)
+    h = fnv1_iterate_u32(h, entry_hash & 0xffffffff)
+    h = fnv1_iterate_u32(h, entry_hash >> 32)
+    h = fnv1_iterate_u32(h, len(data))
+    h = fnv1_iterate_u32(h, entry_type)
+    return h
+
+
+def blob_data_checksum(data):
+    # vkd3d_pipeline_blob_compute_data_checksum(), i.e. hash_uint64() of the shader hash.
+    h = xxh64(data)
+    lo = h & 0xffffffff
+    hi = h >> 32
+    return (lo ^ (hi + 0x9e3779b9 + (lo << 6) + (lo >> 2))) & 0xffffffff
+
+
+def align(value, alignment):
+    return (value + alignment - 1) & ~(alignment - 1)
+
+
+def parse_stream(data):
+    entries = []
+    offset = ARCHIVE_HEADER.size
+
+    while offset + STREAM_ENTRY.size <= len(data):
+        entry_hash, checksum, size, entry_type = STREAM_ENTRY.unpack_from(data, offset)
+        blob_offset = offset + STREAM_ENTRY.size
+        # A torn write at the end of the archive is expected if a process was killed while writing.
+        if blob_offset + size > len(data):
+            break
+        blob = data[blob_offset : blob_offset + size]
+        valid = entry_type in ENTRY_TYPES and stream_entry_checksum(entry_hash, entry_type, blob) == checksum
+        entries.append(Entry(type = entry_type, hash = entry_hash, name = None, data = blob, valid = valid))
+        offset = blob_offset + align(size, BLOB_ALIGN)
+
+    return entries, max(len(data) - offset, 0)
+
+
+def parse_indexed(data):
+    if len(data) < ARCHIVE_HEADER.size + INDEXED_COUNTS.size:
+        raise ValueError('Indexed archive header is truncated.')
+
+    counts = INDEXED_COUNTS.unpack_from(data, ARCHIVE_HEADER.size)
+    total = counts[0] + counts[1] + counts[2]
+    offset = ARCHIVE_HEADER.size + INDEXED_COUNTS.size
+
+    if offset + total * INDEX_ENTRY.size > len(data):
+        raise ValueError('Index table of {} entries is truncated.'.format(total))
+
+    entries = []
+    for i in range(total):
+        entry_hash, checksum, blob_offset, size, entry_type = INDEX_ENTRY.unpack_from(data, offset + i * INDEX_ENTRY.size)
+        if blob_offset + size > len(data):
+            entries.append(Entry(type = entry_type, hash = entry_hash, name = None, data = b'', valid = False))
+            continue
+        blob = data[blob_offset : blob_offset + size]
+        valid = entry_type in ENTRY_TYPES and stream_entry_checksum(entry_hash, entry_type, blob) == checksum
+        entries.append(Entry(type = entry_type, hash = entry_hash, name = None, data = blob, valid = valid))
+
+    return entries, 0
+
+
+def toc_blob_valid(entry_type, blob):
+    if entry_type == ENTRY_PIPELINE:
+        if len(blob) < PIPELINE_BLOB_HEADER.size:
+            return False
+        version, _, _, checksum = struct.unpack_from('=IIII', blob, 0)
+        return version == CACHE_BLOB_VERSION and blob_data_checksum(blob[PIPELINE_BLOB_HEADER.size:]) == checksum
+    else:
+        # struct vkd3d_pipeline_blob_internal.
+        if len(blob) < 4:
+            return False
+        return blob_data_checksum(blob[4:]) == struct.unpack_from('=I', blob, 0)[0]
+
+
+def parse_toc(data):
+    if len(data) < TOC_HEADER.size:
+        raise ValueError('TOC header is truncated.')
+
+    counts = struct.unpack_from('=III', data, 12)
+    total = counts[0] + counts[1] + counts[2]
+    base = TOC_HEADER.size + total * TOC_ENTRY.size
+
+    if base > len(data):
+        raise ValueError('TOC of {} entries is truncated.'.format(total))
+
+    entries = []
+    name_offset = base
+    index = 0
+
+    for entry_type, count in zip(ENTRY_TYPES, counts):
+        for i in range(count):
+            blob_offset, name_length, blob_length = TOC_ENTRY.unpack_from(data, TOC_HEADER.size + index * TOC_ENTRY.size)
+            index += 1
+
+            # Names are tightly packed. A length of 0 means the key is a u64 hash.
+            if name_length:
+                name = data[name_offset : name_offset + name_length].decode('utf-16-le', errors = 'replace')
+                entry_hash = 0
+                name_offset += name_length
+            else:
+                name = None
+                entry_hash = struct.unpack_from('=Q', data, name_offset)[0] if name_offset + 8 <= len(data) else 0
+                name_offset += 8
+
+            if base + blob_offset + blob_length > len(data):
+                entries.append(Entry(type = entry_type, hash = entry_hash, name = name, data = b'', valid = False))
+                continue
+
+            blob = data[base + blob_offset : base + blob_offset + blob_length]
+            entries.append(Entry(type = entry_type, hash = entry_hash, name = name, data = blob,
+                                 valid = toc_blob_valid(entry_type, blob)))
+
+    return entries, 0
+
+
+def parse_archive(data):
+    if len(data) < 4:
+        raise ValueError('File is too small to be an archive.')
+
+    version = struct.unpack_from('=I', data, 0)[0]
+
+    if version == VERSION_TOC:
+        entries, trailing_bytes = parse_toc(data)
+        header = data[0 : TOC_HEADER.size]
+    elif version == VERSION_STREAM:
+        if len(data) < ARCHIVE_HEADER.size:
+            raise ValueError('Stream archive header is truncated.')
+        entries, trailing_bytes = parse_stream(data)
+        header = data[0 : ARCHIVE_HEADER.size]
+    elif version == VERSION_INDEXED:
+        entries, trailing_bytes = parse_indexed(data)
+        header = data[0 : ARCHIVE_HEADER.size]
+    else:
+        raise ValueError('Unrecognized archive version 0x{:08x}.'.format(version))
+
+    return Archive(version = version, header = header, entries = entries, trailing_bytes = trailing_bytes)
+
+
+def pipeline_links(blob):
+    # Yields (entry type, hash) for every SPIR-V and driver cache link in a struct vkd3d_pipeline_blob.
+    offset = PIPELINE_BLOB_HEADER.size
+    while offset + BLOB_CHUNK.size <= len(blob):
+        chunk_type, chunk_size = BLOB_CHUNK.unpack_from(blob, offset)
+        data_offset = offset + BLOB_CHUNK.size
+        if data_offset + chunk_size > len(blob):
+            break
+
+        if chunk_size >= 8:
+            chunk_type &= CHUNK_TYPE_MASK
+            if chunk_type == CHUNK_TYPE_VARINT_SPIRV_LINK:
+                yield ENTRY_SPIRV, struct.unpack_from('=Q', blob, data_offset)[0]
+            elif chunk_type == CHUNK_TYPE_PIPELINE_CACHE_LINK:
+                yield ENTRY_DRIVER_CACHE, struct.unpack_from('=Q', blob, data_offset)[0]
+
+        offset = data_offset + align(chunk_size, CHUNK_ALIGN)
+
+
+def entry_key(entry):
+    return (entry.type, entry.name if entry.name is not None else entry.hash)
+
+
+def find_referenced(entries):
+    referenced = set()
+    for entry in entries:
+        if entry.type == ENTRY_PIPELINE and entry.valid:
+            referenced.update(pipeline_links(entry.data))
+    return referenced
+
+
+def format_name(version):
+    return { VERSION_TOC : 'TOC', VERSION_STREAM : 'stream', VERSION_INDEXED : 'indexed' }[version]
+
+
+def print_header(archive):
+    if archive.version == VERSION_TOC:
+        version, vendor_id, device_id, _, _, _, build, interface_key, uuid = TOC_HEADER.unpack(archive.header)
+    else:
+        version, vendor_id, device_id, _, build, interface_key, uuid = ARCHIVE_HEADER.unpack(archive.header)
+
+    print('Format: {} (version 0x{:08x})'.format(format_name(version), version))
+    print('Vendor ID: 0x{:04x}, Device ID: 0x{:04x}'.format(vendor_id, device_id))
+    print('vkd3d-proton build: {:016x}'.format(build))
+    print('Shader interface key: {:016x}'.format(interface_key))
+    print('Cache UUID: {}'.format(uuid.hex()))
+
+
+def print_report(archive, verbose):
+    print_header(archive)
+
+    referenced = find_referenced(archive.entries)
+    seen = set()
+    present = set()
+    stats = { t : collections.Counter() for t in ENTRY_TYPES }
+
+    for entry in archive.entries:
+        if entry.type not in stats:
+            stats[entry.type] = collections.Counter()
+        s = stats[entry.type]
+        key = entry_key(entry)
+
+        s['count'] += 1
+        s['bytes'] += len(entry.data)
+
+        if not entry.valid:
+            s['invalid'] += 1
+        elif key in seen:
+            s['duplicate'] += 1
+            s['duplicate_bytes'] += len(entry.data)
+        else:
+            seen.add(key)
+            present.add((entry.type, entry.hash))
+            if entry.type != ENTRY_PIPELINE and (entry.type, entry.hash) not in referenced:
+                s['unreferenced'] += 1
+                s['unreferenced_bytes'] += len(entry.data)
+
+        if verbose:
+            print('  {:<12} {:016x} {:>10} bytes{}{}'.format(ENTRY_TYPE_NAMES.get(entry.type, str(entry.type)),
+                  entry.hash, len(entry.data), ' ' + entry.name if entry.name else '',
+                  '' if entry.valid else ' [INVALID]'))
+
+    print()
+    print('{:<14} {:>9} {:>14} {:>12} {:>11} {:>9} {:>13}'.format(
+          'Type', 'Entries', 'Bytes', 'Avg bytes', 'Duplicates', 'Invalid', 'Unreferenced'))
+
+    total = collections.Counter()
+    for entry_type, s in sorted(stats.items()):
+        total.update(s)
+        print('{:<14} {:>9} {:>14} {:>12.1f} {:>11} {:>9} {:>13}'.format(
+              ENTRY_TYPE_NAMES.get(entry_type, 'Unknown ({})'.format(entry_type)),
+              s['count'], s['bytes'], s['bytes'] / s['count'] if s['count'] else 0.0,
+              s['duplicate'], s['invalid'], s['unreferenced'] if entry_type != ENTRY_PIPELINE else '-'))
+
+    print('{:<14} {:>9} {:>14} {:>12.1f} {:>11} {:>9} {:>13}'.format(
+          'Total', total['count'], total['bytes'], total['bytes'] / total['count'] if total['count'] else 0.0,
+          total['duplicate'], total['invalid'], total['unreferenced']))
+
+    print()
+    if total['count']:
+        print('Duplicate ratio: {:.2f} % of entries, {:.2f} % of bytes.'.format(
+              100.0 * total['duplicate'] / total['count'],
+              100.0 * total['duplicate_bytes'] / total['bytes'] if total['bytes'] else 0.0))
+    print('Unreferenced bytes (prunable): {}'.format(total['unreferenced_bytes']))
+    print('Missing link targets: {}'.format(len(referenced - present)))
+    if archive.trailing_bytes:
+        print('Truncated tail: {} bytes'.format(archive.trailing_bytes))
+
+
+def compact_entries(archive, prune, drop_types):
+    # Keeps the first valid instance of every entry, in archive order.
+    seen = set()
+    entries = []
+    for entry in archive.entries:
+        key = entry_key(entry)
+        if entry.valid and entry.type not in drop_types and key not in seen:
+            seen.add(key)
+            entries.append(entry)
+
+    if prune:
+        referenced = find_referenced(entries)
+        entries = [e for e in entries if e.type == ENTRY_PIPELINE or (e.type, e.hash) in referenced]
+
+    return entries
+
+
+def write_stream(f, header, entries):
+    f.write(struct.pack('=I', VERSION_STREAM) + header[4 : ARCHIVE_HEADER.size])
+    for entry in entries:
+        f.write(STREAM_ENTRY.pack(entry.hash, stream_entry_checksum(entry.hash, entry.type, entry.data),
+                                  len(entry.data), entry.type))
+        f.write(entry.data)
+        f.write(bytes(align(len(entry.data), BLOB_ALIGN) - len(entry.data)))
+
+
+def write_indexed(f, header, entries):
+    # Grouped by type in TOC order and sorted by hash, so that the index can be binary searched.
+    entries = sorted(entries, key = lambda e: (e.type, e.hash))
+    counts = [sum(1 for e in entries if e.type == t) for t in ENTRY_TYPES]
+
+    f.write(struct.pack('=I', VERSION_INDEXED) + header[4 : ARCHIVE_HEADER.size])
+    f.write(INDEXED_COUNTS.pack(counts[0], counts[1], counts[2], 0))
+
+    blob_offset = ARCHIVE_HEADER.size + INDEXED_COUNTS.size + len(entries) * INDEX_ENTRY.size
+    for entry in entries:
+        f.write(INDEX_ENTRY.pack(entry.hash, stream_entry_checksum(entry.hash, entry.type, entry.data),
+                                 blob_offset, len(entry.data), entry.type))
+        blob_offset += align(len(entry.data), BLOB_ALIGN)
+
+    for entry in entries:
+        f.write(entry.data)
+        f.write(bytes(align(len(entry.data), BLOB_ALIGN) - len(entry.data)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description = 'Inspect, compact and prune vkd3d-proton pipeline library archives.')
+    parser.add_argument('archive', help = 'TOC, stream or indexed archive, e.g. vkd3d-proton.cache.')
+    parser.add_argument('--verbose', action = 'store_true', help = 'List every entry.')
+    parser.add_argument('--output', type = str, help = 'Write a compacted archive without duplicate and invalid entries.')
+    parser.add_argument('--prune', action = 'store_true',
+                        help = 'When compacting, also drop SPIR-V and driver cache entries no pipeline refers to.')
+    parser.add_argument('--drop-type', action = 'append', default = [], choices = sorted(ENTRY_TYPE_ARGS.keys()),
+                        help = 'When compacting, drop all entries of this type. Can be used multiple times.')
+    parser.add_argument('--format', choices = ['stream', 'indexed'],
+                        help = 'Format of the compacted archive. Defaults to the input format.')
+    args = parser.parse_args()
+
+    try:
+        with open(args.archive, 'rb') as f:
+            data = f.read()
+        archive = parse_archive(data)
+    except (OSError, ValueError) as e:
+        print('Failed to read {}: {}'.format(args.archive, e), file = sys.stderr)
+        return 1
+
+    print('Archive: {} ({} bytes)'.format(args.archive, len(data)))
+    print_report(archive, args.verbose)
+
+    if args.output:
+        if archive.version == VERSION_TOC:
+            print('TOC archives are owned by the application and cannot be compacted.', file = sys.stderr)
+            return 1
+
+        entries = compact_entries(archive, args.prune, set(ENTRY_TYPE_ARGS[t] for t in args.drop_type))
+        output_format = args.format if args.format else format_name(archive.version)
+
+        with open(args.output, 'wb') as f:
+            if output_format == 'indexed':
+                write_indexed(f, archive.header, entries)
+            else:
+                write_stream(f, archive.header, entries)
+            size = f.tell()
+
+        print()
+        print('Wrote {} {} entries to {} ({} bytes, {:.2f} % of input).'.format(
+              len(entries), output_format, args.output, size, 100.0 * size / len(data)))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -19,12 +19,16 @@
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
 #include "vkd3d_common.h"
+#include "vkd3d_atomic.h"
+#include "vkd3d_platform.h"
+#include "vkd3d_threads.h"
 #include "vkd3d_shader.h"
 
 static bool read_shader(struct vkd3d_shader_code *shader, const char *filename)
@@ -79,7 +83,11 @@ static bool write_shader(const struct vkd3d_shader_code *shader, const char *fil
     }
 
     if (fwrite(shader->code, 1, shader->size, fd) != shader->size)
+    {
         fprintf(stderr, "Could not write shader bytecode to file: '%s'.\n", filename);
+        fclose(fd);
+        return false;
+    }
 
     fclose(fd);
     return true;
@@ -103,6 +111,10 @@ static void print_usage(const char *program_name)
     for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
         fprintf(stderr, " [%s]", compiler_options[i].name);
     fprintf(stderr, " [-o <out_spirv_filename>] <dxbc_filename>\n");
+    fprintf(stderr, "       %s", program_name);
+    for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
+        fprintf(stderr, " [%s]", compiler_options[i].name);
+    fprintf(stderr, " [-j <thread_count>] --batch <out_spirv_directory> <dxbc_filename>...\n");
 }
 
 struct options
@@ -110,6 +122,12 @@ struct options
     const char *filename;
     const char *output_filename;
     unsigned int compiler_options;
+
+    /* Batch mode, compiles many shaders to loose SPIR-V modules. */
+    const char *batch_directory;
+    char **batch_filenames;
+    unsigned int batch_filename_count;
+    unsigned int thread_count;
 };
 
 static bool parse_command_line(int argc, char **argv, struct options *options)
@@ -122,16 +140,32 @@ static bool parse_command_line(int argc, char **argv, struct options *options)
 
     memset(options, 0, sizeof(*options));
 
-    for (i = 1; i < argc - 1; ++i)
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i)
     {
         if (!strcmp(argv[i], "-o"))
         {
-            if (i + 1 >= argc - 1)
+            if (i + 1 >= argc)
                 return false;
             options->output_filename = argv[++i];
             continue;
         }
 
+        if (!strcmp(argv[i], "--batch"))
+        {
+            if (i + 1 >= argc)
+                return false;
+            options->batch_directory = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "-j"))
+        {
+            if (i + 1 >= argc)
+                return false;
+            options->thread_count = strtoul(argv[++i], NULL, 0);
+            continue;
+        }
+
         for (j = 0; j < ARRAY_SIZE(compiler_options); ++j)
         {
             if (!strcmp(argv[i], compiler_options[j].name))
@@ -144,10 +178,165 @@ static bool parse_command_line(int argc, char **argv, struct options *options)
             return false;
     }
 
-    options->filename = argv[argc - 1];
+    if (options->batch_directory)
+    {
+        if (i >= argc || options->output_filename)
+            return false;
+        options->batch_filenames = &argv[i];
+        options->batch_filename_count = argc - i;
+        return true;
+    }
+
+    if (i != argc - 1)
+        return false;
+
+    options->filename = argv[i];
     return true;
 }
 
+enum batch_result
+{
+    BATCH_RESULT_SUCCESS = 0,
+    BATCH_RESULT_READ_FAILED,
+    BATCH_RESULT_COMPILE_FAILED,
+    BATCH_RESULT_WRITE_FAILED,
+};
+
+struct batch_job
+{
+    const char *filename;
+    enum batch_result result;
+    size_t input_size;
+    size_t output_size;
+};
+
+struct batch_state
+{
+    const struct options *options;
+    struct batch_job *jobs;
+    uint32_t job_count;
+    uint32_t next_job;
+};
+
+static enum batch_result batch_compile_shader(const struct options *options, struct batch_job *job)
+{
+    struct vkd3d_shader_code dxbc, spirv;
+    char path[VKD3D_PATH_MAX];
+    vkd3d_shader_hash_t hash;
+    HRESULT hr;
+    bool ret;
+
+    if (!read_shader(&dxbc, job->filename))
+        return BATCH_RESULT_READ_FAILED;
+
+    job->input_size = dxbc.size;
+    hash = vkd3d_shader_hash_legacy(&dxbc);
+
+    /* Handles both DXBC and DXIL containers. */
+    hr = vkd3d_shader_compile_dxbc(&dxbc, &spirv, NULL, options->compiler_options, NULL, NULL);
+    vkd3d_shader_free_shader_code(&dxbc);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "Failed to compile shader '%s', hr %#x.\n", job->filename, (int)hr);
+        return BATCH_RESULT_COMPILE_FAILED;
+    }
+
+    /* Use the same <hash>.spv naming as VKD3D_SHADER_DUMP_PATH, so outputs can be matched up with
+     * runtime dumps. Without a root signature the bindings do not match what the runtime generates,
+     * so these modules are not usable as VKD3D_SHADER_OVERRIDE replacements.
+     * Duplicate inputs collapse into one file. */
+    snprintf(path, sizeof(path), "%s/%016"PRIx64".spv", options->batch_directory, hash);
+    job->output_size = spirv.size;
+    ret = write_shader(&spirv, path);
+    vkd3d_shader_free_shader_code(&spirv);
+
+    return ret ? BATCH_RESULT_SUCCESS : BATCH_RESULT_WRITE_FAILED;
+}
+
+static void *batch_thread_main(void *userdata)
+{
+    struct batch_state *state = userdata;
+    uint32_t index;
+
+    /* Shader sizes vary wildly, so pull jobs one at a time rather than splitting the list up front. */
+    while ((index = vkd3d_atomic_uint32_increment(&state->next_job, vkd3d_memory_order_relaxed) - 1) < state->job_count)
+        state->jobs[index].result = batch_compile_shader(state->options, &state->jobs[index]);
+
+    return NULL;
+}
+
+static int run_batch(const struct options *options)
+{
+    uint64_t input_size = 0, output_size = 0;
+    unsigned int thread_count, i, failures;
+    struct batch_state state;
+    uint64_t begin_ts, end_ts;
+    pthread_t *threads;
+
+    memset(&state, 0, sizeof(state));
+    state.options = options;
+    state.job_count = options->batch_filename_count;
+
+    if (!(state.jobs = calloc(state.job_count, sizeof(*state.jobs))))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    for (i = 0; i < state.job_count; i++)
+        state.jobs[i].filename = options->batch_filenames[i];
+
+    thread_count = options->thread_count ? options->thread_count : vkd3d_get_cpu_count();
+    thread_count = max(1u, min(thread_count, state.job_count));
+
+    if (!(threads = calloc(thread_count, sizeof(*threads))))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        free(state.jobs);
+        return 1;
+    }
+
+    begin_ts = vkd3d_get_current_time_ns();
+
+    /* The calling thread participates as well. */
+    for (i = 1; i < thread_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, batch_thread_main, &state))
+        {
+            fprintf(stderr, "Failed to create thread, continuing with %u threads.\n", i);
+            thread_count = i;
+            break;
+        }
+    }
+
+    batch_thread_main(&state);
+
+    for (i = 1; i < thread_count; i++)
+        pthread_join(threads[i], NULL);
+
+    end_ts = vkd3d_get_current_time_ns();
+
+    for (i = 0, failures = 0; i < state.job_count; i++)
+    {
+        if (state.jobs[i].result != BATCH_RESULT_SUCCESS)
+        {
+            failures++;
+            continue;
+        }
+
+        input_size += state.jobs[i].input_size;
+        output_size += state.jobs[i].output_size;
+    }
+
+    printf("Compiled %u / %u shaders on %u threads in %.3f ms (%"PRIu64" bytes in, %"PRIu64" bytes SPIR-V out).\n",
+            state.job_count - failures, state.job_count, thread_count,
+            1e-6 * (double)(end_ts - begin_ts), input_size, output_size);
+
+    free(threads);
+    free(state.jobs);
+    return failures ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
     struct vkd3d_shader_code dxbc, spirv;
@@ -160,6 +349,9 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (options.batch_directory)
+        return run_batch(&options);
+
     if (!read_shader(&dxbc, options.filename))
     {
         fprintf(stderr, "Failed to read DXBC shader.\n");
@@ -28,7 +28,11 @@ import argparse
 import collections
 import struct
 
-ProfileCase = collections.namedtuple('ProfileCase', 'name iterations ticks')
+ProfileCase = collections.namedtuple('ProfileCase', 'name iterations ticks samples ticks_max histogram')
+
+PROFILE_MAGIC = b'VKD3DPRF'
+PROFILE_HEADER = struct.Struct('=8sIIIIIIII')
+BLOCK_COUNTERS = struct.Struct('=QQQQ')
 
 
 def is_valid_block(block):
@@ -43,7 +47,84 @@ def parse_block(block):
     ticks = struct.unpack('=Q', block[0:8])[0]
     iterations = struct.unpack('=Q', block[8:16])[0]
     name = block[16:].split(b'\0', 1)[0].decode('ascii')
-    return ProfileCase(ticks = ticks, iterations = iterations, name = name)
+    return ProfileCase(ticks = ticks, iterations = iterations, name = name,
+                       samples = 0, ticks_max = 0, histogram = [])
+
+
+def parse_legacy_profile(data):
+    blocks = []
+    for offset in range(0, len(data), 64):
+        block = data[offset : offset + 64]
+        if is_valid_block(block):
+            blocks.append(parse_block(block))
+    return blocks, 0
+
+
+def parse_profile(data):
+    if not data.startswith(PROFILE_MAGIC):
+        return parse_legacy_profile(data)
+
+    (magic, version, header_size, region_count, name_size, shard_count,
+     block_size, sub_buckets_log2, bucket_count) = PROFILE_HEADER.unpack_from(data, 0)
+
+    names_offset = header_size
+    shards_offset = names_offset + region_count * name_size
+    histogram_offset = BLOCK_COUNTERS.size
+
+    blocks = []
+    for region in range(region_count):
+        name_data = data[names_offset + region * name_size : names_offset + (region + 1) * name_size]
+        name = name_data.split(b'\0', 1)[0].decode('ascii')
+        if not name:
+            continue
+
+        # Merge per-thread shards.
+        ticks = 0
+        iterations = 0
+        samples = 0
+        ticks_max = 0
+        histogram = [0] * bucket_count
+        for shard in range(shard_count):
+            offset = shards_offset + (shard * region_count + region) * block_size
+            t, i, s, m = BLOCK_COUNTERS.unpack_from(data, offset)
+            ticks += t
+            iterations += i
+            samples += s
+            ticks_max = max(ticks_max, m)
+            counts = struct.unpack_from('={}Q'.format(bucket_count), data, offset + histogram_offset)
+            histogram = [a + b for a, b in zip(histogram, counts)]
+
+        if iterations != 0:
+            blocks.append(ProfileCase(name = name, ticks = ticks, iterations = iterations,
+                                      samples = samples, ticks_max = ticks_max, histogram = histogram))
+
+    return blocks, sub_buckets_log2
+
+
+def histogram_bucket_range(bucket, sub_buckets_log2):
+    sub_buckets = 1 << sub_buckets_log2
+    if bucket < sub_buckets:
+        return bucket, bucket + 1
+    octave = bucket >> sub_buckets_log2
+    sub_bucket = bucket & (sub_buckets - 1)
+    shift = octave - sub_buckets_log2
+    return (sub_buckets + sub_bucket) << shift, (sub_buckets + sub_bucket + 1) << shift
+
+
+def histogram_percentile(block, percentile, sub_buckets_log2):
+    total = sum(block.histogram)
+    if total == 0:
+        return 0.0
+
+    threshold = percentile * total
+    accum = 0
+    for bucket, count in enumerate(block.histogram):
+        accum += count
+        if count != 0 and accum >= threshold:
+            lo, hi = histogram_bucket_range(bucket, sub_buckets_log2)
+            return min(0.5 * (lo + hi), block.ticks_max)
+
+    return float(block.ticks_max)
 
 
 def filter_name(name, allow):
@@ -62,11 +143,22 @@ def find_record_by_name(blocks, name):
 
 
 def normalize_block(block, iter):
-    return ProfileCase(name = block.name, iterations = block.iterations / iter, ticks = block.ticks / iter)
+    return block._replace(iterations = block.iterations / iter, ticks = block.ticks / iter)
 
 
 def per_iteration_normalize(block):
-    return ProfileCase(name = block.name, iterations = block.iterations, ticks = block.ticks / block.iterations)
+    return block._replace(ticks = block.ticks / block.iterations)
+
+
+def subtract_block(block, delta):
+    histogram = block.histogram
+    if len(delta.histogram) == len(histogram):
+        histogram = [a - b for a, b in zip(histogram, delta.histogram)]
+    # ticks_max cannot be subtracted, so keep the maximum over the whole run.
+    return block._replace(ticks = block.ticks - delta.ticks,
+                          iterations = block.iterations - delta.iterations,
+                          samples = block.samples - delta.samples,
+                          histogram = histogram)
 
 
 def main():
@@ -74,7 +166,7 @@ def main():
     parser.add_argument('--divider', type = str, help = 'Represent data in terms of count per divider. Divider is another counter name.')
     parser.add_argument('--per-iteration', action = 'store_true', help = 'Represent ticks in terms of ticks / iteration. Cannot be used with --divider.')
     parser.add_argument('--name', nargs = '+', type = str, help = 'Only display data for certain counters.')
-    parser.add_argument('--sort', type = str, default = 'none', help = 'Sorts input data according to "iterations" or "ticks".')
+    parser.add_argument('--sort', type = str, default = 'none', help = 'Sorts input data according to "iterations", "ticks", "p99" or "max".')
     parser.add_argument('--delta', type = str, help = 'Subtract iterations and timing from other profile blob.')
     parser.add_argument('profile', help = 'The profile binary blob.')
 
@@ -85,25 +177,20 @@ def main():
     delta_map = {}
     if args.delta is not None:
         with open(args.delta, 'rb') as f:
-            for block in iter(lambda: f.read(64), b''):
-                if is_valid_block(block):
-                    b = parse_block(block)
-                    delta_map[b.name] = b
+            delta_blocks, _ = parse_profile(f.read())
+            for b in delta_blocks:
+                delta_map[b.name] = b
 
     blocks = []
     with open(args.profile, 'rb') as f:
-        for block in iter(lambda: f.read(64), b''):
-            if is_valid_block(block):
-                b = parse_block(block)
-                if b.name in delta_map:
-                    d = delta_map[b.name]
-                    b = ProfileCase(ticks = b.ticks - d.ticks,
-                            iterations = b.iterations - d.iterations,
-                            name = b.name)
-                    if b.iterations < 0 or b.ticks < 0:
-                        raise AssertionError('After subtracting, iterations or ticks became negative.')
-                if b.iterations > 0:
-                    blocks.append(b)
+        profile_blocks, sub_buckets_log2 = parse_profile(f.read())
+        for b in profile_blocks:
+            if b.name in delta_map:
+                b = subtract_block(b, delta_map[b.name])
+                if b.iterations < 0 or b.ticks < 0:
+                    raise AssertionError('After subtracting, iterations or ticks became negative.')
+            if b.iterations > 0:
+                blocks.append(b)
 
     if args.divider is not None:
         if args.per_iteration:
@@ -120,6 +207,10 @@ def main():
         blocks.sort(reverse = True, key = lambda a: a.iterations)
     elif args.sort == 'ticks':
         blocks.sort(reverse = True, key = lambda a: a.ticks)
+    elif args.sort == 'p99':
+        blocks.sort(reverse = True, key = lambda a: histogram_percentile(a, 0.99, sub_buckets_log2))
+    elif args.sort == 'max':
+        blocks.sort(reverse = True, key = lambda a: a.ticks_max)
     elif args.sort != 'none':
         raise AssertionError('Invalid argument for --sort.')
 
@@ -138,5 +229,12 @@ def main():
             else:
                 print('    Total time spent: {:.3f}'.format(block.ticks / 1000.0), "Kcycles")
 
+            if block.samples > 0:
+                print('    Samples:', block.samples)
+                print('    Time per sample: p50 {:.3f}, p99 {:.3f}, max {:.3f}'.format(
+                      histogram_percentile(block, 0.50, sub_buckets_log2) / 1000.0,
+                      histogram_percentile(block, 0.99, sub_buckets_log2) / 1000.0,
+                      block.ticks_max / 1000.0), "Kcycles")
+
 if __name__ == '__main__':
     main()
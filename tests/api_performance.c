@@ -0,0 +1,350 @@
+/*
+ * Copyright 2020 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define INITGUID
+#define VKD3D_TEST_DECLARE_MAIN
+#include "d3d12_crosstest.h"
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+
+    pfn_D3D12CreateVersionedRootSignatureDeserializer = get_d3d12_pfn(D3D12CreateVersionedRootSignatureDeserializer);
+    pfn_D3D12SerializeVersionedRootSignature = get_d3d12_pfn(D3D12SerializeVersionedRootSignature);
+}
+
+static double get_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER lc, lf;
+    QueryPerformanceCounter(&lc);
+    QueryPerformanceFrequency(&lf);
+    return (double)lc.QuadPart / (double)lf.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+struct fence_poll_thread_data
+{
+    ID3D12Fence *fence;
+    UINT64 target_value;
+    uint64_t poll_count;
+};
+
+static void fence_poll_thread_main(void *userdata)
+{
+    struct fence_poll_thread_data *data = userdata;
+    uint64_t poll_count = 0;
+
+    while (ID3D12Fence_GetCompletedValue(data->fence) < data->target_value)
+        poll_count++;
+
+    data->poll_count = poll_count + 1;
+}
+
+static void test_fence_performance(ID3D12Device *device)
+{
+    static const unsigned int thread_counts[] = { 1, 4, 8, 16 };
+    static const unsigned int waiter_counts[] = { 16, 256, 4096 };
+    struct fence_poll_thread_data thread_data[16];
+    HANDLE threads[16];
+    unsigned int i, j;
+    uint64_t polls;
+    ID3D12Fence *fence;
+    double t0, t1;
+    HANDLE event;
+    UINT64 value;
+    HRESULT hr;
+
+    /* Several threads spin on GetCompletedValue() while the main thread keeps signalling,
+     * which is the access pattern of games that poll a shared frame fence. */
+    for (i = 0; i < ARRAY_SIZE(thread_counts); i++)
+    {
+        hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&fence);
+        ok(SUCCEEDED(hr), "Failed to create fence, hr %#x.\n", hr);
+
+        for (j = 0; j < thread_counts[i]; j++)
+        {
+            thread_data[j].fence = fence;
+            thread_data[j].target_value = 100000;
+            thread_data[j].poll_count = 0;
+            threads[j] = create_thread(fence_poll_thread_main, &thread_data[j]);
+            ok(!!threads[j], "Failed to create thread.\n");
+        }
+
+        t0 = get_time();
+        for (value = 1; value <= 100000; value++)
+            ID3D12Fence_Signal(fence, value);
+
+        polls = 0;
+        for (j = 0; j < thread_counts[i]; j++)
+        {
+            ok(join_thread(threads[j]), "Failed to join thread.\n");
+            polls += thread_data[j].poll_count;
+        }
+        t1 = get_time();
+
+        ok(ID3D12Fence_GetCompletedValue(fence) == 100000, "Unexpected fence value %"PRIu64".\n",
+                ID3D12Fence_GetCompletedValue(fence));
+        INFO("Fence poll: %2u threads, %9"PRIu64" polls, %.3f Msignals/s, %.3f Mpolls/s.\n",
+                thread_counts[i], polls, 1e-6 * 100000.0 / (t1 - t0), 1e-6 * (double)polls / (t1 - t0));
+
+        ID3D12Fence_Release(fence);
+    }
+
+    /* Many outstanding SetEventOnCompletion() waits at scattered values,
+     * retired one CPU signal at a time. */
+    event = create_event();
+    ok(!!event, "Failed to create event.\n");
+
+    for (i = 0; i < ARRAY_SIZE(waiter_counts); i++)
+    {
+        hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&fence);
+        ok(SUCCEEDED(hr), "Failed to create fence, hr %#x.\n", hr);
+
+        for (j = 0; j < waiter_counts[i]; j++)
+        {
+            value = 1 + (j * 2654435761u) % waiter_counts[i];
+            hr = ID3D12Fence_SetEventOnCompletion(fence, value, event);
+            ok(SUCCEEDED(hr), "Failed to set event on completion, hr %#x.\n", hr);
+        }
+
+        t0 = get_time();
+        for (value = 1; value <= waiter_counts[i]; value++)
+            ID3D12Fence_Signal(fence, value);
+        t1 = get_time();
+
+        ok(ID3D12Fence_GetCompletedValue(fence) == waiter_counts[i], "Unexpected fence value %"PRIu64".\n",
+                ID3D12Fence_GetCompletedValue(fence));
+        ok(wait_event(event, 0) == WAIT_OBJECT_0, "Event not signalled.\n");
+        INFO("Fence events: %4u waiters, %.3f us per signal.\n",
+                waiter_counts[i], 1e6 * (t1 - t0) / waiter_counts[i]);
+
+        ID3D12Fence_Release(fence);
+    }
+
+    destroy_event(event);
+}
+
+static void test_bundle_performance(ID3D12Device *device)
+{
+    static const unsigned int draw_counts[] = { 16, 256, 4096 };
+    ID3D12CommandAllocator *allocator, *bundle_allocator;
+    ID3D12GraphicsCommandList *command_list, *bundle;
+    double record_time, replay_time, start;
+    ID3D12RootSignature *root_signature;
+    const unsigned int iterations = 64;
+    ID3D12PipelineState *pipeline_state;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+    ID3D12Resource *render_target;
+    const unsigned int replays = 16;
+    ID3D12DescriptorHeap *rtv_heap;
+    ID3D12CommandQueue *queue;
+    D3D12_VIEWPORT viewport;
+    unsigned int i, j, k;
+    RECT scissor_rect;
+    HRESULT hr;
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&command_list);
+    ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            &IID_ID3D12CommandAllocator, (void **)&bundle_allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            bundle_allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&bundle);
+    ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+    ID3D12GraphicsCommandList_Close(bundle);
+
+    root_signature = create_empty_root_signature(device, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    pipeline_state = create_pipeline_state(device, root_signature, DXGI_FORMAT_R8G8B8A8_UNORM, NULL, NULL, NULL);
+
+    render_target = create_default_texture2d(device, 64, 64, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM,
+            D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    rtv_heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 1);
+    rtv = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(rtv_heap);
+    ID3D12Device_CreateRenderTargetView(device, render_target, NULL, rtv);
+
+    set_viewport(&viewport, 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f);
+    set_rect(&scissor_rect, 0, 0, 64, 64);
+
+    for (i = 0; i < ARRAY_SIZE(draw_counts); i++)
+    {
+        record_time = replay_time = 0.0;
+
+        for (j = 0; j < iterations; j++)
+        {
+            start = get_time();
+            ID3D12CommandAllocator_Reset(bundle_allocator);
+            ID3D12GraphicsCommandList_Reset(bundle, bundle_allocator, pipeline_state);
+            ID3D12GraphicsCommandList_IASetPrimitiveTopology(bundle, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            for (k = 0; k < draw_counts[i]; k++)
+                ID3D12GraphicsCommandList_DrawInstanced(bundle, 3, 1, 0, 0);
+            hr = ID3D12GraphicsCommandList_Close(bundle);
+            record_time += get_time() - start;
+            ok(SUCCEEDED(hr), "Failed to close bundle, hr %#x.\n", hr);
+
+            start = get_time();
+            ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &rtv, false, NULL);
+            ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, root_signature);
+            ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &viewport);
+            ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+            for (k = 0; k < replays; k++)
+                ID3D12GraphicsCommandList_ExecuteBundle(command_list, bundle);
+            hr = ID3D12GraphicsCommandList_Close(command_list);
+            replay_time += get_time() - start;
+            ok(SUCCEEDED(hr), "Failed to close command list, hr %#x.\n", hr);
+
+            exec_command_list(queue, command_list);
+            wait_queue_idle(device, queue);
+            reset_command_list(command_list, allocator);
+        }
+
+        INFO("Bundle: %4u draws: record %7.2f ns, replay %7.2f ns per draw.\n", draw_counts[i],
+                1e9 * record_time / ((double)iterations * draw_counts[i]),
+                1e9 * replay_time / ((double)iterations * replays * draw_counts[i]));
+    }
+
+    ID3D12GraphicsCommandList_Close(command_list);
+    ID3D12DescriptorHeap_Release(rtv_heap);
+    ID3D12Resource_Release(render_target);
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+    ID3D12GraphicsCommandList_Release(bundle);
+    ID3D12CommandAllocator_Release(bundle_allocator);
+    ID3D12GraphicsCommandList_Release(command_list);
+    ID3D12CommandAllocator_Release(allocator);
+    ID3D12CommandQueue_Release(queue);
+}
+
+static void test_copyable_footprints_performance(ID3D12Device *device)
+{
+    static const struct
+    {
+        const char *name;
+        D3D12_RESOURCE_DIMENSION dimension;
+        DXGI_FORMAT format;
+        unsigned int width, height, depth_or_array_size, mip_levels;
+    }
+    tests[] =
+    {
+        {"2D 4096 x 4096",       D3D12_RESOURCE_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 4096, 4096,    1, 13},
+        {"2D array 1024 x 2048", D3D12_RESOURCE_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 1024, 1024, 2048, 11},
+        {"BC array 512 x 2048",  D3D12_RESOURCE_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC7_UNORM,       512,  512, 2048, 10},
+        {"3D 256 x 256 x 256",   D3D12_RESOURCE_DIMENSION_TEXTURE3D, DXGI_FORMAT_R16G16B16A16_FLOAT, 256, 256, 256, 9},
+    };
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT *layouts, layout;
+    UINT64 *row_sizes, total_size, row_size;
+    unsigned int i, j, count, mismatches;
+    double bulk_time, single_time, start;
+    const unsigned int iterations = 16;
+    D3D12_RESOURCE_DESC desc;
+    UINT *row_counts, rows;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        memset(&desc, 0, sizeof(desc));
+        desc.Dimension = tests[i].dimension;
+        desc.Width = tests[i].width;
+        desc.Height = tests[i].height;
+        desc.DepthOrArraySize = tests[i].depth_or_array_size;
+        desc.MipLevels = tests[i].mip_levels;
+        desc.Format = tests[i].format;
+        desc.SampleDesc.Count = 1;
+        desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+        count = desc.MipLevels;
+        if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+            count *= desc.DepthOrArraySize;
+
+        layouts = malloc(count * sizeof(*layouts));
+        row_counts = malloc(count * sizeof(*row_counts));
+        row_sizes = malloc(count * sizeof(*row_sizes));
+
+        /* Uploaders typically query every subresource of a texture in one go. */
+        start = get_time();
+        for (j = 0; j < iterations; j++)
+        {
+            total_size = 0;
+            ID3D12Device_GetCopyableFootprints(device, &desc, 0, count, 0,
+                    layouts, row_counts, row_sizes, &total_size);
+        }
+        bulk_time = get_time() - start;
+        ok(total_size && total_size != ~(UINT64)0, "Got unexpected total size %#"PRIx64".\n", total_size);
+
+        /* Streaming engines query one subresource at a time instead. */
+        start = get_time();
+        for (j = 0; j < iterations * count; j++)
+        {
+            ID3D12Device_GetCopyableFootprints(device, &desc, j % count, 1, 0,
+                    &layout, &rows, &row_size, NULL);
+        }
+        single_time = get_time() - start;
+
+        for (j = 0, mismatches = 0; j < count; j++)
+        {
+            ID3D12Device_GetCopyableFootprints(device, &desc, j, 1, 0, &layout, &rows, &row_size, NULL);
+            if (memcmp(&layout.Footprint, &layouts[j].Footprint, sizeof(layout.Footprint)) ||
+                    rows != row_counts[j] || row_size != row_sizes[j])
+                mismatches++;
+        }
+        ok(!mismatches, "%u footprints of %s do not match the bulk query.\n", mismatches, tests[i].name);
+
+        INFO("Copyable footprints: %-22s %6u subresources: bulk %7.2f ns, single %7.2f ns per subresource.\n",
+                tests[i].name, count, 1e9 * bulk_time / ((double)iterations * count),
+                1e9 * single_time / ((double)iterations * count));
+
+        free(layouts);
+        free(row_counts);
+        free(row_sizes);
+    }
+}
+
+START_TEST(api_performance)
+{
+    ID3D12Device *device;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+    if (!device)
+        return;
+
+    test_fence_performance(device);
+    test_bundle_performance(device);
+    test_copyable_footprints_performance(device);
+
+    ID3D12Device_Release(device);
+}
@@ -0,0 +1,1426 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* CPU-only micro-benchmarks for code in vkd3d-common which does not need a device. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define VKD3D_TEST_DECLARE_MAIN
+#include "vkd3d_test.h"
+#include "vkd3d_memory.h"
+#include "vkd3d_compress.h"
+#include "vkd3d_lockfree_hashmap.h"
+#include "vkd3d_range_allocator.h"
+#include "vkd3d_threads.h"
+#include "copy_utils.h"
+#include "hashmap.h"
+#include "list.h"
+
+static double get_time(void)
+{
+    return 1e-9 * (double)vkd3d_get_current_time_ns();
+}
+
+static uint8_t *load_file(const char *path, size_t *size)
+{
+    uint8_t *data;
+    long length;
+    FILE *file;
+
+    if (!(file = fopen(path, "rb")))
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    rewind(file);
+
+    if (length <= 0 || !(data = malloc(length)) || fread(data, 1, length, file) != (size_t)length)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *size = length;
+    return data;
+}
+
+static uint8_t *create_spirv_like_stream(size_t word_count, size_t *size)
+{
+    static const uint32_t opcodes[] = { 61, 62, 65, 79, 81, 129, 133, 142, 247, 248, 249, 250 };
+    uint32_t *words, id = 100, seed = 1;
+    size_t i, j, count;
+
+    words = malloc(word_count * sizeof(*words));
+
+    /* Rough approximation of a SPIR-V function body: small opcodes with a handful of
+     * monotonically increasing result IDs and operand IDs referring back to recent results. */
+    for (i = 0; i < word_count; )
+    {
+        seed = seed * 1103515245u + 12345u;
+        count = min(2 + ((seed >> 16) % 4), word_count - i);
+        words[i++] = (count << 16) | opcodes[(seed >> 8) % ARRAY_SIZE(opcodes)];
+
+        for (j = 1; j < count; j++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            words[i++] = j == 1 ? id++ : id - 1 - ((seed >> 16) % 16);
+        }
+    }
+
+    *size = word_count * sizeof(*words);
+    return (uint8_t *)words;
+}
+
+static double time_file_read(const void *data, size_t size, unsigned int iterations)
+{
+    double start_time, end_time;
+    unsigned int i;
+    void *readback;
+    FILE *file;
+
+    if (!(file = tmpfile()))
+        return 0.0;
+
+    readback = malloc(size);
+    fwrite(data, 1, size, file);
+    fflush(file);
+
+    start_time = get_time();
+    for (i = 0; i < iterations; i++)
+    {
+        rewind(file);
+        if (fread(readback, 1, size, file) != size)
+            break;
+    }
+    end_time = get_time();
+
+    free(readback);
+    fclose(file);
+    return (end_time - start_time) / iterations;
+}
+
+static void test_compression_performance(int argc, char **argv)
+{
+    double compress_time, decompress_time, read_time, read_time_compressed;
+    double start_time, end_time, decode_bandwidth, break_even;
+    size_t size, compressed_size, bound;
+    uint8_t *data, *compressed, *decoded;
+    unsigned int i, iterations;
+    bool ret = true;
+
+    data = NULL;
+    if (argc > 1 && !(data = load_file(argv[argc - 1], &size)))
+        trace("Failed to load %s, falling back to synthetic data.\n", argv[argc - 1]);
+    if (!data)
+        data = create_spirv_like_stream(4 * 1024 * 1024, &size);
+
+    iterations = max(1, (unsigned int)((256u * 1024u * 1024u) / size));
+    bound = vkd3d_lz_compress_bound(size);
+    compressed = malloc(bound);
+    decoded = malloc(size);
+
+    start_time = get_time();
+    for (i = 0; i < iterations; i++)
+        compressed_size = vkd3d_lz_compress(compressed, bound, data, size);
+    end_time = get_time();
+    compress_time = (end_time - start_time) / iterations;
+    ok(compressed_size, "Failed to compress.\n");
+
+    start_time = get_time();
+    for (i = 0; i < iterations; i++)
+        ret &= vkd3d_lz_decompress(decoded, size, compressed, compressed_size);
+    end_time = get_time();
+    decompress_time = (end_time - start_time) / iterations;
+    ok(ret && !memcmp(data, decoded, size), "Round-trip failed.\n");
+
+    read_time = time_file_read(data, size, iterations);
+    read_time_compressed = time_file_read(compressed, compressed_size, iterations);
+
+    printf("LZ: %zu -> %zu bytes (ratio %.3f).\n", size, compressed_size, (double)size / compressed_size);
+    printf("LZ: compress %.3f ms (%.1f MB/s), decompress %.3f ms (%.1f MB/s).\n",
+            1e3 * compress_time, 1e-6 * size / compress_time,
+            1e3 * decompress_time, 1e-6 * size / decompress_time);
+    printf("LZ: cached file read raw %.3f ms, compressed %.3f ms + decompress %.3f ms.\n",
+            1e3 * read_time, 1e3 * read_time_compressed, 1e3 * decompress_time);
+
+    /* Reading raw costs size / B, reading compressed costs compressed_size / B + size / D.
+     * Compression wins when the storage bandwidth B is below (size - compressed_size) * D / size. */
+    decode_bandwidth = size / decompress_time;
+    break_even = (double)(size - min(size, compressed_size)) * decode_bandwidth / size;
+    printf("LZ: compression pays off when storage is slower than %.1f MB/s.\n", 1e-6 * break_even);
+
+    free(data);
+    free(compressed);
+    free(decoded);
+}
+
+/* Mirrors the pipeline variant lookup in d3d12_pipeline_state_get_or_create_pipeline(). */
+struct variant_key
+{
+    uint32_t topology;
+    uint32_t dsv_format;
+    uint32_t rasterization_samples;
+    uint32_t view_mask;
+    bool dynamic_topology;
+};
+
+struct variant_entry
+{
+    struct vkd3d_lockfree_hash_map_entry entry;
+    struct list list_entry;
+    struct variant_key key;
+    uint64_t payload;
+};
+
+struct variant_lookup_context
+{
+    struct vkd3d_lockfree_hash_map map;
+    struct list list;
+    rwlock_t lock;
+    const struct variant_key *keys;
+    unsigned int key_count;
+    unsigned int iterations;
+    bool use_map;
+    uint32_t start;
+};
+
+struct variant_lookup_thread
+{
+    struct variant_lookup_context *context;
+    unsigned int index;
+    uint64_t checksum;
+};
+
+static uint32_t variant_key_hash(const struct variant_key *key)
+{
+    uint64_t h = hash_fnv1_init();
+
+    h = hash_fnv1_iterate_u32(h, key->topology);
+    h = hash_fnv1_iterate_u32(h, key->dsv_format);
+    h = hash_fnv1_iterate_u32(h, key->rasterization_samples);
+    h = hash_fnv1_iterate_u32(h, key->view_mask);
+    h = hash_fnv1_iterate_u8(h, key->dynamic_topology);
+    return hash_uint64(h);
+}
+
+static bool variant_entry_compare(const void *key, const struct vkd3d_lockfree_hash_map_entry *entry)
+{
+    const struct variant_entry *e = (const struct variant_entry *)entry;
+    return !memcmp(&e->key, key, sizeof(e->key));
+}
+
+static uint64_t variant_lookup_list(struct variant_lookup_context *context, const struct variant_key *key)
+{
+    const struct variant_entry *e;
+    uint64_t payload = 0;
+
+    rwlock_lock_read(&context->lock);
+    LIST_FOR_EACH_ENTRY(e, &context->list, struct variant_entry, list_entry)
+    {
+        if (!memcmp(&e->key, key, sizeof(*key)))
+        {
+            payload = e->payload;
+            break;
+        }
+    }
+    rwlock_unlock_read(&context->lock);
+
+    return payload;
+}
+
+static uint64_t variant_lookup_map(struct variant_lookup_context *context, const struct variant_key *key)
+{
+    const struct variant_entry *e;
+
+    e = (const struct variant_entry *)vkd3d_lockfree_hash_map_find(&context->map, key, variant_key_hash(key));
+    return e ? e->payload : 0;
+}
+
+static void *variant_lookup_thread_main(void *userdata)
+{
+    struct variant_lookup_thread *thread = userdata;
+    struct variant_lookup_context *context = thread->context;
+    unsigned int i, key_index;
+    uint64_t checksum = 0;
+
+    while (!vkd3d_atomic_uint32_load_explicit(&context->start, vkd3d_memory_order_acquire))
+        vkd3d_pause();
+
+    /* Different threads look at different variants, like command lists rendering to different passes. */
+    key_index = thread->index;
+
+    for (i = 0; i < context->iterations; i++)
+    {
+        const struct variant_key *key = &context->keys[key_index];
+
+        if (context->use_map)
+            checksum += variant_lookup_map(context, key);
+        else
+            checksum += variant_lookup_list(context, key);
+
+        if (++key_index == context->key_count)
+            key_index = 0;
+    }
+
+    thread->checksum = checksum;
+    return NULL;
+}
+
+static double run_variant_lookup(struct variant_lookup_context *context, unsigned int thread_count, uint64_t *checksum)
+{
+    struct variant_lookup_thread threads[16];
+    pthread_t thread_handles[16];
+    double start_time, end_time;
+    unsigned int i;
+
+    context->start = 0;
+
+    for (i = 0; i < thread_count; i++)
+    {
+        threads[i].context = context;
+        threads[i].index = i % context->key_count;
+        threads[i].checksum = 0;
+        pthread_create(&thread_handles[i], NULL, variant_lookup_thread_main, &threads[i]);
+    }
+
+    start_time = get_time();
+    vkd3d_atomic_uint32_store_explicit(&context->start, 1, vkd3d_memory_order_release);
+
+    *checksum = 0;
+    for (i = 0; i < thread_count; i++)
+    {
+        pthread_join(thread_handles[i], NULL);
+        *checksum += threads[i].checksum;
+    }
+    end_time = get_time();
+
+    return end_time - start_time;
+}
+
+static void test_pipeline_variant_lookup_performance(void)
+{
+    static const unsigned int variant_counts[] = { 1, 4, 16, 64 };
+    static const unsigned int thread_counts[] = { 1, 4, 8, 16 };
+    uint64_t list_checksum, map_checksum;
+    struct variant_lookup_context context;
+    double list_time, map_time, lookups;
+    struct variant_entry *entries;
+    struct variant_key *keys;
+    unsigned int i, j, k;
+
+    for (i = 0; i < ARRAY_SIZE(variant_counts); i++)
+    {
+        keys = calloc(variant_counts[i], sizeof(*keys));
+        entries = calloc(variant_counts[i], sizeof(*entries));
+
+        vkd3d_lockfree_hash_map_init(&context.map, variant_entry_compare);
+        list_init(&context.list);
+        rwlock_init(&context.lock);
+
+        for (k = 0; k < variant_counts[i]; k++)
+        {
+            /* Vary DSV format and sample count, which is what tends to create variants in practice. */
+            keys[k].dsv_format = 124 + (k % 8);
+            keys[k].rasterization_samples = 1u << (k / 8);
+            keys[k].dynamic_topology = true;
+
+            entries[k].key = keys[k];
+            entries[k].payload = k + 1;
+            entries[k].entry.hash_value = variant_key_hash(&keys[k]);
+            list_add_tail(&context.list, &entries[k].list_entry);
+            ok(vkd3d_lockfree_hash_map_insert_locked(&context.map, &entries[k].entry), "Failed to insert entry.\n");
+        }
+
+        context.keys = keys;
+        context.key_count = variant_counts[i];
+        context.iterations = 1000000;
+
+        for (j = 0; j < ARRAY_SIZE(thread_counts); j++)
+        {
+            context.use_map = false;
+            list_time = run_variant_lookup(&context, thread_counts[j], &list_checksum);
+            context.use_map = true;
+            map_time = run_variant_lookup(&context, thread_counts[j], &map_checksum);
+            ok(list_checksum == map_checksum, "Checksum mismatch, %"PRIu64" != %"PRIu64".\n",
+                    list_checksum, map_checksum);
+
+            lookups = (double)context.iterations * thread_counts[j];
+            printf("Variant lookup: %2u variants x %2u threads: list + rwlock %7.2f ns, lock-free map %7.2f ns per lookup.\n",
+                    variant_counts[i], thread_counts[j], 1e9 * list_time / lookups, 1e9 * map_time / lookups);
+        }
+
+        vkd3d_lockfree_hash_map_free(&context.map);
+        rwlock_destroy(&context.lock);
+        free(entries);
+        free(keys);
+    }
+}
+
+#define DESCRIPTOR_COPY_PREFETCH_DISTANCE 4
+
+static void descriptor_copy_bulk(uint8_t *dst, const uint8_t *src, size_t stride, unsigned int count, bool non_temporal)
+{
+    if (non_temporal)
+    {
+        vkd3d_memcpy_aligned_non_temporal(dst, src, stride * count);
+        vkd3d_memcpy_non_temporal_barrier();
+    }
+    else
+        vkd3d_memcpy_aligned_cached(dst, src, stride * count);
+}
+
+static void descriptor_copy_single(uint8_t *dst, const uint8_t *src, size_t stride)
+{
+    /* Mirrors the fixed size paths in CopyDescriptorsSimple. */
+    switch (stride)
+    {
+        case 16:
+            vkd3d_memcpy_aligned_16_cached(dst, src);
+            break;
+        case 32:
+            vkd3d_memcpy_aligned_32_cached(dst, src);
+            break;
+        default:
+            vkd3d_memcpy_aligned_64_cached(dst, src);
+            break;
+    }
+}
+
+static void descriptor_copy_scattered(uint8_t *dst, const uint8_t *src, size_t stride,
+        const uint32_t *indices, unsigned int count, bool prefetch)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        /* Same scheme as the generic CopyDescriptors path, which prefetches a few source ranges ahead. */
+        if (prefetch && i + DESCRIPTOR_COPY_PREFETCH_DISTANCE < count)
+            vkd3d_prefetch(src + indices[i + DESCRIPTOR_COPY_PREFETCH_DISTANCE] * stride);
+        descriptor_copy_single(dst + i * stride, src + indices[i] * stride, stride);
+    }
+}
+
+static void test_descriptor_copy_performance(void)
+{
+    static const size_t strides[] = { 16, 32, 64 };
+    static const unsigned int bulk_count = 1024;
+    static const unsigned int scatter_count = 4096;
+    double memcpy_time, cached_time, nt_time, scattered_time, prefetch_time, start_time;
+    const size_t heap_size = 64 * 1024 * 1024;
+    unsigned int i, j, iterations;
+    uint8_t *src_heap, *dst_heap;
+    uint32_t *indices, seed = 1;
+    size_t stride;
+
+    src_heap = vkd3d_malloc_aligned(heap_size, 64);
+    dst_heap = vkd3d_malloc_aligned(heap_size, 64);
+    indices = malloc(scatter_count * sizeof(*indices));
+
+    for (i = 0; i < heap_size; i++)
+        src_heap[i] = i * 7;
+    memset(dst_heap, 0, heap_size);
+
+    for (i = 0; i < ARRAY_SIZE(strides); i++)
+    {
+        stride = strides[i];
+
+        /* Contiguous copy from a staging heap into a shader visible heap. Source and destination are hot. */
+        iterations = 20000;
+
+        start_time = get_time();
+        for (j = 0; j < iterations; j++)
+            memcpy(dst_heap, src_heap + (j & 1) * stride, stride * bulk_count);
+        memcpy_time = get_time() - start_time;
+
+        start_time = get_time();
+        for (j = 0; j < iterations; j++)
+            descriptor_copy_bulk(dst_heap, src_heap + (j & 1) * stride, stride, bulk_count, false);
+        cached_time = get_time() - start_time;
+
+        start_time = get_time();
+        for (j = 0; j < iterations; j++)
+            descriptor_copy_bulk(dst_heap, src_heap + (j & 1) * stride, stride, bulk_count, true);
+        nt_time = get_time() - start_time;
+
+        ok(!memcmp(dst_heap, src_heap + stride, stride * bulk_count), "Bulk copy mismatch.\n");
+
+        printf("Descriptor copy: stride %2zu, bulk x %u: memcpy %6.2f ns, cached %6.2f ns, non-temporal %6.2f ns per descriptor.\n",
+                stride, bulk_count,
+                1e9 * memcpy_time / ((double)iterations * bulk_count),
+                1e9 * cached_time / ((double)iterations * bulk_count),
+                1e9 * nt_time / ((double)iterations * bulk_count));
+
+        /* Single descriptors from random places in a large heap, which is what a renderer
+         * gathering bindless descriptors per draw looks like. Source access is cache missing. */
+        iterations = 200;
+
+        scattered_time = prefetch_time = 0.0;
+        for (j = 0; j < iterations; j++)
+        {
+            unsigned int k;
+
+            for (k = 0; k < scatter_count; k++)
+            {
+                seed = seed * 1103515245u + 12345u;
+                indices[k] = ((uint64_t)seed * (heap_size / stride)) >> 32;
+            }
+
+            start_time = get_time();
+            descriptor_copy_scattered(dst_heap, src_heap, stride, indices, scatter_count, (j & 1) != 0);
+            if (j & 1)
+                prefetch_time += get_time() - start_time;
+            else
+                scattered_time += get_time() - start_time;
+        }
+
+        ok(!memcmp(dst_heap, src_heap + indices[0] * stride, stride), "Scattered copy mismatch.\n");
+
+        printf("Descriptor copy: stride %2zu, scattered x %u: %6.2f ns, with prefetch %6.2f ns per descriptor.\n",
+                stride, scatter_count,
+                1e9 * scattered_time / ((double)(iterations / 2) * scatter_count),
+                1e9 * prefetch_time / ((double)(iterations / 2) * scatter_count));
+    }
+
+    vkd3d_free_aligned(src_heap);
+    vkd3d_free_aligned(dst_heap);
+    free(indices);
+}
+
+/* Reference implementation of the sorted free range list which used to back vkd3d_memory_chunk.
+ * Picks an exact fit if there is one, otherwise the largest free range. */
+struct reference_range
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct reference_range_allocator
+{
+    struct reference_range *ranges;
+    size_t ranges_size;
+    size_t ranges_count;
+    uint64_t size;
+};
+
+static void reference_range_allocator_insert(struct reference_range_allocator *allocator,
+        size_t index, uint64_t offset, uint64_t length)
+{
+    vkd3d_array_reserve((void **)&allocator->ranges, &allocator->ranges_size,
+            allocator->ranges_count + 1, sizeof(*allocator->ranges));
+    memmove(&allocator->ranges[index + 1], &allocator->ranges[index],
+            sizeof(*allocator->ranges) * (allocator->ranges_count - index));
+    allocator->ranges[index].offset = offset;
+    allocator->ranges[index].length = length;
+    allocator->ranges_count++;
+}
+
+static void reference_range_allocator_remove(struct reference_range_allocator *allocator, size_t index)
+{
+    allocator->ranges_count--;
+    memmove(&allocator->ranges[index], &allocator->ranges[index + 1],
+            sizeof(*allocator->ranges) * (allocator->ranges_count - index));
+}
+
+static bool reference_range_allocator_allocate(struct reference_range_allocator *allocator,
+        uint64_t size, uint64_t alignment, uint64_t *offset)
+{
+    struct reference_range *pick = NULL, *range;
+    uint64_t l_length, r_length;
+    size_t i, pick_index = 0;
+
+    for (i = 0; i < allocator->ranges_count; i++)
+    {
+        range = &allocator->ranges[i];
+
+        if (range->offset + range->length < align(range->offset, alignment) + size)
+            continue;
+
+        if (range->length == size)
+        {
+            pick_index = i;
+            pick = range;
+            break;
+        }
+
+        if (!pick || range->length > pick->length)
+        {
+            pick_index = i;
+            pick = range;
+        }
+    }
+
+    if (!pick)
+        return false;
+
+    *offset = align(pick->offset, alignment);
+    l_length = *offset - pick->offset;
+    r_length = pick->offset + pick->length - *offset - size;
+
+    if (l_length)
+    {
+        pick->length = l_length;
+        if (r_length)
+            reference_range_allocator_insert(allocator, pick_index + 1, *offset + size, r_length);
+    }
+    else if (r_length)
+    {
+        pick->offset = *offset + size;
+        pick->length = r_length;
+    }
+    else
+        reference_range_allocator_remove(allocator, pick_index);
+
+    return true;
+}
+
+static void reference_range_allocator_free(struct reference_range_allocator *allocator, uint64_t offset, uint64_t size)
+{
+    bool adjacent_l = false, adjacent_r = false;
+    size_t lo = 0, hi = allocator->ranges_count, index;
+
+    while (lo < hi)
+    {
+        index = lo + (hi - lo) / 2;
+        if (allocator->ranges[index].offset > offset)
+            hi = index;
+        else
+            lo = index + 1;
+    }
+
+    index = lo;
+
+    if (index > 0)
+        adjacent_l = allocator->ranges[index - 1].offset + allocator->ranges[index - 1].length == offset;
+    if (index < allocator->ranges_count)
+        adjacent_r = allocator->ranges[index].offset == offset + size;
+
+    if (adjacent_l)
+    {
+        allocator->ranges[index - 1].length += size;
+        if (adjacent_r)
+        {
+            allocator->ranges[index - 1].length += allocator->ranges[index].length;
+            reference_range_allocator_remove(allocator, index);
+        }
+    }
+    else if (adjacent_r)
+    {
+        allocator->ranges[index].offset = offset;
+        allocator->ranges[index].length += size;
+    }
+    else
+        reference_range_allocator_insert(allocator, index, offset, size);
+}
+
+static uint64_t reference_range_allocator_largest_free(const struct reference_range_allocator *allocator)
+{
+    uint64_t largest = 0;
+    size_t i;
+
+    for (i = 0; i < allocator->ranges_count; i++)
+        largest = max(largest, allocator->ranges[i].length);
+    return largest;
+}
+
+#define ALLOCATOR_STRESS_CHUNK_SIZE (32ull * 1024 * 1024)
+#define ALLOCATOR_STRESS_ALIGNMENT (64ull * 1024)
+#define ALLOCATOR_STRESS_MAX_CHUNKS 256
+
+struct allocator_stress_chunk
+{
+    struct reference_range_allocator reference;
+    struct vkd3d_range_allocator tlsf;
+};
+
+struct allocator_stress_allocation
+{
+    uint32_t chunk_index;
+    uint32_t handle;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct allocator_stress_context
+{
+    struct allocator_stress_chunk chunks[ALLOCATOR_STRESS_MAX_CHUNKS];
+    unsigned int chunk_count;
+    bool use_tlsf;
+};
+
+static bool allocator_stress_chunk_allocate(struct allocator_stress_context *context, unsigned int chunk_index,
+        struct allocator_stress_allocation *allocation)
+{
+    struct allocator_stress_chunk *chunk = &context->chunks[chunk_index];
+    bool ret;
+
+    if (context->use_tlsf)
+    {
+        ret = vkd3d_range_allocator_allocate(&chunk->tlsf, allocation->size, ALLOCATOR_STRESS_ALIGNMENT,
+                &allocation->offset, &allocation->handle);
+    }
+    else
+    {
+        ret = reference_range_allocator_allocate(&chunk->reference, allocation->size, ALLOCATOR_STRESS_ALIGNMENT,
+                &allocation->offset);
+    }
+
+    allocation->chunk_index = chunk_index;
+    return ret;
+}
+
+static bool allocator_stress_allocate(struct allocator_stress_context *context,
+        struct allocator_stress_allocation *allocation)
+{
+    struct allocator_stress_chunk *chunk;
+    unsigned int i;
+
+    /* Same policy as vkd3d_memory_allocator: first chunk which fits, otherwise a new chunk. */
+    for (i = 0; i < context->chunk_count; i++)
+        if (allocator_stress_chunk_allocate(context, i, allocation))
+            return true;
+
+    if (context->chunk_count == ALLOCATOR_STRESS_MAX_CHUNKS)
+        return false;
+
+    chunk = &context->chunks[context->chunk_count++];
+    memset(chunk, 0, sizeof(*chunk));
+
+    if (context->use_tlsf)
+        vkd3d_range_allocator_init(&chunk->tlsf, ALLOCATOR_STRESS_CHUNK_SIZE);
+    else
+        reference_range_allocator_insert(&chunk->reference, 0, 0, ALLOCATOR_STRESS_CHUNK_SIZE);
+
+    return allocator_stress_chunk_allocate(context, context->chunk_count - 1, allocation);
+}
+
+static void allocator_stress_free(struct allocator_stress_context *context,
+        const struct allocator_stress_allocation *allocation)
+{
+    struct allocator_stress_chunk *chunk = &context->chunks[allocation->chunk_index];
+
+    if (context->use_tlsf)
+        vkd3d_range_allocator_free(&chunk->tlsf, allocation->handle);
+    else
+        reference_range_allocator_free(&chunk->reference, allocation->offset, allocation->size);
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+    return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+static void run_allocator_stress(struct allocator_stress_context *context, unsigned int live_count,
+        unsigned int op_count, const char *tag)
+{
+    struct allocator_stress_allocation *allocations;
+    uint64_t free_size, largest_free, start_ns;
+    uint64_t *latencies, free_total, largest_total;
+    unsigned int i, index, latency_count = 0;
+    unsigned int failure_count = 0;
+    uint32_t seed = 1;
+
+    allocations = calloc(live_count, sizeof(*allocations));
+    latencies = calloc(live_count + 2 * op_count, sizeof(*latencies));
+    context->chunk_count = 0;
+
+    /* Mostly small buffers and textures, with the occasional large render target,
+     * roughly what a streaming title creates and destroys as placed or committed resources. */
+    for (i = 0; i < live_count + op_count; i++)
+    {
+        index = i < live_count ? i : (seed = seed * 1103515245u + 12345u, (seed >> 8) % live_count);
+
+        if (i >= live_count)
+        {
+            start_ns = vkd3d_get_current_time_ns();
+            allocator_stress_free(context, &allocations[index]);
+            latencies[latency_count++] = vkd3d_get_current_time_ns() - start_ns;
+        }
+
+        seed = seed * 1103515245u + 12345u;
+        if ((seed >> 8) % 16 == 0)
+            allocations[index].size = ALLOCATOR_STRESS_ALIGNMENT * (16 + (seed >> 16) % 48);
+        else
+            allocations[index].size = ALLOCATOR_STRESS_ALIGNMENT * (1 + (seed >> 16) % 4);
+
+        start_ns = vkd3d_get_current_time_ns();
+        if (!allocator_stress_allocate(context, &allocations[index]))
+            failure_count++;
+        latencies[latency_count++] = vkd3d_get_current_time_ns() - start_ns;
+    }
+
+    ok(!failure_count, "%u allocations failed.\n", failure_count);
+
+    qsort(latencies, latency_count, sizeof(*latencies), compare_uint64);
+
+    free_total = largest_total = 0;
+    for (i = 0; i < context->chunk_count; i++)
+    {
+        if (context->use_tlsf)
+        {
+            free_size = context->chunks[i].tlsf.free_size;
+            largest_free = vkd3d_range_allocator_get_largest_free_range(&context->chunks[i].tlsf);
+        }
+        else
+        {
+            free_size = ALLOCATOR_STRESS_CHUNK_SIZE;
+            for (index = 0; index < live_count; index++)
+                if (allocations[index].chunk_index == i)
+                    free_size -= allocations[index].size;
+            largest_free = reference_range_allocator_largest_free(&context->chunks[i].reference);
+        }
+
+        free_total += free_size;
+        largest_total += largest_free;
+    }
+
+    /* Fragmentation is 1 - largest free range / free space, averaged over all chunks weighted by free space. */
+    printf("Allocator stress (%s, %u live): p50 %5"PRIu64" ns, p99 %6"PRIu64" ns, p99.9 %6"PRIu64" ns, max %7"PRIu64" ns, "
+            "%3u chunks, %5.1f%% free, %5.1f%% fragmentation.\n",
+            tag, live_count,
+            latencies[latency_count / 2], latencies[latency_count * 99 / 100],
+            latencies[latency_count * 999 / 1000], latencies[latency_count - 1],
+            context->chunk_count,
+            100.0 * free_total / (context->chunk_count * ALLOCATOR_STRESS_CHUNK_SIZE),
+            free_total ? 100.0 * (1.0 - (double)largest_total / free_total) : 0.0);
+
+    /* Everything must coalesce back into one free range per chunk. */
+    for (i = 0; i < live_count; i++)
+        allocator_stress_free(context, &allocations[i]);
+
+    for (i = 0; i < context->chunk_count; i++)
+    {
+        if (context->use_tlsf)
+        {
+            ok(vkd3d_range_allocator_is_empty(&context->chunks[i].tlsf) &&
+                    context->chunks[i].tlsf.free_range_count == 1, "Chunk %u is not empty.\n", i);
+            vkd3d_range_allocator_cleanup(&context->chunks[i].tlsf);
+        }
+        else
+        {
+            ok(context->chunks[i].reference.ranges_count == 1, "Chunk %u is not empty.\n", i);
+            free(context->chunks[i].reference.ranges);
+        }
+    }
+
+    free(latencies);
+    free(allocations);
+}
+
+static void test_memory_allocator_performance(void)
+{
+    static const unsigned int live_counts[] = { 256, 1024, 4096 };
+    struct allocator_stress_context *context;
+    unsigned int i;
+
+    context = calloc(1, sizeof(*context));
+
+    for (i = 0; i < ARRAY_SIZE(live_counts); i++)
+    {
+        context->use_tlsf = false;
+        run_allocator_stress(context, live_counts[i], 200000, "free list");
+        context->use_tlsf = true;
+        run_allocator_stress(context, live_counts[i], 200000, "TLSF     ");
+    }
+
+    free(context);
+}
+
+/* Copy of the previous hash_map implementation: modulo indexing, one compare callback per occupied slot. */
+struct legacy_hash_map
+{
+    pfn_hash_func hash_func;
+    pfn_hash_compare_func compare_func;
+    void *entries;
+    size_t entry_size;
+    uint32_t entry_count;
+    uint32_t used_count;
+};
+
+static struct hash_map_entry *legacy_hash_map_get_entry(const struct legacy_hash_map *hash_map, uint32_t entry_idx)
+{
+    return void_ptr_offset(hash_map->entries, hash_map->entry_size * entry_idx);
+}
+
+static struct hash_map_entry *legacy_hash_map_find(const struct legacy_hash_map *hash_map, const void *key)
+{
+    struct hash_map_entry *entry;
+    uint32_t hash_value, entry_idx;
+
+    if (!hash_map->entries)
+        return NULL;
+
+    hash_value = hash_map->hash_func(key);
+    entry_idx = hash_value % hash_map->entry_count;
+
+    while (true)
+    {
+        entry = legacy_hash_map_get_entry(hash_map, entry_idx);
+
+        if (!(entry->flags & HASH_MAP_ENTRY_OCCUPIED))
+            return NULL;
+        if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
+            return entry;
+
+        entry_idx = entry_idx + 1 < hash_map->entry_count ? entry_idx + 1 : 0;
+    }
+}
+
+static void legacy_hash_map_insert(struct legacy_hash_map *hash_map, const void *key, const struct hash_map_entry *entry)
+{
+    uint32_t i, hash_value, entry_idx, old_count = hash_map->entry_count;
+    struct hash_map_entry *target, *old_entry;
+    void *old_entries = hash_map->entries;
+
+    if (10 * hash_map->used_count >= 7 * hash_map->entry_count)
+    {
+        hash_map->entry_count = old_count ? old_count * 2 + 5 : 37;
+        hash_map->entries = vkd3d_calloc(hash_map->entry_count, hash_map->entry_size);
+
+        for (i = 0; i < old_count; i++)
+        {
+            old_entry = void_ptr_offset(old_entries, i * hash_map->entry_size);
+            if (!(old_entry->flags & HASH_MAP_ENTRY_OCCUPIED))
+                continue;
+
+            entry_idx = old_entry->hash_value % hash_map->entry_count;
+            while (legacy_hash_map_get_entry(hash_map, entry_idx)->flags & HASH_MAP_ENTRY_OCCUPIED)
+                entry_idx = entry_idx + 1 < hash_map->entry_count ? entry_idx + 1 : 0;
+            memcpy(legacy_hash_map_get_entry(hash_map, entry_idx), old_entry, hash_map->entry_size);
+        }
+
+        vkd3d_free(old_entries);
+    }
+
+    hash_value = hash_map->hash_func(key);
+    entry_idx = hash_value % hash_map->entry_count;
+
+    while (true)
+    {
+        target = legacy_hash_map_get_entry(hash_map, entry_idx);
+
+        if (!(target->flags & HASH_MAP_ENTRY_OCCUPIED))
+            break;
+        if (target->hash_value == hash_value && hash_map->compare_func(key, target))
+            return;
+
+        entry_idx = entry_idx + 1 < hash_map->entry_count ? entry_idx + 1 : 0;
+    }
+
+    hash_map->used_count++;
+    target->flags = HASH_MAP_ENTRY_OCCUPIED;
+    target->hash_value = hash_value;
+    memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
+}
+
+/* Keys modelled after vkd3d_view_key, vkd3d_sampler_key and the pipeline library internal keys,
+ * hashed the same way the real maps do it. */
+struct bench_view_key
+{
+    uint64_t image;
+    uint32_t view_type;
+    uint32_t format;
+    uint32_t miplevel_idx;
+    uint32_t miplevel_count;
+    uint32_t layer_idx;
+    uint32_t layer_count;
+};
+
+struct bench_sampler_key
+{
+    uint32_t filter;
+    uint32_t address_u;
+    uint32_t address_v;
+    uint32_t address_w;
+    float mip_lod_bias;
+    uint32_t max_anisotropy;
+    uint32_t comparison_func;
+    float min_lod;
+    float max_lod;
+};
+
+struct bench_pso_key
+{
+    uint64_t internal_key_hash;
+};
+
+union bench_hash_key
+{
+    struct bench_view_key view;
+    struct bench_sampler_key sampler;
+    struct bench_pso_key pso;
+};
+
+struct bench_hash_entry
+{
+    struct hash_map_entry entry;
+    union bench_hash_key key;
+    uint32_t value;
+};
+
+static uint32_t bench_view_key_hash(const void *key)
+{
+    const struct bench_view_key *k = key;
+    uint32_t hash;
+
+    hash = hash_uint64(k->image);
+    hash = hash_combine(hash, k->view_type);
+    hash = hash_combine(hash, k->format);
+    hash = hash_combine(hash, k->miplevel_idx);
+    hash = hash_combine(hash, k->miplevel_count);
+    hash = hash_combine(hash, k->layer_idx);
+    hash = hash_combine(hash, k->layer_count);
+    return hash;
+}
+
+static bool bench_view_key_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct bench_hash_entry *e = (const struct bench_hash_entry *)entry;
+    return !memcmp(key, &e->key.view, sizeof(e->key.view));
+}
+
+static uint32_t bench_sampler_key_hash(const void *key)
+{
+    const struct bench_sampler_key *k = key;
+    uint32_t hash;
+
+    hash = k->filter;
+    hash = hash_combine(hash, k->address_u);
+    hash = hash_combine(hash, k->address_v);
+    hash = hash_combine(hash, k->address_w);
+    hash = hash_combine(hash, float_bits_to_uint32(k->mip_lod_bias));
+    hash = hash_combine(hash, k->max_anisotropy);
+    hash = hash_combine(hash, k->comparison_func);
+    hash = hash_combine(hash, float_bits_to_uint32(k->min_lod));
+    hash = hash_combine(hash, float_bits_to_uint32(k->max_lod));
+    return hash;
+}
+
+static bool bench_sampler_key_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct bench_hash_entry *e = (const struct bench_hash_entry *)entry;
+    return !memcmp(key, &e->key.sampler, sizeof(e->key.sampler));
+}
+
+static uint32_t bench_pso_key_hash(const void *key)
+{
+    const struct bench_pso_key *k = key;
+    return hash_uint64(k->internal_key_hash);
+}
+
+static bool bench_pso_key_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct bench_hash_entry *e = (const struct bench_hash_entry *)entry;
+    return ((const struct bench_pso_key *)key)->internal_key_hash == e->key.pso.internal_key_hash;
+}
+
+enum bench_key_kind
+{
+    BENCH_KEY_VIEW,
+    BENCH_KEY_SAMPLER,
+    BENCH_KEY_PSO,
+};
+
+static uint64_t bench_random(uint64_t *state)
+{
+    /* splitmix64 */
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void bench_generate_key(enum bench_key_kind kind, unsigned int index, uint64_t *seed, union bench_hash_key *key)
+{
+    memset(key, 0, sizeof(*key));
+
+    switch (kind)
+    {
+        case BENCH_KEY_VIEW:
+            /* A handful of views per image. Image handles are heap pointers, so mostly the same upper bits. */
+            key->view.image = 0x7f3a00000000ull + (index / 4) * 0x240ull;
+            key->view.view_type = 1;
+            key->view.format = 37 + (index & 1) * 13;
+            key->view.miplevel_idx = (index >> 1) & 1;
+            key->view.miplevel_count = 1;
+            key->view.layer_count = 1;
+            break;
+
+        case BENCH_KEY_SAMPLER:
+            /* Small enums with a long tail of LOD bias variations. */
+            key->sampler.filter = (index % 4 == 3) ? 0x15 : 0x54 + (index % 4);
+            key->sampler.address_u = 1 + (index / 4) % 4;
+            key->sampler.address_v = key->sampler.address_u;
+            key->sampler.address_w = 1 + (index / 16) % 4;
+            key->sampler.mip_lod_bias = -0.25f * (float)(index / 64);
+            key->sampler.max_anisotropy = 16;
+            key->sampler.max_lod = 1000.0f;
+            break;
+
+        case BENCH_KEY_PSO:
+            key->pso.internal_key_hash = bench_random(seed);
+            break;
+    }
+}
+
+static void test_hash_map_performance(void)
+{
+    static const struct
+    {
+        enum bench_key_kind kind;
+        const char *name;
+        pfn_hash_func hash_func;
+        pfn_hash_compare_func compare_func;
+        unsigned int count;
+    }
+    tests[] =
+    {
+        { BENCH_KEY_VIEW, "view", bench_view_key_hash, bench_view_key_compare, 64 * 1024 },
+        { BENCH_KEY_SAMPLER, "sampler", bench_sampler_key_hash, bench_sampler_key_compare, 2048 },
+        { BENCH_KEY_PSO, "PSO", bench_pso_key_hash, bench_pso_key_compare, 16 * 1024 },
+    };
+
+    double legacy_insert, legacy_hit, legacy_miss, new_insert, new_hit, new_miss, start_time;
+    const unsigned int lookup_count = 1000000;
+    union bench_hash_key *keys, *miss_keys;
+    struct legacy_hash_map legacy_map;
+    struct bench_hash_entry entry;
+    struct hash_map_entry *found;
+    unsigned int i, j, mismatch;
+    struct hash_map map;
+    uint64_t seed;
+    uint32_t sum;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        keys = calloc(tests[i].count, sizeof(*keys));
+        miss_keys = calloc(tests[i].count, sizeof(*miss_keys));
+
+        seed = 1;
+        for (j = 0; j < tests[i].count; j++)
+        {
+            bench_generate_key(tests[i].kind, j, &seed, &keys[j]);
+            bench_generate_key(tests[i].kind, j + tests[i].count, &seed, &miss_keys[j]);
+        }
+
+        memset(&legacy_map, 0, sizeof(legacy_map));
+        legacy_map.hash_func = tests[i].hash_func;
+        legacy_map.compare_func = tests[i].compare_func;
+        legacy_map.entry_size = sizeof(struct bench_hash_entry);
+        hash_map_init(&map, tests[i].hash_func, tests[i].compare_func, sizeof(struct bench_hash_entry));
+
+        memset(&entry, 0, sizeof(entry));
+
+        start_time = get_time();
+        for (j = 0; j < tests[i].count; j++)
+        {
+            entry.key = keys[j];
+            entry.value = j;
+            legacy_hash_map_insert(&legacy_map, &keys[j], &entry.entry);
+        }
+        legacy_insert = get_time() - start_time;
+
+        start_time = get_time();
+        for (j = 0; j < tests[i].count; j++)
+        {
+            entry.key = keys[j];
+            entry.value = j;
+            hash_map_insert(&map, &keys[j], &entry.entry);
+        }
+        new_insert = get_time() - start_time;
+
+        ok(map.used_count == tests[i].count, "Unexpected count %u.\n", map.used_count);
+
+        seed = 2;
+        sum = 0;
+        start_time = get_time();
+        for (j = 0; j < lookup_count; j++)
+        {
+            found = legacy_hash_map_find(&legacy_map, &keys[bench_random(&seed) % tests[i].count]);
+            sum += ((struct bench_hash_entry *)found)->value;
+        }
+        legacy_hit = get_time() - start_time;
+
+        seed = 2;
+        start_time = get_time();
+        for (j = 0; j < lookup_count; j++)
+        {
+            found = hash_map_find(&map, &keys[bench_random(&seed) % tests[i].count]);
+            sum -= ((struct bench_hash_entry *)found)->value;
+        }
+        new_hit = get_time() - start_time;
+        ok(!sum, "Lookup mismatch.\n");
+
+        seed = 3;
+        mismatch = 0;
+        start_time = get_time();
+        for (j = 0; j < lookup_count; j++)
+            mismatch += !!legacy_hash_map_find(&legacy_map, &miss_keys[bench_random(&seed) % tests[i].count]);
+        legacy_miss = get_time() - start_time;
+
+        seed = 3;
+        start_time = get_time();
+        for (j = 0; j < lookup_count; j++)
+            mismatch += !!hash_map_find(&map, &miss_keys[bench_random(&seed) % tests[i].count]);
+        new_miss = get_time() - start_time;
+        ok(!mismatch, "Found %u keys which should not be present.\n", mismatch);
+
+        printf("Hash map (%-7s x %5u): insert %6.2f -> %6.2f ns, hit %6.2f -> %6.2f ns, miss %6.2f -> %6.2f ns.\n",
+                tests[i].name, tests[i].count,
+                1e9 * legacy_insert / tests[i].count, 1e9 * new_insert / tests[i].count,
+                1e9 * legacy_hit / lookup_count, 1e9 * new_hit / lookup_count,
+                1e9 * legacy_miss / lookup_count, 1e9 * new_miss / lookup_count);
+
+        /* Remove every other key, and make sure backward shifting did not lose anything. */
+        for (j = 0; j < tests[i].count; j += 2)
+            hash_map_remove(&map, hash_map_find(&map, &keys[j]));
+
+        mismatch = 0;
+        for (j = 0; j < tests[i].count; j++)
+        {
+            found = hash_map_find(&map, &keys[j]);
+            if ((j & 1) ? !found || ((struct bench_hash_entry *)found)->value != j : !!found)
+                mismatch++;
+        }
+        ok(!mismatch, "Got %u mismatches after removal.\n", mismatch);
+        ok(map.used_count == tests[i].count / 2, "Unexpected count %u.\n", map.used_count);
+
+        hash_map_free(&map);
+        vkd3d_free(legacy_map.entries);
+        free(miss_keys);
+        free(keys);
+    }
+}
+
+static uint64_t shader_hash_fnv1(const void *data, size_t size)
+{
+    const uint8_t *code = data;
+    uint64_t h = hash_fnv1_init();
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        h = hash_fnv1_iterate_u8(h, code[i]);
+
+    return h;
+}
+
+static void test_shader_hash_performance(void)
+{
+    static const size_t blob_sizes[] = { 64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+    static const char spam[] = "Nobody inspects the spammish repetition";
+    const size_t total_bytes = 256 * 1024 * 1024;
+    double fnv_time, xxh_time;
+    uint64_t fnv_sum, xxh_sum;
+    unsigned int i, j, count;
+    uint8_t *blob;
+    uint64_t seed;
+
+    /* Reference values from the XXH64 specification, covering the short and the 4-lane path. */
+    ok(hash_xxh64("", 0, 0) == 0xef46db3751d8e999ull, "Got unexpected XXH64 for empty input.\n");
+    ok(hash_xxh64("abc", 3, 0) == 0x44bc2cf5ad770999ull, "Got unexpected XXH64 for short input.\n");
+    ok(hash_xxh64(spam, strlen(spam), 0) == 0xfbcea83c8a378bf1ull, "Got unexpected XXH64 for long input.\n");
+
+    blob = malloc(blob_sizes[ARRAY_SIZE(blob_sizes) - 1] + 1);
+    seed = 1;
+    for (i = 0; i < blob_sizes[ARRAY_SIZE(blob_sizes) - 1] + 1; i++)
+        blob[i] = bench_random(&seed);
+
+    for (i = 0; i < ARRAY_SIZE(blob_sizes); i++)
+    {
+        count = total_bytes / blob_sizes[i];
+
+        fnv_sum = 0;
+        fnv_time = get_time();
+        for (j = 0; j < count; j++)
+            fnv_sum += shader_hash_fnv1(blob + (j & 1), blob_sizes[i]);
+        fnv_time = get_time() - fnv_time;
+
+        xxh_sum = 0;
+        xxh_time = get_time();
+        for (j = 0; j < count; j++)
+            xxh_sum += hash_xxh64(blob + (j & 1), blob_sizes[i], 0);
+        xxh_time = get_time() - xxh_time;
+
+        /* Also keeps the compiler from discarding either loop. */
+        ok(fnv_sum && xxh_sum, "Got zero checksum, %"PRIu64", %"PRIu64".\n", fnv_sum, xxh_sum);
+
+        printf("Shader hash: %8zu bytes: FNV-1 %7.2f GB/s, XXH64 %7.2f GB/s.\n", blob_sizes[i],
+                1e-9 * (double)count * blob_sizes[i] / fnv_time,
+                1e-9 * (double)count * blob_sizes[i] / xxh_time);
+    }
+
+    free(blob);
+}
+
+/* The row copy loop vkd3d_format_copy_data() used to be. */
+static void subresource_copy_reference(uint8_t *dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+        const uint8_t *src, size_t src_row_pitch, size_t src_slice_pitch,
+        size_t row_size, unsigned int row_count, unsigned int slice_count)
+{
+    unsigned int slice, row;
+
+    for (slice = 0; slice < slice_count; slice++)
+    {
+        for (row = 0; row < row_count; row++)
+        {
+            memcpy(dst + slice * dst_slice_pitch + row * dst_row_pitch,
+                    src + slice * src_slice_pitch + row * src_row_pitch, row_size);
+        }
+    }
+}
+
+static void test_subresource_copy_performance(void)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned int block_size;
+        unsigned int block_extent;
+    }
+    formats[] =
+    {
+        { "R8", 1, 1 },
+        { "RGBA8", 4, 1 },
+        { "RGBA16F", 8, 1 },
+        { "BC1", 8, 4 },
+        { "BC7", 16, 4 },
+        { "RGBA32F", 16, 1 },
+    };
+    static const struct
+    {
+        unsigned int width;
+        unsigned int height;
+        unsigned int depth;
+    }
+    extents[] =
+    {
+        { 256, 256, 1 },
+        { 2048, 2048, 1 },
+        { 4096, 4096, 1 },
+        { 256, 256, 64 },
+    };
+    double reference_time, cached_time, nt_time, start_time;
+    size_t row_size, row_pitch, slice_pitch, size;
+    unsigned int i, j, k, pad, iterations;
+    unsigned int row_count, slice_count;
+    const size_t buffer_size = 96 * 1024 * 1024;
+    uint8_t *src, *dst, *reference;
+
+    src = vkd3d_malloc_aligned(buffer_size, 64);
+    dst = vkd3d_malloc_aligned(buffer_size, 64);
+    reference = vkd3d_malloc_aligned(buffer_size, 64);
+
+    if (!src || !dst || !reference)
+    {
+        skip("Failed to allocate buffers.\n");
+        vkd3d_free_aligned(src);
+        vkd3d_free_aligned(dst);
+        vkd3d_free_aligned(reference);
+        return;
+    }
+
+    for (i = 0; i < buffer_size / sizeof(uint32_t); i++)
+        ((uint32_t *)src)[i] = i * 2654435761u;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(extents); j++)
+        {
+            /* Tight pitches, which merge into one copy, and D3D12's 256 byte pitch alignment
+             * with an extra odd pad, which is what linear UMA textures and app buffers tend to look like. */
+            for (pad = 0; pad < 2; pad++)
+            {
+                row_size = (extents[j].width / formats[i].block_extent) * formats[i].block_size;
+                row_count = extents[j].height / formats[i].block_extent;
+                slice_count = extents[j].depth;
+                row_pitch = pad ? align(row_size, 256) + 256 : row_size;
+                slice_pitch = row_pitch * row_count;
+                size = slice_pitch * slice_count;
+
+                if (size > buffer_size)
+                    continue;
+
+                iterations = max(1u, (unsigned int)((256ull * 1024 * 1024) / size));
+
+                /* Padding between rows is never written, so it has to match up front. */
+                memset(dst, 0, size);
+                memset(reference, 0, size);
+
+                start_time = get_time();
+                for (k = 0; k < iterations; k++)
+                {
+                    subresource_copy_reference(reference, row_pitch, slice_pitch, src, row_pitch, slice_pitch,
+                            row_size, row_count, slice_count);
+                }
+                reference_time = get_time() - start_time;
+
+                start_time = get_time();
+                for (k = 0; k < iterations; k++)
+                    vkd3d_copy_rows(dst, row_pitch, slice_pitch, src, row_pitch, slice_pitch, row_size, row_count, slice_count, 0);
+                cached_time = get_time() - start_time;
+
+                ok(!memcmp(dst, reference, size), "Cached copy mismatch.\n");
+                memset(dst, 0, size);
+
+                start_time = get_time();
+                for (k = 0; k < iterations; k++)
+                {
+                    vkd3d_copy_rows(dst, row_pitch, slice_pitch, src, row_pitch, slice_pitch, row_size, row_count, slice_count,
+                            VKD3D_COPY_ROWS_NON_TEMPORAL);
+                }
+                nt_time = get_time() - start_time;
+
+                ok(!memcmp(dst, reference, size), "Non-temporal copy mismatch.\n");
+
+                printf("Subresource copy: %-7s %4u x %4u x %2u, %s pitch: reference %7.2f, cached %7.2f, non-temporal %7.2f GB/s.\n",
+                        formats[i].name, extents[j].width, extents[j].height, extents[j].depth, pad ? "padded" : "tight ",
+                        1e-9 * (double)size * iterations / reference_time,
+                        1e-9 * (double)size * iterations / cached_time,
+                        1e-9 * (double)size * iterations / nt_time);
+            }
+        }
+    }
+
+    /* Unaligned destinations and odd row sizes go through the head and tail paths of the streaming copy. */
+    for (i = 0; i < 64; i++)
+    {
+        row_size = 1 + i * 37;
+        row_pitch = row_size + i;
+        memset(dst, 0, 64 * row_pitch + 64);
+        memset(reference, 0, 64 * row_pitch + 64);
+        subresource_copy_reference(reference + i, row_pitch, 0, src + 3 * i, row_size, 0, row_size, 64, 1);
+        vkd3d_copy_rows(dst + i, row_pitch, 0, src + 3 * i, row_size, 0, row_size, 64, 1, VKD3D_COPY_ROWS_NON_TEMPORAL);
+        ok(!memcmp(dst, reference, 64 * row_pitch + 64), "Unaligned copy %u mismatch.\n", i);
+    }
+
+    vkd3d_free_aligned(src);
+    vkd3d_free_aligned(dst);
+    vkd3d_free_aligned(reference);
+}
+
+START_TEST(cpu_performance)
+{
+    test_compression_performance(argc, argv);
+    test_pipeline_variant_lookup_performance();
+    test_descriptor_copy_performance();
+    test_memory_allocator_performance();
+    test_hash_map_performance();
+    test_shader_hash_performance();
+    test_subresource_copy_performance();
+}
@@ -97,6 +97,7 @@ decl_test(test_enumerate_meta_commands);
 decl_test(test_map_resource);
 decl_test(test_map_placed_resources);
 decl_test(test_bundle_state_inheritance);
+decl_test(test_bundle_redundant_state);
 decl_test(test_shader_instructions);
 decl_test(test_shader_instructions_dxil);
 decl_test(test_compute_shader_instructions);
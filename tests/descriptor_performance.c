@@ -95,6 +95,46 @@ static void copy_descriptor_heap_single(ID3D12Device *device, ID3D12DescriptorHe
     }
 }
 
+#define SCATTER_BATCH_SIZE 256
+
+/* Emulates a renderer gathering descriptors for a draw with one CopyDescriptors call of single descriptor ranges.
+ * Sources come in runs of run_length adjacent descriptors starting at pseudo-random places in the heap,
+ * and destinations are packed linearly. */
+static void copy_descriptor_heap_scatter(ID3D12Device *device, ID3D12DescriptorHeap *gpu_heap,
+        ID3D12DescriptorHeap *cpu_heap, unsigned int count, unsigned int run_length)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE dst_handles[SCATTER_BATCH_SIZE];
+    D3D12_CPU_DESCRIPTOR_HANDLE src_handles[SCATTER_BATCH_SIZE];
+    D3D12_CPU_DESCRIPTOR_HANDLE gpu, cpu;
+    unsigned int i, j, batch_size, src_index = 0;
+    uint32_t seed = 1;
+    UINT64 increment;
+
+    gpu = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(gpu_heap);
+    cpu = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cpu_heap);
+    increment = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    for (i = 0; i < count; i += batch_size)
+    {
+        batch_size = min(count - i, SCATTER_BATCH_SIZE);
+
+        for (j = 0; j < batch_size; j++)
+        {
+            if ((i + j) % run_length == 0)
+            {
+                seed = seed * 1103515245u + 12345u;
+                src_index = ((uint64_t)seed * (count - run_length)) >> 32;
+            }
+
+            dst_handles[j].ptr = gpu.ptr + (i + j) * increment;
+            src_handles[j].ptr = cpu.ptr + src_index++ * increment;
+        }
+
+        ID3D12Device_CopyDescriptors(device, batch_size, dst_handles, NULL,
+                batch_size, src_handles, NULL, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+}
+
 static void zero_descriptor_heap(ID3D12Device *device, ID3D12DescriptorHeap *heap, unsigned int count)
 {
     D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
@@ -224,6 +264,22 @@ static void do_benchmark_run(ID3D12Device *device)
         printf("Copying 1M individual SRVs to zeroed GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
     }
 
+    /* Scattered copies through CopyDescriptors with single descriptor ranges,
+     * both fully scattered and with adjacent ranges which can be merged. */
+    {
+        static const unsigned int run_lengths[] = { 1, 4, 16 };
+        unsigned int i;
+
+        for (i = 0; i < ARRAY_SIZE(run_lengths); i++)
+        {
+            start_time = get_time();
+            copy_descriptor_heap_scatter(device, gpu_heap, cpu_heap, 1000000, run_lengths[i]);
+            end_time = get_time();
+            printf("Copying 1M SRVs as single ranges, %2u adjacent source ranges, took: %.3f ms.\n",
+                    run_lengths[i], 1e3 * (end_time - start_time));
+        }
+    }
+
     ID3D12Resource_Release(texture);
     ID3D12DescriptorHeap_Release(cpu_heap);
     ID3D12DescriptorHeap_Release(gpu_heap);
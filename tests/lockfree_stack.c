@@ -0,0 +1,181 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Stress test for the lock-free slot stack backing the device scratch buffer pools.
+ * Slots move between two stacks sharing one links array, the same way scratch buffers
+ * move between the free and full stacks. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define VKD3D_TEST_DECLARE_MAIN
+#include "vkd3d_test.h"
+#include "vkd3d_lockfree_stack.h"
+#include "vkd3d_threads.h"
+
+#define LOCKFREE_STACK_TEST_SLOT_COUNT 128
+#define LOCKFREE_STACK_TEST_THREAD_COUNT 8
+#define LOCKFREE_STACK_TEST_ITERATIONS 500000
+#define LOCKFREE_STACK_TEST_MAX_HELD 4
+
+struct lockfree_stack_test_context
+{
+    uint32_t links[LOCKFREE_STACK_TEST_SLOT_COUNT];
+    uint32_t owners[LOCKFREE_STACK_TEST_SLOT_COUNT];
+    UINT64 heads[2];
+};
+
+struct lockfree_stack_test_thread_data
+{
+    struct lockfree_stack_test_context *context;
+    unsigned int thread_index;
+    unsigned int double_owned_count;
+    unsigned int pop_count;
+};
+
+static void *lockfree_stack_test_thread_main(void *userdata)
+{
+    struct lockfree_stack_test_thread_data *data = userdata;
+    struct lockfree_stack_test_context *context = data->context;
+    uint32_t held[LOCKFREE_STACK_TEST_MAX_HELD];
+    unsigned int i, j, held_count;
+    uint32_t rng, index, owner;
+
+    rng = 0x9e3779b9u * (data->thread_index + 1);
+
+    for (i = 0; i < LOCKFREE_STACK_TEST_ITERATIONS; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        held_count = 0;
+
+        /* Hold a few slots at a time so that the links of popped slots get rewritten
+         * while other threads may still be looking at them. */
+        for (j = 0; j < 1 + (rng >> 30); j++)
+        {
+            if ((index = vkd3d_lockfree_stack_pop(&context->heads[(rng >> 8) & 1], context->links)) ==
+                    VKD3D_LOCKFREE_STACK_INVALID)
+                continue;
+
+            owner = vkd3d_atomic_uint32_exchange_explicit(&context->owners[index],
+                    data->thread_index + 1, vkd3d_memory_order_relaxed);
+            if (owner)
+                data->double_owned_count++;
+
+            held[held_count++] = index;
+            data->pop_count++;
+        }
+
+        for (j = 0; j < held_count; j++)
+        {
+            vkd3d_atomic_uint32_store_explicit(&context->owners[held[j]], 0, vkd3d_memory_order_relaxed);
+            vkd3d_lockfree_stack_push(&context->heads[(rng >> (9 + j)) & 1], context->links, held[j]);
+        }
+    }
+
+    return NULL;
+}
+
+static void test_lockfree_stack_single_thread(void)
+{
+    uint32_t links[LOCKFREE_STACK_TEST_SLOT_COUNT];
+    unsigned int i;
+    UINT64 head;
+
+    vkd3d_lockfree_stack_init(&head);
+    ok(vkd3d_lockfree_stack_pop(&head, links) == VKD3D_LOCKFREE_STACK_INVALID, "Expected empty stack.\n");
+
+    for (i = 0; i < LOCKFREE_STACK_TEST_SLOT_COUNT; i++)
+        vkd3d_lockfree_stack_push(&head, links, i);
+
+    for (i = LOCKFREE_STACK_TEST_SLOT_COUNT; i; i--)
+        ok(vkd3d_lockfree_stack_pop(&head, links) == i - 1, "Expected slot %u.\n", i - 1);
+
+    ok(vkd3d_lockfree_stack_pop(&head, links) == VKD3D_LOCKFREE_STACK_INVALID, "Expected empty stack.\n");
+}
+
+static void test_lockfree_stack_threads(void)
+{
+    struct lockfree_stack_test_thread_data thread_data[LOCKFREE_STACK_TEST_THREAD_COUNT];
+    pthread_t threads[LOCKFREE_STACK_TEST_THREAD_COUNT];
+    unsigned int double_owned_count, slot_count, i;
+    struct lockfree_stack_test_context context;
+    bool seen[LOCKFREE_STACK_TEST_SLOT_COUNT];
+    uint64_t pop_count;
+    uint32_t index;
+
+    memset(&context, 0, sizeof(context));
+    memset(seen, 0, sizeof(seen));
+    vkd3d_lockfree_stack_init(&context.heads[0]);
+    vkd3d_lockfree_stack_init(&context.heads[1]);
+
+    /* Start with every slot on the first stack, like the free list of a new scratch pool. */
+    for (i = LOCKFREE_STACK_TEST_SLOT_COUNT; i; i--)
+        vkd3d_lockfree_stack_push(&context.heads[0], context.links, i - 1);
+
+    for (i = 0; i < LOCKFREE_STACK_TEST_THREAD_COUNT; i++)
+    {
+        thread_data[i].context = &context;
+        thread_data[i].thread_index = i;
+        thread_data[i].double_owned_count = 0;
+        thread_data[i].pop_count = 0;
+        ok(!pthread_create(&threads[i], NULL, lockfree_stack_test_thread_main, &thread_data[i]),
+                "Failed to create thread %u.\n", i);
+    }
+
+    double_owned_count = 0;
+    pop_count = 0;
+
+    for (i = 0; i < LOCKFREE_STACK_TEST_THREAD_COUNT; i++)
+    {
+        pthread_join(threads[i], NULL);
+        double_owned_count += thread_data[i].double_owned_count;
+        pop_count += thread_data[i].pop_count;
+    }
+
+    ok(!double_owned_count, "%u slots were popped by two threads at once.\n", double_owned_count);
+    ok(pop_count, "No slots were popped.\n");
+
+    /* Every slot must end up on exactly one of the stacks. */
+    slot_count = 0;
+
+    for (i = 0; i < ARRAY_SIZE(context.heads); i++)
+    {
+        while ((index = vkd3d_lockfree_stack_pop(&context.heads[i], context.links)) != VKD3D_LOCKFREE_STACK_INVALID)
+        {
+            if (index >= LOCKFREE_STACK_TEST_SLOT_COUNT || seen[index])
+            {
+                ok(false, "Got unexpected slot %u.\n", index);
+                break;
+            }
+
+            seen[index] = true;
+            slot_count++;
+        }
+    }
+
+    ok(slot_count == LOCKFREE_STACK_TEST_SLOT_COUNT, "Expected %u slots, got %u.\n",
+            LOCKFREE_STACK_TEST_SLOT_COUNT, slot_count);
+
+    for (i = 0; i < LOCKFREE_STACK_TEST_SLOT_COUNT; i++)
+        ok(!context.owners[i], "Slot %u is still owned by thread %u.\n", i, context.owners[i] - 1);
+}
+
+START_TEST(lockfree_stack)
+{
+    test_lockfree_stack_single_thread();
+    test_lockfree_stack_threads();
+}
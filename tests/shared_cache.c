@@ -0,0 +1,310 @@
+/*
+ * Copyright 2026 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Exercises the cross-process shared cache index with several concurrent local processes. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define VKD3D_TEST_DECLARE_MAIN
+#include "vkd3d_test.h"
+#include "vkd3d_shared_cache.h"
+#include "vkd3d_file_utils.h"
+#include "vkd3d_platform.h"
+
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#define SHARED_CACHE_TEST_SIZE (16u * 1024 * 1024)
+#define SHARED_CACHE_TEST_COMPAT_KEY 0x1234567887654321ull
+#define SHARED_CACHE_TEST_PROCESS_COUNT 8
+#define SHARED_CACHE_TEST_ENTRY_COUNT 4096
+
+static size_t shared_cache_test_entry_size(unsigned int index)
+{
+    return 1 + (index * 2654435761u) % 3000;
+}
+
+static void shared_cache_test_fill_entry(unsigned int index, uint8_t *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        data[i] = (uint8_t)(index * 31 + i * 7);
+}
+
+static uint64_t shared_cache_test_entry_hash(unsigned int index)
+{
+    return 0x9e3779b97f4a7c15ull * (index + 1);
+}
+
+/* Every entry is published by one owning process, and every third entry by all processes at once. */
+static bool shared_cache_test_is_published_by(unsigned int index, unsigned int process)
+{
+    return index % SHARED_CACHE_TEST_PROCESS_COUNT == process || index % 3 == 0;
+}
+
+static bool shared_cache_test_check_entry(const struct vkd3d_shared_cache *cache, unsigned int index, bool *found)
+{
+    uint8_t expected[4096];
+    const void *data;
+    size_t size;
+
+    *found = vkd3d_shared_cache_find(cache, shared_cache_test_entry_hash(index), index & 3, &data, &size);
+    if (!*found)
+        return true;
+
+    shared_cache_test_fill_entry(index, expected, shared_cache_test_entry_size(index));
+    return size == shared_cache_test_entry_size(index) && !memcmp(data, expected, size);
+}
+
+#ifndef _WIN32
+static int shared_cache_test_process_main(const char *path, unsigned int process, int start_fd)
+{
+    struct vkd3d_shared_cache cache;
+    unsigned int i, failures = 0;
+    uint8_t data[4096];
+    bool found;
+    char c;
+
+    /* Wait until every process has been forked so that they all race to create and initialize the file. */
+    if (read(start_fd, &c, 1) < 0)
+        return 1;
+
+    if (!vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, SHARED_CACHE_TEST_SIZE))
+        return 2;
+
+    for (i = 0; i < SHARED_CACHE_TEST_ENTRY_COUNT; i++)
+    {
+        if (shared_cache_test_is_published_by(i, process))
+        {
+            shared_cache_test_fill_entry(i, data, shared_cache_test_entry_size(i));
+            if (!vkd3d_shared_cache_publish(&cache, shared_cache_test_entry_hash(i), i & 3,
+                    data, shared_cache_test_entry_size(i)))
+                failures++;
+        }
+
+        /* Whatever other processes have published so far must never be observed half-written. */
+        if (!shared_cache_test_check_entry(&cache, (i * 7) % SHARED_CACHE_TEST_ENTRY_COUNT, &found))
+            failures++;
+    }
+
+    /* Entries can still be in flight if another process claimed them first,
+     * so completeness is only checked once every process is done. */
+    for (i = 0; i < SHARED_CACHE_TEST_ENTRY_COUNT; i++)
+    {
+        if (!shared_cache_test_check_entry(&cache, i, &found))
+            failures++;
+    }
+
+    if (!process)
+        vkd3d_shared_cache_set_tag(&cache, 0xc0ffee);
+
+    vkd3d_shared_cache_close(&cache);
+    return failures ? 3 : 0;
+}
+
+static void test_shared_cache_processes(const char *path)
+{
+    pid_t pids[SHARED_CACHE_TEST_PROCESS_COUNT];
+    struct vkd3d_shared_cache_stats stats;
+    struct vkd3d_shared_cache cache;
+    unsigned int i, missing;
+    int start_pipe[2];
+    bool found;
+    int status;
+
+    vkd3d_file_delete(path);
+
+    if (pipe(start_pipe) < 0)
+    {
+        skip("Failed to create pipe.\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(pids); i++)
+    {
+        if (!(pids[i] = fork()))
+        {
+            close(start_pipe[1]);
+            _exit(shared_cache_test_process_main(path, i, start_pipe[0]));
+        }
+
+        ok(pids[i] > 0, "Failed to fork process %u.\n", i);
+    }
+
+    /* Closing the write end wakes up every process at once. */
+    close(start_pipe[0]);
+    close(start_pipe[1]);
+
+    for (i = 0; i < ARRAY_SIZE(pids); i++)
+    {
+        if (pids[i] <= 0)
+            continue;
+
+        waitpid(pids[i], &status, 0);
+        ok(WIFEXITED(status) && !WEXITSTATUS(status), "Process %u failed, status %#x.\n", i, status);
+    }
+
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, SHARED_CACHE_TEST_SIZE),
+            "Failed to open shared cache.\n");
+
+    for (i = 0, missing = 0; i < SHARED_CACHE_TEST_ENTRY_COUNT; i++)
+    {
+        ok(shared_cache_test_check_entry(&cache, i, &found), "Entry %u is corrupt.\n", i);
+        if (!found)
+            missing++;
+    }
+
+    ok(!missing, "%u entries are missing.\n", missing);
+
+    vkd3d_shared_cache_get_stats(&cache, &stats);
+    ok(stats.entry_count == SHARED_CACHE_TEST_ENTRY_COUNT, "Got %"PRIu64" entries, expected %u.\n",
+            stats.entry_count, SHARED_CACHE_TEST_ENTRY_COUNT);
+    ok(!stats.failed_publish_count, "Got %u failed publishes.\n", stats.failed_publish_count);
+    ok(vkd3d_shared_cache_get_tag(&cache) == 0xc0ffee, "Got unexpected tag %#"PRIx64".\n",
+            vkd3d_shared_cache_get_tag(&cache));
+
+    vkd3d_shared_cache_close(&cache);
+}
+#endif
+
+static void test_shared_cache_incompatible(const char *path)
+{
+    struct vkd3d_shared_cache_stats stats;
+    struct vkd3d_shared_cache cache;
+    static const uint8_t data[16];
+    bool found;
+
+    vkd3d_file_delete(path);
+
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, SHARED_CACHE_TEST_SIZE),
+            "Failed to open shared cache.\n");
+    ok(vkd3d_shared_cache_publish(&cache, 1, 0, data, sizeof(data)), "Failed to publish entry.\n");
+    ok(vkd3d_shared_cache_publish(&cache, 1, 0, data, sizeof(data)), "Failed to publish duplicate entry.\n");
+    ok(vkd3d_shared_cache_find(&cache, 1, 0, NULL, NULL), "Failed to find entry.\n");
+    ok(!vkd3d_shared_cache_find(&cache, 1, 1, NULL, NULL), "Found entry with wrong type.\n");
+    vkd3d_shared_cache_get_stats(&cache, &stats);
+    ok(stats.entry_count == 1, "Got %"PRIu64" entries.\n", stats.entry_count);
+    vkd3d_shared_cache_close(&cache);
+
+    /* A different driver must not see entries of the previous one. */
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY + 1, SHARED_CACHE_TEST_SIZE),
+            "Failed to recreate shared cache.\n");
+    found = vkd3d_shared_cache_find(&cache, 1, 0, NULL, NULL);
+    ok(!found, "Found stale entry.\n");
+    vkd3d_shared_cache_get_stats(&cache, &stats);
+    ok(!stats.entry_count, "Got %"PRIu64" entries.\n", stats.entry_count);
+    vkd3d_shared_cache_close(&cache);
+
+    vkd3d_file_delete(path);
+}
+
+static void test_shared_cache_full(const char *path)
+{
+    struct vkd3d_shared_cache_stats stats;
+    struct vkd3d_shared_cache cache;
+    unsigned int i, published;
+    uint8_t data[4096];
+    bool found;
+
+    vkd3d_file_delete(path);
+
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, 256 * 1024),
+            "Failed to open shared cache.\n");
+
+    for (i = 0, published = 0; i < 1024; i++)
+    {
+        shared_cache_test_fill_entry(i, data, shared_cache_test_entry_size(i));
+        if (!vkd3d_shared_cache_publish(&cache, shared_cache_test_entry_hash(i), i & 3,
+                data, shared_cache_test_entry_size(i)))
+            break;
+        published++;
+    }
+
+    ok(published && published < 1024, "Published %u entries.\n", published);
+
+    vkd3d_shared_cache_get_stats(&cache, &stats);
+    ok(stats.failed_publish_count == 1, "Got %u failed publishes.\n", stats.failed_publish_count);
+    ok(stats.entry_count == published, "Got %"PRIu64" entries, expected %u.\n", stats.entry_count, published);
+
+    /* Running out of space must not affect existing entries. */
+    for (i = 0; i < published; i++)
+        ok(shared_cache_test_check_entry(&cache, i, &found) && found, "Entry %u is missing or corrupt.\n", i);
+
+    vkd3d_shared_cache_close(&cache);
+    vkd3d_file_delete(path);
+}
+
+static void test_shared_cache_tag(const char *path)
+{
+    struct vkd3d_shared_cache cache;
+    static const uint8_t data[16];
+    const void *blob;
+
+    vkd3d_file_delete(path);
+
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, SHARED_CACHE_TEST_SIZE),
+            "Failed to open shared cache.\n");
+    ok(vkd3d_shared_cache_publish(&cache, 1, 0, data, sizeof(data)), "Failed to publish entry.\n");
+    ok(vkd3d_shared_cache_find(&cache, 1, 0, &blob, NULL), "Failed to find entry.\n");
+    ok(!vkd3d_shared_cache_is_tagged(&cache, blob), "Untagged cache reports entry as tagged.\n");
+
+    /* Only entries published before the tag was set are covered by it. */
+    vkd3d_shared_cache_set_tag(&cache, 0xc0ffee);
+    ok(vkd3d_shared_cache_publish(&cache, 2, 0, data, sizeof(data)), "Failed to publish entry.\n");
+    ok(vkd3d_shared_cache_find(&cache, 1, 0, &blob, NULL), "Failed to find entry.\n");
+    ok(vkd3d_shared_cache_is_tagged(&cache, blob), "Entry published before the tag is not tagged.\n");
+    ok(vkd3d_shared_cache_find(&cache, 2, 0, &blob, NULL), "Failed to find entry.\n");
+    ok(!vkd3d_shared_cache_is_tagged(&cache, blob), "Entry published after the tag is tagged.\n");
+    vkd3d_shared_cache_close(&cache);
+
+    /* The boundary is shared with other users of the table. */
+    ok(vkd3d_shared_cache_open(&cache, path, SHARED_CACHE_TEST_COMPAT_KEY, SHARED_CACHE_TEST_SIZE),
+            "Failed to reopen shared cache.\n");
+    ok(vkd3d_shared_cache_find(&cache, 1, 0, &blob, NULL), "Failed to find entry.\n");
+    ok(vkd3d_shared_cache_is_tagged(&cache, blob), "Entry published before the tag is not tagged.\n");
+    ok(vkd3d_shared_cache_find(&cache, 2, 0, &blob, NULL), "Failed to find entry.\n");
+    ok(!vkd3d_shared_cache_is_tagged(&cache, blob), "Entry published after the tag is tagged.\n");
+    vkd3d_shared_cache_close(&cache);
+
+    vkd3d_file_delete(path);
+}
+
+START_TEST(shared_cache)
+{
+    char path[VKD3D_PATH_MAX];
+    const char *dir;
+
+    if (!(dir = getenv("TMPDIR")))
+        dir = ".";
+
+    snprintf(path, sizeof(path), "%s/vkd3d-shared-cache-test.%u", dir, (unsigned int)getpid());
+
+#ifndef _WIN32
+    test_shared_cache_processes(path);
+#else
+    skip("Multi-process test is not implemented on Windows.\n");
+#endif
+    test_shared_cache_incompatible(path);
+    test_shared_cache_full(path);
+    test_shared_cache_tag(path);
+
+    vkd3d_file_delete(path);
+}